@@ -976,6 +976,8 @@ void CaptureContext::LoadCaptureThreaded(const QString &captureFile, const Repla
     if(Config().EventBrowser_AddFake)
       r->AddFakeMarkers();
 
+    r->SetPrefetchEnabled(Config().Replay_PrefetchEvents);
+
     m_FrameInfo = r->GetFrameInfo();
 
     m_APIProps = r->GetAPIProperties();
@@ -403,6 +403,14 @@ DECLARE_REFLECTION_STRUCT(BugReport);
       "Defaults to ``-1``.");                                                                      \
   CONFIG_SETTING_VAL(public, int, int, LocalProxyAPI, -1)                                          \
                                                                                                    \
+  DOCUMENT(                                                                                        \
+      "``True`` if data for the actions around the current event should be speculatively fetched " \
+      "while the UI is idle, so that stepping to a neighbouring event is faster. This costs some " \
+      "extra replay work and memory.\n"                                                            \
+      "\n"                                                                                         \
+      "Defaults to ``False``.");                                                                   \
+  CONFIG_SETTING_VAL(public, bool, bool, Replay_PrefetchEvents, false)                             \
+                                                                                                   \
   DOCUMENT(                                                                                        \
       "``True`` if the buffer formatter's help section should be shown.\n"                         \
       "\n:"                                                                                        \
@@ -466,16 +466,18 @@ void ReplayManager::run(int proxyRenderer, const QString &capturefile, const Rep
 
   m_Running = true;
 
+  bool prefetchPending = false;
+
   // main render command loop
   while(m_Running)
   {
     InvokeHandle *cmd = NULL;
 
     // wait for the condition to be woken, grab top of current queue,
-    // unlock again.
+    // unlock again. If there's prefetch work pending don't wait, so it can be done while idle.
     {
       QMutexLocker autolock(&m_RenderLock);
-      if(m_RenderQueue.isEmpty())
+      if(m_RenderQueue.isEmpty() && !prefetchPending)
         m_RenderCondition.wait(&m_RenderLock, 10);
 
       if(!m_RenderQueue.isEmpty())
@@ -483,7 +485,15 @@ void ReplayManager::run(int proxyRenderer, const QString &capturefile, const Rep
     }
 
     if(cmd == NULL)
+    {
+      // do one step at a time, so that a real command is never waiting on more than one step
+      if(prefetchPending)
+        prefetchPending = m_Renderer->PrefetchStep();
       continue;
+    }
+
+    // any command could have changed the event, so check for new prefetch work once idle again
+    prefetchPending = true;
 
     if(cmd->method != NULL)
     {
@@ -153,6 +153,7 @@ fail:
 DEFINE_SAFE_EQUALITY(ActionDescription)
 DEFINE_SAFE_EQUALITY(CounterResult)
 DEFINE_SAFE_EQUALITY(APIEvent)
+DEFINE_SAFE_EQUALITY(APICallStatistics)
 DEFINE_SAFE_EQUALITY(Bindpoint)
 DEFINE_SAFE_EQUALITY(BufferDescription)
 DEFINE_SAFE_EQUALITY(CaptureFileFormat)
@@ -162,6 +163,7 @@ DEFINE_SAFE_EQUALITY(EnvironmentModification)
 DEFINE_SAFE_EQUALITY(EventUsage)
 DEFINE_SAFE_EQUALITY(PathEntry)
 DEFINE_SAFE_EQUALITY(PixelModification)
+DEFINE_SAFE_EQUALITY(ResourceDataRequest)
 DEFINE_SAFE_EQUALITY(ResourceDescription)
 DEFINE_SAFE_EQUALITY(ResourceId)
 DEFINE_SAFE_EQUALITY(LineColumnInfo)
@@ -349,11 +349,13 @@ TEMPLATE_ARRAY_INSTANTIATE(rdcarray, float)
 TEMPLATE_ARRAY_INSTANTIATE(rdcarray, uint32_t)
 TEMPLATE_ARRAY_INSTANTIATE(rdcarray, uint64_t)
 TEMPLATE_ARRAY_INSTANTIATE(rdcarray, rdcstr)
+TEMPLATE_ARRAY_INSTANTIATE(rdcarray, bytebuf)
 TEMPLATE_ARRAY_INSTANTIATE(rdcarray, WindowingSystem)
 TEMPLATE_ARRAY_INSTANTIATE(rdcarray, ActionDescription)
 TEMPLATE_ARRAY_INSTANTIATE(rdcarray, GPUCounter)
 TEMPLATE_ARRAY_INSTANTIATE(rdcarray, CounterResult)
 TEMPLATE_ARRAY_INSTANTIATE(rdcarray, APIEvent)
+TEMPLATE_ARRAY_INSTANTIATE(rdcarray, APICallStatistics)
 TEMPLATE_ARRAY_INSTANTIATE(rdcarray, Bindpoint)
 TEMPLATE_ARRAY_INSTANTIATE(rdcarray, BufferDescription)
 TEMPLATE_ARRAY_INSTANTIATE(rdcarray, CaptureFileFormat)
@@ -363,6 +365,7 @@ TEMPLATE_ARRAY_INSTANTIATE(rdcarray, EnvironmentModification)
 TEMPLATE_ARRAY_INSTANTIATE(rdcarray, EventUsage)
 TEMPLATE_ARRAY_INSTANTIATE(rdcarray, PathEntry)
 TEMPLATE_ARRAY_INSTANTIATE(rdcarray, PixelModification)
+TEMPLATE_ARRAY_INSTANTIATE(rdcarray, ResourceDataRequest)
 TEMPLATE_ARRAY_INSTANTIATE(rdcarray, ResourceDescription)
 TEMPLATE_ARRAY_INSTANTIATE(rdcarray, ResourceId)
 TEMPLATE_ARRAY_INSTANTIATE(rdcarray, LineColumnInfo)
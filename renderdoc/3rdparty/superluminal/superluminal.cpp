@@ -23,6 +23,7 @@
  ******************************************************************************/
 
 #include "api/replay/rdcstr.h"
+#include "api/replay/renderdoc_replay.h"
 #include "common/common.h"
 #include "common/globalconfig.h"
 #include "os/os_specific.h"
@@ -98,12 +99,16 @@ void Init()
 
   if(ret != 1)
     RDCEraseEl(funcTable);
+
+  // superluminal consumes every profile region for as long as it's loaded
+  if(funcTable.BeginEvent)
+    Atomic::Inc32(&RENDERDOC_ProfileRegionsActive);
 }
 
-void BeginProfileRange(const rdcstr &name)
+void BeginProfileRange(const char *name)
 {
   if(funcTable.BeginEvent)
-    funcTable.BeginEvent("RenderDoc", name.c_str(), PERFORMANCEAPI_DEFAULT_COLOR);
+    funcTable.BeginEvent("RenderDoc", name, PERFORMANCEAPI_DEFAULT_COLOR);
 }
 
 void EndProfileRange()
@@ -587,6 +587,64 @@ struct NewChildData
 
 DECLARE_REFLECTION_STRUCT(NewChildData);
 
+DOCUMENT("The overhead added by RenderDoc to one intercepted API entry point in a target.");
+struct APICallStatistics
+{
+  DOCUMENT("");
+  APICallStatistics() = default;
+  APICallStatistics(const APICallStatistics &) = default;
+  APICallStatistics &operator=(const APICallStatistics &) = default;
+
+  bool operator==(const APICallStatistics &o) const
+  {
+    return name == o.name && capturing == o.capturing && callCount == o.callCount &&
+           totalMicroseconds == o.totalMicroseconds && driverMicroseconds == o.driverMicroseconds &&
+           serialisedBytes == o.serialisedBytes;
+  }
+  bool operator<(const APICallStatistics &o) const
+  {
+    if(!(name == o.name))
+      return name < o.name;
+    if(!(capturing == o.capturing))
+      return capturing < o.capturing;
+    if(!(callCount == o.callCount))
+      return callCount < o.callCount;
+    if(!(totalMicroseconds == o.totalMicroseconds))
+      return totalMicroseconds < o.totalMicroseconds;
+    if(!(driverMicroseconds == o.driverMicroseconds))
+      return driverMicroseconds < o.driverMicroseconds;
+    if(!(serialisedBytes == o.serialisedBytes))
+      return serialisedBytes < o.serialisedBytes;
+    return false;
+  }
+
+  DOCUMENT("The name of the entry point.");
+  rdcstr name;
+
+  DOCUMENT(R"(``True`` if these calls were made while a frame capture was in progress, ``False`` if
+they were made while idle.
+)");
+  bool capturing = false;
+
+  DOCUMENT("The number of calls made to the entry point.");
+  uint64_t callCount = 0;
+
+  DOCUMENT(R"(The total time spent in the intercepted entry point in microseconds, including
+RenderDoc's own work and the call into the driver.
+)");
+  double totalMicroseconds = 0.0;
+
+  DOCUMENT(R"(The time spent calling into the driver in microseconds, where it is measured. The
+difference to :data:`totalMicroseconds` is the overhead added by RenderDoc.
+)");
+  double driverMicroseconds = 0.0;
+
+  DOCUMENT("The number of bytes serialised by calls to the entry point.");
+  uint64_t serialisedBytes = 0;
+};
+
+DECLARE_REFLECTION_STRUCT(APICallStatistics);
+
 DOCUMENT("A message from a target control connection.");
 struct TargetControlMessage
 {
@@ -631,6 +689,15 @@ or has finished, it will be -1.0
 
   DOCUMENT("The number of the capturable windows");
   uint32_t capturableWindowCount = 0;
+
+  DOCUMENT("The local path where a copied profile trace was written.");
+  rdcstr profileTrace;
+
+  DOCUMENT(R"(The per-entry-point call statistics, summed since counting was first enabled.
+
+:type: List[APICallStatistics]
+)");
+  rdcarray<APICallStatistics> callStatistics;
 };
 
 DECLARE_REFLECTION_STRUCT(TargetControlMessage);
@@ -977,4 +1044,5 @@ DECLARE_REFLECTION_STRUCT(ExecuteResult);
 // name.
 typedef std::function<bool()> RENDERDOC_KillCallback;
 typedef std::function<void(float)> RENDERDOC_ProgressCallback;
+typedef std::function<void(uint32_t, const bytebuf &)> RENDERDOC_ResourceDataCallback;
 typedef std::function<WindowingData(bool, const rdcarray<WindowingSystem> &)> RENDERDOC_PreviewWindowCallback;
@@ -1576,6 +1576,59 @@ an array slice.
 
 DECLARE_REFLECTION_STRUCT(Subresource);
 
+DOCUMENT(R"(Describes one range of buffer or texture data to fetch at a particular event, for use
+with :meth:`ReplayController.FetchResourceData`.
+)");
+struct ResourceDataRequest
+{
+  DOCUMENT("");
+  ResourceDataRequest() = default;
+  ResourceDataRequest(const ResourceDataRequest &) = default;
+  ResourceDataRequest &operator=(const ResourceDataRequest &) = default;
+
+  bool operator==(const ResourceDataRequest &o) const
+  {
+    return eventId == o.eventId && resourceId == o.resourceId && subresource == o.subresource &&
+           byteOffset == o.byteOffset && byteSize == o.byteSize;
+  }
+  bool operator<(const ResourceDataRequest &o) const
+  {
+    if(!(eventId == o.eventId))
+      return eventId < o.eventId;
+    if(!(resourceId == o.resourceId))
+      return resourceId < o.resourceId;
+    if(!(subresource == o.subresource))
+      return subresource < o.subresource;
+    if(!(byteOffset == o.byteOffset))
+      return byteOffset < o.byteOffset;
+    if(!(byteSize == o.byteSize))
+      return byteSize < o.byteSize;
+    return false;
+  }
+
+  DOCUMENT(R"(The :data:`eventId <APIEvent.eventId>` to fetch the data at. As with
+:meth:`ReplayController.SetFrameEvent` the data is fetched as it is immediately after this event.
+)");
+  uint32_t eventId = 0;
+
+  DOCUMENT("The :class:`ResourceId` of the buffer or texture to fetch data from.");
+  ResourceId resourceId;
+
+  DOCUMENT(R"(For textures, the subresource to fetch.
+
+:type: Subresource
+)");
+  Subresource subresource;
+
+  DOCUMENT("For buffers, the byte offset to the start of the range to fetch.");
+  uint64_t byteOffset = 0;
+
+  DOCUMENT("For buffers, the length of the range, or 0 to fetch the rest of the buffer.");
+  uint64_t byteSize = 0;
+};
+
+DECLARE_REFLECTION_STRUCT(ResourceDataRequest);
+
 DOCUMENT(R"(Describes the properties of an action.
 
 An action is a call such as a draw, a compute dispatch, clears, copies, resolves, etc. Any GPU event
@@ -34,6 +34,7 @@ void RENDERDOC_OutOfMemory(uint64_t sz);
 #endif
 
 class rdcinflexiblestr;
+struct SDObjectArena;
 
 // special type for storing literals. This allows functions to force callers to pass them literals
 class rdcliteral
@@ -47,6 +48,9 @@ class rdcliteral
   // similarly friend inflexible strings to allow them to decompose to a literal
   friend class rdcinflexiblestr;
 
+  // structured data arenas hand out interned strings that live as long as the objects using them
+  friend struct SDObjectArena;
+
   rdcliteral(const char *s, size_t l) : str(s), len(l) {}
   rdcliteral() = delete;
 
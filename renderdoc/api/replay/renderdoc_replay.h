@@ -392,6 +392,16 @@ well as control the replay and analysis functionality available.
 
   :param float progress: The latest progress amount.
 
+.. function:: ResourceDataCallback()
+
+  Not an actual member function - the signature for any ``ResourceDataCallback`` callbacks.
+
+  Called by :meth:`ReplayController.FetchResourceData` with the data for one request as soon as it
+  is available.
+
+  :param int index: The index of the request in the list that was passed in.
+  :param bytes data: The data that was fetched for the request.
+
 .. function:: PreviewWindowCallback()
 
   Not an actual member function - the signature for any ``PreviewWindowCallback`` callbacks.
@@ -471,6 +481,34 @@ function must be called from another thread.
 )");
   virtual void SetFrameEvent(uint32_t eventId, bool force) = 0;
 
+  DOCUMENT(R"(Enable or disable speculative prefetching of data for actions near the current event.
+
+When enabled, each call to :meth:`SetFrameEvent` plans a small amount of work for the actions
+immediately after and before the new event. That work is only done when :meth:`PrefetchStep` is
+called, so the caller controls when idle time is spent on it.
+
+Prefetched pipeline states, output min/max values and post-transform data are kept in bounded caches
+so that a later :meth:`SetFrameEvent` to one of those events returns more quickly.
+
+Disabling prefetching discards any pending work and cached results.
+
+:param bool enabled: ``True`` if prefetching should be enabled.
+)");
+  virtual void SetPrefetchEnabled(bool enabled) = 0;
+
+  DOCUMENT(R"(Perform one unit of any pending prefetch work planned by :meth:`SetFrameEvent`.
+
+This should be called when the caller is otherwise idle. Each step replays to a single nearby
+event, fetches its data, then replays back to the current event. A step can't be interrupted once
+started, so a call made while one is running can wait for up to two partial replays of the frame
+plus the fetch. Callers that need to stay responsive should only call this after checking that no
+other work is waiting.
+
+:return: ``True`` if there is more prefetch work pending, ``False`` if there is nothing left to do.
+:rtype: bool
+)");
+  virtual bool PrefetchStep() = 0;
+
   DOCUMENT(R"(Retrieve the current :class:`D3D11State` pipeline state.
 
 The return value will be ``None`` if the capture is not using the D3D11 API.
@@ -1018,6 +1056,32 @@ texture to something compatible with the target file format.
 )");
   virtual bytebuf GetTextureData(ResourceId tex, const Subresource &sub) = 0;
 
+  DOCUMENT(R"(Retrieve the contents of several buffer ranges or texture subresources, each at
+its own event.
+
+This gives the same data as calling :meth:`SetFrameEvent` and then :meth:`GetBufferData` or
+:meth:`GetTextureData` for each request. Where the driver supports it, the frame is replayed once
+and each resource is copied aside at its event, instead of replaying and reading back separately
+for every request.
+
+The data copied aside is limited to :paramref:`memoryCap` bytes. If more is requested, the replay
+is split into as many passes as needed. If :paramref:`callback` is given, each result is passed to
+it as soon as it is available and then discarded, so the data does not all need to be held at once.
+
+The current event is unchanged after this call.
+
+:param List[ResourceDataRequest] requests: The data to fetch.
+:param int memoryCap: The maximum number of bytes to copy aside in one pass, or 0 for no limit.
+:param ResourceDataCallback callback: A callback that will be called with each result, or ``None``
+  to return all the results together.
+:return: The contents for each request in the same order as :paramref:`requests`, or an empty
+  list if :paramref:`callback` was given.
+:rtype: List[bytes]
+)");
+  virtual rdcarray<bytebuf> FetchResourceData(const rdcarray<ResourceDataRequest> &requests,
+                                              uint64_t memoryCap,
+                                              RENDERDOC_ResourceDataCallback callback) = 0;
+
   static const uint32_t NoPreference = ~0U;
 
 protected:
@@ -1127,6 +1191,36 @@ The details of the types of messages that can be received are listed under
   DOCUMENT("Cycle the currently active window if there are more windows to capture.");
   virtual void CycleActiveWindow() = 0;
 
+  DOCUMENT(R"(Start or stop recording internal profile regions on the target. Regions recorded so
+far are kept when recording stops.
+
+:param bool enabled: ``True`` to start recording, ``False`` to stop.
+)");
+  virtual void SetProfileRecording(bool enabled) = 0;
+
+  DOCUMENT(R"(Begin copying the profile regions recorded on the target to the local machine, as a
+Chrome trace JSON file that can be opened in ``chrome://tracing`` or the Perfetto UI.
+
+A :data:`TargetControlMessageType.ProfileTraceCopied` message is received once it's written.
+
+:param str localpath: The absolute path on the local system where the trace should be saved.
+)");
+  virtual void CopyProfileTrace(const rdcstr &localpath) = 0;
+
+  DOCUMENT(R"(Start or stop counting the calls made to each intercepted API entry point on the
+target, with the time spent in them. Counts so far are kept when counting stops.
+
+:param bool enabled: ``True`` to start counting, ``False`` to stop.
+)");
+  virtual void SetCallStatisticsEnabled(bool enabled) = 0;
+
+  DOCUMENT(R"(Request the current call statistics from the target.
+
+A :data:`TargetControlMessageType.CallStatistics` message is received with the statistics, in
+:data:`TargetControlMessage.callStatistics`.
+)");
+  virtual void RequestCallStatistics() = 0;
+
 protected:
   ITargetControl() = default;
   ~ITargetControl() = default;
@@ -2266,12 +2360,22 @@ extern "C" RENDERDOC_API int RENDERDOC_CC RENDERDOC_RunFunctionalTests(int pytho
 #if !defined(SWIG)
 #include "version.h"
 
-DOCUMENT("INTERNAL: Begin a profile region.");
-extern "C" RENDERDOC_API void RENDERDOC_CC RENDERDOC_BeginProfileRegion(const rdcstr &name);
+DOCUMENT(R"(INTERNAL: Begin a profile region. The name must stay valid until profile data is written
+out, e.g. a string literal.)");
+extern "C" RENDERDOC_API void RENDERDOC_CC RENDERDOC_BeginProfileRegion(const char *name);
 
 DOCUMENT("INTERNAL: End a profile region.");
 extern "C" RENDERDOC_API void RENDERDOC_CC RENDERDOC_EndProfileRegion();
 
+DOCUMENT("INTERNAL: Non-zero while anything is consuming profile regions.");
+extern "C" RENDERDOC_API int32_t RENDERDOC_ProfileRegionsActive;
+
+DOCUMENT("INTERNAL: Start or stop recording profile regions with the built-in profiler.");
+extern "C" RENDERDOC_API void RENDERDOC_CC RENDERDOC_SetProfileRecording(bool enabled);
+
+DOCUMENT("INTERNAL: Write the recorded profile regions to a file as Chrome trace JSON.");
+extern "C" RENDERDOC_API bool RENDERDOC_CC RENDERDOC_WriteProfileTrace(const rdcstr &filename);
+
 // don't define profile regions in stable builds
 #if RENDERDOC_STABLE_BUILD
 
@@ -2279,10 +2383,23 @@ extern "C" RENDERDOC_API void RENDERDOC_CC RENDERDOC_EndProfileRegion();
 
 #else
 
+// when nothing is consuming profile regions this costs only a check of
+// RENDERDOC_ProfileRegionsActive
 struct RENDERDOC_ProfileRegion
 {
-  RENDERDOC_ProfileRegion(const rdcstr &name) { RENDERDOC_BeginProfileRegion(name); }
-  ~RENDERDOC_ProfileRegion() { RENDERDOC_EndProfileRegion(); }
+  RENDERDOC_ProfileRegion(const char *name) : active(RENDERDOC_ProfileRegionsActive != 0)
+  {
+    if(active)
+      RENDERDOC_BeginProfileRegion(name);
+  }
+  ~RENDERDOC_ProfileRegion()
+  {
+    if(active)
+      RENDERDOC_EndProfileRegion();
+  }
+
+  // a region that was begun is always ended, even if profiling stops in between
+  bool active;
 };
 
 #define RENDERDOC_PROFILEREGION(name) RENDERDOC_ProfileRegion profile##__LINE__(name);
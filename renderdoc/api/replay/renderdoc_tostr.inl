@@ -1042,6 +1042,8 @@ rdcstr DoStringise(const SectionType &el)
     STRINGISE_ENUM_CLASS_NAMED(EditedShaders, "renderdoc/ui/edits");
     STRINGISE_ENUM_CLASS_NAMED(D3D12Core, "renderdoc/internal/d3d12core");
     STRINGISE_ENUM_CLASS_NAMED(D3D12SDKLayers, "renderdoc/internal/d3d12sdklayers");
+    STRINGISE_ENUM_CLASS_NAMED(Blobs, "renderdoc/internal/blobs");
+    STRINGISE_ENUM_CLASS_NAMED(IncrementalContents, "renderdoc/internal/incrementalcontents");
   }
   END_ENUM_STRINGISE();
 }
@@ -1100,6 +1102,7 @@ rdcstr DoStringise(const SectionFlags &el)
     STRINGISE_BITFIELD_CLASS_BIT_NAMED(ASCIIStored, "Stored as ASCII");
     STRINGISE_BITFIELD_CLASS_BIT_NAMED(LZ4Compressed, "Compressed with LZ4");
     STRINGISE_BITFIELD_CLASS_BIT_NAMED(ZstdCompressed, "Compressed with Zstd");
+    STRINGISE_BITFIELD_CLASS_BIT_NAMED(Seekable, "Seekable blocks");
   }
   END_BITFIELD_STRINGISE();
 }
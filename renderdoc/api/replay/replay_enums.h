@@ -110,6 +110,21 @@ version of RenderDoc that addes a new section type. They should be considered eq
   This section contains an internal copy of D3D12SDKLayers for replaying.
 
   The name for this section will be "renderdoc/internal/d3d12sdklayers".
+
+.. data:: Blobs
+
+  This section contains large byte buffers from the :data:`FrameCapture` section, each stored once
+  even if the capture contains it several times. The frame capture refers to them by hash.
+
+  The name for this section will be "renderdoc/internal/blobs".
+
+.. data:: IncrementalContents
+
+  This section contains resource contents that are stored incrementally, holding only what changed
+  since an earlier capture along with that capture's filename. The earlier captures are needed to
+  read the full contents.
+
+  The name for this section will be "renderdoc/internal/incrementalcontents".
 )");
 enum class SectionType : uint32_t
 {
@@ -126,6 +141,8 @@ enum class SectionType : uint32_t
   EditedShaders,
   D3D12Core,
   D3D12SDKLayers,
+  Blobs,
+  IncrementalContents,
   Count,
 };
 
@@ -3744,6 +3761,14 @@ DOCUMENT(R"(The type of message received from or sent to an application target c
 .. data:: CapturableWindowCount
 
   The number of capturable windows has changed.
+
+.. data:: ProfileTraceCopied
+
+  A trace of the target's profile regions was copied across the connection.
+
+.. data:: CallStatistics
+
+  The target's per-entry-point call statistics were received.
 )");
 enum class TargetControlMessageType : uint32_t
 {
@@ -3756,7 +3781,9 @@ enum class TargetControlMessageType : uint32_t
   RegisterAPI,
   NewChild,
   CaptureProgress,
-  CapturableWindowCount
+  CapturableWindowCount,
+  ProfileTraceCopied,
+  CallStatistics,
 };
 
 DECLARE_REFLECTION_ENUM(TargetControlMessageType);
@@ -4023,6 +4050,12 @@ DOCUMENT(R"(A set of flags describing the properties of a section in a renderdoc
 .. data:: ZstdCompressed
 
   This section is compressed with Zstd on disk.
+
+.. data:: Seekable
+
+  This section is compressed in independent blocks followed by a block index, so that it can be
+  decompressed from any offset and in parallel. Only meaningful along with :data:`LZ4Compressed` or
+  :data:`ZstdCompressed`.
 )");
 enum class SectionFlags : uint32_t
 {
@@ -4030,6 +4063,7 @@ enum class SectionFlags : uint32_t
   ASCIIStored = 0x1,
   LZ4Compressed = 0x2,
   ZstdCompressed = 0x4,
+  Seekable = 0x8,
 };
 
 BITMASK_OPERATORS(SectionFlags);
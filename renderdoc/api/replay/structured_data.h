@@ -495,8 +495,8 @@ struct SDObject
 
   /////////////////////////////////////////////////////////////////
   // memory management, in a dll safe way
-  void *operator new(size_t sz) { return SDObject::alloc(sz); }
-  void operator delete(void *p) { SDObject::dealloc(p); }
+  void *operator new(size_t sz) { return SDObject::allocObject(sz); }
+  void operator delete(void *p) { SDObject::freeObject(p); }
   void *operator new[](size_t count) = delete;
   void operator delete[](void *p) = delete;
 
@@ -533,10 +533,10 @@ struct SDObject
   SDObject *Duplicate() const
   {
     SDObject *ret = new SDObject();
-    ret->name = name;
+    ret->name = CopyString(name);
     ret->type = type;
     ret->data.basic = data.basic;
-    ret->data.str = data.str;
+    ret->data.str = CopyString(data.str);
 
     if(m_Lazy)
     {
@@ -989,7 +989,39 @@ protected:
 #endif
   }
 
+  // heap allocated objects are prefixed with a header noting whether they came from an arena, so
+  // that delete knows whether to free the storage. The arena writes the same header.
+  static const size_t AllocHeaderSize = sizeof(uint64_t);
+
+  static void *allocObject(size_t sz)
+  {
+    byte *ret = (byte *)alloc(sz + AllocHeaderSize);
+    *(uint64_t *)ret = 0;
+    return ret + AllocHeaderSize;
+  }
+  static void freeObject(void *p)
+  {
+    if(p == NULL)
+      return;
+    byte *base = (byte *)p - AllocHeaderSize;
+    if(*(uint64_t *)base == 0)
+      dealloc(base);
+  }
+
+  // strings on arena objects may be interned in the arena, so they're copied into their own
+  // storage when duplicating. Otherwise the copy would dangle once the arena's file is destroyed.
+  rdcinflexiblestr CopyString(const rdcinflexiblestr &str) const
+  {
+    if(m_Arena)
+      return rdcstr(str.c_str());
+    return str;
+  }
+
 private:
+  friend struct SDObjectArena;
+
+  // set by the arena on objects it allocates, NULL for objects on the heap or stack
+  SDObjectArena *m_Arena = NULL;
   SDObject *m_Parent = NULL;
   mutable LazyArrayData *m_Lazy = NULL;
 
@@ -1357,27 +1389,7 @@ DOCUMENT("Defines a single structured chunk, which is a :class:`SDObject`.");
 struct SDChunk : public SDObject
 {
   /////////////////////////////////////////////////////////////////
-  // memory management, in a dll safe way
-  void *operator new(size_t sz)
-  {
-    void *ret = NULL;
-#ifdef RENDERDOC_EXPORTS
-    ret = malloc(sz);
-    if(ret == NULL)
-      RENDERDOC_OutOfMemory(sz);
-#else
-    ret = RENDERDOC_AllocArrayMem(sz);
-#endif
-    return ret;
-  }
-  void operator delete(void *p)
-  {
-#ifdef RENDERDOC_EXPORTS
-    free(p);
-#else
-    RENDERDOC_FreeArrayMem(p);
-#endif
-  }
+  // memory management is inherited from SDObject
   void *operator new[](size_t count) = delete;
   void operator delete[](void *p) = delete;
 
@@ -1395,11 +1407,11 @@ struct SDChunk : public SDObject
   SDChunk *Duplicate() const
   {
     SDChunk *ret = new SDChunk();
-    ret->name = name;
+    ret->name = CopyString(name);
     ret->metadata = metadata;
     ret->type = type;
     ret->data.basic = data.basic;
-    ret->data.str = data.str;
+    ret->data.str = CopyString(data.str);
 
     ret->data.children.resize(data.children.size());
 
@@ -1528,11 +1540,18 @@ public:
   SDFile() {}
   ~SDFile()
   {
+    // chunks allocated from the arena only run their destructors here, the arena itself is freed
+    // afterwards
     for(SDChunk *chunk : chunks)
       delete chunk;
 
     for(bytebuf *buf : buffers)
       delete buf;
+
+#if !defined(SWIG)
+    if(arena)
+      freeArena(arena);
+#endif
   }
 
   DOCUMENT(R"(The chunks in the file in order.
@@ -1550,6 +1569,15 @@ public:
   DOCUMENT("The version of this structured stream, typically only used internally.");
   uint64_t version = 0;
 
+#if !defined(SWIG)
+  // storage for chunks and objects created by the serialiser. It moves with the chunks when files
+  // are swapped, so objects allocated from it must not be moved to another file individually.
+  // Duplicate them instead, which copies any strings interned in the arena.
+  // The arena is internal, so it's freed through a function set by whoever created it.
+  SDObjectArena *arena = NULL;
+  void (*freeArena)(SDObjectArena *arena) = NULL;
+#endif
+
   DOCUMENT(R"(Swaps the contents of this file with another.
 
 :param SDFile other: The other file to swap with.
@@ -1559,6 +1587,10 @@ public:
     chunks.swap(other.chunks);
     buffers.swap(other.buffers);
     std::swap(version, other.version);
+#if !defined(SWIG)
+    std::swap(arena, other.arena);
+    std::swap(freeArena, other.freeArena);
+#endif
   }
 
 protected:
@@ -0,0 +1,398 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+
+#include "common/call_stats.h"
+#include "common/formatting.h"
+#include "common/threading.h"
+
+namespace CallStats
+{
+struct Counters
+{
+  uint64_t calls;
+  uint64_t totalTicks;
+  uint64_t driverTicks;
+  uint64_t serialisedBytes;
+};
+
+struct ThreadCounters
+{
+  // the innermost counted call in progress on this thread, if any
+  Counters *current;
+  // indexed by whether a capture was active, then by entry point. Only written by the owning thread
+  Counters counters[2][MaxEntryPoints];
+};
+
+int32_t Enabled = 0;
+};
+
+namespace
+{
+bool capturing = false;
+
+Threading::CriticalSection entryLock;
+rdcarray<const char *> entryNames;
+
+// tables are never freed, so that counts from threads that have exited are still gathered
+Threading::CriticalSection threadsLock;
+rdcarray<CallStats::ThreadCounters *> threads;
+
+bool tlsAllocated = false;
+uint64_t tlsSlot = 0;
+
+CallStats::ThreadCounters *GetThreadCounters()
+{
+  CallStats::ThreadCounters *t = (CallStats::ThreadCounters *)Threading::GetTLSValue(tlsSlot);
+
+  if(t)
+    return t;
+
+  t = new CallStats::ThreadCounters;
+  memset(t, 0, sizeof(CallStats::ThreadCounters));
+
+  Threading::SetTLSValue(tlsSlot, t);
+
+  SCOPED_LOCK(threadsLock);
+  threads.push_back(t);
+
+  return t;
+}
+
+CallStats::Counters *GetCurrentCall()
+{
+  if(!tlsAllocated)
+    return NULL;
+
+  CallStats::ThreadCounters *t = (CallStats::ThreadCounters *)Threading::GetTLSValue(tlsSlot);
+  return t ? t->current : NULL;
+}
+};
+
+namespace CallStats
+{
+void SetEnabled(bool enabled)
+{
+  SCOPED_LOCK(threadsLock);
+
+  if(enabled == IsEnabled())
+    return;
+
+  if(enabled)
+  {
+    if(!tlsAllocated)
+    {
+      tlsSlot = Threading::AllocateTLSSlot();
+      tlsAllocated = true;
+    }
+
+    Atomic::Inc32(&Enabled);
+  }
+  else
+  {
+    Atomic::Dec32(&Enabled);
+  }
+}
+
+void SetCapturing(bool capture)
+{
+  capturing = capture;
+}
+
+EntryPoint Register(const char *name)
+{
+  SCOPED_LOCK(entryLock);
+
+  // the same entry point can be counted from several places, e.g. aliased functions
+  for(size_t i = 0; i < entryNames.size(); i++)
+    if(entryNames[i] == name || !strcmp(entryNames[i], name))
+      return EntryPoint(i);
+
+  if(entryNames.size() >= MaxEntryPoints)
+  {
+    RDCWARN("Too many entry points registered, not counting calls to %s", name);
+    return InvalidEntryPoint;
+  }
+
+  entryNames.push_back(name);
+  return EntryPoint(entryNames.size() - 1);
+}
+
+void RecordDriverTicks(uint64_t ticks)
+{
+  Counters *c = GetCurrentCall();
+  if(c)
+    c->driverTicks += ticks;
+}
+
+void RecordSerialisedBytes(uint64_t bytes)
+{
+  Counters *c = GetCurrentCall();
+  if(c)
+    c->serialisedBytes += bytes;
+}
+
+void ScopedCall::Begin(EntryPoint entry)
+{
+  // the TLS slot is allocated before counting is enabled
+  m_Thread = GetThreadCounters();
+  m_Counters = &m_Thread->counters[capturing ? 1 : 0][entry];
+  m_Outer = m_Thread->current;
+  m_Thread->current = m_Counters;
+  m_Start = Timing::GetTick();
+}
+
+void ScopedCall::End()
+{
+  m_Counters->totalTicks += Timing::GetTick() - m_Start;
+  m_Counters->calls++;
+  m_Thread->current = m_Outer;
+}
+
+rdcarray<APICallStatistics> Gather()
+{
+  rdcarray<const char *> names;
+  {
+    SCOPED_LOCK(entryLock);
+    names = entryNames;
+  }
+
+  // idle counts for every entry point, followed by capturing counts
+  rdcarray<Counters> totals;
+  totals.resize(names.size() * 2);
+  memset(totals.data(), 0, totals.byteSize());
+
+  {
+    SCOPED_LOCK(threadsLock);
+    for(ThreadCounters *t : threads)
+    {
+      for(int c = 0; c < 2; c++)
+      {
+        for(size_t i = 0; i < names.size(); i++)
+        {
+          const Counters &src = t->counters[c][i];
+          Counters &dst = totals[c * names.size() + i];
+          dst.calls += src.calls;
+          dst.totalTicks += src.totalTicks;
+          dst.driverTicks += src.driverTicks;
+          dst.serialisedBytes += src.serialisedBytes;
+        }
+      }
+    }
+  }
+
+  const double microPerTick = 1000.0 / Timing::GetTickFrequency();
+
+  rdcarray<APICallStatistics> ret;
+  for(int c = 0; c < 2; c++)
+  {
+    for(size_t i = 0; i < names.size(); i++)
+    {
+      const Counters &total = totals[c * names.size() + i];
+      if(total.calls == 0)
+        continue;
+
+      APICallStatistics stats;
+      stats.name = names[i];
+      stats.capturing = (c == 1);
+      stats.callCount = total.calls;
+      stats.totalMicroseconds = double(total.totalTicks) * microPerTick;
+      stats.driverMicroseconds = double(total.driverTicks) * microPerTick;
+      stats.serialisedBytes = total.serialisedBytes;
+      ret.push_back(stats);
+    }
+  }
+
+  return ret;
+}
+
+void Reset()
+{
+  SCOPED_LOCK(threadsLock);
+  for(ThreadCounters *t : threads)
+    memset(t->counters, 0, sizeof(t->counters));
+}
+};
+
+#if ENABLED(ENABLE_UNIT_TESTS)
+
+#include "catch/catch.hpp"
+
+TEST_CASE("Call statistics are counted per entry point", "[callstats]")
+{
+  CallStats::Reset();
+  CallStats::SetCapturing(false);
+  CallStats::SetEnabled(true);
+
+  CallStats::EntryPoint a = CallStats::Register("TestCallA");
+  CallStats::EntryPoint b = CallStats::Register("TestCallB");
+
+  auto find = [](const char *name, bool capture) {
+    APICallStatistics ret;
+    for(const APICallStatistics &stats : CallStats::Gather())
+      if(stats.name == name && stats.capturing == capture)
+        ret = stats;
+    return ret;
+  };
+
+  SECTION("Entry points are registered once by name")
+  {
+    CHECK(a != b);
+    CHECK(a != CallStats::InvalidEntryPoint);
+
+    char name[] = "TestCallA";
+    CHECK(CallStats::Register(name) == a);
+  }
+
+  SECTION("Calls are counted")
+  {
+    for(int i = 0; i < 3; i++)
+    {
+      CallStats::ScopedCall call(a);
+      CallStats::AddSerialisedBytes(100);
+      CallStats::AddDriverTicks(5);
+    }
+
+    APICallStatistics stats = find("TestCallA", false);
+    CHECK(stats.callCount == 3);
+    CHECK(stats.serialisedBytes == 300);
+    CHECK(stats.driverMicroseconds > 0.0);
+    CHECK(stats.totalMicroseconds >= 0.0);
+
+    CHECK(find("TestCallB", false).callCount == 0);
+  }
+
+  SECTION("Calls while capturing are counted separately")
+  {
+    CallStats::SetCapturing(true);
+    {
+      CallStats::ScopedCall call(a);
+    }
+    CallStats::SetCapturing(false);
+    {
+      CallStats::ScopedCall call(a);
+    }
+    {
+      CallStats::ScopedCall call(a);
+    }
+
+    CHECK(find("TestCallA", true).callCount == 1);
+    CHECK(find("TestCallA", false).callCount == 2);
+  }
+
+  SECTION("Nested calls charge bytes to the innermost call")
+  {
+    {
+      CallStats::ScopedCall outer(a);
+      CallStats::AddSerialisedBytes(10);
+      {
+        CallStats::ScopedCall inner(b);
+        CallStats::AddSerialisedBytes(20);
+      }
+      CallStats::AddSerialisedBytes(30);
+    }
+
+    APICallStatistics statsA = find("TestCallA", false);
+    APICallStatistics statsB = find("TestCallB", false);
+
+    CHECK(statsA.serialisedBytes == 40);
+    CHECK(statsB.serialisedBytes == 20);
+    // time is inclusive of nested calls
+    CHECK(statsA.totalMicroseconds >= statsB.totalMicroseconds);
+  }
+
+  SECTION("Nothing is counted outside of calls or while disabled")
+  {
+    CallStats::AddSerialisedBytes(10);
+
+    CallStats::SetEnabled(false);
+    {
+      CallStats::ScopedCall call(a);
+      CallStats::AddSerialisedBytes(10);
+    }
+
+    CHECK(CallStats::Gather().empty());
+  }
+
+  SECTION("Calls are summed across threads")
+  {
+    Threading::ThreadHandle thread = Threading::CreateThread([a]() {
+      for(int i = 0; i < 100; i++)
+      {
+        CallStats::ScopedCall call(a);
+        CallStats::AddSerialisedBytes(1);
+      }
+    });
+
+    for(int i = 0; i < 50; i++)
+    {
+      CallStats::ScopedCall call(a);
+      CallStats::AddSerialisedBytes(1);
+    }
+
+    Threading::JoinThread(thread);
+    Threading::CloseThread(thread);
+
+    APICallStatistics stats = find("TestCallA", false);
+    CHECK(stats.callCount == 150);
+    CHECK(stats.serialisedBytes == 150);
+  }
+
+  CallStats::SetEnabled(false);
+  CallStats::Reset();
+}
+
+TEST_CASE("Benchmark call statistics overhead", "[.][benchmark][callstats]")
+{
+  const int iterations = 10000000;
+
+  CallStats::EntryPoint entry = CallStats::Register("BenchmarkCall");
+
+  auto run = [iterations, entry]() {
+    uint64_t start = Timing::GetTick();
+    for(int i = 0; i < iterations; i++)
+    {
+      CallStats::ScopedCall call(entry);
+      CallStats::AddSerialisedBytes(64);
+    }
+    return double(Timing::GetTick() - start) / Timing::GetTickFrequency();
+  };
+
+  CallStats::SetEnabled(false);
+  double disabled = run();
+
+  CallStats::SetEnabled(true);
+  double enabled = run();
+
+  CallStats::SetEnabled(false);
+  CallStats::Reset();
+
+  WARN(StringFormat::Fmt("%d calls:", iterations));
+  WARN(StringFormat::Fmt("  disabled: %.2f ms (%.2f ns per call)", disabled,
+                         disabled * 1000000.0 / iterations));
+  WARN(StringFormat::Fmt("  enabled: %.2f ms (%.2f ns per call)", enabled,
+                         enabled * 1000000.0 / iterations));
+}
+
+#endif    // ENABLED(ENABLE_UNIT_TESTS)
@@ -0,0 +1,123 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+
+#pragma once
+
+#include "api/replay/control_types.h"
+#include "common/common.h"
+#include "os/os_specific.h"
+
+// cheap per-entry-point counters for the API hook layers, to find which intercepted functions cost
+// frame time while RenderDoc is injected - both while idle and while capturing.
+//
+// Each thread accumulates into its own table so counting never takes a lock, the tables are only
+// summed when the statistics are gathered. Counting is disabled by default, and then costs a single
+// branch per call.
+namespace CallStats
+{
+typedef uint32_t EntryPoint;
+
+static const EntryPoint InvalidEntryPoint = ~0U;
+static const uint32_t MaxEntryPoints = 2048;
+
+// non-zero while counting. Only read directly by the inline functions below
+extern int32_t Enabled;
+
+inline bool IsEnabled()
+{
+  return Enabled != 0;
+}
+
+// start or stop counting. Counts so far are kept when counting stops
+void SetEnabled(bool enabled);
+
+// calls made while capturing are counted separately from those made while idle
+void SetCapturing(bool capturing);
+
+// returns the index for the named entry point, registering it if needed. Returns InvalidEntryPoint
+// once MaxEntryPoints have been registered. The name must stay valid, e.g. a string literal.
+EntryPoint Register(const char *name);
+
+// internal: charge time spent in the driver, or bytes serialised, to the call in progress on this
+// thread. Nothing is recorded outside of a counted call.
+void RecordDriverTicks(uint64_t ticks);
+void RecordSerialisedBytes(uint64_t bytes);
+
+inline void AddDriverTicks(uint64_t ticks)
+{
+  if(Enabled)
+    RecordDriverTicks(ticks);
+}
+
+inline void AddSerialisedBytes(uint64_t bytes)
+{
+  if(Enabled)
+    RecordSerialisedBytes(bytes);
+}
+
+// sums the counters from every thread. Entry points that were never called are omitted. Counts from
+// other threads are read while they may be updating them, so calls in progress may be missing.
+rdcarray<APICallStatistics> Gather();
+
+// discard all counts, mostly useful for tests
+void Reset();
+
+struct Counters;
+struct ThreadCounters;
+
+// counts one call to an entry point for its lifetime. Time is inclusive of any nested counted
+// calls, though driver time and serialised bytes are charged to the innermost call.
+class ScopedCall
+{
+public:
+  ScopedCall(EntryPoint entry) : m_Thread(NULL)
+  {
+    if(Enabled && entry != InvalidEntryPoint)
+      Begin(entry);
+  }
+  ~ScopedCall()
+  {
+    if(m_Thread)
+      End();
+  }
+
+private:
+  ScopedCall(const ScopedCall &) = delete;
+  ScopedCall &operator=(const ScopedCall &) = delete;
+
+  void Begin(EntryPoint entry);
+  void End();
+
+  ThreadCounters *m_Thread;
+  Counters *m_Counters;
+  Counters *m_Outer;
+  uint64_t m_Start;
+};
+};
+
+#define SCOPED_CALL_STATS(name)                                          \
+  static const CallStats::EntryPoint CONCAT(callstats_entry, __LINE__) = \
+      CallStats::Register(name);                                         \
+  CallStats::ScopedCall CONCAT(callstats_scope, __LINE__)(CONCAT(callstats_entry, __LINE__));
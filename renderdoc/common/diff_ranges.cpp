@@ -0,0 +1,485 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#include "common/diff_ranges.h"
+#include <string.h>
+
+#if defined(__x86_64__) || defined(_M_X64)
+
+#define DIFF_X64 OPTION_ON
+#define DIFF_NEON OPTION_OFF
+
+#include <immintrin.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define AVX2_TARGET
+#else
+#define AVX2_TARGET __attribute__((target("avx2")))
+#endif
+
+#elif defined(__aarch64__) || defined(_M_ARM64)
+
+#define DIFF_X64 OPTION_OFF
+#define DIFF_NEON OPTION_ON
+
+#include <arm_neon.h>
+
+#else
+
+#define DIFF_X64 OPTION_OFF
+#define DIFF_NEON OPTION_OFF
+
+#endif
+
+// differences are found at this granularity, then the ends of each range are refined to the byte
+static const size_t DiffBlockSize = 32;
+
+// Returns the offset of the first block at or after offs where a and b differ, if different is
+// true, or where they are equal if it's false. Returns end if there is no such block. offs and end
+// are multiples of DiffBlockSize.
+typedef size_t (*DiffScanFunc)(const byte *a, const byte *b, size_t offs, size_t end,
+                               bool different);
+
+static inline bool BlockEqual_Scalar(const byte *a, const byte *b)
+{
+  uint64_t x = 0;
+  for(size_t i = 0; i < DiffBlockSize; i += sizeof(uint64_t))
+  {
+    uint64_t av, bv;
+    memcpy(&av, a + i, sizeof(av));
+    memcpy(&bv, b + i, sizeof(bv));
+    x |= av ^ bv;
+  }
+  return x == 0;
+}
+
+static size_t Scan_Scalar(const byte *a, const byte *b, size_t offs, size_t end, bool different)
+{
+  while(offs < end && BlockEqual_Scalar(a + offs, b + offs) == different)
+    offs += DiffBlockSize;
+  return offs;
+}
+
+#if ENABLED(DIFF_X64)
+
+static inline __m128i Xor_SSE2(const byte *a, const byte *b)
+{
+  return _mm_xor_si128(_mm_loadu_si128((const __m128i *)a), _mm_loadu_si128((const __m128i *)b));
+}
+
+static inline bool IsZero_SSE2(__m128i v)
+{
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128())) == 0xffff;
+}
+
+static inline bool BlockEqual_SSE2(const byte *a, const byte *b)
+{
+  return IsZero_SSE2(_mm_or_si128(Xor_SSE2(a, b), Xor_SSE2(a + 16, b + 16)));
+}
+
+static size_t Scan_SSE2(const byte *a, const byte *b, size_t offs, size_t end, bool different)
+{
+  // most memory is unchanged, so skip over equal memory four blocks at a time
+  if(different)
+  {
+    for(; offs + DiffBlockSize * 4 <= end; offs += DiffBlockSize * 4)
+    {
+      const byte *a4 = a + offs, *b4 = b + offs;
+      __m128i x = _mm_or_si128(_mm_or_si128(Xor_SSE2(a4, b4), Xor_SSE2(a4 + 16, b4 + 16)),
+                               _mm_or_si128(Xor_SSE2(a4 + 32, b4 + 32), Xor_SSE2(a4 + 48, b4 + 48)));
+      x = _mm_or_si128(x, _mm_or_si128(Xor_SSE2(a4 + 64, b4 + 64), Xor_SSE2(a4 + 80, b4 + 80)));
+      x = _mm_or_si128(x, _mm_or_si128(Xor_SSE2(a4 + 96, b4 + 96), Xor_SSE2(a4 + 112, b4 + 112)));
+      if(!IsZero_SSE2(x))
+        break;
+    }
+  }
+
+  while(offs < end && BlockEqual_SSE2(a + offs, b + offs) == different)
+    offs += DiffBlockSize;
+  return offs;
+}
+
+AVX2_TARGET static inline __m256i Xor_AVX2(const byte *a, const byte *b)
+{
+  return _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)a),
+                          _mm256_loadu_si256((const __m256i *)b));
+}
+
+AVX2_TARGET static size_t Scan_AVX2(const byte *a, const byte *b, size_t offs, size_t end,
+                                    bool different)
+{
+  if(different)
+  {
+    for(; offs + DiffBlockSize * 4 <= end; offs += DiffBlockSize * 4)
+    {
+      const byte *a4 = a + offs, *b4 = b + offs;
+      __m256i x = _mm256_or_si256(_mm256_or_si256(Xor_AVX2(a4, b4), Xor_AVX2(a4 + 32, b4 + 32)),
+                                  _mm256_or_si256(Xor_AVX2(a4 + 64, b4 + 64),
+                                                  Xor_AVX2(a4 + 96, b4 + 96)));
+      if(!_mm256_testz_si256(x, x))
+        break;
+    }
+  }
+
+  for(; offs < end; offs += DiffBlockSize)
+  {
+    __m256i x = Xor_AVX2(a + offs, b + offs);
+    if((_mm256_testz_si256(x, x) == 0) == different)
+      break;
+  }
+
+  _mm256_zeroupper();
+
+  return offs;
+}
+
+static bool SupportsAVX2()
+{
+#if defined(_MSC_VER)
+  int info[4] = {};
+  __cpuid(info, 0);
+  if(info[0] < 7)
+    return false;
+
+  // check the OS saves the AVX registers, then for AVX2 itself
+  __cpuid(info, 1);
+  const bool osxsave = (info[2] & (1 << 27)) != 0;
+  const bool avx = (info[2] & (1 << 28)) != 0;
+  if(!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6)
+    return false;
+
+  __cpuidex(info, 7, 0);
+  return (info[1] & (1 << 5)) != 0;
+#else
+  return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+
+#endif    // ENABLED(DIFF_X64)
+
+#if ENABLED(DIFF_NEON)
+
+static inline uint8x16_t Xor_NEON(const byte *a, const byte *b)
+{
+  return veorq_u8(vld1q_u8(a), vld1q_u8(b));
+}
+
+static inline bool BlockEqual_NEON(const byte *a, const byte *b)
+{
+  return vmaxvq_u8(vorrq_u8(Xor_NEON(a, b), Xor_NEON(a + 16, b + 16))) == 0;
+}
+
+static size_t Scan_NEON(const byte *a, const byte *b, size_t offs, size_t end, bool different)
+{
+  if(different)
+  {
+    for(; offs + DiffBlockSize * 4 <= end; offs += DiffBlockSize * 4)
+    {
+      const byte *a4 = a + offs, *b4 = b + offs;
+      uint8x16_t x = vorrq_u8(vorrq_u8(Xor_NEON(a4, b4), Xor_NEON(a4 + 16, b4 + 16)),
+                              vorrq_u8(Xor_NEON(a4 + 32, b4 + 32), Xor_NEON(a4 + 48, b4 + 48)));
+      x = vorrq_u8(x, vorrq_u8(Xor_NEON(a4 + 64, b4 + 64), Xor_NEON(a4 + 80, b4 + 80)));
+      x = vorrq_u8(x, vorrq_u8(Xor_NEON(a4 + 96, b4 + 96), Xor_NEON(a4 + 112, b4 + 112)));
+      if(vmaxvq_u8(x) != 0)
+        break;
+    }
+  }
+
+  while(offs < end && BlockEqual_NEON(a + offs, b + offs) == different)
+    offs += DiffBlockSize;
+  return offs;
+}
+
+#endif    // ENABLED(DIFF_NEON)
+
+struct DiffKernel
+{
+  const char *name;
+  DiffScanFunc scan;
+};
+
+// all the kernels this CPU can run, from slowest to fastest
+static rdcarray<DiffKernel> GetDiffKernels()
+{
+  rdcarray<DiffKernel> ret;
+  ret.push_back({"Scalar", &Scan_Scalar});
+
+#if ENABLED(DIFF_X64)
+  ret.push_back({"SSE2", &Scan_SSE2});
+  if(SupportsAVX2())
+    ret.push_back({"AVX2", &Scan_AVX2});
+#endif
+
+#if ENABLED(DIFF_NEON)
+  ret.push_back({"NEON", &Scan_NEON});
+#endif
+
+  return ret;
+}
+
+static void FindDiffRanges(DiffScanFunc scan, const byte *a, const byte *b, size_t bufSize,
+                           size_t mergeGap, DiffRanges &ranges)
+{
+  mergeGap = RDCMAX(mergeGap, DiffRangeMinMergeGap);
+
+  const size_t firstRange = ranges.size();
+
+  auto addRange = [&ranges, firstRange, mergeGap](size_t start, size_t end) {
+    if(ranges.size() > firstRange && start - ranges.back().second <= mergeGap)
+      ranges.back().second = end;
+    else
+      ranges.push_back({start, end});
+  };
+
+  const size_t blocksEnd = bufSize - (bufSize % DiffBlockSize);
+
+  size_t offs = 0;
+  while(offs < blocksEnd)
+  {
+    size_t start = scan(a, b, offs, blocksEnd, true);
+    if(start >= blocksEnd)
+      break;
+
+    size_t end = scan(a, b, start + DiffBlockSize, blocksEnd, false);
+    offs = end;
+
+    // narrow the range down to the differing bytes. If the memory is being written while we
+    // compare, the difference may have gone by now, in which case there's nothing to add.
+    while(start < end && a[start] == b[start])
+      start++;
+    while(end > start && a[end - 1] == b[end - 1])
+      end--;
+
+    if(start < end)
+      addRange(start, end);
+  }
+
+  for(size_t i = blocksEnd; i < bufSize; i++)
+  {
+    if(a[i] != b[i])
+      addRange(i, i + 1);
+  }
+}
+
+void FindDiffRanges(const void *a, const void *b, size_t bufSize, size_t mergeGap,
+                    DiffRanges &ranges)
+{
+  static const DiffScanFunc scan = GetDiffKernels().back().scan;
+
+  FindDiffRanges(scan, (const byte *)a, (const byte *)b, bufSize, mergeGap, ranges);
+}
+
+#if ENABLED(ENABLE_UNIT_TESTS)
+
+#include "catch/catch.hpp"
+#include "common/formatting.h"
+#include "common/timing.h"
+
+// byte by byte, for comparison
+static DiffRanges ReferenceDiffRanges(const byte *a, const byte *b, size_t bufSize, size_t mergeGap)
+{
+  mergeGap = RDCMAX(mergeGap, DiffRangeMinMergeGap);
+
+  DiffRanges ret;
+  for(size_t i = 0; i < bufSize; i++)
+  {
+    if(a[i] == b[i])
+      continue;
+
+    if(!ret.empty() && i - ret.back().second <= mergeGap)
+      ret.back().second = i + 1;
+    else
+      ret.push_back({i, i + 1});
+  }
+  return ret;
+}
+
+TEST_CASE("Test finding diff ranges", "[diffranges]")
+{
+  const size_t size = 64 * 1024;
+
+  bytebuf a, b;
+  a.resize(size + 16);
+  b.resize(size + 16);
+
+  uint32_t rng = 12345;
+  auto rand = [&rng]() {
+    rng = rng * 1664525U + 1013904223U;
+    return rng >> 8;
+  };
+
+  for(size_t i = 0; i < a.size(); i++)
+    a[i] = b[i] = byte(rand());
+
+  rdcarray<DiffKernel> kernels = GetDiffKernels();
+
+  SECTION("Identical buffers have no ranges")
+  {
+    for(const DiffKernel &kernel : kernels)
+    {
+      CAPTURE(kernel.name);
+
+      DiffRanges ranges;
+      FindDiffRanges(kernel.scan, a.data(), b.data(), size, 0, ranges);
+      CHECK(ranges.empty());
+    }
+  };
+
+  SECTION("Changes at either end are separate ranges")
+  {
+    b[0] ^= 0xff;
+    b[size - 1] ^= 0xff;
+
+    for(const DiffKernel &kernel : kernels)
+    {
+      CAPTURE(kernel.name);
+
+      DiffRanges ranges;
+      FindDiffRanges(kernel.scan, a.data(), b.data(), size, 4096, ranges);
+      REQUIRE(ranges.size() == 2);
+      CHECK(ranges[0].first == 0);
+      CHECK(ranges[0].second == 1);
+      CHECK(ranges[1].first == size - 1);
+      CHECK(ranges[1].second == size);
+
+      // the single range agrees with the outer bounds
+      size_t diffStart = 0, diffEnd = 0;
+      CHECK(FindDiffRange(a.data(), b.data(), size, diffStart, diffEnd));
+      CHECK(diffStart == ranges[0].first);
+      CHECK(diffEnd == ranges.back().second);
+    }
+  };
+
+  SECTION("Kernels match the reference")
+  {
+    for(int iter = 0; iter < 50; iter++)
+    {
+      // a mix of isolated changes and clusters
+      const uint32_t numChanges = rand() % 40;
+      for(uint32_t c = 0; c < numChanges; c++)
+      {
+        size_t offs = rand() % size;
+        size_t len = (rand() % 4) == 0 ? rand() % 300 : 1;
+        for(size_t i = offs; i < RDCMIN(size + 16, offs + len); i++)
+          b[i] = byte(a[i] + 1 + (rand() % 255));
+      }
+
+      // unaligned starts and sizes that aren't a multiple of the block size
+      const size_t offsA = rand() % 16, offsB = rand() % 16;
+      const size_t len = size - (rand() % 100);
+      const size_t gap = rand() % 3 == 0 ? 0 : rand() % 2000;
+
+      CAPTURE(iter);
+      CAPTURE(offsA);
+      CAPTURE(offsB);
+      CAPTURE(len);
+      CAPTURE(gap);
+
+      // compare a against a shifted copy of b, so that the offsets don't line up
+      bytebuf shiftedB;
+      shiftedB.resize(size + 32);
+      memcpy(shiftedB.data() + offsB, b.data() + offsA, len);
+
+      const DiffRanges ref = ReferenceDiffRanges(a.data() + offsA, shiftedB.data() + offsB, len, gap);
+
+      for(const DiffKernel &kernel : kernels)
+      {
+        CAPTURE(kernel.name);
+
+        DiffRanges ranges;
+        FindDiffRanges(kernel.scan, a.data() + offsA, shiftedB.data() + offsB, len, gap, ranges);
+        CHECK((ranges == ref));
+      }
+
+      // reset for the next iteration
+      memcpy(b.data(), a.data(), a.size());
+    }
+  };
+
+  SECTION("Ranges are appended")
+  {
+    b[100] ^= 1;
+
+    DiffRanges ranges;
+    ranges.push_back({0, 50});
+    FindDiffRanges(a.data(), b.data(), size, 4096, ranges);
+    REQUIRE(ranges.size() == 2);
+    CHECK(ranges[0].second == 50);
+    CHECK(ranges[1].first == 100);
+    CHECK(ranges[1].second == 101);
+  };
+}
+
+TEST_CASE("Benchmark finding diff ranges", "[.][benchmark][diffranges]")
+{
+  const size_t size = 256 * 1024 * 1024;
+  const int iterations = 4;
+
+  byte *a = AllocAlignedBuffer(size);
+  byte *b = AllocAlignedBuffer(size);
+  memset(a, 0x7f, size);
+  memset(b, 0x7f, size);
+
+  // a few scattered changes, as in a large upload heap where little is written each frame
+  for(size_t i = 0; i < 16; i++)
+    b[(size / 16) * i + 1000] = 0;
+
+  rdcstr results;
+
+  auto report = [&](const char *name, double ms) {
+    results += StringFormat::Fmt("\n%8s: %6.2f GB/s", name,
+                                 double(size) * iterations / (ms / 1000.0) / (1024.0 * 1024.0 * 1024.0));
+  };
+
+  PerformanceTimer timer;
+
+  for(int i = 0; i < iterations; i++)
+  {
+    size_t diffStart = 0, diffEnd = 0;
+    FindDiffRange(a, b, size, diffStart, diffEnd);
+  }
+
+  report("Single", timer.GetMilliseconds());
+
+  for(const DiffKernel &kernel : GetDiffKernels())
+  {
+    timer.Restart();
+
+    for(int i = 0; i < iterations; i++)
+    {
+      DiffRanges ranges;
+      FindDiffRanges(kernel.scan, a, b, size, 4096, ranges);
+    }
+
+    report(kernel.name, timer.GetMilliseconds());
+  }
+
+  FreeAlignedBuffer(a);
+  FreeAlignedBuffer(b);
+
+  WARN("Comparing " << size / (1024 * 1024) << "MB:" << results.c_str());
+}
+
+#endif    // ENABLED(ENABLE_UNIT_TESTS)
@@ -0,0 +1,46 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#pragma once
+
+#include "api/replay/rdcarray.h"
+#include "api/replay/rdcpair.h"
+#include "common/common.h"
+
+typedef rdcarray<rdcpair<size_t, size_t>> DiffRanges;
+
+// Finds every range of bytes that differ between a and b, as [start, end) byte offsets, and
+// appends them to ranges in ascending order. Unlike FindDiffRange this doesn't return a single
+// span covering every difference, so a couple of small changes far apart don't mean everything in
+// between must be treated as changed.
+//
+// Ranges separated by mergeGap bytes or fewer are merged, as each range has some overhead for the
+// caller. mergeGap is at least DiffRangeMinMergeGap, as differences are found a block at a time.
+//
+// The comparison uses the widest SIMD instructions available at runtime. a and b don't need to be
+// aligned.
+static const size_t DiffRangeMinMergeGap = 64;
+
+void FindDiffRanges(const void *a, const void *b, size_t bufSize, size_t mergeGap,
+                    DiffRanges &ranges);
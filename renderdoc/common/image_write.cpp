@@ -0,0 +1,816 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#include "image_write.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "common/formatting.h"
+#include "common/threading.h"
+#include "jpeg-compressor/jpge.h"
+#include "maths/half_convert.h"
+#include "miniz/miniz.h"
+#include "os/os_specific.h"
+
+// uncompressed bytes in each strip. Big enough that each strip compresses well and the per-strip
+// overhead is small, small enough that a batch of strips for every worker is cheap to hold.
+static const size_t ImageStripBytes = 1024 * 1024;
+
+struct ImageStrip
+{
+  uint32_t y = 0;
+  uint32_t numRows = 0;
+
+  // the encoded bytes for this strip, as they'll be written to the file
+  bytebuf data;
+
+  // checksum of the strip's uncompressed data, for formats that need one over the whole image
+  uint32_t checksum = 0;
+};
+
+typedef std::function<void(ImageStrip &strip)> EncodeStripFunc;
+typedef std::function<bool(ImageStrip &strip)> CommitStripFunc;
+
+// splits the image into strips of rows, encodes a batch of strips at a time in parallel and then
+// commits the batch in order.
+static bool ProcessStrips(uint32_t height, size_t rowBytes, EncodeStripFunc encode,
+                          CommitStripFunc commit)
+{
+  const uint32_t stripRows =
+      (uint32_t)RDCCLAMP(ImageStripBytes / RDCMAX(rowBytes, (size_t)1), (size_t)1, (size_t)height);
+  const uint32_t numStrips = (height + stripRows - 1) / stripRows;
+
+  // two strips per thread gives some slack for strips that take longer to encode
+  const uint32_t batchSize = (Threading::Jobs::NumWorkers() + 1) * 2;
+
+  rdcarray<ImageStrip> strips;
+
+  for(uint32_t first = 0; first < numStrips; first += batchSize)
+  {
+    const uint32_t count = RDCMIN(batchSize, numStrips - first);
+
+    strips.resize(count);
+    for(uint32_t i = 0; i < count; i++)
+    {
+      strips[i].y = (first + i) * stripRows;
+      strips[i].numRows = RDCMIN(stripRows, height - strips[i].y);
+      strips[i].data.clear();
+      strips[i].checksum = 0;
+    }
+
+    Threading::Jobs::ParallelFor(0, count, [&](uint32_t i) { encode(strips[i]); });
+
+    for(uint32_t i = 0; i < count; i++)
+    {
+      if(!commit(strips[i]))
+        return false;
+    }
+  }
+
+  return true;
+}
+
+static bool WriteBytes(FILE *f, const void *data, size_t size)
+{
+  if(size == 0)
+    return true;
+
+  if(FileIO::fwrite(data, 1, size, f) != size)
+  {
+    RDCERR("Failed writing image: %s", FileIO::ErrorString().c_str());
+    return false;
+  }
+
+  return true;
+}
+
+template <typename T>
+static void AppendLE(bytebuf &out, T val)
+{
+  out.append((const byte *)&val, sizeof(T));
+}
+
+static void AppendBE32(bytebuf &out, uint32_t val)
+{
+  byte b[4] = {byte(val >> 24), byte(val >> 16), byte(val >> 8), byte(val)};
+  out.append(b, 4);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// PNG
+//
+// Each strip is filtered and deflated independently. Every strip but the last ends with a sync
+// flush, which byte-aligns the deflate stream without marking the final block, so the compressed
+// strips concatenate into one valid zlib stream. Each strip is written in its own IDAT chunk.
+
+static mz_bool AppendDeflated(const void *buf, int len, void *user)
+{
+  ((bytebuf *)user)->append((const byte *)buf, (size_t)len);
+  return MZ_TRUE;
+}
+
+static inline byte PaethPredictor(int a, int b, int c)
+{
+  int p = a + b - c;
+  int pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+  if(pa <= pb && pa <= pc)
+    return byte(a);
+  if(pb <= pc)
+    return byte(b);
+  return byte(c);
+}
+
+// filters one row with each of the five PNG filters and keeps the one whose output has the
+// smallest sum of absolute values, the same heuristic stb_image_write and libpng use.
+static void FilterPNGRow(const byte *prev, const byte *cur, size_t rowBytes, uint32_t bpp,
+                         byte *scratch, byte *out)
+{
+  byte *filtered[5];
+  for(int f = 0; f < 5; f++)
+    filtered[f] = scratch + f * rowBytes;
+
+  for(size_t i = 0; i < rowBytes; i++)
+  {
+    const int a = i >= bpp ? cur[i - bpp] : 0;
+    const int b = prev[i];
+    const int c = i >= bpp ? prev[i - bpp] : 0;
+
+    filtered[0][i] = cur[i];
+    filtered[1][i] = byte(cur[i] - a);
+    filtered[2][i] = byte(cur[i] - b);
+    filtered[3][i] = byte(cur[i] - ((a + b) >> 1));
+    filtered[4][i] = byte(cur[i] - PaethPredictor(a, b, c));
+  }
+
+  int best = 0;
+  uint64_t bestEstimate = ~0ULL;
+
+  for(int f = 0; f < 5; f++)
+  {
+    uint64_t estimate = 0;
+    for(size_t i = 0; i < rowBytes; i++)
+      estimate += (uint64_t)abs((int)(int8_t)filtered[f][i]);
+
+    if(estimate < bestEstimate)
+    {
+      best = f;
+      bestEstimate = estimate;
+    }
+  }
+
+  out[0] = byte(best);
+  memcpy(out + 1, filtered[best], rowBytes);
+}
+
+// combines the adler32 of two consecutive blocks of data, given the length of the second block
+static uint32_t CombineAdler32(uint32_t adler1, uint32_t adler2, uint64_t len2)
+{
+  const uint32_t base = 65521;
+
+  uint32_t rem = uint32_t(len2 % base);
+  uint32_t sum1 = adler1 & 0xffff;
+  uint32_t sum2 = uint32_t((uint64_t(rem) * sum1) % base);
+
+  sum1 += (adler2 & 0xffff) + base - 1;
+  sum2 += ((adler1 >> 16) & 0xffff) + ((adler2 >> 16) & 0xffff) + base - rem;
+
+  if(sum1 >= base)
+    sum1 -= base;
+  if(sum1 >= base)
+    sum1 -= base;
+  if(sum2 >= (base << 1))
+    sum2 -= (base << 1);
+  if(sum2 >= base)
+    sum2 -= base;
+
+  return sum1 | (sum2 << 16);
+}
+
+static bool WritePNGChunk(FILE *f, const char *type, const bytebuf &prefix, const bytebuf &data,
+                          const bytebuf &suffix)
+{
+  bytebuf header;
+  AppendBE32(header, uint32_t(prefix.size() + data.size() + suffix.size()));
+  header.append((const byte *)type, 4);
+
+  // mz_crc32 resets the CRC when given NULL, so skip empty parts
+  mz_ulong crc = mz_crc32(MZ_CRC32_INIT, (const byte *)type, 4);
+  for(const bytebuf *part : {&prefix, &data, &suffix})
+  {
+    if(!part->empty())
+      crc = mz_crc32(crc, part->data(), part->size());
+  }
+
+  bytebuf footer;
+  AppendBE32(footer, uint32_t(crc));
+
+  return WriteBytes(f, header.data(), header.size()) &&
+         WriteBytes(f, prefix.data(), prefix.size()) && WriteBytes(f, data.data(), data.size()) &&
+         WriteBytes(f, suffix.data(), suffix.size()) && WriteBytes(f, footer.data(), footer.size());
+}
+
+bool write_png_to_file(FILE *f, uint32_t width, uint32_t height, uint32_t channels,
+                       ImageRowsCallback rows)
+{
+  if(channels < 1 || channels > 4 || width == 0 || height == 0)
+  {
+    RDCERR("Unsupported PNG image %ux%u with %u channels", width, height, channels);
+    return false;
+  }
+
+  static const byte signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+  // greyscale, greyscale + alpha, RGB, RGBA
+  static const byte colourTypes[4] = {0, 4, 2, 6};
+
+  if(!WriteBytes(f, signature, sizeof(signature)))
+    return false;
+
+  bytebuf ihdr;
+  AppendBE32(ihdr, width);
+  AppendBE32(ihdr, height);
+  ihdr.push_back(8);    // bit depth
+  ihdr.push_back(colourTypes[channels - 1]);
+  ihdr.push_back(0);    // deflate
+  ihdr.push_back(0);    // adaptive filtering
+  ihdr.push_back(0);    // no interlacing
+
+  if(!WritePNGChunk(f, "IHDR", {}, ihdr, {}))
+    return false;
+
+  const size_t rowBytes = size_t(width) * channels;
+  const int flags =
+      (int)tdefl_create_comp_flags_from_zip_params(MZ_DEFAULT_LEVEL, -MZ_DEFAULT_WINDOW_BITS,
+                                                   MZ_DEFAULT_STRATEGY);
+
+  bool success = true;
+
+  auto encode = [&](ImageStrip &strip) {
+    // fetch the row above the strip too, as the filters predict from it
+    const uint32_t firstRow = strip.y > 0 ? strip.y - 1 : 0;
+    const uint32_t numRows = strip.y + strip.numRows - firstRow;
+
+    bytebuf raw, filtered, scratch, zeroRow;
+    raw.resize(rowBytes * numRows);
+    filtered.resize((rowBytes + 1) * strip.numRows);
+    scratch.resize(rowBytes * 5);
+    zeroRow.resize(rowBytes);
+
+    rows(firstRow, numRows, raw.data());
+
+    for(uint32_t r = 0; r < strip.numRows; r++)
+    {
+      const uint32_t y = strip.y + r;
+      const byte *cur = raw.data() + (y - firstRow) * rowBytes;
+      const byte *prev = y > 0 ? cur - rowBytes : zeroRow.data();
+
+      FilterPNGRow(prev, cur, rowBytes, channels, scratch.data(),
+                   filtered.data() + r * (rowBytes + 1));
+    }
+
+    strip.checksum = (uint32_t)mz_adler32(MZ_ADLER32_INIT, filtered.data(), filtered.size());
+
+    const bool last = (strip.y + strip.numRows == height);
+
+    tdefl_compressor *comp = tdefl_compressor_alloc();
+    tdefl_init(comp, &AppendDeflated, &strip.data, flags);
+    tdefl_status status = tdefl_compress_buffer(comp, filtered.data(), filtered.size(),
+                                                last ? TDEFL_FINISH : TDEFL_SYNC_FLUSH);
+    tdefl_compressor_free(comp);
+
+    if(status != (last ? TDEFL_STATUS_DONE : TDEFL_STATUS_OKAY))
+    {
+      RDCERR("Failed to compress PNG rows %u-%u: %d", strip.y, strip.y + strip.numRows, status);
+      success = false;
+    }
+  };
+
+  uint32_t adler = MZ_ADLER32_INIT;
+
+  auto commit = [&](ImageStrip &strip) {
+    if(!success)
+      return false;
+
+    bytebuf prefix, suffix;
+
+    // zlib header, for a 32k window and the default compression level
+    if(strip.y == 0)
+    {
+      prefix.push_back(0x78);
+      prefix.push_back(0x9c);
+    }
+
+    const uint64_t filteredSize = uint64_t(rowBytes + 1) * strip.numRows;
+    adler = strip.y == 0 ? strip.checksum : CombineAdler32(adler, strip.checksum, filteredSize);
+
+    if(strip.y + strip.numRows == height)
+      AppendBE32(suffix, adler);
+
+    return WritePNGChunk(f, "IDAT", prefix, strip.data, suffix);
+  };
+
+  if(!ProcessStrips(height, rowBytes, encode, commit))
+    return false;
+
+  return WritePNGChunk(f, "IEND", {}, {}, {});
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// JPG
+
+class FileOutputStream : public jpge::output_stream
+{
+public:
+  FileOutputStream(FILE *f) : m_File(f) {}
+  bool put_buf(const void *buf, int len) override { return WriteBytes(m_File, buf, (size_t)len); }
+
+private:
+  FILE *m_File;
+};
+
+bool write_jpg_to_file(FILE *f, uint32_t width, uint32_t height, uint32_t channels, int quality,
+                       ImageRowsCallback rows)
+{
+  FileOutputStream stream(f);
+
+  jpge::params p;
+  p.m_quality = quality;
+
+  jpge::jpeg_encoder encoder;
+  if(!encoder.init(&stream, (int)width, (int)height, (int)channels, p))
+  {
+    RDCERR("Failed to initialise JPG encoder for %ux%u with %u channels", width, height, channels);
+    return false;
+  }
+
+  const size_t rowBytes = size_t(width) * channels;
+
+  // the encoder consumes scanlines serially, but the rows can still be converted in parallel
+  auto encode = [&](ImageStrip &strip) {
+    strip.data.resize(rowBytes * strip.numRows);
+    rows(strip.y, strip.numRows, strip.data.data());
+  };
+
+  auto commit = [&](ImageStrip &strip) {
+    for(uint32_t r = 0; r < strip.numRows; r++)
+    {
+      if(!encoder.process_scanline(strip.data.data() + r * rowBytes))
+        return false;
+    }
+    return true;
+  };
+
+  for(uint32_t pass = 0; pass < encoder.get_total_passes(); pass++)
+  {
+    if(!ProcessStrips(height, rowBytes, encode, commit) || !encoder.process_scanline(NULL))
+    {
+      RDCERR("Failed to encode JPG");
+      return false;
+    }
+  }
+
+  return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// HDR
+//
+// Radiance RGBE, with each scanline run-length encoded per channel where the width allows.
+
+static void ConvertToRGBE(const float *rgba, byte *rgbe)
+{
+  float maxcomp = RDCMAX(rgba[0], RDCMAX(rgba[1], rgba[2]));
+
+  if(maxcomp < 1e-32f)
+  {
+    rgbe[0] = rgbe[1] = rgbe[2] = rgbe[3] = 0;
+  }
+  else
+  {
+    int exponent = 0;
+    float normalize = (float)frexp(maxcomp, &exponent) * 256.0f / maxcomp;
+
+    rgbe[0] = byte(rgba[0] * normalize);
+    rgbe[1] = byte(rgba[1] * normalize);
+    rgbe[2] = byte(rgba[2] * normalize);
+    rgbe[3] = byte(exponent + 128);
+  }
+}
+
+static void EncodeHDRScanline(const float *rgba, uint32_t width, byte *scratch, bytebuf &out)
+{
+  // scanlines too narrow or too wide for RLE are written flat
+  if(width < 8 || width >= 32768)
+  {
+    for(uint32_t x = 0; x < width; x++)
+    {
+      byte rgbe[4];
+      ConvertToRGBE(rgba + x * 4, rgbe);
+      out.append(rgbe, 4);
+    }
+    return;
+  }
+
+  for(uint32_t x = 0; x < width; x++)
+  {
+    byte rgbe[4];
+    ConvertToRGBE(rgba + x * 4, rgbe);
+    for(uint32_t c = 0; c < 4; c++)
+      scratch[c * width + x] = rgbe[c];
+  }
+
+  const byte header[4] = {2, 2, byte(width >> 8), byte(width & 0xff)};
+  out.append(header, 4);
+
+  for(uint32_t c = 0; c < 4; c++)
+  {
+    const byte *comp = scratch + c * width;
+    uint32_t x = 0;
+
+    while(x < width)
+    {
+      // find the start of the next run of at least 3 identical bytes
+      uint32_t r = x;
+      while(r + 2 < width && !(comp[r] == comp[r + 1] && comp[r] == comp[r + 2]))
+        r++;
+      if(r + 2 >= width)
+        r = width;
+
+      // dump the bytes before it
+      while(x < r)
+      {
+        uint32_t len = RDCMIN(r - x, 128U);
+        out.push_back(byte(len));
+        out.append(comp + x, len);
+        x += len;
+      }
+
+      // then the run itself
+      if(r < width)
+      {
+        while(r < width && comp[r] == comp[x])
+          r++;
+
+        while(x < r)
+        {
+          uint32_t len = RDCMIN(r - x, 127U);
+          out.push_back(byte(len + 128));
+          out.push_back(comp[x]);
+          x += len;
+        }
+      }
+    }
+  }
+}
+
+bool write_hdr_to_file(FILE *f, uint32_t width, uint32_t height, ImageRowsCallback rows)
+{
+  rdcstr header = StringFormat::Fmt(
+      "#?RADIANCE\n# Written by RenderDoc\nFORMAT=32-bit_rle_rgbe\n\n-Y %u +X %u\n", height, width);
+
+  if(!WriteBytes(f, header.c_str(), header.size()))
+    return false;
+
+  const size_t rowBytes = size_t(width) * 4 * sizeof(float);
+
+  auto encode = [&](ImageStrip &strip) {
+    rdcarray<float> rgba;
+    bytebuf scratch;
+    rgba.resize(size_t(width) * 4 * strip.numRows);
+    scratch.resize(size_t(width) * 4);
+
+    rows(strip.y, strip.numRows, (byte *)rgba.data());
+
+    strip.data.reserve(rowBytes * strip.numRows / 4);
+    for(uint32_t r = 0; r < strip.numRows; r++)
+      EncodeHDRScanline(rgba.data() + r * width * 4, width, scratch.data(), strip.data);
+  };
+
+  auto commit = [&](ImageStrip &strip) {
+    return WriteBytes(f, strip.data.data(), strip.data.size());
+  };
+
+  return ProcessStrips(height, rowBytes, encode, commit);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// EXR
+//
+// Single-part scanline file, uncompressed, one scanline per block. Since every block is the same
+// size the offset table can be written before any pixel data.
+
+static void AppendEXRAttribute(bytebuf &out, const char *name, const char *type, const bytebuf &value)
+{
+  out.append((const byte *)name, strlen(name) + 1);
+  out.append((const byte *)type, strlen(type) + 1);
+  AppendLE<uint32_t>(out, (uint32_t)value.size());
+  out.append(value);
+}
+
+bool write_exr_to_file(FILE *f, uint32_t width, uint32_t height, bool fullFloat,
+                       ImageRowsCallback rows)
+{
+  // must be in this order as many viewers don't pay attention to channels and just assume
+  // they are in this order. It's also the sorted order the format requires
+  const char channelNames[4] = {'A', 'B', 'G', 'R'};
+  const uint32_t channelSources[4] = {3, 2, 1, 0};
+
+  const uint32_t compSize = fullFloat ? 4 : 2;
+
+  bytebuf header;
+
+  // magic number and version 2, single-part scanline
+  const byte magic[8] = {0x76, 0x2f, 0x31, 0x01, 2, 0, 0, 0};
+  header.append(magic, sizeof(magic));
+
+  bytebuf value;
+
+  for(char c : channelNames)
+  {
+    value.push_back(byte(c));
+    value.push_back(0);
+    AppendLE<int32_t>(value, fullFloat ? 2 : 1);    // FLOAT or HALF
+    AppendLE<uint32_t>(value, 0);                   // pLinear and reserved
+    AppendLE<int32_t>(value, 1);                    // x sampling
+    AppendLE<int32_t>(value, 1);                    // y sampling
+  }
+  value.push_back(0);
+  AppendEXRAttribute(header, "channels", "chlist", value);
+
+  value.clear();
+  value.push_back(0);    // NO_COMPRESSION
+  AppendEXRAttribute(header, "compression", "compression", value);
+
+  value.clear();
+  AppendLE<int32_t>(value, 0);
+  AppendLE<int32_t>(value, 0);
+  AppendLE<int32_t>(value, int32_t(width) - 1);
+  AppendLE<int32_t>(value, int32_t(height) - 1);
+  AppendEXRAttribute(header, "dataWindow", "box2i", value);
+  AppendEXRAttribute(header, "displayWindow", "box2i", value);
+
+  value.clear();
+  value.push_back(0);    // INCREASING_Y
+  AppendEXRAttribute(header, "lineOrder", "lineOrder", value);
+
+  value.clear();
+  AppendLE<float>(value, 1.0f);
+  AppendEXRAttribute(header, "pixelAspectRatio", "float", value);
+  AppendEXRAttribute(header, "screenWindowWidth", "float", value);
+
+  value.clear();
+  AppendLE<float>(value, 0.0f);
+  AppendLE<float>(value, 0.0f);
+  AppendEXRAttribute(header, "screenWindowCenter", "v2f", value);
+
+  header.push_back(0);
+
+  // each block is the y coordinate, the data size, then each channel's values for the scanline
+  const uint32_t lineDataSize = width * 4 * compSize;
+  const uint64_t blockSize = sizeof(int32_t) * 2 + lineDataSize;
+
+  uint64_t offset = header.size() + sizeof(uint64_t) * height;
+  for(uint32_t y = 0; y < height; y++)
+  {
+    AppendLE<uint64_t>(header, offset);
+    offset += blockSize;
+  }
+
+  if(!WriteBytes(f, header.data(), header.size()))
+    return false;
+
+  const size_t rowBytes = size_t(width) * 4 * sizeof(float);
+
+  auto encode = [&](ImageStrip &strip) {
+    rdcarray<float> rgba;
+    rgba.resize(size_t(width) * 4 * strip.numRows);
+
+    rows(strip.y, strip.numRows, (byte *)rgba.data());
+
+    strip.data.resize(size_t(blockSize * strip.numRows));
+
+    byte *out = strip.data.data();
+    for(uint32_t r = 0; r < strip.numRows; r++)
+    {
+      const float *src = rgba.data() + r * width * 4;
+
+      int32_t y = int32_t(strip.y + r);
+      memcpy(out, &y, sizeof(y));
+      memcpy(out + sizeof(int32_t), &lineDataSize, sizeof(lineDataSize));
+      out += sizeof(int32_t) * 2;
+
+      for(uint32_t c = 0; c < 4; c++)
+      {
+        const uint32_t srcComp = channelSources[c];
+
+        if(fullFloat)
+        {
+          float *dst = (float *)out;
+          for(uint32_t x = 0; x < width; x++)
+            dst[x] = src[x * 4 + srcComp];
+        }
+        else
+        {
+          uint16_t *dst = (uint16_t *)out;
+          for(uint32_t x = 0; x < width; x++)
+            dst[x] = ConvertToHalf(src[x * 4 + srcComp]);
+        }
+
+        out += width * compSize;
+      }
+    }
+  };
+
+  auto commit = [&](ImageStrip &strip) {
+    return WriteBytes(f, strip.data.data(), strip.data.size());
+  };
+
+  return ProcessStrips(height, rowBytes, encode, commit);
+}
+
+#if ENABLED(ENABLE_UNIT_TESTS)
+
+#include "catch/catch.hpp"
+#include "stb/stb_image.h"
+#include "tinyexr/tinyexr.h"
+
+static bytebuf WriteTestImage(std::function<bool(FILE *)> write)
+{
+  const rdcstr filename = FileIO::GetTempFolderFilename() + "renderdoc_image_write_test";
+
+  FILE *f = FileIO::fopen(filename, FileIO::WriteBinary);
+  REQUIRE(f);
+  bool success = write(f);
+  FileIO::fclose(f);
+
+  CHECK(success);
+
+  bytebuf ret;
+  FileIO::ReadAll(filename, ret);
+  FileIO::Delete(filename);
+  return ret;
+}
+
+TEST_CASE("Streaming image writers", "[image]")
+{
+  SECTION("PNG")
+  {
+    // tall enough to be split into several strips
+    const uint32_t width = 301, height = 3011;
+
+    for(uint32_t channels = 1; channels <= 4; channels++)
+    {
+      bytebuf expected;
+      expected.resize(width * height * channels);
+      for(size_t i = 0; i < expected.size(); i++)
+        expected[i] = byte((i % 7) * 40 + (i / (width * channels)) + ((i * 2654435761U) >> 28));
+
+      bytebuf png = WriteTestImage([&](FILE *f) {
+        return write_png_to_file(f, width, height, channels,
+                                 [&](uint32_t y, uint32_t numRows, byte *dst) {
+                                   memcpy(dst, expected.data() + y * width * channels,
+                                          numRows * width * channels);
+                                 });
+      });
+
+      int w = 0, h = 0, comp = 0;
+      byte *decoded = stbi_load_from_memory(png.data(), (int)png.size(), &w, &h, &comp, 0);
+      REQUIRE(decoded);
+      CHECK(w == (int)width);
+      CHECK(h == (int)height);
+      CHECK(comp == (int)channels);
+      CHECK(memcmp(decoded, expected.data(), expected.size()) == 0);
+      stbi_image_free(decoded);
+
+      // stb_image doesn't check the zlib checksum, so inflate the IDAT chunks ourselves
+      bytebuf zlib;
+      size_t offs = 8;
+      while(offs + 12 <= png.size())
+      {
+        const byte *chunk = png.data() + offs;
+        uint32_t len = (chunk[0] << 24) | (chunk[1] << 16) | (chunk[2] << 8) | chunk[3];
+        if(memcmp(chunk + 4, "IDAT", 4) == 0)
+          zlib.append(chunk + 8, len);
+        offs += len + 12;
+      }
+      CHECK(offs == png.size());
+
+      bytebuf inflated;
+      inflated.resize((width * channels + 1) * height);
+      mz_ulong inflatedSize = (mz_ulong)inflated.size();
+      int ret = mz_uncompress(inflated.data(), &inflatedSize, zlib.data(), (mz_ulong)zlib.size());
+      CHECK(ret == (int)MZ_OK);
+      CHECK(inflatedSize == inflated.size());
+    }
+  };
+
+  const uint32_t width = 257, height = 1031;
+
+  rdcarray<float> expected;
+  expected.resize(width * height * 4);
+  for(size_t i = 0; i < expected.size(); i++)
+    expected[i] = float((i * 37) % 1000) / 100.0f;
+
+  ImageRowsCallback floatRows = [&](uint32_t y, uint32_t numRows, byte *dst) {
+    memcpy(dst, expected.data() + y * width * 4, numRows * width * 4 * sizeof(float));
+  };
+
+  SECTION("HDR")
+  {
+    bytebuf hdr = WriteTestImage(
+        [&](FILE *f) { return write_hdr_to_file(f, width, height, floatRows); });
+
+    int w = 0, h = 0, comp = 0;
+    float *decoded = stbi_loadf_from_memory(hdr.data(), (int)hdr.size(), &w, &h, &comp, 4);
+    REQUIRE(decoded);
+    CHECK(w == (int)width);
+    CHECK(h == (int)height);
+
+    // RGBE shares one exponent across the pixel, so precision is relative to the largest channel
+    bool match = true;
+    for(size_t p = 0; p < width * height; p++)
+    {
+      float maxcomp = RDCMAX(expected[p * 4 + 0], RDCMAX(expected[p * 4 + 1], expected[p * 4 + 2]));
+      for(size_t c = 0; c < 3; c++)
+        match &= fabsf(decoded[p * 4 + c] - expected[p * 4 + c]) <= maxcomp / 64.0f + 1e-6f;
+    }
+    CHECK(match);
+    stbi_image_free(decoded);
+  };
+
+  SECTION("EXR")
+  {
+    for(bool fullFloat : {false, true})
+    {
+      bytebuf exr = WriteTestImage(
+          [&](FILE *f) { return write_exr_to_file(f, width, height, fullFloat, floatRows); });
+
+      float *decoded = NULL;
+      int w = 0, h = 0;
+      const char *err = NULL;
+      REQUIRE(LoadEXRFromMemory(&decoded, &w, &h, exr.data(), exr.size(), &err) == TINYEXR_SUCCESS);
+      CHECK(w == (int)width);
+      CHECK(h == (int)height);
+
+      bool match = true;
+      for(size_t i = 0; i < expected.size(); i++)
+      {
+        if(fullFloat)
+          match &= decoded[i] == expected[i];
+        else
+          match &= decoded[i] == ConvertFromHalf(ConvertToHalf(expected[i]));
+      }
+      CHECK(match);
+      free(decoded);
+    }
+  };
+
+  SECTION("JPG")
+  {
+    bytebuf rgb;
+    rgb.resize(width * height * 3);
+    for(size_t i = 0; i < rgb.size(); i++)
+      rgb[i] = byte(((i / 3) % width) / 2 + (i % 3) * 30);
+
+    bytebuf jpg = WriteTestImage([&](FILE *f) {
+      return write_jpg_to_file(f, width, height, 3, 95, [&](uint32_t y, uint32_t numRows, byte *dst) {
+        memcpy(dst, rgb.data() + y * width * 3, numRows * width * 3);
+      });
+    });
+
+    int w = 0, h = 0, comp = 0;
+    byte *decoded = stbi_load_from_memory(jpg.data(), (int)jpg.size(), &w, &h, &comp, 3);
+    REQUIRE(decoded);
+    CHECK(w == (int)width);
+    CHECK(h == (int)height);
+
+    // lossy, but a smooth gradient should come back close
+    uint64_t totalError = 0;
+    for(size_t i = 0; i < rgb.size(); i++)
+      totalError += abs(int(decoded[i]) - int(rgb[i]));
+    CHECK(totalError / rgb.size() < 4);
+    stbi_image_free(decoded);
+  };
+}
+
+#endif
@@ -0,0 +1,54 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#pragma once
+
+#include <stdio.h>
+#include <functional>
+#include "common/common.h"
+
+// Streaming image writers. Rather than taking the whole image, each writer pulls the image a strip
+// of rows at a time, converting and compressing several strips in parallel and writing them to
+// the file in order. Only a bounded number of strips are in flight at once so memory use doesn't
+// grow with the image size.
+//
+// The callback fills rows [y, y + numRows) tightly packed into dst, in the pixel layout the writer
+// expects. It's called from several threads at once, for disjoint row ranges.
+typedef std::function<void(uint32_t y, uint32_t numRows, byte *dst)> ImageRowsCallback;
+
+// rows are 8-bit UNorm with 1 to 4 channels
+extern bool write_png_to_file(FILE *f, uint32_t width, uint32_t height, uint32_t channels,
+                              ImageRowsCallback rows);
+
+// rows are 8-bit UNorm with 1, 3 or 4 channels. The JPEG encoder itself is serial, only the rows
+// are produced in parallel
+extern bool write_jpg_to_file(FILE *f, uint32_t width, uint32_t height, uint32_t channels,
+                              int quality, ImageRowsCallback rows);
+
+// rows are RGBA32 float, alpha is ignored. Negative values should already be clamped to 0
+extern bool write_hdr_to_file(FILE *f, uint32_t width, uint32_t height, ImageRowsCallback rows);
+
+// rows are RGBA32 float, stored uncompressed as either 16-bit or 32-bit floats
+extern bool write_exr_to_file(FILE *f, uint32_t width, uint32_t height, bool fullFloat,
+                              ImageRowsCallback rows);
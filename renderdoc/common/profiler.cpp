@@ -0,0 +1,426 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#include "common/profiler.h"
+#include "api/replay/renderdoc_replay.h"
+#include "common/formatting.h"
+#include "common/threading.h"
+#include "os/os_specific.h"
+
+namespace
+{
+// per-thread capacity, must be a power of two. Once full the oldest regions are overwritten
+static const int64_t RingSize = 1 << 16;
+
+struct ProfileEvent
+{
+  uint64_t tick;
+  // NULL for the end of a region
+  const char *name;
+  // nesting depth, the same for a region's begin and end
+  uint32_t depth;
+};
+
+struct ThreadEvents
+{
+  uint64_t threadID;
+  // only accessed by the owning thread
+  uint32_t depth;
+  // total number of events ever recorded. Incremented after each event is written, so readers know
+  // every event before it is complete
+  int64_t written;
+  // events before this index were discarded by Clear()
+  int64_t discarded;
+  ProfileEvent events[RingSize];
+};
+
+// ring buffers are never freed, so that regions from threads that have exited can still be written
+Threading::CriticalSection threadsLock;
+rdcarray<ThreadEvents *> threads;
+
+int32_t recording = 0;
+bool tlsAllocated = false;
+uint64_t tlsSlot = 0;
+uint64_t baseTick = 0;
+
+ThreadEvents *GetThreadEvents()
+{
+  ThreadEvents *t = (ThreadEvents *)Threading::GetTLSValue(tlsSlot);
+
+  if(t)
+    return t;
+
+  t = new ThreadEvents;
+  t->threadID = Threading::GetCurrentID();
+  t->depth = 0;
+  t->written = 0;
+  t->discarded = 0;
+
+  Threading::SetTLSValue(tlsSlot, t);
+
+  SCOPED_LOCK(threadsLock);
+  threads.push_back(t);
+
+  return t;
+}
+
+void RecordEvent(ThreadEvents *t, const char *name)
+{
+  ProfileEvent &ev = t->events[t->written & (RingSize - 1)];
+  ev.tick = Timing::GetTick();
+  ev.name = name;
+  ev.depth = t->depth;
+
+  // publish the event to any reader
+  Atomic::Inc64(&t->written);
+}
+
+rdcstr EscapeName(const char *name)
+{
+  rdcstr ret;
+  for(; *name; name++)
+  {
+    if(*name == '"' || *name == '\\')
+      ret.push_back('\\');
+    ret.push_back(*name);
+  }
+  return ret;
+}
+};
+
+namespace Profiler
+{
+void SetRecording(bool enabled)
+{
+  SCOPED_LOCK(threadsLock);
+
+  if(enabled == IsRecording())
+    return;
+
+  if(enabled)
+  {
+    if(!tlsAllocated)
+    {
+      tlsSlot = Threading::AllocateTLSSlot();
+      tlsAllocated = true;
+    }
+
+    if(baseTick == 0)
+      baseTick = Timing::GetTick();
+
+    Atomic::Inc32(&recording);
+    Atomic::Inc32(&RENDERDOC_ProfileRegionsActive);
+  }
+  else
+  {
+    Atomic::Dec32(&recording);
+    Atomic::Dec32(&RENDERDOC_ProfileRegionsActive);
+  }
+}
+
+bool IsRecording()
+{
+  return recording != 0;
+}
+
+void BeginRegion(const char *name)
+{
+  if(!IsRecording())
+    return;
+
+  ThreadEvents *t = GetThreadEvents();
+  RecordEvent(t, name);
+  t->depth++;
+}
+
+void EndRegion()
+{
+  // regions are still ended after recording stops, so that those already begun are complete. If
+  // this thread never began a region since recording started there's nothing to end
+  if(!tlsAllocated)
+    return;
+
+  ThreadEvents *t = (ThreadEvents *)Threading::GetTLSValue(tlsSlot);
+  if(!t || t->depth == 0)
+    return;
+
+  t->depth--;
+  RecordEvent(t, NULL);
+}
+
+rdcstr FormatTrace()
+{
+  rdcarray<ThreadEvents *> snapshot;
+  {
+    SCOPED_LOCK(threadsLock);
+    snapshot = threads;
+  }
+
+  const uint64_t now = Timing::GetTick();
+  // GetTickFrequency() is in ticks per millisecond, trace timestamps are in microseconds
+  const double microPerTick = 1000.0 / Timing::GetTickFrequency();
+  const uint32_t pid = Process::GetCurrentPID();
+
+  rdcstr ret = R"({
+  "displayTimeUnit": "ns",
+  "traceEvents": [)";
+
+  bool first = true;
+
+  auto addRegion = [&](uint64_t tid, const ProfileEvent &begin, uint64_t endTick) {
+    // stupid JSON not allowing trailing ,s :(
+    if(!first)
+      ret += ",";
+    first = false;
+
+    ret += StringFormat::Fmt(R"(
+    { "name": "%s", "cat": "RenderDoc", "ph": "X", "ts": %.3f, "dur": %.3f,)",
+                             EscapeName(begin.name).c_str(),
+                             double(begin.tick - baseTick) * microPerTick,
+                             double(endTick - begin.tick) * microPerTick);
+    ret += StringFormat::Fmt(R"( "pid": %u, "tid": %llu, "args": { "depth": %u } })", pid, tid,
+                             begin.depth);
+  };
+
+  rdcarray<ProfileEvent> events;
+  rdcarray<ProfileEvent> open;
+
+  for(ThreadEvents *t : snapshot)
+  {
+    // ExchAdd64 with 0 is used as an atomic read
+    const int64_t end = Atomic::ExchAdd64(&t->written, 0);
+    const int64_t begin = RDCMAX(end - RingSize, Atomic::ExchAdd64(&t->discarded, 0));
+
+    if(end <= begin)
+      continue;
+
+    events.resize(size_t(end - begin));
+    for(int64_t i = begin; i < end; i++)
+      events[size_t(i - begin)] = t->events[i & (RingSize - 1)];
+
+    // the owning thread keeps recording while we copy, so any events it has wrapped around and
+    // overwritten since are torn and must be dropped
+    const int64_t oldestValid = Atomic::ExchAdd64(&t->written, 0) - RingSize;
+    const size_t skip = oldestValid > begin ? size_t(oldestValid - begin) : 0;
+
+    open.clear();
+
+    for(size_t i = skip; i < events.size(); i++)
+    {
+      const ProfileEvent &ev = events[i];
+
+      if(ev.name)
+      {
+        open.push_back(ev);
+        continue;
+      }
+
+      // ends whose begin has been overwritten are dropped
+      while(!open.empty() && open.back().depth > ev.depth)
+        open.pop_back();
+
+      if(open.empty() || open.back().depth != ev.depth)
+        continue;
+
+      addRegion(t->threadID, open.back(), ev.tick);
+      open.pop_back();
+    }
+
+    // regions that are still going are written as if they ended now
+    for(const ProfileEvent &ev : open)
+      addRegion(t->threadID, ev, now);
+  }
+
+  ret += R"(
+  ]
+}
+)";
+
+  return ret;
+}
+
+bool WriteTrace(const rdcstr &filename)
+{
+  rdcstr trace = FormatTrace();
+
+  if(!FileIO::WriteAll(filename, trace))
+  {
+    RDCERR("Couldn't write profile trace to '%s'", filename.c_str());
+    return false;
+  }
+
+  RDCLOG("Wrote profile trace to '%s'", filename.c_str());
+
+  return true;
+}
+
+void Clear()
+{
+  SCOPED_LOCK(threadsLock);
+
+  for(ThreadEvents *t : threads)
+  {
+    t->discarded = Atomic::ExchAdd64(&t->written, 0);
+  }
+}
+};
+
+#if ENABLED(ENABLE_UNIT_TESTS)
+
+#include "catch/catch.hpp"
+
+TEST_CASE("Profiler records nested regions per thread", "[profiler]")
+{
+  Profiler::SetRecording(true);
+  Profiler::Clear();
+
+  SECTION("Nested regions")
+  {
+    Profiler::BeginRegion("Outer");
+    Profiler::BeginRegion("Inner \"quoted\"");
+    Profiler::EndRegion();
+    Profiler::EndRegion();
+
+    rdcstr trace = Profiler::FormatTrace();
+
+    CHECK(trace.contains(R"("name": "Outer")"));
+    CHECK(trace.contains(R"("name": "Inner \"quoted\"")"));
+    CHECK(trace.contains(R"("depth": 0)"));
+    CHECK(trace.contains(R"("depth": 1)"));
+    CHECK(trace.contains(StringFormat::Fmt(R"("tid": %llu)", Threading::GetCurrentID())));
+  }
+
+  SECTION("Regions on other threads")
+  {
+    uint64_t workerID = 0;
+
+    Threading::ThreadHandle thread = Threading::CreateThread([&workerID]() {
+      workerID = Threading::GetCurrentID();
+      Profiler::BeginRegion("Worker");
+      Profiler::EndRegion();
+    });
+    Threading::JoinThread(thread);
+    Threading::CloseThread(thread);
+
+    rdcstr trace = Profiler::FormatTrace();
+
+    CHECK(trace.contains(R"("name": "Worker")"));
+    CHECK(trace.contains(StringFormat::Fmt(R"("tid": %llu)", workerID)));
+  }
+
+  SECTION("Regions begun before recording stops are still ended")
+  {
+    Profiler::BeginRegion("Recorded");
+    Profiler::SetRecording(false);
+    Profiler::BeginRegion("Ignored");
+    Profiler::EndRegion();
+    Profiler::EndRegion();
+    Profiler::SetRecording(true);
+
+    rdcstr trace = Profiler::FormatTrace();
+
+    CHECK(trace.contains(R"("name": "Recorded")"));
+    CHECK_FALSE(trace.contains(R"("name": "Ignored")"));
+  }
+
+  SECTION("Unfinished regions are written")
+  {
+    Profiler::BeginRegion("Unfinished");
+
+    rdcstr trace = Profiler::FormatTrace();
+
+    Profiler::EndRegion();
+
+    CHECK(trace.contains(R"("name": "Unfinished")"));
+  }
+
+  SECTION("Overwritten regions are dropped")
+  {
+    Profiler::BeginRegion("Overwritten");
+    for(int64_t i = 0; i < RingSize; i++)
+    {
+      Profiler::BeginRegion("Filler");
+      Profiler::EndRegion();
+    }
+    Profiler::EndRegion();
+
+    rdcstr trace = Profiler::FormatTrace();
+
+    CHECK_FALSE(trace.contains(R"("name": "Overwritten")"));
+    CHECK(trace.contains(R"("name": "Filler")"));
+  }
+
+  SECTION("Cleared regions are not written")
+  {
+    Profiler::BeginRegion("Cleared");
+    Profiler::EndRegion();
+
+    Profiler::Clear();
+
+    CHECK_FALSE(Profiler::FormatTrace().contains(R"("name": "Cleared")"));
+  }
+
+  Profiler::SetRecording(false);
+  Profiler::Clear();
+}
+
+#if !RENDERDOC_STABLE_BUILD
+
+TEST_CASE("Benchmark profile region overhead", "[.][benchmark][profiler]")
+{
+  const int iterations = 10000000;
+
+  auto run = [iterations]() {
+    uint64_t start = Timing::GetTick();
+    for(int i = 0; i < iterations; i++)
+    {
+      RENDERDOC_PROFILEREGION("Benchmark");
+    }
+    return double(Timing::GetTick() - start) / Timing::GetTickFrequency();
+  };
+
+  const bool wasRecording = Profiler::IsRecording();
+
+  Profiler::SetRecording(false);
+  double disabled = run();
+
+  // don't measure the first allocation of this thread's ring buffer
+  Profiler::SetRecording(true);
+  Profiler::BeginRegion("Warmup");
+  Profiler::EndRegion();
+  double enabled = run();
+
+  Profiler::SetRecording(wasRecording);
+  Profiler::Clear();
+
+  WARN(StringFormat::Fmt("%d regions:", iterations));
+  WARN(StringFormat::Fmt("  not recording: %.2f ms (%.2f ns per region)", disabled,
+                         disabled * 1000000.0 / iterations));
+  WARN(StringFormat::Fmt("  recording: %.2f ms (%.2f ns per region)", enabled,
+                         enabled * 1000000.0 / iterations));
+}
+
+#endif
+
+#endif    // ENABLED(ENABLE_UNIT_TESTS)
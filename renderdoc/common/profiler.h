@@ -0,0 +1,55 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#pragma once
+
+#include "api/replay/rdcstr.h"
+#include "common/common.h"
+
+// a lightweight built-in backend for the RENDERDOC_PROFILEREGION/RENDERDOC_PROFILEFUNCTION macros,
+// so that profile regions can be inspected on platforms without an external profiler.
+//
+// Each thread records into its own fixed-size ring buffer, so recording never takes a lock and
+// only the most recent regions are kept. The regions can be written at any time as Chrome trace
+// JSON, which can be loaded in chrome://tracing or the Perfetto UI.
+//
+// While nothing is consuming profile regions RENDERDOC_ProfileRegionsActive is 0, so the macros
+// cost a single branch.
+namespace Profiler
+{
+// start or stop recording regions. Regions recorded so far are kept when recording stops
+void SetRecording(bool enabled);
+bool IsRecording();
+
+// region names must stay valid until the trace is written, e.g. string literals.
+void BeginRegion(const char *name);
+void EndRegion();
+
+// formats every region still in the ring buffers as a Chrome trace JSON document
+rdcstr FormatTrace();
+bool WriteTrace(const rdcstr &filename);
+
+// discard all recorded regions, mostly useful for tests
+void Clear();
+};
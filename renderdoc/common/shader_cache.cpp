@@ -0,0 +1,610 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#include "shader_cache.h"
+#include <algorithm>
+#include "common/threading.h"
+#include "zstd/xxhash.h"
+#include "zstd/zstd.h"
+
+static const int shaderCacheCompressionLevel = 7;
+
+uint64_t ShaderCacheHash(const rdcstr &str, uint64_t hash)
+{
+  return XXH64(str.c_str(), str.size(), hash);
+}
+
+ShaderCacheFile::~ShaderCacheFile()
+{
+  Close();
+}
+
+void ShaderCacheFile::Close()
+{
+  if(m_Mapping)
+    FileIO::funmap(m_Mapping, m_MappingSize);
+
+  m_Mapping = NULL;
+  m_MappingSize = 0;
+  m_Contents.clear();
+  m_Data = NULL;
+  m_FileSize = 0;
+
+  m_Index.clear();
+  m_LiveBytes = 0;
+}
+
+bool ShaderCacheFile::Open(const rdcstr &filename, uint32_t magicNumber, uint32_t versionNumber)
+{
+  Close();
+
+  m_Filename = filename;
+  m_Magic = magicNumber;
+  m_Version = versionNumber;
+
+  FILE *f = FileIO::fopen(filename, FileIO::ReadBinary);
+
+  if(!f)
+    return false;
+
+  FileIO::fseek64(f, 0, SEEK_END);
+  m_FileSize = FileIO::ftell64(f);
+  FileIO::fseek64(f, 0, SEEK_SET);
+
+  if(m_FileSize < sizeof(Header))
+  {
+    FileIO::fclose(f);
+    Close();
+    return false;
+  }
+
+  m_Mapping = FileIO::fmap(f, m_FileSize);
+
+  if(m_Mapping)
+  {
+    m_MappingSize = m_FileSize;
+    m_Data = m_Mapping;
+  }
+  else
+  {
+    m_Contents.resize((size_t)m_FileSize);
+    if(FileIO::fread(m_Contents.data(), 1, m_Contents.size(), f) == m_Contents.size())
+      m_Data = m_Contents.data();
+  }
+
+  FileIO::fclose(f);
+
+  if(!m_Data)
+  {
+    RDCERR("Couldn't read shader cache '%s'", filename.c_str());
+    Close();
+    return false;
+  }
+
+  Header header;
+  memcpy(&header, m_Data, sizeof(header));
+
+  if(header.globalMagic != ShaderCacheMagic || header.magicNumber != magicNumber ||
+     header.versionNumber != versionNumber)
+  {
+    Close();
+    return false;
+  }
+
+  if(header.indexOffset < sizeof(Header) || header.indexOffset > m_FileSize ||
+     (m_FileSize - header.indexOffset) / sizeof(Entry) < header.numEntries)
+  {
+    RDCWARN("Shader cache '%s' has an invalid index, discarding", filename.c_str());
+    Close();
+    return false;
+  }
+
+  m_Index.resize(header.numEntries);
+  memcpy(m_Index.data(), m_Data + header.indexOffset, m_Index.byteSize());
+
+  for(size_t i = 0; i < m_Index.size(); i++)
+  {
+    const Entry &e = m_Index[i];
+
+    if(e.offset < sizeof(Header) || e.offset > header.indexOffset ||
+       header.indexOffset - e.offset < e.compressedSize || (i > 0 && !(m_Index[i - 1] < e)))
+    {
+      RDCWARN("Shader cache '%s' has an invalid entry, discarding", filename.c_str());
+      Close();
+      return false;
+    }
+
+    m_LiveBytes += e.compressedSize;
+  }
+
+  return true;
+}
+
+const ShaderCacheFile::Entry *ShaderCacheFile::FindEntry(uint64_t key) const
+{
+  Entry search = {};
+  search.key = key;
+
+  auto it = std::lower_bound(m_Index.begin(), m_Index.end(), search);
+
+  if(it != m_Index.end() && it->key == key)
+    return it;
+
+  return NULL;
+}
+
+bool ShaderCacheFile::Decompress(const byte *compressed, uint32_t compressedSize, uint32_t size,
+                                 bytebuf &data) const
+{
+  data.resize(size);
+
+  size_t ret = ZSTD_decompress(data.data(), size, compressed, compressedSize);
+
+  if(ZSTD_isError(ret) || ret != size)
+  {
+    RDCERR("Couldn't decompress shader cache entry from '%s'", m_Filename.c_str());
+    data.clear();
+    return false;
+  }
+
+  return true;
+}
+
+bool ShaderCacheFile::Read(uint64_t key, bytebuf &data) const
+{
+  auto it = m_Pending.find(key);
+  if(it != m_Pending.end())
+  {
+    data = it->second.data;
+    return true;
+  }
+
+  const Entry *e = FindEntry(key);
+  if(!e)
+    return false;
+
+  return Decompress(m_Data + e->offset, e->compressedSize, e->size, data);
+}
+
+void ShaderCacheFile::Write(uint64_t key, const byte *data, uint32_t length)
+{
+  // compressing at this level is slow, so leave it until the cache is saved rather than holding up
+  // whoever created the entry
+  m_Pending[key].data.assign(data, length);
+}
+
+bool ShaderCacheFile::Compress()
+{
+  rdcarray<PendingEntry *> entries;
+  for(auto it = m_Pending.begin(); it != m_Pending.end(); ++it)
+    entries.push_back(&it->second);
+
+  int32_t failed = 0;
+
+  Threading::Jobs::ParallelFor(0, (uint32_t)entries.size(), [&entries, &failed](uint32_t i) {
+    PendingEntry &entry = *entries[i];
+
+    entry.compressed.resize(ZSTD_compressBound(entry.data.size()));
+
+    size_t compressedSize =
+        ZSTD_compress(entry.compressed.data(), entry.compressed.size(), entry.data.data(),
+                      entry.data.size(), shaderCacheCompressionLevel);
+
+    if(ZSTD_isError(compressedSize))
+    {
+      RDCERR("Couldn't compress shader cache entry: %s", ZSTD_getErrorName(compressedSize));
+      Atomic::Inc32(&failed);
+      return;
+    }
+
+    entry.compressed.resize(compressedSize);
+  });
+
+  return failed == 0;
+}
+
+size_t ShaderCacheFile::NumEntries() const
+{
+  size_t ret = m_Index.size();
+
+  for(auto it = m_Pending.begin(); it != m_Pending.end(); ++it)
+    if(!FindEntry(it->first))
+      ret++;
+
+  return ret;
+}
+
+void ShaderCacheFile::Save()
+{
+  if(m_Pending.empty())
+    return;
+
+  if(!Compress())
+  {
+    RDCERR("Error compressing shader cache '%s'", m_Filename.c_str());
+    return;
+  }
+
+  uint64_t replacedBytes = 0, pendingBytes = 0;
+  for(auto it = m_Pending.begin(); it != m_Pending.end(); ++it)
+  {
+    const Entry *e = FindEntry(it->first);
+    if(e)
+      replacedBytes += e->compressedSize;
+    pendingBytes += it->second.compressed.size();
+  }
+
+  // everything in the file that isn't a live entry is stale once a new index is written, including
+  // the current index
+  const uint64_t liveBytes = m_LiveBytes - replacedBytes + pendingBytes;
+  const uint64_t staleBytes = m_Data ? m_FileSize - sizeof(Header) - m_LiveBytes + replacedBytes : 0;
+
+  bool success;
+  if(!m_Data || staleBytes > liveBytes)
+    success = Rewrite();
+  else
+    success = Append();
+
+  if(!success)
+  {
+    RDCERR("Error writing shader cache '%s'", m_Filename.c_str());
+    return;
+  }
+
+  RDCDEBUG("Wrote %zu entries to shader cache '%s'", m_Pending.size(), m_Filename.c_str());
+
+  m_Pending.clear();
+
+  Open(m_Filename, m_Magic, m_Version);
+}
+
+bool ShaderCacheFile::Rewrite()
+{
+  rdcstr tmpFilename = m_Filename + ".tmp";
+
+  FILE *f = FileIO::fopen(tmpFilename, FileIO::WriteBinary);
+
+  if(!f)
+  {
+    RDCERR("Error opening shader cache '%s' for write", tmpFilename.c_str());
+    return false;
+  }
+
+  Header header = {ShaderCacheMagic, m_Magic, m_Version, 0, sizeof(Header)};
+
+  bool success = FileIO::fwrite(&header, sizeof(header), 1, f) == 1;
+
+  rdcarray<Entry> index;
+  index.reserve(m_Index.size() + m_Pending.size());
+
+  // copy across the entries that are still live without recompressing them
+  for(const Entry &e : m_Index)
+  {
+    if(m_Pending.find(e.key) != m_Pending.end())
+      continue;
+
+    success &= FileIO::fwrite(m_Data + e.offset, 1, e.compressedSize, f) == e.compressedSize;
+
+    index.push_back({e.key, header.indexOffset, e.compressedSize, e.size});
+    header.indexOffset += e.compressedSize;
+  }
+
+  for(auto it = m_Pending.begin(); it != m_Pending.end(); ++it)
+  {
+    const bytebuf &compressed = it->second.compressed;
+    const uint32_t size = (uint32_t)it->second.data.size();
+
+    success &= FileIO::fwrite(compressed.data(), 1, compressed.size(), f) == compressed.size();
+
+    index.push_back({it->first, header.indexOffset, (uint32_t)compressed.size(), size});
+    header.indexOffset += compressed.size();
+  }
+
+  std::sort(index.begin(), index.end());
+  header.numEntries = (uint32_t)index.size();
+
+  success &= FileIO::fwrite(index.data(), sizeof(Entry), index.size(), f) == index.size();
+
+  FileIO::fseek64(f, 0, SEEK_SET);
+  success &= FileIO::fwrite(&header, sizeof(header), 1, f) == 1;
+
+  FileIO::fclose(f);
+
+  // the old file can't be replaced while it's still mapped
+  Close();
+
+  if(success)
+    success = FileIO::Move(tmpFilename, m_Filename, true);
+
+  if(!success)
+    FileIO::Delete(tmpFilename);
+
+  return success;
+}
+
+bool ShaderCacheFile::Append()
+{
+  rdcarray<Entry> index;
+  index.reserve(m_Index.size() + m_Pending.size());
+
+  for(const Entry &e : m_Index)
+    if(m_Pending.find(e.key) == m_Pending.end())
+      index.push_back(e);
+
+  // nothing is read from the old contents from here on
+  Close();
+
+  FILE *f = FileIO::fopen(m_Filename, FileIO::UpdateBinary);
+
+  if(!f)
+  {
+    RDCERR("Error opening shader cache '%s' for update", m_Filename.c_str());
+    return false;
+  }
+
+  FileIO::fseek64(f, 0, SEEK_END);
+
+  Header header = {ShaderCacheMagic, m_Magic, m_Version, 0, FileIO::ftell64(f)};
+
+  bool success = true;
+
+  for(auto it = m_Pending.begin(); it != m_Pending.end(); ++it)
+  {
+    const bytebuf &compressed = it->second.compressed;
+    const uint32_t size = (uint32_t)it->second.data.size();
+
+    success &= FileIO::fwrite(compressed.data(), 1, compressed.size(), f) == compressed.size();
+
+    index.push_back({it->first, header.indexOffset, (uint32_t)compressed.size(), size});
+    header.indexOffset += compressed.size();
+  }
+
+  std::sort(index.begin(), index.end());
+  header.numEntries = (uint32_t)index.size();
+
+  success &= FileIO::fwrite(index.data(), sizeof(Entry), index.size(), f) == index.size();
+
+  // the header is written last, so if anything above fails the file still points at the previous
+  // index which hasn't been touched
+  if(success)
+  {
+    FileIO::fseek64(f, 0, SEEK_SET);
+    success &= FileIO::fwrite(&header, sizeof(header), 1, f) == 1;
+  }
+
+  FileIO::fclose(f);
+
+  return success;
+}
+
+#if ENABLED(ENABLE_UNIT_TESTS)
+
+#include "catch/catch.hpp"
+
+TEST_CASE("Indexed shader cache", "[shadercache]")
+{
+  const rdcstr filename = FileIO::GetTempFolderFilename() + "renderdoc_shader_cache_test.cache";
+  const uint32_t magic = 0x12345678, version = 3;
+
+  FileIO::Delete(filename);
+
+  auto makeData = [](uint32_t seed, size_t size) {
+    bytebuf ret;
+    ret.resize(size);
+    for(size_t i = 0; i < size; i++)
+      ret[i] = byte((i / 16) * seed);
+    return ret;
+  };
+
+  const bytebuf a = makeData(3, 1000), b = makeData(5, 20000), c = makeData(7, 3);
+
+  {
+    ShaderCacheFile cache;
+    CHECK_FALSE(cache.Open(filename, magic, version));
+    CHECK(cache.NumEntries() == 0);
+
+    cache.Write(100, a.data(), (uint32_t)a.size());
+    cache.Write(~0ULL, b.data(), (uint32_t)b.size());
+    cache.Write(7, c.data(), (uint32_t)c.size());
+
+    // entries can be read before they're written to disk
+    bytebuf data;
+    CHECK(cache.Read(100, data));
+    CHECK((data == a));
+
+    cache.Save();
+
+    CHECK(cache.NumEntries() == 3);
+  }
+
+  const uint64_t firstSize = FileIO::GetFileSize(filename);
+
+  {
+    ShaderCacheFile cache;
+    REQUIRE(cache.Open(filename, magic, version));
+    CHECK(cache.NumEntries() == 3);
+
+    bytebuf data;
+    CHECK(cache.Read(100, data));
+    CHECK((data == a));
+    CHECK(cache.Read(~0ULL, data));
+    CHECK((data == b));
+    CHECK(cache.Read(7, data));
+    CHECK((data == c));
+    CHECK_FALSE(cache.Read(8, data));
+  }
+
+  SECTION("Different version")
+  {
+    ShaderCacheFile cache;
+    CHECK_FALSE(cache.Open(filename, magic, version + 1));
+    CHECK(cache.NumEntries() == 0);
+  }
+
+  SECTION("Corrupted file")
+  {
+    FILE *f = FileIO::fopen(filename, FileIO::UpdateBinary);
+    REQUIRE(f);
+    FileIO::fseek64(f, sizeof(uint32_t) * 4, SEEK_SET);
+    uint64_t badOffset = firstSize + 1;
+    FileIO::fwrite(&badOffset, sizeof(badOffset), 1, f);
+    FileIO::fclose(f);
+
+    ShaderCacheFile cache;
+    CHECK_FALSE(cache.Open(filename, magic, version));
+    CHECK(cache.NumEntries() == 0);
+  }
+
+  SECTION("New entries are appended")
+  {
+    const bytebuf d = makeData(9, 500), a2 = makeData(11, 1000);
+
+    {
+      ShaderCacheFile cache;
+      REQUIRE(cache.Open(filename, magic, version));
+
+      cache.Write(50, d.data(), (uint32_t)d.size());
+      cache.Write(100, a2.data(), (uint32_t)a2.size());
+      CHECK(cache.NumEntries() == 4);
+
+      cache.Save();
+    }
+
+    CHECK(FileIO::GetFileSize(filename) > firstSize);
+
+    ShaderCacheFile cache;
+    REQUIRE(cache.Open(filename, magic, version));
+    CHECK(cache.NumEntries() == 4);
+
+    bytebuf data;
+    CHECK(cache.Read(50, data));
+    CHECK((data == d));
+    CHECK(cache.Read(100, data));
+    CHECK((data == a2));
+    CHECK(cache.Read(~0ULL, data));
+    CHECK((data == b));
+  }
+
+  SECTION("Stale data is compacted")
+  {
+    bytebuf big;
+    big.resize(64 * 1024);
+    for(size_t i = 0; i < big.size(); i++)
+      big[i] = byte((rand() & 0xff0) >> 4);
+
+    uint64_t maxSize = 0;
+
+    for(int i = 0; i < 8; i++)
+    {
+      big[0] = byte(i);
+
+      ShaderCacheFile cache;
+      REQUIRE(cache.Open(filename, magic, version));
+      cache.Write(1234, big.data(), (uint32_t)big.size());
+      cache.Save();
+
+      maxSize = RDCMAX(maxSize, FileIO::GetFileSize(filename));
+    }
+
+    // without compaction each replaced copy would still be in the file
+    CHECK(maxSize < big.size() * 3);
+
+    ShaderCacheFile cache;
+    REQUIRE(cache.Open(filename, magic, version));
+    CHECK(cache.NumEntries() == 4);
+
+    bytebuf data;
+    CHECK(cache.Read(1234, data));
+    CHECK((data == big));
+    CHECK(cache.Read(7, data));
+    CHECK((data == c));
+  }
+
+  SECTION("Results are only created when looked up")
+  {
+    struct TestCallbacks
+    {
+      mutable int created = 0, destroyed = 0;
+
+      bool Create(uint32_t size, byte *data, bytebuf **ret) const
+      {
+        created++;
+        *ret = new bytebuf(data, size);
+        return true;
+      }
+
+      void Destroy(bytebuf *buf) const
+      {
+        destroyed++;
+        delete buf;
+      }
+      uint32_t GetSize(bytebuf *buf) const { return (uint32_t)buf->size(); }
+      const byte *GetData(bytebuf *buf) const { return buf->data(); }
+    } callbacks;
+
+    {
+      ShaderCache<bytebuf *, TestCallbacks> cache(callbacks);
+      REQUIRE(cache.Open(filename, magic, version));
+
+      CHECK(callbacks.created == 0);
+
+      bytebuf *result = NULL;
+      CHECK(cache.Find(~0ULL, result));
+      REQUIRE(result);
+      CHECK((*result == b));
+      CHECK(callbacks.created == 1);
+
+      bytebuf *again = NULL;
+      CHECK(cache.Find(~0ULL, again));
+      CHECK(again == result);
+      CHECK(callbacks.created == 1);
+
+      CHECK_FALSE(cache.Find(8, result));
+
+      cache.Insert(8, new bytebuf(c));
+      CHECK(cache.Find(8, result));
+      CHECK((*result == c));
+
+      // replacing an entry doesn't destroy the result that was handed out
+      cache.Insert(8, new bytebuf(a));
+      CHECK(callbacks.destroyed == 0);
+      CHECK((*result == c));
+
+      CHECK(cache.Find(8, result));
+      CHECK((*result == a));
+
+      cache.Save();
+    }
+
+    CHECK(callbacks.destroyed == 3);
+
+    ShaderCacheFile cache;
+    REQUIRE(cache.Open(filename, magic, version));
+    CHECK(cache.NumEntries() == 4);
+  }
+
+  FileIO::Delete(filename);
+}
+
+#endif
@@ -26,115 +26,167 @@
 
 #include <map>
 #include "common/common.h"
-#include "serialise/streamio.h"
-#include "serialise/zstdio.h"
-
-static const uint32_t ShaderCacheMagic = MAKE_FOURCC('R', 'D', '$', '$');
-
-template <typename ResultType, typename ShaderCallbacks>
-bool LoadShaderCache(const rdcstr &filename, const uint32_t magicNumber, const uint32_t versionNumber,
-                     std::map<uint32_t, ResultType> &resultCache, const ShaderCallbacks &callbacks)
+#include "os/os_specific.h"
+
+// bumped from the original 'RD$$' when the file became indexed, so old caches are discarded
+static const uint32_t ShaderCacheMagic = MAKE_FOURCC('R', 'D', '$', 'I');
+
+// hashes shader sources and parameters into cache keys. Chain calls by passing the previous hash
+uint64_t ShaderCacheHash(const rdcstr &str, uint64_t hash = 0);
+
+// The on-disk file behind a shader cache. Each entry is compressed separately and the file ends
+// with a table of entries sorted by key, so opening the cache only reads the table. Entries are
+// decompressed straight out of the mapped file the first time they're read.
+//
+// New entries are appended along with a new table when the cache is saved, leaving the old table
+// and any replaced entries behind as stale data. Once that outweighs the live entries the file is
+// rewritten without it.
+class ShaderCacheFile
 {
-  rdcstr shadercache = FileIO::GetAppFolderFilename(filename);
-
-  StreamReader fileReader(FileIO::fopen(shadercache, FileIO::ReadBinary));
+public:
+  ShaderCacheFile() = default;
+  ~ShaderCacheFile();
 
-  uint32_t globalMagic = 0, localMagic = 0, version = 0;
-  fileReader.Read(globalMagic);
-  fileReader.Read(localMagic);
-  fileReader.Read(version);
+  ShaderCacheFile(const ShaderCacheFile &) = delete;
+  ShaderCacheFile &operator=(const ShaderCacheFile &) = delete;
 
-  if(globalMagic != ShaderCacheMagic || localMagic != magicNumber || version != versionNumber)
-    return false;
+  // opens the cache at the given absolute path. Returns false if there's no valid cache with these
+  // magic and version numbers, in which case the cache starts empty and is rewritten on save.
+  bool Open(const rdcstr &filename, uint32_t magicNumber, uint32_t versionNumber);
 
-  uint64_t uncompressedSize = 0;
-  fileReader.Read(uncompressedSize);
+  // decompresses the entry with the given key into data. Returns false if there's no such entry
+  bool Read(uint64_t key, bytebuf &data) const;
 
-  // header has been read. The rest is zstd compressed
-  StreamReader compressedReader(new ZSTDDecompressor(&fileReader, Ownership::Nothing),
-                                uncompressedSize, Ownership::Stream);
+  // adds an entry, or replaces an existing one, to be written to disk on the next save. The data
+  // is copied, and only compressed when saving
+  void Write(uint64_t key, const byte *data, uint32_t length);
 
-  uint32_t numentries = 0;
-  compressedReader.Read(numentries);
+  // compresses any new entries on the job workers and writes them to disk
+  void Save();
 
-  bool ret = true;
-  bytebuf data;
+  size_t NumEntries() const;
 
-  for(uint32_t i = 0; i < numentries; i++)
+private:
+  struct Entry
   {
-    uint32_t hash = 0, length = 0;
-    compressedReader.Read(hash);
-    compressedReader.Read(length);
+    uint64_t key;
+    uint64_t offset;
+    uint32_t compressedSize;
+    uint32_t size;
 
-    data.resize(length);
-    compressedReader.Read(data.data(), length);
-
-    ResultType result;
-    bool created = callbacks.Create(length, data.data(), &result);
-
-    if(!created)
-    {
-      RDCERR("Couldn't create blob of size %u from shadercache", length);
-      ret = false;
-      break;
-    }
-
-    resultCache[hash] = result;
-  }
-
-  return ret && !compressedReader.IsErrored() && !fileReader.IsErrored();
-}
+    bool operator<(const Entry &o) const { return key < o.key; }
+  };
 
+  struct Header
+  {
+    uint32_t globalMagic;
+    uint32_t magicNumber;
+    uint32_t versionNumber;
+    uint32_t numEntries;
+    uint64_t indexOffset;
+  };
+
+  void Close();
+  const Entry *FindEntry(uint64_t key) const;
+  bool Decompress(const byte *compressed, uint32_t compressedSize, uint32_t size,
+                  bytebuf &data) const;
+  bool Compress();
+  bool Rewrite();
+  bool Append();
+
+  rdcstr m_Filename;
+  uint32_t m_Magic = 0, m_Version = 0;
+
+  // the file contents, mapped if possible or otherwise read in
+  byte *m_Mapping = NULL;
+  uint64_t m_MappingSize = 0;
+  bytebuf m_Contents;
+  const byte *m_Data = NULL;
+  uint64_t m_FileSize = 0;
+
+  // sorted by key
+  rdcarray<Entry> m_Index;
+  uint64_t m_LiveBytes = 0;
+
+  struct PendingEntry
+  {
+    bytebuf data;
+    bytebuf compressed;
+  };
+  std::map<uint64_t, PendingEntry> m_Pending;
+};
+
+// Holds the results created from a ShaderCacheFile, such as shader blobs, which are only created
+// when they're first looked up. Results handed out stay valid until the cache is destroyed, even if
+// their entry is replaced. The callbacks convert to and from bytes on disk:
+//
+//   bool Create(uint32_t size, byte *data, ResultType *result);
+//   void Destroy(ResultType result);
+//   uint32_t GetSize(ResultType result);
+//   const byte *GetData(ResultType result);
 template <typename ResultType, typename ShaderCallbacks>
-void SaveShaderCache(const rdcstr &filename, uint32_t magicNumber, uint32_t versionNumber,
-                     const std::map<uint32_t, ResultType> &cache, const ShaderCallbacks &callbacks)
+class ShaderCache
 {
-  rdcstr shadercache = FileIO::GetAppFolderFilename(filename);
-
-  FILE *f = FileIO::fopen(shadercache, FileIO::WriteBinary);
-
-  if(!f)
+public:
+  ShaderCache(const ShaderCallbacks &callbacks) : m_Callbacks(callbacks) {}
+  ~ShaderCache()
   {
-    RDCERR("Error opening shader cache for write");
-    return;
+    for(auto it = m_Results.begin(); it != m_Results.end(); ++it)
+      m_Callbacks.Destroy(it->second);
+    for(ResultType result : m_Replaced)
+      m_Callbacks.Destroy(result);
   }
 
-  StreamWriter fileWriter(f, Ownership::Stream);
-
-  fileWriter.Write(ShaderCacheMagic);
-  fileWriter.Write(magicNumber);
-  fileWriter.Write(versionNumber);
-
-  uint32_t numentries = (uint32_t)cache.size();
-
-  uint64_t uncompressedSize = sizeof(numentries);    // number of entries
+  bool Open(const rdcstr &filename, uint32_t magicNumber, uint32_t versionNumber)
+  {
+    return m_File.Open(filename, magicNumber, versionNumber);
+  }
 
-  // hash + length + data for each entry
-  for(auto it = cache.begin(); it != cache.end(); ++it)
-    uncompressedSize += sizeof(uint32_t) * 2 + callbacks.GetSize(it->second);
+  // the returned result is owned by the cache
+  bool Find(uint64_t key, ResultType &result)
+  {
+    auto it = m_Results.find(key);
+    if(it != m_Results.end())
+    {
+      result = it->second;
+      return true;
+    }
 
-  fileWriter.Write(uncompressedSize);
+    bytebuf data;
+    if(!m_File.Read(key, data))
+      return false;
 
-  StreamWriter compressedWriter(new ZSTDCompressor(&fileWriter, Ownership::Nothing),
-                                Ownership::Stream);
+    if(!m_Callbacks.Create((uint32_t)data.size(), data.data(), &result))
+    {
+      RDCERR("Couldn't create blob of size %zu from shadercache", data.size());
+      return false;
+    }
 
-  compressedWriter.Write(numentries);
+    m_Results[key] = result;
+    return true;
+  }
 
-  for(auto it = cache.begin(); it != cache.end(); ++it)
+  // the cache takes ownership of result, replacing any existing result for the key
+  void Insert(uint64_t key, ResultType result)
   {
-    uint32_t hash = it->first;
-    uint32_t len = callbacks.GetSize(it->second);
-    const byte *data = callbacks.GetData(it->second);
-
-    compressedWriter.Write(hash);
-    compressedWriter.Write(len);
-    compressedWriter.Write(data, len);
+    auto it = m_Results.find(key);
+    if(it != m_Results.end())
+    {
+      if(it->second == result)
+        return;
+      // the old result may still be in use by whoever found it
+      m_Replaced.push_back(it->second);
+    }
 
-    callbacks.Destroy(it->second);
+    m_Results[key] = result;
+    m_File.Write(key, m_Callbacks.GetData(result), m_Callbacks.GetSize(result));
   }
 
-  compressedWriter.Finish();
+  void Save() { m_File.Save(); }
 
-  RDCDEBUG("Successfully wrote %u entries to cache, compressed from %llu to %llu", numentries,
-           uncompressedSize, fileWriter.GetOffset());
-}
+private:
+  const ShaderCallbacks &m_Callbacks;
+  ShaderCacheFile m_File;
+  std::map<uint64_t, ResultType> m_Results;
+  rdcarray<ResultType> m_Replaced;
+};
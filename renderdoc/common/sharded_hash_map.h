@@ -0,0 +1,182 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <unordered_map>
+#include "common/threading.h"
+
+// A thread-safe hash map split into shards by key, each with its own lock. Threads working on
+// different keys rarely share a shard so they don't contend, and lookups only take a shard's read
+// lock so they run concurrently even on the same shard.
+//
+// Each call locks only for its own duration. Iterating locks one shard at a time, so it sees a
+// consistent view of each shard but not of the whole map if it's modified concurrently.
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+class ShardedHashMap
+{
+public:
+  ShardedHashMap() = default;
+  ShardedHashMap(const ShardedHashMap &) = delete;
+  ShardedHashMap &operator=(const ShardedHashMap &) = delete;
+
+  bool Find(const Key &key, Value &value) const
+  {
+    const Shard &shard = GetShard(key);
+    SCOPED_READLOCK(shard.lock);
+    auto it = shard.entries.find(key);
+    if(it == shard.entries.end())
+      return false;
+    value = it->second;
+    return true;
+  }
+
+  bool Contains(const Key &key) const
+  {
+    const Shard &shard = GetShard(key);
+    SCOPED_READLOCK(shard.lock);
+    return shard.entries.find(key) != shard.entries.end();
+  }
+
+  // adds an entry if there isn't already one for the key, returning true if it was added. Keys
+  // that are already present only take the read lock.
+  bool Insert(const Key &key, const Value &value)
+  {
+    if(Contains(key))
+      return false;
+
+    Shard &shard = GetShard(key);
+    SCOPED_WRITELOCK(shard.lock);
+    return shard.entries.insert(std::make_pair(key, value)).second;
+  }
+
+  // calls func(Value &value, bool added) on the entry for the key, adding a default constructed
+  // value first if there isn't one. Returns whether the entry was added.
+  template <typename Func>
+  bool Modify(const Key &key, Func func)
+  {
+    Shard &shard = GetShard(key);
+    SCOPED_WRITELOCK(shard.lock);
+    auto it = shard.entries.find(key);
+    const bool added = (it == shard.entries.end());
+    if(added)
+      it = shard.entries.insert(std::make_pair(key, Value())).first;
+    func(it->second, added);
+    return added;
+  }
+
+  // returns true if there was an entry to remove
+  bool Erase(const Key &key)
+  {
+    Shard &shard = GetShard(key);
+    SCOPED_WRITELOCK(shard.lock);
+    return shard.entries.erase(key) > 0;
+  }
+
+  void Clear()
+  {
+    for(Shard &shard : m_Shards)
+    {
+      SCOPED_WRITELOCK(shard.lock);
+      shard.entries.clear();
+    }
+  }
+
+  size_t Size() const
+  {
+    size_t ret = 0;
+    for(const Shard &shard : m_Shards)
+    {
+      SCOPED_READLOCK(shard.lock);
+      ret += shard.entries.size();
+    }
+    return ret;
+  }
+
+  bool IsEmpty() const { return Size() == 0; }
+  // calls func(const Key &key, const Value &value) on every entry, in no particular order. func
+  // must not modify this map.
+  template <typename Func>
+  void ForEach(Func func) const
+  {
+    for(const Shard &shard : m_Shards)
+    {
+      SCOPED_READLOCK(shard.lock);
+      for(auto it = shard.entries.begin(); it != shard.entries.end(); ++it)
+        func(it->first, it->second);
+    }
+  }
+
+  // calls func(const Key &key, Value &value) on every entry, in no particular order, removing the
+  // entries it returns true for. func must not otherwise modify this map.
+  template <typename Func>
+  void RemoveIf(Func func)
+  {
+    for(Shard &shard : m_Shards)
+    {
+      SCOPED_WRITELOCK(shard.lock);
+      for(auto it = shard.entries.begin(); it != shard.entries.end();)
+      {
+        if(func(it->first, it->second))
+          it = shard.entries.erase(it);
+        else
+          ++it;
+      }
+    }
+  }
+
+  // the keys sorted in ascending order, for when a stable order is needed
+  rdcarray<Key> GetSortedKeys() const
+  {
+    rdcarray<Key> ret;
+    ret.reserve(Size());
+    ForEach([&ret](const Key &key, const Value &) { ret.push_back(key); });
+    std::sort(ret.begin(), ret.end());
+    return ret;
+  }
+
+private:
+  static const size_t NumShards = 64;
+
+  struct Shard
+  {
+    mutable Threading::RWLock lock;
+    std::unordered_map<Key, Value, Hash> entries;
+  };
+
+  Shard &GetShard(const Key &key) { return m_Shards[ShardIndex(key)]; }
+  const Shard &GetShard(const Key &key) const { return m_Shards[ShardIndex(key)]; }
+  static size_t ShardIndex(const Key &key)
+  {
+    // mix the high bits down, in case the hash is the identity for sequential keys
+    uint64_t h = (uint64_t)Hash()(key);
+    h ^= h >> 29;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 32;
+    return size_t(h % NumShards);
+  }
+
+  Shard m_Shards[NumShards];
+};
@@ -0,0 +1,200 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#include "common/formatting.h"
+#include "common/sharded_hash_map.h"
+#include "common/timing.h"
+#include "strings/string_utils.h"
+
+#if ENABLED(ENABLE_UNIT_TESTS)
+
+#include <map>
+#include "catch/catch.hpp"
+
+TEST_CASE("Test sharded hash map", "[shardedmap]")
+{
+  ShardedHashMap<uint64_t, uint32_t> map;
+
+  SECTION("Basic operations")
+  {
+    CHECK(map.IsEmpty());
+
+    CHECK(map.Insert(5, 50));
+    CHECK_FALSE(map.Insert(5, 55));
+    CHECK(map.Insert(1000, 10));
+
+    uint32_t value = 0;
+    CHECK(map.Find(5, value));
+    CHECK(value == 50);
+    CHECK_FALSE(map.Find(6, value));
+    CHECK(map.Contains(1000));
+    CHECK(map.Size() == 2);
+
+    CHECK(map.Modify(6, [](uint32_t &v, bool added) { v = added ? 60 : 0; }));
+    CHECK_FALSE(map.Modify(6, [](uint32_t &v, bool added) { v += added ? 0 : 1; }));
+    CHECK(map.Find(6, value));
+    CHECK(value == 61);
+
+    CHECK(map.Erase(5));
+    CHECK_FALSE(map.Erase(5));
+    CHECK_FALSE(map.Contains(5));
+
+    map.Clear();
+    CHECK(map.IsEmpty());
+  };
+
+  SECTION("Iteration")
+  {
+    for(uint64_t i = 0; i < 1000; i++)
+      map.Insert(i * 3, uint32_t(i));
+
+    uint64_t sum = 0;
+    map.ForEach([&sum](const uint64_t &key, const uint32_t &value) {
+      CHECK(key == value * 3);
+      sum += value;
+    });
+    CHECK(sum == 999 * 1000 / 2);
+
+    map.RemoveIf([](const uint64_t &key, uint32_t &value) {
+      value++;
+      return (key % 2) == 0;
+    });
+
+    rdcarray<uint64_t> keys = map.GetSortedKeys();
+    REQUIRE(keys.size() == 500);
+    for(size_t i = 0; i < keys.size(); i++)
+    {
+      CHECK(keys[i] == i * 6 + 3);
+
+      uint32_t value = 0;
+      map.Find(keys[i], value);
+      CHECK(value == i * 2 + 2);
+    }
+  };
+
+  SECTION("Concurrent modification")
+  {
+    const uint32_t numThreads = 8;
+    const uint32_t numKeys = 1000;
+
+    rdcarray<Threading::ThreadHandle> threads;
+    for(uint32_t t = 0; t < numThreads; t++)
+    {
+      threads.push_back(Threading::CreateThread([&map, t]() {
+        // every thread increments every key, and adds and removes some of its own
+        for(uint32_t i = 0; i < numKeys; i++)
+        {
+          map.Modify(i, [](uint32_t &v, bool) { v++; });
+          map.Insert(numKeys * (t + 1) + i, t);
+          if(i % 2)
+            map.Erase(numKeys * (t + 1) + i - 1);
+        }
+      }));
+    }
+
+    for(Threading::ThreadHandle t : threads)
+    {
+      Threading::JoinThread(t);
+      Threading::CloseThread(t);
+    }
+
+    for(uint32_t i = 0; i < numKeys; i++)
+    {
+      uint32_t value = 0;
+      CHECK(map.Find(i, value));
+      CHECK(value == numThreads);
+    }
+
+    CHECK(map.Size() == numKeys + numThreads * numKeys / 2);
+  };
+}
+
+// simulates resource tracking while capturing: mostly record lookups and repeated frame references,
+// with occasional new references
+TEST_CASE("Benchmark sharded hash map contention", "[.][benchmark][shardedmap]")
+{
+  const uint32_t numResources = 4096;
+  const uint32_t opsPerThread = 1000000;
+
+  auto runOps = [&](uint32_t numThreads, std::function<void(uint32_t, uint32_t)> op) {
+    rdcarray<Threading::ThreadHandle> threads;
+
+    PerformanceTimer timer;
+
+    for(uint32_t t = 0; t < numThreads; t++)
+    {
+      threads.push_back(Threading::CreateThread([&op, t]() {
+        uint32_t rng = t * 7919 + 1;
+        for(uint32_t i = 0; i < opsPerThread; i++)
+        {
+          rng = rng * 1664525U + 1013904223U;
+          op(rng >> 8, i);
+        }
+      }));
+    }
+
+    for(Threading::ThreadHandle t : threads)
+    {
+      Threading::JoinThread(t);
+      Threading::CloseThread(t);
+    }
+
+    return double(numThreads) * opsPerThread / (timer.GetMilliseconds() / 1000.0);
+  };
+
+  rdcstr results;
+
+  for(uint32_t numThreads = 1; numThreads <= RDCMAX(16U, Threading::NumberOfCores());
+      numThreads *= 2)
+  {
+    ShardedHashMap<uint64_t, uint32_t> sharded;
+
+    double shardedOps = runOps(numThreads, [&sharded](uint32_t r, uint32_t i) {
+      uint64_t key = r % numResources;
+      if((i % 16) == 0)
+        sharded.Modify(key, [](uint32_t &v, bool) { v++; });
+      else
+        sharded.Insert(key, 1);
+    });
+
+    Threading::CriticalSection lock;
+    std::map<uint64_t, uint32_t> single;
+
+    double singleOps = runOps(numThreads, [&lock, &single](uint32_t r, uint32_t i) {
+      uint64_t key = r % numResources;
+      SCOPED_LOCK(lock);
+      if((i % 16) == 0)
+        single[key]++;
+      else if(single.find(key) == single.end())
+        single[key] = 1;
+    });
+
+    results += StringFormat::Fmt("\n%2u threads: %8.2f Mops/s sharded, %8.2f Mops/s single lock",
+                                 numThreads, shardedOps / 1e6, singleOps / 1e6);
+  }
+
+  WARN("Resource tracking operations:" << results.c_str());
+}
+
+#endif    // ENABLED(ENABLE_UNIT_TESTS)
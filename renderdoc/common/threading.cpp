@@ -0,0 +1,555 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#include "common/threading.h"
+#include <deque>
+#include "core/settings.h"
+
+RDOC_CONFIG(uint32_t, Threading_JobWorkerThreads, 0,
+            "The number of worker threads in the shared job pool used to split up work. 0 picks "
+            "one fewer than the number of CPU cores, so that the waiting thread can also run "
+            "work.");
+
+namespace Threading
+{
+namespace Jobs
+{
+struct JobData
+{
+  std::function<void()> func;
+
+  // the thread to run on for JobThread::Caller, or 0 for any thread
+  uint64_t owner = 0;
+
+  // held by the caller until Wait() or Release(), by the scheduler until the job has run, and by
+  // each unfinished dependency
+  int32_t refs = 2;
+  // the number of unfinished dependencies, plus one while the job is being added
+  int32_t pending = 1;
+
+  // protects finished, continuations and waiter
+  SpinLock lock;
+  int32_t finished = 0;
+  rdcarray<JobData *> continuations;
+  // the thread blocked in Wait() on this job, if any
+  Semaphore *waiter = NULL;
+};
+
+// each worker's jobs. The owning worker pushes and pops at the back, other threads steal from the
+// front. Jobs added from threads that aren't workers go into a shared queue of the same kind.
+struct JobQueue
+{
+  SpinLock lock;
+  std::deque<Job> jobs;
+
+  void Push(Job job)
+  {
+    SCOPED_SPINLOCK(lock);
+    jobs.push_back(job);
+  }
+
+  Job PopBack()
+  {
+    SCOPED_SPINLOCK(lock);
+    if(jobs.empty())
+      return NULL;
+    Job ret = jobs.back();
+    jobs.pop_back();
+    return ret;
+  }
+
+  Job PopFront()
+  {
+    SCOPED_SPINLOCK(lock);
+    if(jobs.empty())
+      return NULL;
+    Job ret = jobs.front();
+    jobs.pop_front();
+    return ret;
+  }
+};
+
+struct Worker
+{
+  ThreadHandle thread = 0;
+  JobQueue queue;
+  // set by the worker as the last thing it does before its thread exits
+  int32_t exited = 0;
+};
+
+static CriticalSection workersLock;
+static rdcarray<Worker *> workers;
+// number of workers, read without taking the lock once they're started
+static int32_t numWorkers = 0;
+static int32_t workersStarted = 0;
+static int32_t workersShutdown = 0;
+// overrides Threading_JobWorkerThreads when non-zero
+static uint32_t workerCount = 0;
+
+static JobQueue sharedQueue;
+
+// jobs that can only run on a particular thread, once they have no pending dependencies
+static SpinLock callerJobsLock;
+static rdcarray<Job> callerJobs;
+
+// idle workers sleep on this until jobs are added
+static Semaphore *workAvailable = NULL;
+static int32_t numSleeping = 0;
+
+// threads blocked in Wait() with nothing to run. They're woken when the job they wait on finishes
+// or when a new job is scheduled, as they may be the only thread able to run it
+static SpinLock blockedLock;
+static rdcarray<Semaphore *> blocked;
+static int32_t numBlocked = 0;
+
+static uint64_t workerTLSSlot = 0;
+
+static Worker *CurrentWorker()
+{
+  if(workerTLSSlot == 0)
+    return NULL;
+  return (Worker *)GetTLSValue(workerTLSSlot);
+}
+
+static bool IsFinished(Job job)
+{
+  return Atomic::CmpExch32(&job->finished, 1, 1) == 1;
+}
+
+static void WakeBlocked()
+{
+  if(Atomic::CmpExch32(&numBlocked, 0, 0) == 0)
+    return;
+
+  SCOPED_SPINLOCK(blockedLock);
+  for(Semaphore *s : blocked)
+    s->Wake(1);
+}
+
+static void Schedule(Job job)
+{
+  if(job->owner != 0)
+  {
+    {
+      SCOPED_SPINLOCK(callerJobsLock);
+      callerJobs.push_back(job);
+    }
+    // the owner may be waiting on another job, and only it can run this one
+    WakeBlocked();
+    return;
+  }
+
+  Worker *worker = CurrentWorker();
+  if(worker)
+    worker->queue.Push(job);
+  else
+    sharedQueue.Push(job);
+
+  if(Atomic::CmpExch32(&numSleeping, 0, 0) > 0)
+    workAvailable->Wake(1);
+
+  WakeBlocked();
+}
+
+static Job FindCallerJob(uint64_t threadID)
+{
+  SCOPED_SPINLOCK(callerJobsLock);
+  for(size_t i = 0; i < callerJobs.size(); i++)
+  {
+    if(callerJobs[i]->owner == threadID)
+    {
+      Job ret = callerJobs[i];
+      callerJobs.erase(i);
+      return ret;
+    }
+  }
+  return NULL;
+}
+
+static Job FindJob(Worker *worker, uint64_t threadID, uint32_t &stealIndex)
+{
+  Job job = FindCallerJob(threadID);
+  if(job)
+    return job;
+
+  if(worker)
+  {
+    job = worker->queue.PopBack();
+    if(job)
+      return job;
+  }
+
+  job = sharedQueue.PopFront();
+  if(job)
+    return job;
+
+  // the workers array doesn't change while they're running
+  uint32_t count = (uint32_t)Atomic::CmpExch32(&numWorkers, 0, 0);
+  for(uint32_t i = 0; i < count; i++)
+  {
+    Worker *victim = workers[(stealIndex + i) % count];
+    if(victim == worker)
+      continue;
+
+    job = victim->queue.PopFront();
+    if(job)
+    {
+      stealIndex = (stealIndex + i) % count;
+      return job;
+    }
+  }
+
+  return NULL;
+}
+
+static void Run(Job job)
+{
+  job->func();
+  job->func = std::function<void()>();
+
+  rdcarray<Job> continuations;
+  {
+    SCOPED_SPINLOCK(job->lock);
+    job->finished = 1;
+    continuations.swap(job->continuations);
+    // wake under the lock, the waiter's semaphore is only valid until it unregisters
+    if(job->waiter)
+      job->waiter->Wake(1);
+  }
+
+  for(Job c : continuations)
+  {
+    if(Atomic::Dec32(&c->pending) == 0)
+      Schedule(c);
+    Release(c);
+  }
+
+  // release the scheduler's reference
+  Release(job);
+}
+
+static void WorkerMain(Worker *worker)
+{
+  SetCurrentThreadName("RenderDoc job worker");
+  SetTLSValue(workerTLSSlot, worker);
+
+  uint64_t threadID = GetCurrentID();
+  uint32_t stealIndex = 0;
+
+  for(;;)
+  {
+    Job job = FindJob(worker, threadID, stealIndex);
+    if(job)
+    {
+      Run(job);
+      continue;
+    }
+
+    // check for work again after announcing we're going to sleep, so that a job added in between
+    // either gets found here or wakes us up
+    Atomic::Inc32(&numSleeping);
+
+    job = FindJob(worker, threadID, stealIndex);
+    if(job)
+    {
+      Atomic::Dec32(&numSleeping);
+      Run(job);
+      continue;
+    }
+
+    if(Atomic::CmpExch32(&workersShutdown, 1, 1) == 1)
+    {
+      Atomic::Dec32(&numSleeping);
+      break;
+    }
+
+    workAvailable->WaitForWake();
+    Atomic::Dec32(&numSleeping);
+  }
+
+  SetTLSValue(workerTLSSlot, NULL);
+
+  Atomic::Exch32(&worker->exited, 1);
+}
+
+static void StartWorkers()
+{
+  if(Atomic::CmpExch32(&workersStarted, 1, 1) == 1)
+    return;
+
+  SCOPED_LOCK(workersLock);
+
+  if(workersStarted)
+    return;
+
+  uint32_t count = workerCount;
+  if(count == 0)
+    count = Threading_JobWorkerThreads();
+  if(count == 0)
+    count = Threading::NumberOfCores() - 1;
+
+  if(workerTLSSlot == 0)
+    workerTLSSlot = AllocateTLSSlot();
+  if(workAvailable == NULL)
+    workAvailable = new Semaphore();
+
+  Atomic::Exch32(&workersShutdown, 0);
+
+  for(uint32_t i = 0; i < count; i++)
+    workers.push_back(new Worker);
+
+  for(Worker *worker : workers)
+    worker->thread = CreateThread([worker]() { WorkerMain(worker); });
+
+  Atomic::Exch32(&numWorkers, (int32_t)count);
+  Atomic::Exch32(&workersStarted, 1);
+}
+
+Job Add(std::function<void()> func, const rdcarray<Job> &dependencies, JobThread thread)
+{
+  StartWorkers();
+
+  Job job = new JobData;
+  job->func = std::move(func);
+  if(thread == JobThread::Caller)
+    job->owner = GetCurrentID();
+
+  for(Job dep : dependencies)
+  {
+    if(dep == NULL)
+      continue;
+
+    SCOPED_SPINLOCK(dep->lock);
+    if(!dep->finished)
+    {
+      Atomic::Inc32(&job->refs);
+      Atomic::Inc32(&job->pending);
+      dep->continuations.push_back(job);
+    }
+  }
+
+  if(Atomic::Dec32(&job->pending) == 0)
+    Schedule(job);
+
+  return job;
+}
+
+void Wait(Job job)
+{
+  if(job == NULL)
+    return;
+
+  Worker *worker = CurrentWorker();
+  uint64_t threadID = GetCurrentID();
+  uint32_t stealIndex = 0;
+
+  while(!IsFinished(job))
+  {
+    Job other = FindJob(worker, threadID, stealIndex);
+    if(other)
+    {
+      Run(other);
+      continue;
+    }
+
+    // the job is running elsewhere. Block until it finishes or another job is scheduled
+    Semaphore wake;
+
+    {
+      SCOPED_SPINLOCK(blockedLock);
+      blocked.push_back(&wake);
+      Atomic::Inc32(&numBlocked);
+    }
+
+    bool block = false;
+    {
+      SCOPED_SPINLOCK(job->lock);
+      if(!job->finished)
+      {
+        job->waiter = &wake;
+        block = true;
+      }
+    }
+
+    // check for work again after registering, so that a job scheduled in between either gets found
+    // here or wakes us up
+    if(block)
+    {
+      other = FindJob(worker, threadID, stealIndex);
+      if(other == NULL)
+        wake.WaitForWake();
+    }
+
+    {
+      SCOPED_SPINLOCK(job->lock);
+      job->waiter = NULL;
+    }
+
+    {
+      SCOPED_SPINLOCK(blockedLock);
+      blocked.removeOne(&wake);
+      Atomic::Dec32(&numBlocked);
+    }
+
+    if(other)
+      Run(other);
+  }
+
+  Release(job);
+}
+
+void Wait(const rdcarray<Job> &jobs)
+{
+  for(Job job : jobs)
+    Wait(job);
+}
+
+void Release(Job job)
+{
+  if(job && Atomic::Dec32(&job->refs) == 0)
+    delete job;
+}
+
+void ParallelFor(uint32_t begin, uint32_t end, std::function<void(uint32_t)> func,
+                 uint32_t grainSize)
+{
+  if(end <= begin)
+    return;
+
+  StartWorkers();
+
+  const uint32_t count = end - begin;
+  const uint32_t numThreads = NumWorkers() + 1;
+
+  // aim for a few batches per thread so that uneven work still balances out
+  if(grainSize == 0)
+    grainSize = RDCMAX(1U, count / (numThreads * 4));
+
+  const uint32_t numBatches = (count + grainSize - 1) / grainSize;
+
+  if(numThreads == 1 || numBatches == 1)
+  {
+    for(uint32_t i = begin; i < end; i++)
+      func(i);
+    return;
+  }
+
+  // each job takes batches until there are none left, so jobs that start late do less
+  int32_t nextBatch = 0;
+  auto runBatches = [&]() {
+    for(;;)
+    {
+      int32_t batch = Atomic::Inc32(&nextBatch) - 1;
+      if(batch >= (int32_t)numBatches)
+        break;
+
+      uint32_t batchBegin = begin + uint32_t(batch) * grainSize;
+      uint32_t batchEnd = RDCMIN(end, batchBegin + grainSize);
+      for(uint32_t i = batchBegin; i < batchEnd; i++)
+        func(i);
+    }
+  };
+
+  rdcarray<Job> jobs;
+  for(uint32_t i = 1; i < RDCMIN(numThreads, numBatches); i++)
+    jobs.push_back(Add(runBatches));
+
+  runBatches();
+
+  Wait(jobs);
+}
+
+uint32_t NumWorkers()
+{
+  StartWorkers();
+  return (uint32_t)Atomic::CmpExch32(&numWorkers, 0, 0);
+}
+
+void SetWorkerCount(uint32_t count)
+{
+  workerCount = count;
+}
+
+void Shutdown(bool join)
+{
+  if(Atomic::CmpExch32(&workersStarted, 1, 1) == 0)
+    return;
+
+  SCOPED_LOCK(workersLock);
+
+  Atomic::Exch32(&workersShutdown, 1);
+
+  // workers finish the queued jobs before they notice the shutdown
+  workAvailable->Wake((uint32_t)workers.size());
+
+  if(join)
+  {
+    for(Worker *worker : workers)
+    {
+      JoinThread(worker->thread);
+      CloseThread(worker->thread);
+    }
+  }
+  else
+  {
+    // joining could deadlock while the library is unloaded, so wait a bounded time for each worker
+    // to flag that it has exited instead.
+    const uint32_t timeoutMS = 1000;
+    bool exited = true;
+    for(uint32_t waited = 0;; waited++)
+    {
+      exited = true;
+      for(Worker *worker : workers)
+        exited &= Atomic::CmpExch32(&worker->exited, 1, 1) == 1;
+
+      if(exited || waited >= timeoutMS)
+        break;
+
+      Sleep(1);
+    }
+
+    for(Worker *worker : workers)
+      DetachThread(worker->thread);
+
+    // a worker that hasn't exited could still be stealing from the others, so leave everything
+    // as-is for it. The workers are leaked and don't start again, jobs added later are run by the
+    // threads waiting on them.
+    if(!exited)
+    {
+      RDCWARN("Job workers still running after %u ms, leaking them", timeoutMS);
+      return;
+    }
+  }
+
+  // only delete workers once they've all stopped, as the others could still be stealing from them
+  for(Worker *worker : workers)
+    delete worker;
+
+  workers.clear();
+
+  Atomic::Exch32(&numWorkers, 0);
+  Atomic::Exch32(&workersStarted, 0);
+}
+};
+};
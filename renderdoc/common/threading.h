@@ -110,6 +110,59 @@ public:
 private:
   SpinLock *m_Spin = NULL;
 };
+
+// A shared pool of worker threads for splitting up work that would otherwise run serially, such as
+// analysis on the replay thread. Each worker keeps its own queue of jobs and runs the most recently
+// added first, while idle workers steal the oldest jobs from other queues. Any thread waiting on a
+// job runs other jobs in the meantime, so jobs can add and wait on jobs of their own.
+//
+// Workers are started the first time a job is added, with the count from SetWorkerCount() or else
+// Threading_JobWorkerThreads.
+namespace Jobs
+{
+struct JobData;
+typedef JobData *Job;
+
+enum class JobThread
+{
+  // the job can run on any worker, or on any thread that's waiting for jobs to finish
+  Any,
+  // the job only runs on the thread that added it, while that thread is waiting in Wait() or
+  // ParallelFor(). Use this for work that makes graphics API calls or isn't otherwise thread-safe.
+  Caller,
+};
+
+// adds a job that runs once all of its dependencies have finished. The returned job must be
+// passed to either Wait() or Release() exactly once.
+Job Add(std::function<void()> func, const rdcarray<Job> &dependencies = {},
+        JobThread thread = JobThread::Any);
+
+// blocks until the job has finished, running other jobs meanwhile, then releases it
+void Wait(Job job);
+void Wait(const rdcarray<Job> &jobs);
+
+// releases a job without waiting on it. It can still be used as a dependency until then
+void Release(Job job);
+
+// calls func for each index in [begin, end), split across the workers and the calling thread,
+// and returns once every call has finished. grainSize is the number of indices taken at a time,
+// or 0 to pick one based on the number of workers.
+void ParallelFor(uint32_t begin, uint32_t end, std::function<void(uint32_t)> func,
+                 uint32_t grainSize = 0);
+
+// the number of worker threads, not counting threads that wait on jobs
+uint32_t NumWorkers();
+
+// sets the number of workers to start, overriding Threading_JobWorkerThreads. 0 restores the
+// default. Only takes effect the next time the workers are started
+void SetWorkerCount(uint32_t count);
+
+// finishes any outstanding jobs and stops the workers. They start again if another job is added.
+// Without join the workers are only given a bounded time to exit rather than joined, for when the
+// library is being unloaded and joining threads could deadlock. Any still running after that are
+// leaked, and the workers don't start again.
+void Shutdown(bool join = true);
+};
 };
 
 #define SCOPED_LOCK(cs) Threading::ScopedLock CONCAT(scopedlock, __LINE__)(&cs);
@@ -22,8 +22,12 @@
  * THE SOFTWARE.
  ******************************************************************************/
 
+#include "common/formatting.h"
 #include "common/threading.h"
+#include "common/timing.h"
+#include "core/core.h"
 #include "os/os_specific.h"
+#include "strings/string_utils.h"
 
 #if ENABLED(ENABLE_UNIT_TESTS)
 
@@ -71,4 +75,212 @@ TEST_CASE("Test spin lock", "[threading]")
   CHECK(finalValue == value);
 }
 
+TEST_CASE("Test job system", "[threading][jobs]")
+{
+  SECTION("Jobs run and can be waited on")
+  {
+    int32_t count = 0;
+
+    rdcarray<Threading::Jobs::Job> jobs;
+    for(int i = 0; i < 100; i++)
+      jobs.push_back(Threading::Jobs::Add([&count]() { Atomic::Inc32(&count); }));
+
+    Threading::Jobs::Wait(jobs);
+
+    CHECK(count == 100);
+  };
+
+  SECTION("Dependencies finish first")
+  {
+    int32_t order = 0;
+    int32_t a = 0, b = 0, c = 0, d = 0;
+
+    // a diamond, with d depending on both b and c which depend on a
+    Threading::Jobs::Job jobA = Threading::Jobs::Add([&]() {
+      Threading::Sleep(10);
+      a = Atomic::Inc32(&order);
+    });
+    Threading::Jobs::Job jobB =
+        Threading::Jobs::Add([&]() { b = Atomic::Inc32(&order); }, {jobA});
+    Threading::Jobs::Job jobC =
+        Threading::Jobs::Add([&]() { c = Atomic::Inc32(&order); }, {jobA});
+    Threading::Jobs::Job jobD =
+        Threading::Jobs::Add([&]() { d = Atomic::Inc32(&order); }, {jobB, jobC});
+
+    Threading::Jobs::Release(jobA);
+    Threading::Jobs::Release(jobB);
+    Threading::Jobs::Release(jobC);
+    Threading::Jobs::Wait(jobD);
+
+    CHECK(a == 1);
+    CHECK(b > a);
+    CHECK(c > a);
+    CHECK(d == 4);
+  };
+
+  SECTION("Caller jobs only run on the adding thread")
+  {
+    const uint64_t threadID = Threading::GetCurrentID();
+
+    rdcarray<Threading::Jobs::Job> jobs;
+    rdcarray<uint64_t> ranOn;
+    ranOn.resize(16);
+
+    for(size_t i = 0; i < ranOn.size(); i++)
+    {
+      Threading::Jobs::Job dep = Threading::Jobs::Add([]() { Threading::Sleep(1); });
+      jobs.push_back(Threading::Jobs::Add([&ranOn, i]() { ranOn[i] = Threading::GetCurrentID(); },
+                                          {dep}, Threading::Jobs::JobThread::Caller));
+      Threading::Jobs::Release(dep);
+    }
+
+    Threading::Jobs::Wait(jobs);
+
+    for(size_t i = 0; i < ranOn.size(); i++)
+    {
+      CAPTURE(i);
+      CHECK(ranOn[i] == threadID);
+    }
+  };
+
+  SECTION("Parallel for covers every index once")
+  {
+    rdcarray<int32_t> counts;
+    counts.resize(10000);
+
+    for(uint32_t grain : {0U, 1U, 7U, 20000U})
+    {
+      CAPTURE(grain);
+
+      for(int32_t &c : counts)
+        c = 0;
+
+      Threading::Jobs::ParallelFor(100, 10000, [&counts](uint32_t i) { Atomic::Inc32(&counts[i]); },
+                                   grain);
+
+      for(uint32_t i = 0; i < 10000; i++)
+      {
+        CAPTURE(i);
+        CHECK(counts[i] == (i < 100 ? 0 : 1));
+      }
+    }
+  };
+
+  SECTION("Jobs can wait on other jobs")
+  {
+    int32_t count = 0;
+
+    Threading::Jobs::ParallelFor(0, 64, [&count](uint32_t) {
+      Threading::Jobs::ParallelFor(0, 64, [&count](uint32_t) { Atomic::Inc32(&count); });
+    });
+
+    CHECK(count == 64 * 64);
+  };
+
+  SECTION("Worker count is configurable")
+  {
+    SDObject *config = RenderDoc::Inst().SetConfigSetting("Threading_JobWorkerThreads");
+    REQUIRE(config);
+
+    const uint64_t prev = config->data.basic.u;
+
+    Threading::Jobs::Shutdown();
+    config->data.basic.u = 3;
+    CHECK(Threading::Jobs::NumWorkers() == 3);
+
+    int32_t count = 0;
+    Threading::Jobs::ParallelFor(0, 1000, [&count](uint32_t) { Atomic::Inc32(&count); });
+    CHECK(count == 1000);
+
+    Threading::Jobs::SetWorkerCount(2);
+    Threading::Jobs::Shutdown();
+    CHECK(Threading::Jobs::NumWorkers() == 2);
+
+    Threading::Jobs::SetWorkerCount(0);
+    Threading::Jobs::Shutdown();
+    config->data.basic.u = prev;
+  };
+
+  SECTION("Shutting down without joining waits for idle workers to exit")
+  {
+    Threading::Jobs::Shutdown();
+    Threading::Jobs::SetWorkerCount(2);
+
+    int32_t count = 0;
+    Threading::Jobs::ParallelFor(0, 1000, [&count](uint32_t) { Atomic::Inc32(&count); });
+    CHECK(count == 1000);
+
+    Threading::Jobs::Shutdown(false);
+
+    // the workers exited in time, so they're freed and start again as normal
+    CHECK(Threading::Jobs::NumWorkers() == 2);
+
+    count = 0;
+    Threading::Jobs::ParallelFor(0, 1000, [&count](uint32_t) { Atomic::Inc32(&count); });
+    CHECK(count == 1000);
+
+    Threading::Jobs::SetWorkerCount(0);
+    Threading::Jobs::Shutdown();
+  };
+
+  SECTION("Waiting on a long job wakes when it finishes")
+  {
+    int32_t done = 0;
+
+    Threading::Jobs::Job job = Threading::Jobs::Add([&done]() {
+      Threading::Sleep(50);
+      Atomic::Inc32(&done);
+    });
+
+    // give a worker time to take the job, so that the wait has nothing to run and blocks
+    Threading::Sleep(5);
+    Threading::Jobs::Wait(job);
+
+    CHECK(done == 1);
+  };
+}
+
+TEST_CASE("Benchmark job system scaling", "[.][benchmark][threading][jobs]")
+{
+  const uint32_t count = 1 << 16;
+
+  rdcarray<uint32_t> results;
+  results.resize(count);
+
+  SDObject *config = RenderDoc::Inst().SetConfigSetting("Threading_JobWorkerThreads");
+  REQUIRE(config);
+
+  const uint64_t prev = config->data.basic.u;
+
+  rdcstr timings;
+  double serialTime = 0.0;
+
+  for(uint32_t threads = 1; threads <= Threading::NumberOfCores(); threads *= 2)
+  {
+    Threading::Jobs::Shutdown();
+    config->data.basic.u = threads - 1;
+
+    PerformanceTimer timer;
+
+    Threading::Jobs::ParallelFor(0, count, [&results](uint32_t i) {
+      // enough work per index to outweigh the scheduling
+      uint32_t x = i;
+      for(int r = 0; r < 2000; r++)
+        x = x * 1664525U + 1013904223U;
+      results[i] = x;
+    });
+
+    double time = timer.GetMilliseconds();
+    if(threads == 1)
+      serialTime = time;
+
+    timings += StringFormat::Fmt("\n%u threads: %.2f ms (%.2fx)", threads, time, serialTime / time);
+  }
+
+  Threading::Jobs::Shutdown();
+  config->data.basic.u = prev;
+
+  WARN("ParallelFor over " << count << " indices:" << timings.c_str());
+}
+
 #endif    // ENABLED(ENABLE_UNIT_TESTS)
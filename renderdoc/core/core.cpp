@@ -27,6 +27,7 @@
 #include <time.h>
 #include <algorithm>
 #include "api/replay/version.h"
+#include "common/call_stats.h"
 #include "common/common.h"
 #include "common/threading.h"
 #include "core/settings.h"
@@ -49,6 +50,26 @@
 RDOC_DEBUG_CONFIG(bool, Capture_Debug_SnapshotDiagnosticLog, false,
                   "Snapshot the diagnostic log at capture time and embed in the capture.");
 
+RDOC_CONFIG(bool, Capture_AsyncWriting, false,
+            "Hold captures in memory when the frame ends and write them to disk on a background "
+            "thread, so the application doesn't stall while the capture is compressed and "
+            "written.");
+RDOC_CONFIG(uint32_t, Capture_AsyncWritingMemoryLimitMB, 2048,
+            "The memory in MB that captures waiting to be written in the background may use. Once "
+            "this is exceeded new captures are written to disk before the application continues.");
+RDOC_CONFIG(uint32_t, Capture_JobWorkerThreads, 0,
+            "The number of job worker threads used in the captured application, for example to "
+            "serialise initial states in the background. 0 picks half the number of CPU cores so "
+            "that the application keeps the rest. Read when the application starts.");
+RDOC_CONFIG(bool, Capture_MapWriteTracking, false,
+            "Track writes to persistent and coherent maps with page protection while capturing, so "
+            "that only written pages are compared for changes instead of the whole map. Where this "
+            "isn't supported the whole map is compared as normal.");
+RDOC_CONFIG(uint32_t, Capture_MapDiffMergeGap, 4096,
+            "When comparing persistent and coherent maps for changes, separate changed ranges "
+            "closer than this many bytes are merged and written as one. Smaller values write less "
+            "unchanged data, at the cost of more writes for scattered changes.");
+
 void LogReplayOptions(const ReplayOptions &opts)
 {
   RDCLOG("%s API validation during replay", (opts.apiValidation ? "Enabling" : "Not enabling"));
@@ -523,6 +544,15 @@ void RenderDoc::Initialise()
     RDCLOGOUTPUT();
 
   ProcessConfig();
+
+  // the job workers compete with the application's own threads while capturing
+  if(!IsReplayApp())
+  {
+    uint32_t jobWorkers = Capture_JobWorkerThreads();
+    if(jobWorkers == 0)
+      jobWorkers = RDCMAX(1U, Threading::NumberOfCores() / 2);
+    Threading::Jobs::SetWorkerCount(jobWorkers);
+  }
 }
 
 RenderDoc::~RenderDoc()
@@ -532,10 +562,17 @@ RenderDoc::~RenderDoc()
     UnloadCrashHandler();
   }
 
+  // captures still being written in the background must reach disk before we go away
+  FlushCaptureWrites();
+
   for(auto it = m_ShutdownFunctions.begin(); it != m_ShutdownFunctions.end(); ++it)
     (*it)();
   m_ShutdownFunctions.clear();
 
+  // in a captured application nothing else stops the job workers. Don't join them, for the same
+  // reason as the target control thread below
+  Threading::Jobs::Shutdown(false);
+
   for(size_t i = 0; i < m_Captures.size(); i++)
   {
     if(m_Captures[i].retrieved)
@@ -581,6 +618,8 @@ void RenderDoc::RemoveHooks()
     UnloadCrashHandler();
   }
 
+  FlushCaptureWrites();
+
   if(m_RemoteThread)
   {
     // explicitly wait for thread to shutdown, this call is not from module unloading and
@@ -732,6 +771,10 @@ void RenderDoc::ShutdownReplay()
   for(auto it = m_ShutdownFunctions.begin(); it != m_ShutdownFunctions.end(); ++it)
     (*it)();
   m_ShutdownFunctions.clear();
+
+  // stop the job workers here rather than in the destructor, where joining threads could deadlock
+  // while the module is being unloaded
+  Threading::Jobs::Shutdown();
 }
 
 void RenderDoc::RegisterShutdownFunction(ShutdownFunction func)
@@ -818,6 +861,7 @@ void RenderDoc::StartFrameCapture(void *dev, void *wnd)
   {
     frameCap->StartFrameCapture(dev, wnd);
     m_CapturesActive++;
+    CallStats::SetCapturing(m_CapturesActive > 0);
   }
 }
 
@@ -842,6 +886,7 @@ bool RenderDoc::EndFrameCapture(void *dev, void *wnd)
   {
     bool ret = frameCap->EndFrameCapture(dev, wnd);
     m_CapturesActive--;
+    CallStats::SetCapturing(m_CapturesActive > 0);
     return ret;
   }
   return false;
@@ -854,6 +899,7 @@ bool RenderDoc::DiscardFrameCapture(void *dev, void *wnd)
   {
     bool ret = frameCap->DiscardFrameCapture(dev, wnd);
     m_CapturesActive--;
+    CallStats::SetCapturing(m_CapturesActive > 0);
     return ret;
   }
   return false;
@@ -1243,10 +1289,14 @@ RDCFile *RenderDoc::CreateRDC(RDCDriver driver, uint32_t frameNum, const FramePi
   // make sure we don't stomp another capture if we make multiple captures in the same frame.
   {
     SCOPED_LOCK(m_CaptureLock);
+    SCOPED_LOCK(m_CaptureWriteLock);
     int altnum = 2;
-    while(std::find_if(m_Captures.begin(), m_Captures.end(), [this](const CaptureData &o) {
-            return o.path == m_CurrentLogFile;
-          }) != m_Captures.end())
+    auto capturePath = [this](const CaptureData &o) { return o.path == m_CurrentLogFile; };
+    auto pendingPath = [this](const PendingCaptureWrite &o) { return o.path == m_CurrentLogFile; };
+
+    while(std::find_if(m_Captures.begin(), m_Captures.end(), capturePath) != m_Captures.end() ||
+          std::find_if(m_PendingCaptureWrites.begin(), m_PendingCaptureWrites.end(), pendingPath) !=
+              m_PendingCaptureWrites.end())
     {
       m_CurrentLogFile =
           StringFormat::Fmt("%s%s_%d.rdc", m_CaptureFileTemplate.c_str(), suffix.c_str(), altnum);
@@ -1259,9 +1309,45 @@ RDCFile *RenderDoc::CreateRDC(RDCDriver driver, uint32_t frameNum, const FramePi
   {
     // point sample info into raw buffer
     ResamplePixels(fp, outRaw);
-    EncodePixelsPNG(outRaw, outPng);
   }
 
+  if(Capture_AsyncWriting())
+  {
+    SCOPED_LOCK(m_CaptureWriteLock);
+
+    const uint64_t limit = uint64_t(Capture_AsyncWritingMemoryLimitMB()) * 1024 * 1024;
+
+    // the size isn't known until the capture is finished, so reserve as much as the last capture
+    // needed now. Otherwise captures being made at the same time could all fit under the limit
+    const uint64_t reserve = RDCMAX(m_LastCaptureBytes, (uint64_t)1);
+
+    if(m_PendingCaptureBytes + reserve <= limit)
+    {
+      // without creating a file the sections are kept in memory. The PNG thumbnail is encoded
+      // along with the rest of the file writing once the capture is finished
+      ret->SetData(driver, ToStr(driver).c_str(), OSUtility::GetMachineIdent(), NULL, m_TimeBase,
+                   m_TimeFrequency);
+
+      PendingCaptureWrite write;
+      write.id = m_NextCaptureWriteID++;
+      write.rdc = ret;
+      write.path = m_CurrentLogFile;
+      write.thumb = new RDCThumb(outRaw);
+      write.size = reserve;
+      write.captureCallstacks = m_Options.captureCallstacks;
+      m_PendingCaptureWrites.push_back(write);
+      m_PendingCaptureBytes += reserve;
+
+      return ret;
+    }
+
+    RDCLOG("%llu bytes of captures are still being written, writing '%s' synchronously",
+           m_PendingCaptureBytes, m_CurrentLogFile.c_str());
+  }
+
+  if(fp.data)
+    EncodePixelsPNG(outRaw, outPng);
+
   ret->SetData(driver, ToStr(driver).c_str(), OSUtility::GetMachineIdent(), &outPng, m_TimeBase,
                m_TimeFrequency);
 
@@ -1694,90 +1780,229 @@ void RenderDoc::SetCaptureFileTemplate(const rdcstr &pathtemplate)
   FileIO::CreateParentDirectory(m_CaptureFileTemplate);
 }
 
+static bytebuf GetResolveDatabase()
+{
+  size_t sz = 0;
+  Callstack::GetLoadedModules(NULL, sz);
+
+  bytebuf buf;
+  buf.resize(sz);
+  Callstack::GetLoadedModules(buf.data(), sz);
+
+  return buf;
+}
+
 void RenderDoc::FinishCaptureWriting(RDCFile *rdc, uint32_t frameNumber)
 {
   RenderDoc::Inst().SetProgress(CaptureProgress::FileWriting, 0.0f);
 
   if(rdc)
   {
-    // add the resolve database if we were capturing callstacks.
-    if(m_Options.captureCallstacks)
+    PendingCaptureWrite write;
+    uint64_t nextID = 0;
+
     {
-      SectionProperties props = {};
-      props.type = SectionType::ResolveDatabase;
-      props.version = 1;
-      StreamWriter *w = rdc->WriteSection(props);
+      SCOPED_LOCK(m_CaptureWriteLock);
+      for(PendingCaptureWrite &w : m_PendingCaptureWrites)
+      {
+        if(w.rdc == rdc && !w.writing)
+        {
+          // replace the reservation with the real size now that it's known
+          uint64_t size = 0;
+          for(int i = 0; i < rdc->NumSections(); i++)
+            size += rdc->GetSectionProperties(i).uncompressedSize;
+
+          m_PendingCaptureBytes -= w.size;
+          m_PendingCaptureBytes += size;
+          m_LastCaptureBytes = size;
+
+          w.size = size;
+          w.writing = true;
+          if(w.captureCallstacks)
+            w.resolveDB = GetResolveDatabase();
+          write = w;
+          break;
+        }
+      }
 
-      size_t sz = 0;
-      Callstack::GetLoadedModules(NULL, sz);
+      nextID = m_NextCaptureWriteID;
+    }
 
-      byte *buf = new byte[sz];
-      Callstack::GetLoadedModules(buf, sz);
+    if(write.rdc)
+    {
+      // the thread isn't joined, FlushCaptureWrites waits for the write to be removed from the
+      // pending list instead.
+      Threading::ThreadHandle thread = Threading::CreateThread(
+          [this, write, frameNumber]() { WriteCaptureAsync(write, frameNumber); });
+      Threading::DetachThread(thread);
+    }
+    else
+    {
+      // a capture with incremental contents refers to earlier captures, which must be on disk
+      // before this one is available
+      if(rdc->SectionIndex(SectionType::IncrementalContents) >= 0)
+        WaitForCaptureWrites(nextID);
 
-      w->Write(buf, sz);
+      WriteCapture(rdc, m_CurrentLogFile, frameNumber,
+                   m_Options.captureCallstacks ? GetResolveDatabase() : bytebuf());
+    }
+  }
+  else
+  {
+    RDCLOG("Discarded capture, Frame %u", frameNumber);
+  }
 
-      w->Finish();
+  RenderDoc::Inst().SetProgress(CaptureProgress::FileWriting, 1.0f);
+}
 
-      delete w;
-    }
+void RenderDoc::WriteCapture(RDCFile *rdc, const rdcstr &path, uint32_t frameNumber,
+                             const bytebuf &resolveDB)
+{
+  // add the resolve database if we were capturing callstacks.
+  if(!resolveDB.empty())
+  {
+    SectionProperties props = {};
+    props.type = SectionType::ResolveDatabase;
+    props.version = 1;
+    StreamWriter *w = rdc->WriteSection(props);
 
-    const RDCThumb &thumb = rdc->GetThumbnail();
-    if(thumb.format != FileType::JPG && thumb.width > 0 && thumb.height > 0)
-    {
-      SectionProperties props = {};
-      props.type = SectionType::ExtendedThumbnail;
-      props.version = 1;
-      StreamWriter *w = rdc->WriteSection(props);
+    w->Write(resolveDB.data(), resolveDB.size());
 
-      // if this file format ever changes, be sure to update the XML export which has a special
-      // handling for this case.
+    w->Finish();
 
-      ExtThumbnailHeader header;
-      header.width = thumb.width;
-      header.height = thumb.height;
-      header.format = thumb.format;
-      header.len = (uint32_t)thumb.pixels.size();
-      w->Write(header);
-      w->Write(thumb.pixels.data(), thumb.pixels.size());
+    delete w;
+  }
 
-      w->Finish();
+  const RDCThumb &thumb = rdc->GetThumbnail();
+  if(thumb.format != FileType::JPG && thumb.width > 0 && thumb.height > 0)
+  {
+    SectionProperties props = {};
+    props.type = SectionType::ExtendedThumbnail;
+    props.version = 1;
+    StreamWriter *w = rdc->WriteSection(props);
 
-      delete w;
-    }
+    // if this file format ever changes, be sure to update the XML export which has a special
+    // handling for this case.
 
-    if(Capture_Debug_SnapshotDiagnosticLog())
-    {
-      rdcstr logcontents = FileIO::logfile_readall(0, RDCGETLOGFILE());
+    ExtThumbnailHeader header;
+    header.width = thumb.width;
+    header.height = thumb.height;
+    header.format = thumb.format;
+    header.len = (uint32_t)thumb.pixels.size();
+    w->Write(header);
+    w->Write(thumb.pixels.data(), thumb.pixels.size());
 
-      SectionProperties props = {};
-      props.type = SectionType::EmbeddedLogfile;
-      props.version = 1;
-      props.flags = SectionFlags::LZ4Compressed;
-      StreamWriter *w = rdc->WriteSection(props);
+    w->Finish();
 
-      w->Write(logcontents.data(), logcontents.size());
+    delete w;
+  }
 
-      w->Finish();
+  if(Capture_Debug_SnapshotDiagnosticLog())
+  {
+    rdcstr logcontents = FileIO::logfile_readall(0, RDCGETLOGFILE());
 
-      delete w;
-    }
+    SectionProperties props = {};
+    props.type = SectionType::EmbeddedLogfile;
+    props.version = 1;
+    props.flags = SectionFlags::LZ4Compressed;
+    StreamWriter *w = rdc->WriteSection(props);
 
-    RDCLOG("Written to disk: %s", m_CurrentLogFile.c_str());
+    w->Write(logcontents.data(), logcontents.size());
 
-    CaptureData cap(m_CurrentLogFile, Timing::GetUnixTimestamp(), rdc->GetDriver(), frameNumber);
-    {
-      SCOPED_LOCK(m_CaptureLock);
-      m_Captures.push_back(cap);
-    }
+    w->Finish();
+
+    delete w;
+  }
+
+  RDCLOG("Written to disk: %s", path.c_str());
+
+  CaptureData cap(path, Timing::GetUnixTimestamp(), rdc->GetDriver(), frameNumber);
+  {
+    SCOPED_LOCK(m_CaptureLock);
+    m_Captures.push_back(cap);
+  }
+
+  delete rdc;
+}
+
+void RenderDoc::WriteCaptureAsync(PendingCaptureWrite write, uint32_t frameNumber)
+{
+  RDCThumb outPng;
+  if(write.thumb->width > 0 && write.thumb->height > 0)
+    EncodePixelsPNG(*write.thumb, outPng);
+  SAFE_DELETE(write.thumb);
+
+  RDCFile *rdc = new RDCFile;
+
+  rdc->SetData(write.rdc->GetDriver(), write.rdc->GetDriverName(), write.rdc->GetMachineIdent(),
+               &outPng, write.rdc->GetTimestampBase(), write.rdc->GetTimestampFrequency());
+
+  FileIO::CreateParentDirectory(write.path);
+
+  rdc->Create(write.path);
+
+  if(rdc->ErrorCode() != ContainerError::NoError)
+  {
+    RDCERR("Error creating RDC at '%s'", write.path.c_str());
+    SAFE_DELETE(rdc);
+  }
+  else if(!rdc->TakeMemorySections(*write.rdc))
+  {
+    RDCERR("Error writing capture sections to '%s'", write.path.c_str());
+    SAFE_DELETE(rdc);
+  }
 
-    delete rdc;
+  delete write.rdc;
+
+  if(rdc)
+  {
+    // a capture with incremental contents refers to earlier captures, which must be on disk
+    // before this one is available
+    if(rdc->SectionIndex(SectionType::IncrementalContents) >= 0)
+      WaitForCaptureWrites(write.id);
+
+    WriteCapture(rdc, write.path, frameNumber, write.resolveDB);
   }
   else
   {
     RDCLOG("Discarded capture, Frame %u", frameNumber);
   }
 
-  RenderDoc::Inst().SetProgress(CaptureProgress::FileWriting, 1.0f);
+  SCOPED_LOCK(m_CaptureWriteLock);
+  m_PendingCaptureBytes -= write.size;
+  m_PendingCaptureWrites.removeIf(
+      [&write](const PendingCaptureWrite &w) { return w.id == write.id; });
+
+  if(m_CaptureWriteWaiters > 0)
+  {
+    m_CaptureWriteDone.Wake(m_CaptureWriteWaiters);
+    m_CaptureWriteWaiters = 0;
+  }
+}
+
+void RenderDoc::WaitForCaptureWrites(uint64_t beforeID)
+{
+  for(;;)
+  {
+    {
+      SCOPED_LOCK(m_CaptureWriteLock);
+      if(std::find_if(m_PendingCaptureWrites.begin(), m_PendingCaptureWrites.end(),
+                      [beforeID](const PendingCaptureWrite &w) {
+                        return w.writing && w.id < beforeID;
+                      }) == m_PendingCaptureWrites.end())
+        return;
+
+      // registered under the lock, so a write finishing before we wait still wakes us
+      m_CaptureWriteWaiters++;
+    }
+
+    m_CaptureWriteDone.WaitForWake();
+  }
+}
+
+void RenderDoc::FlushCaptureWrites()
+{
+  WaitForCaptureWrites(~0ULL);
 }
 
 void RenderDoc::AddChildProcess(uint32_t pid, uint32_t ident)
@@ -2005,4 +2230,124 @@ TEST_CASE("Check ResourceId tostr", "[tostr]")
   CHECK(ToStr(*u.id) == "ResourceId::1311768465173141112");
 }
 
+TEST_CASE("Captures can be written in the background", "[core]")
+{
+  RenderDoc &rd = RenderDoc::Inst();
+
+  SDObject *async = rd.SetConfigSetting("Capture_AsyncWriting");
+  REQUIRE(async);
+  const bool prevAsync = async->data.basic.b;
+  async->data.basic.b = true;
+
+  const rdcstr prevTemplate = rd.GetCaptureFileTemplate();
+  const rdcstr captureTemplate = FileIO::GetTempFolderFilename() + "renderdoc_async_write_test";
+  rd.SetCaptureFileTemplate(captureTemplate);
+
+  bytebuf contents;
+  contents.resize(1024 * 1024 + 13);
+  for(size_t i = 0; i < contents.size(); i++)
+    contents[i] = byte((i * 7) & 0xff);
+
+  RenderDoc::FramePixels fp;
+  fp.width = fp.max_width = 16;
+  fp.height = 8;
+  fp.stride = 4;
+  fp.bpc = 1;
+  fp.pitch = fp.width * fp.stride;
+  fp.pitch_requirement = 4;
+  fp.len = fp.pitch * fp.height;
+  fp.data = new uint8_t[fp.len];
+  memset(fp.data, 0x80, fp.len);
+
+  auto writeFrame = [&contents](RDCFile *rdc) {
+    SectionProperties props = {};
+    props.type = SectionType::FrameCapture;
+    props.flags = SectionFlags::LZ4Compressed;
+    props.version = 1;
+    StreamWriter *w = rdc->WriteSection(props);
+    w->Write(contents.data(), contents.size());
+    w->Finish();
+    delete w;
+  };
+
+  RDCFile *rdc = rd.CreateRDC(RDCDriver::Vulkan, 1234, fp);
+  REQUIRE(rdc);
+
+  writeFrame(rdc);
+
+  // the capture isn't on disk until the background write finishes
+  rd.FinishCaptureWriting(rdc, 1234);
+  rd.FlushCaptureWrites();
+
+  rdcstr path;
+  for(const CaptureData &cap : rd.GetCaptures())
+    if(cap.frameNumber == 1234 && cap.path.beginsWith(captureTemplate))
+      path = cap.path;
+
+  REQUIRE_FALSE(path.empty());
+
+  {
+    RDCFile check;
+    check.Open(path);
+    REQUIRE((check.ErrorCode() == ContainerError::NoError));
+
+    CHECK(check.GetDriver() == RDCDriver::Vulkan);
+    CHECK(check.GetThumbnail().width == 16);
+    CHECK(check.SectionIndex(SectionType::ExtendedThumbnail) >= 0);
+
+    int idx = check.SectionIndex(SectionType::FrameCapture);
+    REQUIRE(idx == 0);
+    CHECK(bool(check.GetSectionProperties(idx).flags & SectionFlags::LZ4Compressed));
+    CHECK(check.GetSectionProperties(idx).uncompressedSize == contents.size());
+
+    StreamReader *reader = check.ReadSection(idx);
+    bytebuf readback;
+    readback.resize(contents.size());
+    reader->Read(readback.data(), readback.size());
+    CHECK_FALSE(reader->IsErrored());
+    delete reader;
+
+    CHECK((readback == contents));
+  }
+
+  FileIO::Delete(path);
+
+  // captures reserve memory as soon as they're created, sized like the last capture. Only one fits
+  // under this limit, so the second is written synchronously
+  {
+    SDObject *limit = rd.SetConfigSetting("Capture_AsyncWritingMemoryLimitMB");
+    REQUIRE(limit);
+    const uint32_t prevLimit = limit->data.basic.u;
+    limit->data.basic.u = 2;
+
+    RDCFile *first = rd.CreateRDC(RDCDriver::Vulkan, 1235, fp);
+    REQUIRE(first);
+    const rdcstr firstPath = rd.GetCurrentLogFile();
+
+    RDCFile *second = rd.CreateRDC(RDCDriver::Vulkan, 1236, fp);
+    REQUIRE(second);
+    const rdcstr secondPath = rd.GetCurrentLogFile();
+
+    CHECK_FALSE(FileIO::exists(firstPath));
+    CHECK(FileIO::exists(secondPath));
+
+    writeFrame(first);
+    writeFrame(second);
+
+    rd.FinishCaptureWriting(second, 1236);
+    rd.FinishCaptureWriting(first, 1235);
+    rd.FlushCaptureWrites();
+
+    CHECK(FileIO::exists(firstPath));
+
+    FileIO::Delete(firstPath);
+    FileIO::Delete(secondPath);
+
+    limit->data.basic.u = prevLimit;
+  }
+
+  async->data.basic.b = prevAsync;
+  rd.SetCaptureFileTemplate(prevTemplate);
+}
+
 #endif
@@ -408,6 +408,8 @@ public:
   // set from outside of the device creation interface
   void SetCaptureFileTemplate(const rdcstr &logFile);
   const char *GetCaptureFileTemplate() const { return m_CaptureFileTemplate.c_str(); }
+  // the path of the capture most recently created with CreateRDC
+  const rdcstr &GetCurrentLogFile() const { return m_CurrentLogFile; }
   const rdcstr &GetCurrentTarget() const { return m_Target; }
   void Initialise();
   void RemoveHooks();
@@ -446,6 +448,8 @@ public:
   void EncodePixelsPNG(const RDCThumb &in, RDCThumb &out);
   RDCFile *CreateRDC(RDCDriver driver, uint32_t frameNum, const FramePixels &fp);
   void FinishCaptureWriting(RDCFile *rdc, uint32_t frameNumber);
+  // waits for any captures still being written in the background to reach disk
+  void FlushCaptureWrites();
 
   void AddChildProcess(uint32_t pid, uint32_t ident);
   rdcarray<rdcpair<uint32_t, uint32_t>> GetChildProcesses();
@@ -629,6 +633,39 @@ private:
   Threading::CriticalSection m_CaptureLock;
   rdcarray<CaptureData> m_Captures;
 
+  // a capture held in memory by CreateRDC, to be written to disk on a background thread once
+  // FinishCaptureWriting is called. See Capture_AsyncWriting
+  struct PendingCaptureWrite
+  {
+    uint64_t id = 0;
+    RDCFile *rdc = NULL;
+    rdcstr path;
+    // the raw thumbnail, encoded on the writing thread
+    RDCThumb *thumb = NULL;
+    // the bytes counted against Capture_AsyncWritingMemoryLimitMB. Until the capture is finished
+    // this is an estimate from the previous capture
+    uint64_t size = 0;
+    bool writing = false;
+    // snapshotted when the write is queued, as the options can change before it's written
+    bool captureCallstacks = false;
+    bytebuf resolveDB;
+  };
+
+  void WriteCapture(RDCFile *rdc, const rdcstr &path, uint32_t frameNumber,
+                    const bytebuf &resolveDB);
+  void WriteCaptureAsync(PendingCaptureWrite write, uint32_t frameNumber);
+  // waits for captures queued before the given write ID to finish writing
+  void WaitForCaptureWrites(uint64_t beforeID);
+
+  Threading::CriticalSection m_CaptureWriteLock;
+  rdcarray<PendingCaptureWrite> m_PendingCaptureWrites;
+  uint64_t m_PendingCaptureBytes = 0;
+  uint64_t m_LastCaptureBytes = 0;
+  uint64_t m_NextCaptureWriteID = 1;
+  // woken when a background write finishes, for each thread waiting in WaitForCaptureWrites
+  Threading::Semaphore m_CaptureWriteDone;
+  uint32_t m_CaptureWriteWaiters = 0;
+
   Threading::CriticalSection m_ChildLock;
   rdcarray<rdcpair<uint32_t, uint32_t>> m_Children;
   rdcarray<rdcpair<uint32_t, Threading::ThreadHandle>> m_ChildThreads;
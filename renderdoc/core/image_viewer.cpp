@@ -276,6 +276,14 @@ public:
   {
   }
   void GetBufferData(ResourceId buff, uint64_t offset, uint64_t len, bytebuf &retData) {}
+  void FetchResourceData(const rdcarray<ResourceDataRequest> &requests,
+                         rdcarray<bytebuf> &results, rdcarray<bool> &fetched)
+  {
+    results.clear();
+    results.resize(requests.size());
+    fetched.clear();
+    fetched.resize(requests.size());
+  }
   void InitPostVSBuffers(uint32_t eventId) {}
   void InitPostVSBuffers(const rdcarray<uint32_t> &eventId) {}
   MeshFormat GetPostVSBuffers(uint32_t eventId, uint32_t instID, uint32_t viewID, MeshDataStage stage)
@@ -58,6 +58,7 @@ rdcstr DoStringise(const ReplayProxyPacket &el)
 
     STRINGISE_ENUM_NAMED(eReplayProxy_GetBufferData, "GetBufferData");
     STRINGISE_ENUM_NAMED(eReplayProxy_GetTextureData, "GetTextureData");
+    STRINGISE_ENUM_NAMED(eReplayProxy_FetchResourceData, "FetchResourceData");
 
     STRINGISE_ENUM_NAMED(eReplayProxy_SavePipelineState, "SavePipelineState");
     STRINGISE_ENUM_NAMED(eReplayProxy_GetUsage, "GetUsage");
@@ -1037,6 +1038,106 @@ void ReplayProxy::GetTextureData(ResourceId tex, const Subresource &sub,
   PROXY_FUNCTION(GetTextureData, tex, sub, params, data);
 }
 
+template <typename ParamSerialiser, typename ReturnSerialiser>
+void ReplayProxy::Proxied_FetchResourceData(ParamSerialiser &paramser, ReturnSerialiser &retser,
+                                            const rdcarray<ResourceDataRequest> &requests,
+                                            rdcarray<bytebuf> &results, rdcarray<bool> &fetched)
+{
+  const ReplayProxyPacket expectedPacket = eReplayProxy_FetchResourceData;
+  ReplayProxyPacket packet = eReplayProxy_FetchResourceData;
+
+  {
+    BEGIN_PARAMS();
+    SERIALISE_ELEMENT(requests);
+    END_PARAMS();
+  }
+
+  {
+    REMOTE_EXECUTION();
+    if(paramser.IsReading() && !paramser.IsErrored() && !m_IsErrored)
+      m_Remote->FetchResourceData(requests, results, fetched);
+  }
+
+  // as with GetBufferData we over-estimate the uncompressed size, allowing for the length and
+  // alignment padding of every element, then pad up to it.
+  uint64_t dataSize = 5 * retser.GetChunkAlignment() + fetched.size();
+  for(const bytebuf &r : results)
+    dataSize += r.size() + 2 * retser.GetChunkAlignment();
+
+  {
+    ReturnSerialiser &ser = retser;
+    PACKET_HEADER(packet);
+    SERIALISE_ELEMENT(packet);
+    SERIALISE_ELEMENT(dataSize);
+  }
+
+  char empty[128] = {};
+
+  // lz4 compress
+  if(retser.IsReading())
+  {
+    ReadSerialiser ser(new StreamReader(new LZ4Decompressor(retser.GetReader(), Ownership::Nothing),
+                                        dataSize, Ownership::Stream),
+                       Ownership::Stream);
+
+    // bytebuf only serialises as raw bytes at the top level, so serialise each result separately
+    uint64_t numResults = results.size();
+    SERIALISE_ELEMENT(numResults);
+    results.resize((size_t)numResults);
+    for(bytebuf &result : results)
+    {
+      SERIALISE_ELEMENT(result);
+    }
+    SERIALISE_ELEMENT(fetched);
+
+    uint64_t offs = ser.GetReader()->GetOffset();
+    RDCASSERT(offs <= dataSize, offs, dataSize);
+
+    while(offs < dataSize)
+    {
+      uint64_t chunk = RDCMIN(dataSize - offs, (uint64_t)sizeof(empty));
+      ser.GetReader()->Read(empty, chunk);
+      offs += chunk;
+    }
+  }
+  else
+  {
+    WriteSerialiser ser(new StreamWriter(new LZ4Compressor(retser.GetWriter(), Ownership::Nothing),
+                                         Ownership::Stream),
+                        Ownership::Stream);
+
+    // bytebuf only serialises as raw bytes at the top level, so serialise each result separately
+    uint64_t numResults = results.size();
+    SERIALISE_ELEMENT(numResults);
+    results.resize((size_t)numResults);
+    for(bytebuf &result : results)
+    {
+      SERIALISE_ELEMENT(result);
+    }
+    SERIALISE_ELEMENT(fetched);
+
+    uint64_t offs = ser.GetWriter()->GetOffset();
+    RDCASSERT(offs <= dataSize, offs, dataSize);
+
+    while(offs < dataSize)
+    {
+      uint64_t chunk = RDCMIN(dataSize - offs, (uint64_t)sizeof(empty));
+      ser.GetWriter()->Write(empty, chunk);
+      offs += chunk;
+    }
+  }
+
+  retser.EndChunk();
+
+  CheckError(packet, expectedPacket);
+}
+
+void ReplayProxy::FetchResourceData(const rdcarray<ResourceDataRequest> &requests,
+                                    rdcarray<bytebuf> &results, rdcarray<bool> &fetched)
+{
+  PROXY_FUNCTION(FetchResourceData, requests, results, fetched);
+}
+
 template <typename ParamSerialiser, typename ReturnSerialiser>
 void ReplayProxy::Proxied_InitPostVSBuffers(ParamSerialiser &paramser, ReturnSerialiser &retser,
                                             uint32_t eventId)
@@ -2883,6 +2984,13 @@ bool ReplayProxy::Tick(int type)
       GetTextureData(ResourceId(), Subresource(), GetTextureDataParams(), dummy);
       break;
     }
+    case eReplayProxy_FetchResourceData:
+    {
+      rdcarray<bytebuf> dummy;
+      rdcarray<bool> dummyFetched;
+      FetchResourceData({}, dummy, dummyFetched);
+      break;
+    }
     case eReplayProxy_SavePipelineState: SavePipelineState(0); break;
     case eReplayProxy_GetUsage: GetUsage(ResourceId()); break;
     case eReplayProxy_GetLiveID: GetLiveID(ResourceId()); break;
@@ -63,6 +63,7 @@ enum ReplayProxyPacket
 
   eReplayProxy_GetBufferData,
   eReplayProxy_GetTextureData,
+  eReplayProxy_FetchResourceData,
 
   eReplayProxy_SavePipelineState,
   eReplayProxy_GetUsage,
@@ -488,6 +489,8 @@ public:
                              bytebuf &retData);
   IMPLEMENT_FUNCTION_PROXIED(void, GetTextureData, ResourceId tex, const Subresource &sub,
                              const GetTextureDataParams &params, bytebuf &data);
+  IMPLEMENT_FUNCTION_PROXIED(void, FetchResourceData, const rdcarray<ResourceDataRequest> &requests,
+                             rdcarray<bytebuf> &results, rdcarray<bool> &fetched);
 
   IMPLEMENT_FUNCTION_PROXIED(void, InitPostVSBuffers, uint32_t eventId);
   IMPLEMENT_FUNCTION_PROXIED(void, InitPostVSBuffers, const rdcarray<uint32_t> &passEvents);
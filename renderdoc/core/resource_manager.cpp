@@ -228,3 +228,293 @@ void ResourceRecord::Delete(ResourceRecordHandler *mgr)
     mgr->DestroyResourceRecord(this);
   }
 }
+
+#if ENABLED(ENABLE_UNIT_TESTS)
+
+#undef None
+#undef Always
+
+#include "catch/catch.hpp"
+#include "serialise/rdcfile.h"
+
+// a resource manager that only has CPU memory, so that the capture and replay of initial contents
+// can be tested without a graphics API
+struct SyntheticResource
+{
+  ResourceId id;
+  bytebuf contents;
+};
+
+struct SyntheticRecord : public ResourceRecord
+{
+  enum
+  {
+    NullResource = 0
+  };
+
+  SyntheticRecord(ResourceId id) : ResourceRecord(id, true) {}
+};
+
+struct SyntheticContents
+{
+  bytebuf data;
+
+  template <typename Configuration>
+  void Free(ResourceManager<Configuration> *rm)
+  {
+    data.clear();
+  }
+};
+
+struct SyntheticResourceManagerConfiguration
+{
+  typedef SyntheticResource *WrappedResourceType;
+  typedef SyntheticResource *RealResourceType;
+  typedef SyntheticRecord RecordType;
+  typedef SyntheticContents InitialContentData;
+};
+
+class SyntheticResourceManager : public ResourceManager<SyntheticResourceManagerConfiguration>
+{
+public:
+  SyntheticResourceManager(CaptureState &state, RDCIncrementalContents *incremental)
+      : ResourceManager(state), m_Incremental(incremental)
+  {
+  }
+
+  // serialises contents the same way as the drivers, storing them incrementally when there's
+  // somewhere to put them
+  template <typename SerialiserType>
+  bool Serialise_Contents(SerialiserType &ser, ResourceId id, const SyntheticContents *initial)
+  {
+    SERIALISE_ELEMENT(id);
+
+    uint64_t ContentsSize = initial ? initial->data.size() : 0;
+    SERIALISE_ELEMENT(ContentsSize);
+
+    bool Incremental = ser.IsWriting() && m_Incremental && ContentsSize > 0;
+    SERIALISE_ELEMENT(Incremental);
+
+    bytebuf Contents;
+
+    if(ser.IsWriting())
+      Contents = initial->data;
+    else
+      Contents.resize((size_t)ContentsSize);
+
+    if(Incremental)
+    {
+      if(ser.IsWriting())
+        m_Incremental->Add(id, Contents.data(), Contents.size());
+      else if(!m_Incremental->Resolve(id, Contents.data(), Contents.size()))
+        return false;
+    }
+    else
+    {
+      SERIALISE_ELEMENT(Contents);
+    }
+
+    if(ser.IsReading())
+    {
+      SyntheticContents contents;
+      contents.data.swap(Contents);
+      SetInitialContents(id, contents);
+    }
+
+    return true;
+  }
+
+protected:
+  ResourceId GetID(SyntheticResource *res) { return res->id; }
+  bool ResourceTypeRelease(SyntheticResource *res) { return true; }
+  bool Prepare_InitialState(SyntheticResource *res)
+  {
+    SyntheticContents contents;
+    contents.data = res->contents;
+    SetInitialContents(res->id, contents);
+    return true;
+  }
+  uint64_t GetSize_InitialState(ResourceId id, const SyntheticContents &initial)
+  {
+    return initial.data.size() + 128;
+  }
+  bool Serialise_InitialState(WriteSerialiser &ser, ResourceId id, SyntheticRecord *record,
+                              const SyntheticContents *initialData)
+  {
+    return Serialise_Contents(ser, id, initialData);
+  }
+  void Create_InitialState(ResourceId id, SyntheticResource *live, bool hasData) {}
+  void Apply_InitialState(SyntheticResource *live, const SyntheticContents &initial)
+  {
+    live->contents = initial.data;
+  }
+
+  RDCIncrementalContents *m_Incremental;
+};
+
+TEST_CASE("Initial contents are stored incrementally by the resource manager",
+          "[resourcemanager][incremental]")
+{
+  const uint64_t PageSize = RDCIncrementalContents::PageSize;
+
+  rdcstr dir = FileIO::GetTempFolderFilename() + "/rdoc_incremental_manager_test";
+  rdcstr paths[3] = {dir + "/first.rdc", dir + "/second.rdc", dir + "/third.rdc"};
+
+  FileIO::CreateParentDirectory(paths[0]);
+
+  SyntheticResource resources[3];
+  resources[0].contents.resize(size_t(PageSize * 8 + 77));
+  resources[1].contents.resize(size_t(PageSize * 3));
+  resources[2].contents.resize(size_t(PageSize / 2));
+
+  for(SyntheticResource &res : resources)
+  {
+    res.id = ResourceIDGen::GetNewUniqueID();
+    for(byte &b : res.contents)
+      b = byte((rand() & 0xff0) >> 4);
+  }
+
+  // the contents of each resource at the start of each capture
+  rdcarray<bytebuf> expected[3];
+
+  RDCIncrementalContents incremental;
+  CaptureState state = CaptureState::BackgroundCapturing;
+
+  SyntheticResourceManager rm(state, &incremental);
+
+  for(SyntheticResource &res : resources)
+  {
+    rm.AddCurrentResource(res.id, &res);
+    rm.AddResourceRecord(res.id);
+  }
+
+  auto capture = [&](const rdcstr &path, uint64_t &stored) {
+    for(SyntheticResource &res : resources)
+      rm.MarkDirtyResource(res.id);
+
+    rm.PrepareInitialContents();
+
+    state = CaptureState::ActiveCapturing;
+
+    for(SyntheticResource &res : resources)
+      rm.MarkResourceFrameReferenced(res.id, eFrameRef_Read);
+
+    RDCFile rdc;
+    rdc.SetData(RDCDriver::Vulkan, "Vulkan", 0, NULL, 0, 1.0);
+    rdc.Create(path);
+
+    SectionProperties props;
+    props.type = SectionType::FrameCapture;
+    StreamWriter *writer = rdc.WriteSection(props);
+
+    {
+      WriteSerialiser ser(writer, Ownership::Nothing);
+      rm.InsertInitialContentsChunks(ser);
+    }
+
+    writer->Finish();
+    delete writer;
+
+    stored = incremental.GetDataSize();
+
+    bool success = incremental.EndCapture(rdc, path);
+
+    state = CaptureState::BackgroundCapturing;
+
+    rm.FreeInitialContents();
+    rm.ClearReferencedResources();
+
+    for(int i = 0; i < 3; i++)
+      expected[i].push_back(resources[i].contents);
+
+    return success;
+  };
+
+  auto replay = [&](const rdcstr &path, rdcarray<bytebuf> &contents) {
+    RDCFile rdc;
+    rdc.Open(path);
+
+    RDCIncrementalContents replayIncremental;
+    if(!replayIncremental.Read(rdc, path))
+      return false;
+
+    CaptureState replayState = CaptureState::LoadingReplaying;
+    SyntheticResourceManager replayRM(replayState, &replayIncremental);
+
+    ReadSerialiser ser(rdc.ReadSection(rdc.SectionIndex(SectionType::FrameCapture)),
+                       Ownership::Stream);
+
+    bool success = true;
+
+    while(success && !ser.GetReader()->AtEnd())
+    {
+      SystemChunk chunk = ser.ReadChunk<SystemChunk>();
+
+      if(chunk == SystemChunk::InitialContents)
+        success = replayRM.Serialise_Contents(ser, ResourceId(), NULL);
+      else
+        ser.SkipCurrentChunk();
+
+      ser.EndChunk();
+    }
+
+    contents.clear();
+    for(SyntheticResource &res : resources)
+      contents.push_back(replayRM.GetInitialContents(res.id).data);
+
+    replayRM.Shutdown();
+
+    return success;
+  };
+
+  uint64_t stored = 0;
+
+  // the first capture stores everything
+  REQUIRE(capture(paths[0], stored));
+  CHECK(stored == resources[0].contents.size() + resources[1].contents.size() +
+                      resources[2].contents.size());
+
+  // then only what changed, including the partial last page
+  resources[0].contents[size_t(PageSize * 2 + 5)]++;
+  resources[0].contents[size_t(PageSize * 8 + 70)]++;
+  REQUIRE(capture(paths[1], stored));
+  CHECK(stored == PageSize + 77);
+
+  resources[1].contents[0]++;
+  resources[2].contents[10]++;
+  REQUIRE(capture(paths[2], stored));
+  CHECK(stored == PageSize + resources[2].contents.size());
+
+  SECTION("Replayed contents match what was captured")
+  {
+    for(int c = 0; c < 3; c++)
+    {
+      rdcarray<bytebuf> contents;
+      REQUIRE(replay(paths[c], contents));
+
+      for(int i = 0; i < 3; i++)
+        CHECK(contents[i] == expected[i][c]);
+    }
+  }
+
+  SECTION("Replay fails without a base capture")
+  {
+    FileIO::Delete(paths[0]);
+
+    rdcarray<bytebuf> contents;
+    CHECK_FALSE(replay(paths[2], contents));
+  }
+
+  for(SyntheticResource &res : resources)
+  {
+    rm.GetResourceRecord(res.id)->Delete(&rm);
+    rm.ReleaseCurrentResource(res.id);
+  }
+
+  rm.Shutdown();
+
+  for(int i = 0; i < 3; i++)
+    FileIO::Delete(paths[i]);
+}
+
+#endif    // ENABLED(ENABLE_UNIT_TESTS)
@@ -32,6 +32,7 @@
 #include <unordered_set>
 #include "api/replay/rdcflatmap.h"
 #include "api/replay/resourceid.h"
+#include "common/sharded_hash_map.h"
 #include "common/threading.h"
 #include "core/core.h"
 #include "os/os_specific.h"
@@ -705,10 +706,10 @@ protected:
   void Prepare_InitialStateIfPostponed(ResourceId id, bool midframe);
   void SkipOrPostponeOrPrepare_InitialState(ResourceId id, FrameRefType refType);
 
-  // very coarse lock, protects EVERYTHING. This could certainly be improved and it may be a
-  // bottleneck for performance. Given that the main use cases are write-rarely read-often the lock
-  // should be optimised for that as we only want to make sure we're not modifying the objects
-  // together, by far the most common operation is looking up data.
+  // coarse lock, protects everything that isn't in a ShardedHashMap. The per-resource tracking
+  // that's hit from every recording thread while capturing - records, frame references, dirty
+  // resources and write times - is sharded instead so that threads working on different resources
+  // don't contend, and checks for resources already in the right state only take a read lock.
   Threading::CriticalSection m_Lock;
 
   // we only need to lock during capturing, on replay we have single threaded access.
@@ -722,10 +723,10 @@ protected:
   std::map<RealResourceType, WrappedResourceType> m_WrapperMap;
 
   // used during capture - holds resources referenced in current frame (and how they're referenced)
-  std::map<ResourceId, FrameRefType> m_FrameReferencedResources;
+  ShardedHashMap<ResourceId, FrameRefType> m_FrameReferencedResources;
 
   // used during capture - holds resources marked as dirty, needing initial contents
-  std::set<ResourceId> m_DirtyResources;
+  ShardedHashMap<ResourceId, bool> m_DirtyResources;
 
   struct InitialContentDataOrChunk
   {
@@ -758,8 +759,7 @@ protected:
   std::unordered_map<ResourceId, WrappedResourceType> m_LiveResourceMap;
 
   // used during capture - holds resource records by id.
-  std::unordered_map<ResourceId, RecordType *> m_ResourceRecords;
-  Threading::RWLock m_ResourceRecordLock;
+  ShardedHashMap<ResourceId, RecordType *> m_ResourceRecords;
 
   // used during replay - holds current resource replacements
   // replaced -> replacement
@@ -769,15 +769,13 @@ protected:
 
   // During initial resources preparation, persistent resources are
   // postponed until serializing to RDC file.
-  std::unordered_set<ResourceId> m_PostponedResourceIDs;
+  ShardedHashMap<ResourceId, bool> m_PostponedResourceIDs;
   // During initial resources preparation, resources that are completely written
   // over are skipped
-  std::unordered_set<ResourceId> m_SkippedResourceIDs;
+  ShardedHashMap<ResourceId, bool> m_SkippedResourceIDs;
 
   struct ResourceRefTimes
   {
-    ResourceId id;
-
     // On marking resource write-referenced in frame, its last write time is reset. The time is used
     // to determine persistent resources, and is checked against the `PERSISTENT_RESOURCE_AGE`.
     double writeTime;
@@ -788,14 +786,14 @@ protected:
     // for that long. If the time is 0.0 then it's been written in a more visible way recently or
     // has never been marked skippable.
     double firstSkipTime;
-
-    bool operator<(const ResourceId &o) const { return id < o; }
   };
 
+  void UpdateRefTimes(ResourceRefTimes &times, FrameRefType refType, double now);
+
   // all resources that are written in some way end up in this list. We then check the last time
   // they were written, and the last time they were ever partially used (not completely overwritten
   // in one atomic chunk).
-  rdcarray<ResourceRefTimes> m_ResourceRefTimes;
+  ShardedHashMap<ResourceId, ResourceRefTimes> m_ResourceRefTimes;
 
   // Timestamp at the beginning of the frame capture. Used to determine which
   // resources to refresh for their last write or partial use time (see `ResourceRefTimes`).
@@ -830,7 +828,7 @@ void ResourceManager<Configuration>::Shutdown()
       m_LiveResourceMap.erase(removeit);
   }
 
-  RDCASSERT(m_ResourceRecords.empty());
+  RDCASSERT(m_ResourceRecords.IsEmpty());
 }
 
 template <typename Configuration>
@@ -838,7 +836,7 @@ ResourceManager<Configuration>::~ResourceManager()
 {
   RDCASSERT(m_LiveResourceMap.empty());
   RDCASSERT(m_InitialContents.empty());
-  RDCASSERT(m_ResourceRecords.empty());
+  RDCASSERT(m_ResourceRecords.IsEmpty());
 
   RenderDoc::Inst().UnregisterMemoryRegion(this);
 }
@@ -847,24 +845,25 @@ template <typename Configuration>
 void ResourceManager<Configuration>::MarkBackgroundFrameReferenced(
     const rdcflatmap<ResourceId, FrameRefType> &refs)
 {
-  SCOPED_LOCK_OPTIONAL(m_Lock, m_Capturing);
-
   if(IsBackgroundCapturing(m_State))
   {
-    if(refs.size() <= m_ResourceRefTimes.size())
+    if(refs.size() <= m_ResourceRefTimes.Size())
     {
       for(auto it = refs.begin(); it != refs.end(); ++it)
         UpdateLastWriteTime(it->first, it->second);
     }
     else
     {
-      for(const ResourceRefTimes &res : m_ResourceRefTimes)
-      {
-        auto it = refs.find(res.id);
+      double now = m_ResourcesUpdateTimer.GetMilliseconds();
 
-        if(it != refs.end())
-          UpdateLastWriteTime(it->first, it->second);
-      }
+      m_ResourceRefTimes.RemoveIf([&refs, now, this](ResourceId id, ResourceRefTimes &times) {
+        auto it = refs.find(id);
+
+        if(it != refs.end() && IsDirtyFrameRef(it->second))
+          UpdateRefTimes(times, it->second, now);
+
+        return false;
+      });
     }
   }
 }
@@ -872,8 +871,6 @@ void ResourceManager<Configuration>::MarkBackgroundFrameReferenced(
 template <typename Configuration>
 void ResourceManager<Configuration>::CleanBackgroundFrameReferences()
 {
-  SCOPED_LOCK_OPTIONAL(m_Lock, m_Capturing);
-
   if(IsBackgroundCapturing(m_State))
   {
     double now = m_ResourcesUpdateTimer.GetMilliseconds();
@@ -881,37 +878,12 @@ void ResourceManager<Configuration>::CleanBackgroundFrameReferences()
     // retire any old entries, if they were written once they shouldn't be tracked forever. This
     // means the list only keeps track of recently written resources, not all resources that have
     // ever been written.
-    //
-    // walk the array. If we find an item we want to remove we increment src otherwise we copy src
-    // to dst (if they are different). Thus next time dst will point at the item we want to skip, at
-    // each stage copying src to dst (if they are different). If we find an item we want to remove
-    // we increment src and continue (thus it will get copied ove
-    size_t dst = 0, src = 0;
-    for(dst = 0, src = 0; src < m_ResourceRefTimes.size();)
-    {
-      ResourceRefTimes &check = m_ResourceRefTimes[src];
-
+    m_ResourceRefTimes.RemoveIf([now](ResourceId, const ResourceRefTimes &check) {
       // if this isn't skippable, and the write time was a long time ago then we can delete it.
       // Resources not in the list are treated as if they were written an infinite time ago and so
       // are postponable.
-      if(now - check.writeTime > PERSISTENT_RESOURCE_AGE && check.firstSkipTime == 0.0)
-      {
-        // skip src, check the next one
-        src++;
-        continue;
-      }
-
-      // we want to keep src. If dst == src we can just continue on to the next iteration, if not
-      // then we need to copy src into dst (where dst is the leftovers from previously remove
-      // entries)
-      if(dst != src)
-        m_ResourceRefTimes[dst] = m_ResourceRefTimes[src];
-
-      dst++;
-      src++;
-    }
-
-    m_ResourceRefTimes.resize(dst);
+      return now - check.writeTime > PERSISTENT_RESOURCE_AGE && check.firstSkipTime == 0.0;
+    });
   }
 }
 
@@ -920,8 +892,6 @@ template <typename Compose>
 void ResourceManager<Configuration>::MarkResourceFrameReferenced(ResourceId id,
                                                                  FrameRefType refType, Compose comp)
 {
-  SCOPED_LOCK_OPTIONAL(m_Lock, m_Capturing);
-
   if(id == ResourceId())
     return;
 
@@ -940,7 +910,16 @@ void ResourceManager<Configuration>::MarkResourceFrameReferenced(ResourceId id,
   if(IsBackgroundCapturing(m_State))
     return;
 
-  bool newRef = MarkReferenced(m_FrameReferencedResources, id, refType, comp);
+  // most references are repeats that don't change how the resource is referenced, so check that
+  // with only a read lock first
+  FrameRefType prevRef = eFrameRef_None;
+  if(m_FrameReferencedResources.Find(id, prevRef) && comp(prevRef, refType) == prevRef)
+    return;
+
+  bool newRef =
+      m_FrameReferencedResources.Modify(id, [refType, comp](FrameRefType &ref, bool added) {
+        ref = added ? refType : comp(ref, refType);
+      });
 
   if(newRef)
   {
@@ -960,23 +939,19 @@ void ResourceManager<Configuration>::MarkResourceFrameReferenced(ResourceId id,
 template <typename Configuration>
 void ResourceManager<Configuration>::MarkDirtyResource(ResourceId res)
 {
-  SCOPED_LOCK_OPTIONAL(m_Lock, m_Capturing);
-
   if(res == ResourceId())
     return;
 
-  m_DirtyResources.insert(res);
+  m_DirtyResources.Insert(res, true);
 }
 
 template <typename Configuration>
 bool ResourceManager<Configuration>::IsResourceDirty(ResourceId res)
 {
-  SCOPED_LOCK_OPTIONAL(m_Lock, m_Capturing);
-
   if(res == ResourceId())
     return false;
 
-  return m_DirtyResources.find(res) != m_DirtyResources.end();
+  return m_DirtyResources.Contains(res);
 }
 
 template <typename Configuration>
@@ -1056,17 +1031,23 @@ void ResourceManager<Configuration>::Serialise_InitialContentsNeeded(WriteSerial
   // need to be reset.
   rdcarray<WrittenRecord> NeededInitials;
 
+  // sorted so that the list is in a stable order
+  rdcarray<ResourceId> referenced = m_FrameReferencedResources.GetSortedKeys();
+
   // reasonable estimate, and these records are small
-  NeededInitials.reserve(m_FrameReferencedResources.size() + m_InitialContents.size());
+  NeededInitials.reserve(referenced.size() + m_InitialContents.size());
 
   // all resources that were recorded as being modified should be included in the list of those
   // needing initial contents
-  for(auto it = m_FrameReferencedResources.begin(); it != m_FrameReferencedResources.end(); ++it)
+  for(ResourceId id : referenced)
   {
-    RecordType *record = GetResourceRecord(it->first);
-    if(IsDirtyFrameRef(it->second))
+    FrameRefType refType = eFrameRef_None;
+    m_FrameReferencedResources.Find(id, refType);
+
+    RecordType *record = GetResourceRecord(id);
+    if(IsDirtyFrameRef(refType))
     {
-      WrittenRecord wr = {it->first, record ? record->DataInSerialiser : true};
+      WrittenRecord wr = {id, record ? record->DataInSerialiser : true};
 
       NeededInitials.push_back(wr);
     }
@@ -1081,7 +1062,7 @@ void ResourceManager<Configuration>::Serialise_InitialContentsNeeded(WriteSerial
     bool include = RenderDoc::Inst().GetCaptureOptions().refAllResources;
 
     ResourceId id = it->first;
-    if(m_FrameReferencedResources.find(id) != m_FrameReferencedResources.end())
+    if(m_FrameReferencedResources.Contains(id))
       include = true;
 
     if(include)
@@ -1108,13 +1089,17 @@ void ResourceManager<Configuration>::FreeInitialContents()
     if(!m_InitialContents.empty())
       m_InitialContents.erase(m_InitialContents.begin());
   }
-  m_PostponedResourceIDs.clear();
-  m_SkippedResourceIDs.clear();
+  m_PostponedResourceIDs.Clear();
+  m_SkippedResourceIDs.Clear();
 }
 
 template <typename Configuration>
 void ResourceManager<Configuration>::Prepare_InitialStateIfPostponed(ResourceId id, bool midframe)
 {
+  // check before locking, as this is called for every write reference while capturing
+  if(!IsResourcePostponed(id))
+    return;
+
   SCOPED_LOCK_OPTIONAL(m_Lock, m_Capturing);
 
   if(!IsResourcePostponed(id))
@@ -1126,23 +1111,25 @@ void ResourceManager<Configuration>::Prepare_InitialStateIfPostponed(ResourceId
   WrappedResourceType res = GetCurrentResource(id);
   Prepare_InitialState(res);
 
-  m_PostponedResourceIDs.erase(id);
+  m_PostponedResourceIDs.Erase(id);
 }
 
 template <typename Configuration>
 void ResourceManager<Configuration>::SkipOrPostponeOrPrepare_InitialState(ResourceId id,
                                                                           FrameRefType refType)
 {
-  SCOPED_LOCK_OPTIONAL(m_Lock, m_Capturing);
-
+  // check before locking, as this is called for every reference while capturing
   if(!IsResourceSkipped(id))
     return;
 
+  SCOPED_LOCK_OPTIONAL(m_Lock, m_Capturing);
+
   // the first time we encounter a skipped resource, we can choose to
   // skip this resource forever, convert it to be postponed, or prepare
   // it immediately. We can't retrieve its initial state once it has
   // been written over.
-  m_SkippedResourceIDs.erase(id);
+  if(!m_SkippedResourceIDs.Erase(id))
+    return;
 
   // skip this forever if the first encounter is a complete write
   if(IsCompleteWriteFrameRef(refType))
@@ -1156,7 +1143,7 @@ void ResourceManager<Configuration>::SkipOrPostponeOrPrepare_InitialState(Resour
   // postpone it to conserve memory consumption.
   if(!IsDirtyFrameRef(refType) && IsResourceTrackedForPersistency(GetCurrentResource(id)))
   {
-    m_PostponedResourceIDs.insert(id);
+    m_PostponedResourceIDs.Insert(id, true);
     RDCDEBUG("Resource %s converted from skipped to postponed on refType of %s", ToStr(id).c_str(),
              ToStr(refType).c_str());
     SetInitialContents(id, InitialContentData());
@@ -1183,96 +1170,90 @@ template <typename Configuration>
 inline void ResourceManager<Configuration>::ResetLastWriteTimes()
 {
   SCOPED_LOCK_OPTIONAL(m_Lock, m_Capturing);
-  for(auto it = m_ResourceRefTimes.begin(); it != m_ResourceRefTimes.end(); ++it)
-  {
+
+  double captureStartTime = m_captureStartTime;
+  double now = m_ResourcesUpdateTimer.GetMilliseconds();
+
+  m_ResourceRefTimes.RemoveIf([captureStartTime, now](ResourceId, ResourceRefTimes &times) {
     // Reset only those resources which were below the threshold on
     // capture start. Other resource are already above the threshold.
-    if(m_captureStartTime - it->writeTime <= PERSISTENT_RESOURCE_AGE)
-      it->writeTime = m_ResourcesUpdateTimer.GetMilliseconds();
-  }
+    if(captureStartTime - times.writeTime <= PERSISTENT_RESOURCE_AGE)
+      times.writeTime = now;
+    return false;
+  });
 }
 
 template <typename Configuration>
 inline void ResourceManager<Configuration>::UpdateLastWriteTime(ResourceId id, FrameRefType refType)
 {
-  // parent must hold m_Lock for us
-
   // only care about write refs. A read ref would invalidate skippable state, however a skippable
   // resource is left in an undefined state where reads are not valid so we don't. We need to see
   // another write first before a read could be a problem, so we just pay attention for that write.
   if(!IsDirtyFrameRef(refType))
     return;
 
-  ResourceRefTimes *it = std::lower_bound(m_ResourceRefTimes.begin(), m_ResourceRefTimes.end(), id);
-
-  if(it == m_ResourceRefTimes.end() || it->id != id)
-  {
-    // if it's not pointing to the end, figure out where we need to insert it there
-    size_t idx = it - m_ResourceRefTimes.begin();
-    m_ResourceRefTimes.insert(idx, {id, 0.0, 0.0});
-    it = m_ResourceRefTimes.begin() + idx;
-  }
-
   double now = m_ResourcesUpdateTimer.GetMilliseconds();
 
-  it->writeTime = now;
+  m_ResourceRefTimes.Modify(id, [this, refType, now](ResourceRefTimes &times, bool) {
+    UpdateRefTimes(times, refType, now);
+  });
+}
+
+template <typename Configuration>
+inline void ResourceManager<Configuration>::UpdateRefTimes(ResourceRefTimes &times,
+                                                           FrameRefType refType, double now)
+{
+  times.writeTime = now;
 
   if(refType == eFrameRef_CompleteWriteAndDiscard)
   {
     // don't continually update it. We want to know that this resource *was* completely written and
     // discarded, and hasn't been written in any other way since then.
-    if(it->firstSkipTime == 0.0)
-      it->firstSkipTime = now;
+    if(times.firstSkipTime == 0.0)
+      times.firstSkipTime = now;
   }
   else
   {
-    it->firstSkipTime = 0.0;
+    times.firstSkipTime = 0.0;
   }
 }
 
 template <typename Configuration>
 inline bool ResourceManager<Configuration>::HasPersistentAge(ResourceId id)
 {
-  SCOPED_LOCK_OPTIONAL(m_Lock, m_Capturing);
-
-  ResourceRefTimes *it = std::lower_bound(m_ResourceRefTimes.begin(), m_ResourceRefTimes.end(), id);
-
-  if(it == m_ResourceRefTimes.end() || it->id != id)
+  ResourceRefTimes times = {};
+  if(!m_ResourceRefTimes.Find(id, times))
     return true;
 
-  return m_ResourcesUpdateTimer.GetMilliseconds() - it->writeTime >= PERSISTENT_RESOURCE_AGE;
+  return m_ResourcesUpdateTimer.GetMilliseconds() - times.writeTime >= PERSISTENT_RESOURCE_AGE;
 }
 
 template <typename Configuration>
 inline bool ResourceManager<Configuration>::HasSkippableAge(ResourceId id)
 {
-  SCOPED_LOCK_OPTIONAL(m_Lock, m_Capturing);
-
-  ResourceRefTimes *it = std::lower_bound(m_ResourceRefTimes.begin(), m_ResourceRefTimes.end(), id);
+  ResourceRefTimes times = {};
 
   // if it doesn't have a write time, it can't be skippable
-  if(it == m_ResourceRefTimes.end() || it->id != id)
+  if(!m_ResourceRefTimes.Find(id, times))
     return false;
 
   // if it's never been skipped or it was reset, it's also not skippable
-  if(it->firstSkipTime == 0.0)
+  if(times.firstSkipTime == 0.0)
     return false;
 
-  return m_ResourcesUpdateTimer.GetMilliseconds() - it->firstSkipTime >= SKIP_RESOURCE_AGE;
+  return m_ResourcesUpdateTimer.GetMilliseconds() - times.firstSkipTime >= SKIP_RESOURCE_AGE;
 }
 
 template <typename Configuration>
 inline bool ResourceManager<Configuration>::IsResourcePostponed(ResourceId id)
 {
-  SCOPED_LOCK_OPTIONAL(m_Lock, m_Capturing);
-  return m_PostponedResourceIDs.find(id) != m_PostponedResourceIDs.end();
+  return m_PostponedResourceIDs.Contains(id);
 }
 
 template <typename Configuration>
 inline bool ResourceManager<Configuration>::IsResourceSkipped(ResourceId id)
 {
-  SCOPED_LOCK_OPTIONAL(m_Lock, m_Capturing);
-  return m_SkippedResourceIDs.find(id) != m_SkippedResourceIDs.end();
+  return m_SkippedResourceIDs.Contains(id);
 }
 
 template <typename Configuration>
@@ -1375,10 +1356,7 @@ rdcarray<ResourceId> ResourceManager<Configuration>::InitialContentResources()
 template <typename Configuration>
 void ResourceManager<Configuration>::MarkUnwrittenResources()
 {
-  SCOPED_READLOCK(m_ResourceRecordLock);
-
-  for(auto it = m_ResourceRecords.begin(); it != m_ResourceRecords.end(); ++it)
-    it->second->MarkDataUnwritten();
+  m_ResourceRecords.ForEach([](ResourceId, RecordType *record) { record->MarkDataUnwritten(); });
 }
 
 template <typename Configuration>
@@ -1388,41 +1366,36 @@ void ResourceManager<Configuration>::InsertReferencedChunks(WriteSerialiser &ser
 
   SCOPED_LOCK_OPTIONAL(m_Lock, m_Capturing);
 
-  RDCDEBUG("%u frame resource records", (uint32_t)m_FrameReferencedResources.size());
+  RDCDEBUG("%u frame resource records", (uint32_t)m_FrameReferencedResources.Size());
 
   if(RenderDoc::Inst().GetCaptureOptions().refAllResources)
   {
-    SCOPED_READLOCK(m_ResourceRecordLock);
-
-    float num = float(m_ResourceRecords.size());
+    float num = float(m_ResourceRecords.Size());
     float idx = 0.0f;
 
-    for(auto it = m_ResourceRecords.begin(); it != m_ResourceRecords.end(); ++it)
-    {
+    m_ResourceRecords.ForEach([&](ResourceId id, RecordType *record) {
       RenderDoc::Inst().SetProgress(CaptureProgress::AddReferencedResources, idx / num);
       idx += 1.0f;
 
-      if(m_FrameReferencedResources.find(it->first) == m_FrameReferencedResources.end() &&
-         it->second->InternalResource)
-        continue;
+      if(!m_FrameReferencedResources.Contains(id) && record->InternalResource)
+        return;
 
-      it->second->Insert(sortedChunks);
-    }
+      record->Insert(sortedChunks);
+    });
   }
   else
   {
-    float num = float(m_FrameReferencedResources.size());
+    float num = float(m_FrameReferencedResources.Size());
     float idx = 0.0f;
 
-    for(auto it = m_FrameReferencedResources.begin(); it != m_FrameReferencedResources.end(); ++it)
-    {
+    m_FrameReferencedResources.ForEach([&](ResourceId id, FrameRefType) {
       RenderDoc::Inst().SetProgress(CaptureProgress::AddReferencedResources, idx / num);
       idx += 1.0f;
 
-      RecordType *record = GetResourceRecord(it->first);
+      RecordType *record = GetResourceRecord(id);
       if(record)
         record->Insert(sortedChunks);
-    }
+    });
   }
 
   RDCDEBUG("%u frame resource chunks", (uint32_t)sortedChunks.size());
@@ -1438,17 +1411,19 @@ void ResourceManager<Configuration>::PrepareInitialContents()
 {
   SCOPED_LOCK_OPTIONAL(m_Lock, m_Capturing);
 
-  RDCDEBUG("Preparing up to %u potentially dirty resources", (uint32_t)m_DirtyResources.size());
+  // sorted so that resources are prepared in a stable order
+  rdcarray<ResourceId> dirtyResources = m_DirtyResources.GetSortedKeys();
+
+  RDCDEBUG("Preparing up to %u potentially dirty resources", (uint32_t)dirtyResources.size());
   uint32_t prepared = 0;
   uint32_t postponed = 0;
   uint32_t skipped = 0;
 
-  float num = float(m_DirtyResources.size());
+  float num = float(dirtyResources.size());
   float idx = 0.0f;
 
-  for(auto it = m_DirtyResources.begin(); it != m_DirtyResources.end(); ++it)
+  for(ResourceId id : dirtyResources)
   {
-    ResourceId id = *it;
 
     RenderDoc::Inst().SetProgress(CaptureProgress::PrepareInitialStates, idx / num);
     idx += 1.0f;
@@ -1468,14 +1443,14 @@ void ResourceManager<Configuration>::PrepareInitialContents()
 
     if(ShouldSkip(id))
     {
-      m_SkippedResourceIDs.insert(id);
+      m_SkippedResourceIDs.Insert(id, true);
       skipped++;
       continue;
     }
 
     if(ShouldPostpone(id))
     {
-      m_PostponedResourceIDs.insert(id);
+      m_PostponedResourceIDs.Insert(id, true);
       // Set empty contents here, it'll be prepared on serialization.
       SetInitialContents(id, InitialContentData());
       postponed++;
@@ -1514,7 +1489,7 @@ void ResourceManager<Configuration>::InsertInitialContentsChunks(WriteSerialiser
     RenderDoc::Inst().SetProgress(CaptureProgress::SerialiseInitialStates, idx / num);
     idx += 1.0f;
 
-    if(m_FrameReferencedResources.find(id) == m_FrameReferencedResources.end() &&
+    if(!m_FrameReferencedResources.Contains(id) &&
        !RenderDoc::Inst().GetCaptureOptions().refAllResources)
     {
 #if ENABLED(VERBOSE_DIRTY_RESOURCES)
@@ -1587,7 +1562,7 @@ void ResourceManager<Configuration>::ApplyInitialContentsNonChunks(WriteSerialis
   {
     ResourceId id = it->first;
 
-    if(m_FrameReferencedResources.find(id) == m_FrameReferencedResources.end() &&
+    if(!m_FrameReferencedResources.Contains(id) &&
        !RenderDoc::Inst().GetCaptureOptions().refAllResources)
     {
       continue;
@@ -1608,19 +1583,18 @@ void ResourceManager<Configuration>::ClearReferencedResources()
 {
   SCOPED_LOCK_OPTIONAL(m_Lock, m_Capturing);
 
-  for(auto it = m_FrameReferencedResources.begin(); it != m_FrameReferencedResources.end(); ++it)
-  {
-    RecordType *record = GetResourceRecord(it->first);
+  m_FrameReferencedResources.RemoveIf([this](ResourceId id, FrameRefType refType) {
+    RecordType *record = GetResourceRecord(id);
 
     if(record)
     {
-      if(IncludesWrite(it->second))
-        MarkDirtyResource(it->first);
+      if(IncludesWrite(refType))
+        MarkDirtyResource(id);
       record->Delete(this);
     }
-  }
 
-  m_FrameReferencedResources.clear();
+    return true;
+  });
 }
 
 template <typename Configuration>
@@ -1660,47 +1634,33 @@ void ResourceManager<Configuration>::RemoveReplacement(ResourceId id)
 template <typename Configuration>
 typename Configuration::RecordType *ResourceManager<Configuration>::GetResourceRecord(ResourceId id)
 {
-  SCOPED_READLOCK(m_ResourceRecordLock);
-
-  auto it = m_ResourceRecords.find(id);
-
-  if(it == m_ResourceRecords.end())
-    return NULL;
-
-  return it->second;
+  RecordType *record = NULL;
+  m_ResourceRecords.Find(id, record);
+  return record;
 }
 
 template <typename Configuration>
 bool ResourceManager<Configuration>::HasResourceRecord(ResourceId id)
 {
-  SCOPED_READLOCK(m_ResourceRecordLock);
-
-  auto it = m_ResourceRecords.find(id);
-
-  if(it == m_ResourceRecords.end())
-    return false;
-
-  return true;
+  return m_ResourceRecords.Contains(id);
 }
 
 template <typename Configuration>
 typename Configuration::RecordType *ResourceManager<Configuration>::AddResourceRecord(ResourceId id)
 {
-  SCOPED_WRITELOCK(m_ResourceRecordLock);
+  RecordType *record = new RecordType(id);
 
-  RDCASSERT(m_ResourceRecords.find(id) == m_ResourceRecords.end(), id);
+  bool added = m_ResourceRecords.Modify(id, [record](RecordType *&r, bool) { r = record; });
+  RDCASSERT(added, id);
 
-  return (m_ResourceRecords[id] = new RecordType(id));
+  return record;
 }
 
 template <typename Configuration>
 void ResourceManager<Configuration>::RemoveResourceRecord(ResourceId id)
 {
-  SCOPED_WRITELOCK(m_ResourceRecordLock);
-
-  RDCASSERT(m_ResourceRecords.find(id) != m_ResourceRecords.end(), id);
-
-  m_ResourceRecords.erase(id);
+  bool removed = m_ResourceRecords.Erase(id);
+  RDCASSERT(removed, id);
 }
 
 template <typename Configuration>
@@ -1899,11 +1859,8 @@ void ResourceManager<Configuration>::ReleaseCurrentResource(ResourceId id)
   }
 
   m_CurrentResourceMap.erase(id);
-  m_DirtyResources.erase(id);
-
-  auto it = std::lower_bound(m_ResourceRefTimes.begin(), m_ResourceRefTimes.end(), id);
-  if(it != m_ResourceRefTimes.end())
-    m_ResourceRefTimes.erase(it - m_ResourceRefTimes.begin());
+  m_DirtyResources.Erase(id);
+  m_ResourceRefTimes.Erase(id);
 }
 
 template <typename Configuration>
@@ -25,6 +25,8 @@
 
 #include "android/android.h"
 #include "api/replay/renderdoc_replay.h"
+#include "common/call_stats.h"
+#include "common/profiler.h"
 #include "common/threading.h"
 #include "core/core.h"
 #include "jpeg-compressor/jpgd.h"
@@ -32,7 +34,7 @@
 #include "replay/replay_driver.h"
 #include "serialise/serialiser.h"
 
-static const uint32_t TargetControlProtocolVersion = 6;
+static const uint32_t TargetControlProtocolVersion = 8;
 
 static bool IsProtocolVersionSupported(const uint32_t protocolVersion)
 {
@@ -52,6 +54,14 @@ static bool IsProtocolVersionSupported(const uint32_t protocolVersion)
   if(protocolVersion == 5)
     return true;
 
+  // 6 -> 7 added profile recording and trace packets
+  if(protocolVersion == 6)
+    return true;
+
+  // 7 -> 8 added call statistics packets
+  if(protocolVersion == 7)
+    return true;
+
   if(protocolVersion == TargetControlProtocolVersion)
     return true;
 
@@ -72,7 +82,11 @@ enum PacketType : uint32_t
   ePacket_NewChild,
   ePacket_CaptureProgress,
   ePacket_CycleActiveWindow,
-  ePacket_CapturableWindowCount
+  ePacket_CapturableWindowCount,
+  ePacket_SetProfileRecording,
+  ePacket_ProfileTrace,
+  ePacket_SetCallStatistics,
+  ePacket_CallStatistics,
 };
 
 DECLARE_REFLECTION_ENUM(PacketType);
@@ -95,6 +109,10 @@ rdcstr DoStringise(const PacketType &el)
     STRINGISE_ENUM_NAMED(ePacket_CaptureProgress, "Capture Progress");
     STRINGISE_ENUM_NAMED(ePacket_CycleActiveWindow, "Cycle Active Window");
     STRINGISE_ENUM_NAMED(ePacket_CapturableWindowCount, "Capturable Window Count");
+    STRINGISE_ENUM_NAMED(ePacket_SetProfileRecording, "Set Profile Recording");
+    STRINGISE_ENUM_NAMED(ePacket_ProfileTrace, "Profile Trace");
+    STRINGISE_ENUM_NAMED(ePacket_SetCallStatistics, "Set Call Statistics");
+    STRINGISE_ENUM_NAMED(ePacket_CallStatistics, "Call Statistics");
   }
   END_ENUM_STRINGISE();
 }
@@ -371,6 +389,46 @@ void RenderDoc::TargetControlClientThread(uint32_t version, Network::Socket *cli
       {
         RenderDoc::Inst().CycleActiveWindow();
       }
+      else if(type == ePacket_SetProfileRecording)
+      {
+        bool enabled = false;
+
+        READ_DATA_SCOPE();
+        SERIALISE_ELEMENT(enabled);
+
+        Profiler::SetRecording(enabled);
+      }
+      else if(type == ePacket_ProfileTrace)
+      {
+        rdcstr trace = Profiler::FormatTrace();
+
+        WRITE_DATA_SCOPE();
+        SCOPED_SERIALISE_CHUNK(ePacket_ProfileTrace);
+        SERIALISE_ELEMENT(trace);
+
+        if(ser.IsErrored())
+          SAFE_DELETE(client);
+      }
+      else if(type == ePacket_SetCallStatistics)
+      {
+        bool enabled = false;
+
+        READ_DATA_SCOPE();
+        SERIALISE_ELEMENT(enabled);
+
+        CallStats::SetEnabled(enabled);
+      }
+      else if(type == ePacket_CallStatistics)
+      {
+        rdcarray<APICallStatistics> stats = CallStats::Gather();
+
+        WRITE_DATA_SCOPE();
+        SCOPED_SERIALISE_CHUNK(ePacket_CallStatistics);
+        SERIALISE_ELEMENT(stats);
+
+        if(ser.IsErrored())
+          SAFE_DELETE(client);
+      }
 
       reader.EndChunk();
 
@@ -666,6 +724,64 @@ public:
       SAFE_DELETE(m_Socket);
   }
 
+  void SetProfileRecording(bool enabled)
+  {
+    if(m_Version < 7)
+      return;
+
+    WRITE_DATA_SCOPE();
+    SCOPED_SERIALISE_CHUNK(ePacket_SetProfileRecording);
+
+    SERIALISE_ELEMENT(enabled);
+
+    if(ser.IsErrored())
+      SAFE_DELETE(m_Socket);
+  }
+
+  void CopyProfileTrace(const rdcstr &localpath)
+  {
+    if(m_Version < 7)
+      return;
+
+    WRITE_DATA_SCOPE();
+    SCOPED_SERIALISE_CHUNK(ePacket_ProfileTrace);
+
+    if(ser.IsErrored())
+    {
+      SAFE_DELETE(m_Socket);
+      return;
+    }
+
+    // traces come back in the order they were requested
+    m_ProfileTraceCopies.push_back(localpath);
+  }
+
+  void SetCallStatisticsEnabled(bool enabled)
+  {
+    if(m_Version < 8)
+      return;
+
+    WRITE_DATA_SCOPE();
+    SCOPED_SERIALISE_CHUNK(ePacket_SetCallStatistics);
+
+    SERIALISE_ELEMENT(enabled);
+
+    if(ser.IsErrored())
+      SAFE_DELETE(m_Socket);
+  }
+
+  void RequestCallStatistics()
+  {
+    if(m_Version < 8)
+      return;
+
+    WRITE_DATA_SCOPE();
+    SCOPED_SERIALISE_CHUNK(ePacket_CallStatistics);
+
+    if(ser.IsErrored())
+      SAFE_DELETE(m_Socket);
+  }
+
   TargetControlMessage ReceiveMessage(RENDERDOC_ProgressCallback progress)
   {
     TargetControlMessage msg;
@@ -872,6 +988,46 @@ public:
       reader.EndChunk();
       return msg;
     }
+    else if(type == ePacket_ProfileTrace)
+    {
+      msg.type = TargetControlMessageType::ProfileTraceCopied;
+
+      rdcstr trace;
+
+      READ_DATA_SCOPE();
+      SERIALISE_ELEMENT(trace);
+
+      if(reader.IsErrored() || m_ProfileTraceCopies.empty())
+      {
+        SAFE_DELETE(m_Socket);
+
+        msg.type = TargetControlMessageType::Disconnected;
+        return msg;
+      }
+
+      msg.profileTrace = m_ProfileTraceCopies[0];
+      m_ProfileTraceCopies.erase(0);
+
+      if(!FileIO::WriteAll(msg.profileTrace, trace))
+        RDCERR("Couldn't write profile trace to '%s'", msg.profileTrace.c_str());
+
+      reader.EndChunk();
+      return msg;
+    }
+    else if(type == ePacket_CallStatistics)
+    {
+      msg.type = TargetControlMessageType::CallStatistics;
+
+      rdcarray<APICallStatistics> stats;
+
+      READ_DATA_SCOPE();
+      SERIALISE_ELEMENT(stats);
+
+      msg.callStatistics.swap(stats);
+
+      reader.EndChunk();
+      return msg;
+    }
     else
     {
       RDCERR("Unexpected packed received: %d", type);
@@ -890,6 +1046,7 @@ private:
   uint32_t m_Version, m_PID;
 
   std::map<uint32_t, rdcstr> m_CaptureCopies;
+  rdcarray<rdcstr> m_ProfileTraceCopies;
 };
 
 extern "C" RENDERDOC_API ITargetControl *RENDERDOC_CC RENDERDOC_CreateTargetControl(
@@ -25,6 +25,7 @@
 
 #include "d3d11_context.h"
 #include <algorithm>
+#include "core/settings.h"
 #include "strings/string_utils.h"
 #include "d3d11_device.h"
 #include "d3d11_manager.h"
@@ -32,6 +33,8 @@
 #include "d3d11_replay.h"
 #include "d3d11_resources.h"
 
+RDOC_EXTERN_CONFIG(uint32_t, Capture_BlobThreshold);
+
 WRAPPED_POOL_INST(WrappedID3D11DeviceContext);
 WRAPPED_POOL_INST(WrappedID3D11CommandList);
 
@@ -161,6 +164,7 @@ WrappedID3D11DeviceContext::WrappedID3D11DeviceContext(WrappedID3D11Device *real
 
   m_ScratchSerialiser.SetUserData(GetResourceManager());
   m_ScratchSerialiser.SetVersion(D3D11InitParams::CurrentVersion);
+  m_ScratchSerialiser.SetBlobThreshold(Capture_BlobThreshold());
 
   m_SuccessfulCapture = true;
   m_FailureReason = CaptureSucceeded;
@@ -1216,6 +1220,7 @@ ReplayStatus WrappedID3D11DeviceContext::ReplayLog(CaptureState readType, uint32
   ser.SetStringDatabase(&m_StringDB);
   ser.SetUserData(GetResourceManager());
   ser.SetVersion(m_pDevice->GetLogVersion());
+  ser.SetBlobStore(m_pDevice->GetBlobStore());
 
   if(IsLoading(m_State) || IsStructuredExporting(m_State))
   {
@@ -25,6 +25,7 @@
 
 #include "d3d11_device.h"
 #include "core/core.h"
+#include "core/settings.h"
 #include "driver/dxgi/dxgi_wrapped.h"
 #include "jpeg-compressor/jpge.h"
 #include "maths/formatpacking.h"
@@ -38,6 +39,8 @@
 #include "d3d11_resources.h"
 #include "d3d11_shader_cache.h"
 
+RDOC_EXTERN_CONFIG(uint32_t, Capture_BlobThreshold);
+
 WRAPPED_POOL_INST(WrappedID3D11Device);
 
 WrappedID3D11Device *WrappedID3D11Device::m_pCurrentWrappedDevice = NULL;
@@ -67,6 +70,7 @@ WrappedID3D11Device::WrappedID3D11Device(ID3D11Device *realDevice, D3D11InitPara
 
   m_ScratchSerialiser.SetChunkMetadataRecording(flags);
   m_ScratchSerialiser.SetVersion(D3D11InitParams::CurrentVersion);
+  m_ScratchSerialiser.SetBlobThreshold(Capture_BlobThreshold());
 
   m_StructuredFile = m_StoredStructuredData = new SDFile;
 
@@ -260,6 +264,7 @@ WrappedID3D11Device::~WrappedID3D11Device()
     m_pCurrentWrappedDevice = NULL;
 
   SAFE_DELETE(m_StoredStructuredData);
+  SAFE_DELETE(m_Blobs);
 
   D3D11MarkerRegion::device = NULL;
 
@@ -1316,10 +1321,19 @@ ReplayStatus WrappedID3D11Device::ReadLogInitialisation(RDCFile *rdc, bool store
     return ReplayStatus::FileIOFailed;
   }
 
+  SAFE_DELETE(m_Blobs);
+  m_Blobs = new RDCBlobStore;
+  if(!m_Blobs->Read(*rdc))
+  {
+    delete reader;
+    return ReplayStatus::FileCorrupted;
+  }
+
   ReadSerialiser ser(reader, Ownership::Stream);
 
   ser.SetStringDatabase(&m_StringDB);
   ser.SetUserData(GetResourceManager());
+  ser.SetBlobStore(m_Blobs);
 
   ser.ConfigureStructuredExport(&GetChunkName, storeStructuredBuffers, m_TimeBase, m_TimeFrequency);
 
@@ -2111,8 +2125,9 @@ bool WrappedID3D11Device::EndFrameCapture(void *dev, void *wnd)
     {
       SectionProperties props;
 
-      // Compress with LZ4 so that it's fast
-      props.flags = SectionFlags::LZ4Compressed;
+      // Compress with LZ4 so that it's fast, in independent blocks so that it can be decompressed
+      // in parallel when loading
+      props.flags = SectionFlags::LZ4Compressed | SectionFlags::Seekable;
       props.version = m_SectionVersion;
       props.type = SectionType::FrameCapture;
 
@@ -2125,11 +2140,17 @@ bool WrappedID3D11Device::EndFrameCapture(void *dev, void *wnd)
 
     uint64_t captureSectionSize = 0;
 
+    // large buffers in the frame capture, each stored once after it
+    RDCBlobStore blobs;
+
     {
       WriteSerialiser ser(captureWriter, Ownership::Stream);
 
       ser.SetChunkMetadataRecording(m_ScratchSerialiser.GetChunkMetadataRecording());
 
+      ser.SetBlobThreshold(Capture_BlobThreshold());
+      ser.SetBlobStore(&blobs);
+
       ser.SetUserData(GetResourceManager());
 
       {
@@ -2201,6 +2222,9 @@ bool WrappedID3D11Device::EndFrameCapture(void *dev, void *wnd)
     RDCLOG("Captured D3D11 frame with %f MB capture section in %f seconds",
            double(captureSectionSize) / (1024.0 * 1024.0), m_CaptureTimer.GetMilliseconds() / 1000.0);
 
+    if(rdc)
+      blobs.Write(*rdc);
+
     RenderDoc::Inst().FinishCaptureWriting(rdc, m_CapturedFrames.back().frameNumber);
 
     m_State = CaptureState::BackgroundCapturing;
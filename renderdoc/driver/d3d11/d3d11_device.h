@@ -553,6 +553,9 @@ private:
   WriteSerialiser m_ScratchSerialiser;
   std::set<rdcstr> m_StringDB;
 
+  // large buffers referenced from the frame capture, see Serialiser::SetBlobThreshold
+  RDCBlobStore *m_Blobs = NULL;
+
   ResourceId m_ResourceID;
   D3D11ResourceRecord *m_DeviceRecord;
 
@@ -623,6 +626,7 @@ public:
   }
   const ReplayOptions &GetReplayOptions() { return m_ReplayOptions; }
   uint64_t GetLogVersion() { return m_SectionVersion; }
+  RDCBlobStore *GetBlobStore() { return m_Blobs; }
   virtual ~WrappedID3D11Device();
 
   ////////////////////////////////////////////////////////////////
@@ -43,15 +43,13 @@ void D3D11ResourceManager::SetInternalResource(ID3D11DeviceChild *res)
 
 void D3D11ResourceManager::FreeCaptureData()
 {
-  for(auto it = m_ResourceRecords.begin(); it != m_ResourceRecords.end(); ++it)
-  {
-    D3D11ResourceRecord *record = it->second;
-
-    if(record == NULL || m_Device->GetImmediateContext()->ShadowStorageInUse(record))
-      continue;
+  WrappedID3D11DeviceContext *ctx = m_Device->GetImmediateContext();
+  m_ResourceRecords.ForEach([ctx](ResourceId, D3D11ResourceRecord *record) {
+    if(record == NULL || ctx->ShadowStorageInUse(record))
+      return;
 
     record->FreeShadowStorage();
-  }
+  });
 }
 
 ResourceId D3D11ResourceManager::GetID(ID3D11DeviceChild *res)
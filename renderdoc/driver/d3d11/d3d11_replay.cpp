@@ -713,8 +713,6 @@ void D3D11Replay::SavePipelineState(uint32_t eventId)
 
   D3D11RenderState *rs = m_pDevice->GetImmediateContext()->GetCurrentPipelineState();
 
-  m_RenderStateOM = rs->OM;
-
   D3D11Pipe::State &ret = *m_D3D11PipelineState;
 
   /////////////////////////////////////////////////
@@ -1595,6 +1593,10 @@ ReplayStatus D3D11Replay::ReadLogInitialisation(RDCFile *rdc, bool storeStructur
 void D3D11Replay::ReplayLog(uint32_t endEventID, ReplayLogType replayType)
 {
   m_pDevice->ReplayLog(0, endEventID, replayType);
+
+  // snapshot the output merger here rather than in SavePipelineState, since the controller can
+  // restore a cached pipeline state without calling it
+  m_RenderStateOM = m_pDevice->GetImmediateContext()->GetCurrentPipelineState()->OM;
 }
 
 SDFile *D3D11Replay::GetStructuredFile()
@@ -2546,6 +2548,16 @@ void D3D11Replay::GetTextureData(ResourceId tex, const Subresource &sub,
   SAFE_RELEASE(dummyTex);
 }
 
+void D3D11Replay::FetchResourceData(const rdcarray<ResourceDataRequest> &requests,
+                                    rdcarray<bytebuf> &results, rdcarray<bool> &fetched)
+{
+  // no batched readback here, every request is fetched by seeking to its event
+  results.clear();
+  results.resize(requests.size());
+  fetched.clear();
+  fetched.resize(requests.size());
+}
+
 void D3D11Replay::ReplaceResource(ResourceId from, ResourceId to)
 {
   auto fromit = WrappedShader::m_ShaderList.find(from);
@@ -23,7 +23,6 @@
  ******************************************************************************/
 
 #include "d3d11_shader_cache.h"
-#include "common/shader_cache.h"
 #include "driver/dx/official/d3dcompiler.h"
 #include "driver/dxgi/dxgi_common.h"
 #include "driver/shaders/dxbc/dxbc_container.h"
@@ -82,28 +81,17 @@ struct D3DBlobShaderCallbacks
 } D3D11ShaderCacheCallbacks;
 
 D3D11ShaderCache::D3D11ShaderCache(WrappedID3D11Device *wrapper)
+    : m_ShaderCache(D3D11ShaderCacheCallbacks)
 {
   m_pDevice = wrapper;
 
-  bool success = LoadShaderCache("d3dshaders.cache", m_ShaderCacheMagic, m_ShaderCacheVersion,
-                                 m_ShaderCache, D3D11ShaderCacheCallbacks);
-
-  // if we failed to load from the cache
-  m_ShaderCacheDirty = !success;
+  m_ShaderCache.Open(FileIO::GetAppFolderFilename("d3dshaders.cache"), m_ShaderCacheMagic,
+                     m_ShaderCacheVersion);
 }
 
 D3D11ShaderCache::~D3D11ShaderCache()
 {
-  if(m_ShaderCacheDirty)
-  {
-    SaveShaderCache("d3dshaders.cache", m_ShaderCacheMagic, m_ShaderCacheVersion, m_ShaderCache,
-                    D3D11ShaderCacheCallbacks);
-  }
-  else
-  {
-    for(auto it = m_ShaderCache.begin(); it != m_ShaderCache.end(); ++it)
-      D3D11ShaderCacheCallbacks.Destroy(it->second);
-  }
+  m_ShaderCache.Save();
 }
 
 rdcstr D3D11ShaderCache::GetShaderBlob(const char *source, const char *entry,
@@ -119,16 +107,15 @@ rdcstr D3D11ShaderCache::GetShaderBlob(const char *source, const char *entry,
                                    {"hlsl_texsample.h", texsample}, {"hlsl_cbuffers.h", cbuffers},
                                });
 
-  uint32_t hash = strhash(source);
-  hash = strhash(entry, hash);
-  hash = strhash(profile, hash);
-  hash = strhash(cbuffers.c_str(), hash);
-  hash = strhash(texsample.c_str(), hash);
+  uint64_t hash = ShaderCacheHash(source);
+  hash = ShaderCacheHash(entry, hash);
+  hash = ShaderCacheHash(profile, hash);
+  hash = ShaderCacheHash(cbuffers, hash);
+  hash = ShaderCacheHash(texsample, hash);
   hash ^= compileFlags;
 
-  if(m_ShaderCache.find(hash) != m_ShaderCache.end())
+  if(m_ShaderCache.Find(hash, *srcblob))
   {
-    *srcblob = m_ShaderCache[hash];
     (*srcblob)->AddRef();
     return "";
   }
@@ -180,9 +167,8 @@ rdcstr D3D11ShaderCache::GetShaderBlob(const char *source, const char *entry,
 
   if(m_CacheShaders)
   {
-    m_ShaderCache[hash] = byteBlob;
+    m_ShaderCache.Insert(hash, byteBlob);
     byteBlob->AddRef();
-    m_ShaderCacheDirty = true;
   }
 
   SAFE_RELEASE(errBlob);
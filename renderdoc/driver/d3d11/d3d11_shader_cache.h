@@ -27,10 +27,13 @@
 #include <map>
 #include <string>
 #include <vector>
+#include "common/shader_cache.h"
 #include "driver/dx/official/d3d11_4.h"
 
 class WrappedID3D11Device;
 
+struct D3DBlobShaderCallbacks;
+
 class D3D11ShaderCache
 {
 public:
@@ -49,10 +52,10 @@ public:
   void SetCaching(bool enabled) { m_CacheShaders = enabled; }
 private:
   static const uint32_t m_ShaderCacheMagic = 0xf000baba;
-  static const uint32_t m_ShaderCacheVersion = 3;
+  static const uint32_t m_ShaderCacheVersion = 4;
 
   ID3D11Device *m_pDevice = NULL;
 
-  bool m_ShaderCacheDirty = false, m_CacheShaders = false;
-  std::map<uint32_t, ID3DBlob *> m_ShaderCache;
+  bool m_CacheShaders = false;
+  ShaderCache<ID3DBlob *, D3DBlobShaderCallbacks> m_ShaderCache;
 };
@@ -25,6 +25,7 @@
 #include "d3d12_device.h"
 #include <algorithm>
 #include "core/core.h"
+#include "core/settings.h"
 #include "driver/dxgi/dxgi_common.h"
 #include "driver/dxgi/dxgi_wrapped.h"
 #include "driver/ihv/amd/amd_rgp.h"
@@ -40,6 +41,8 @@
 #include "d3d12_resources.h"
 #include "d3d12_shader_cache.h"
 
+RDOC_EXTERN_CONFIG(uint32_t, Capture_BlobThreshold);
+
 WRAPPED_POOL_INST(WrappedID3D12Device);
 
 Threading::CriticalSection WrappedID3D12Device::m_DeviceWrappersLock;
@@ -779,6 +782,7 @@ WrappedID3D12Device::~WrappedID3D12Device()
   }
 
   SAFE_DELETE(m_StoredStructuredData);
+  SAFE_DELETE(m_Blobs);
 
   RenderDoc::Inst().RemoveDeviceFrameCapturer((ID3D12Device *)this);
 
@@ -2533,8 +2537,9 @@ bool WrappedID3D12Device::EndFrameCapture(void *dev, void *wnd)
   {
     SectionProperties props;
 
-    // Compress with LZ4 so that it's fast
-    props.flags = SectionFlags::LZ4Compressed;
+    // Compress with LZ4 so that it's fast, in independent blocks so that it can be decompressed
+    // in parallel when loading
+    props.flags = SectionFlags::LZ4Compressed | SectionFlags::Seekable;
     props.version = m_SectionVersion;
     props.type = SectionType::FrameCapture;
 
@@ -2547,11 +2552,17 @@ bool WrappedID3D12Device::EndFrameCapture(void *dev, void *wnd)
 
   uint64_t captureSectionSize = 0;
 
+  // large buffers in the frame capture, each stored once after it
+  RDCBlobStore blobs;
+
   {
     WriteSerialiser ser(captureWriter, Ownership::Stream);
 
     ser.SetChunkMetadataRecording(GetThreadSerialiser().GetChunkMetadataRecording());
 
+    ser.SetBlobThreshold(Capture_BlobThreshold());
+    ser.SetBlobStore(&blobs);
+
     ser.SetUserData(GetResourceManager());
 
     m_InitParams.usedDXIL = m_UsedDXIL;
@@ -2639,6 +2650,9 @@ bool WrappedID3D12Device::EndFrameCapture(void *dev, void *wnd)
   RDCLOG("Captured D3D12 frame with %f MB capture section in %f seconds",
          double(captureSectionSize) / (1024.0 * 1024.0), m_CaptureTimer.GetMilliseconds() / 1000.0);
 
+  if(rdc)
+    blobs.Write(*rdc);
+
   if(D3D12Core)
   {
     if(rdc)
@@ -3333,6 +3347,7 @@ WriteSerialiser &WrappedID3D12Device::GetThreadSerialiser()
   ser->SetChunkMetadataRecording(flags);
   ser->SetUserData(GetResourceManager());
   ser->SetVersion(D3D12InitParams::CurrentVersion);
+  ser->SetBlobThreshold(Capture_BlobThreshold());
 
   Threading::SetTLSValue(threadSerialiserTLSSlot, (void *)ser);
 
@@ -3953,12 +3968,21 @@ ReplayStatus WrappedID3D12Device::ReadLogInitialisation(RDCFile *rdc, bool store
     return ReplayStatus::FileIOFailed;
   }
 
+  SAFE_DELETE(m_Blobs);
+  m_Blobs = new RDCBlobStore;
+  if(!m_Blobs->Read(*rdc))
+  {
+    delete reader;
+    return ReplayStatus::FileCorrupted;
+  }
+
   ReadSerialiser ser(reader, Ownership::Stream);
 
   APIProps.DXILShaders = m_UsedDXIL = m_InitParams.usedDXIL;
 
   ser.SetStringDatabase(&m_StringDB);
   ser.SetUserData(GetResourceManager());
+  ser.SetBlobStore(m_Blobs);
 
   ser.ConfigureStructuredExport(&GetChunkName, storeStructuredBuffers, m_TimeBase, m_TimeFrequency);
 
@@ -701,6 +701,9 @@ private:
 
   std::set<rdcstr> m_StringDB;
 
+  // large buffers referenced from the frame capture, see Serialiser::SetBlobThreshold
+  RDCBlobStore *m_Blobs = NULL;
+
   ResourceId m_ResourceID;
   D3D12ResourceRecord *m_DeviceRecord;
 
@@ -834,6 +837,7 @@ public:
   }
   const ReplayOptions &GetReplayOptions() { return m_ReplayOptions; }
   uint64_t GetLogVersion() { return m_SectionVersion; }
+  RDCBlobStore *GetBlobStore() { return m_Blobs; }
   CaptureState GetState() { return m_State; }
   D3D12Replay *GetReplay() { return m_Replay; }
   WrappedID3D12CommandQueue *GetQueue() { return m_Queue; }
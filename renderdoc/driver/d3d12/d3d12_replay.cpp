@@ -3953,6 +3953,16 @@ void D3D12Replay::GetTextureData(ResourceId tex, const Subresource &sub,
   SAFE_RELEASE(tmpTexture);
 }
 
+void D3D12Replay::FetchResourceData(const rdcarray<ResourceDataRequest> &requests,
+                                    rdcarray<bytebuf> &results, rdcarray<bool> &fetched)
+{
+  // no batched readback here, every request is fetched by seeking to its event
+  results.clear();
+  results.resize(requests.size());
+  fetched.clear();
+  fetched.resize(requests.size());
+}
+
 void D3D12Replay::SetCustomShaderIncludes(const rdcarray<rdcstr> &directories)
 {
   m_CustomShaderIncludes = directories;
@@ -23,7 +23,6 @@
  ******************************************************************************/
 
 #include "d3d12_shader_cache.h"
-#include "common/shader_cache.h"
 #include "core/plugins.h"
 #include "driver/dx/official/d3dcompiler.h"
 #include "driver/dx/official/dxcapi.h"
@@ -292,27 +291,15 @@ struct D3D12BlobShaderCallbacks
   const byte *GetData(ID3DBlob *blob) const { return (const byte *)blob->GetBufferPointer(); }
 } D3D12ShaderCacheCallbacks;
 
-D3D12ShaderCache::D3D12ShaderCache()
+D3D12ShaderCache::D3D12ShaderCache() : m_ShaderCache(D3D12ShaderCacheCallbacks)
 {
-  bool success = LoadShaderCache("d3dshaders.cache", m_ShaderCacheMagic, m_ShaderCacheVersion,
-                                 m_ShaderCache, D3D12ShaderCacheCallbacks);
-
-  // if we failed to load from the cache
-  m_ShaderCacheDirty = !success;
+  m_ShaderCache.Open(FileIO::GetAppFolderFilename("d3dshaders.cache"), m_ShaderCacheMagic,
+                     m_ShaderCacheVersion);
 }
 
 D3D12ShaderCache::~D3D12ShaderCache()
 {
-  if(m_ShaderCacheDirty)
-  {
-    SaveShaderCache("d3dshaders.cache", m_ShaderCacheMagic, m_ShaderCacheVersion, m_ShaderCache,
-                    D3D12ShaderCacheCallbacks);
-  }
-  else
-  {
-    for(auto it = m_ShaderCache.begin(); it != m_ShaderCache.end(); ++it)
-      D3D12ShaderCacheCallbacks.Destroy(it->second);
-  }
+  m_ShaderCache.Save();
 }
 
 rdcstr D3D12ShaderCache::GetShaderBlob(const char *source, const char *entry,
@@ -328,20 +315,19 @@ rdcstr D3D12ShaderCache::GetShaderBlob(const char *source, const char *entry,
                                    {"hlsl_texsample.h", texsample}, {"hlsl_cbuffers.h", cbuffers},
                                });
 
-  uint32_t hash = strhash(source);
-  hash = strhash(entry, hash);
-  hash = strhash(profile, hash);
-  hash = strhash(cbuffers.c_str(), hash);
-  hash = strhash(texsample.c_str(), hash);
+  uint64_t hash = ShaderCacheHash(source);
+  hash = ShaderCacheHash(entry, hash);
+  hash = ShaderCacheHash(profile, hash);
+  hash = ShaderCacheHash(cbuffers, hash);
+  hash = ShaderCacheHash(texsample, hash);
   for(const ShaderCompileFlag &f : compileFlags.flags)
   {
-    hash = strhash(f.name.c_str(), hash);
-    hash = strhash(f.value.c_str(), hash);
+    hash = ShaderCacheHash(f.name, hash);
+    hash = ShaderCacheHash(f.value, hash);
   }
 
-  if(m_ShaderCache.find(hash) != m_ShaderCache.end())
+  if(m_ShaderCache.Find(hash, *srcblob))
   {
-    *srcblob = m_ShaderCache[hash];
     (*srcblob)->AddRef();
     return "";
   }
@@ -502,9 +488,8 @@ rdcstr D3D12ShaderCache::GetShaderBlob(const char *source, const char *entry,
 
   if(m_CacheShaders)
   {
-    m_ShaderCache[hash] = byteBlob;
+    m_ShaderCache.Insert(hash, byteBlob);
     byteBlob->AddRef();
-    m_ShaderCacheDirty = true;
   }
 
   SAFE_RELEASE(errBlob);
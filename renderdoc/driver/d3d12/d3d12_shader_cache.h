@@ -27,11 +27,14 @@
 #include <map>
 #include <string>
 #include <vector>
+#include "common/shader_cache.h"
 #include "driver/dx/official/d3d11_4.h"
 #include "d3d12_common.h"
 
 class WrappedID3D11Device;
 
+struct D3D12BlobShaderCallbacks;
+
 class D3D12ShaderCache
 {
 public:
@@ -66,8 +69,8 @@ public:
   void SetCaching(bool enabled) { m_CacheShaders = enabled; }
 private:
   static const uint32_t m_ShaderCacheMagic = 0xf000baba;
-  static const uint32_t m_ShaderCacheVersion = 3;
+  static const uint32_t m_ShaderCacheVersion = 4;
 
-  bool m_ShaderCacheDirty = false, m_CacheShaders = false;
-  std::map<uint32_t, ID3DBlob *> m_ShaderCache;
+  bool m_CacheShaders = false;
+  ShaderCache<ID3DBlob *, D3D12BlobShaderCallbacks> m_ShaderCache;
 };
@@ -25,6 +25,7 @@
 
 #pragma once
 
+#include "common/call_stats.h"
 #include "common/common.h"
 #include "core/core.h"
 #include "maths/vec.h"
@@ -448,11 +449,12 @@ T CheckConstParam(T t);
 
 #define USE_SCRATCH_SERIALISER() WriteSerialiser &ser = m_ScratchSerialiser;
 
-#define SERIALISE_TIME_CALL(...)                                          \
-  m_ScratchSerialiser.ChunkMetadata().timestampMicro = Timing::GetTick(); \
-  __VA_ARGS__;                                                            \
-  m_ScratchSerialiser.ChunkMetadata().durationMicro =                     \
-      Timing::GetTick() - m_ScratchSerialiser.ChunkMetadata().timestampMicro;
+#define SERIALISE_TIME_CALL(...)                                              \
+  m_ScratchSerialiser.ChunkMetadata().timestampMicro = Timing::GetTick();     \
+  __VA_ARGS__;                                                                \
+  m_ScratchSerialiser.ChunkMetadata().durationMicro =                         \
+      Timing::GetTick() - m_ScratchSerialiser.ChunkMetadata().timestampMicro; \
+  CallStats::AddDriverTicks(m_ScratchSerialiser.ChunkMetadata().durationMicro);
 
 // A handy macros to say "is the serialiser reading and we're doing replay-mode stuff?"
 // The reason we check both is that checking the first allows the compiler to eliminate the other
@@ -26,12 +26,15 @@
 #include "gl_driver.h"
 #include <algorithm>
 #include "common/common.h"
+#include "core/settings.h"
 #include "driver/shaders/spirv/spirv_compile.h"
 #include "jpeg-compressor/jpge.h"
 #include "serialise/rdcfile.h"
 #include "strings/string_utils.h"
 #include "gl_replay.h"
 
+RDOC_EXTERN_CONFIG(uint32_t, Capture_BlobThreshold);
+
 std::map<uint64_t, GLWindowingData> WrappedOpenGL::m_ActiveContexts;
 
 void WrappedOpenGL::BuildGLExtensions()
@@ -936,6 +939,7 @@ WrappedOpenGL::~WrappedOpenGL()
   m_ArrayMS.Destroy();
 
   SAFE_DELETE(m_FrameReader);
+  SAFE_DELETE(m_Blobs);
 
   SAFE_DELETE(m_StoredStructuredData);
 
@@ -951,6 +955,9 @@ WrappedOpenGL::~WrappedOpenGL()
       it->second.m_ContextDataRecord->Delete(GetResourceManager());
       GetResourceManager()->ReleaseCurrentResource(it->second.m_ContextDataResourceID);
     }
+
+    SAFE_DELETE(it->second.m_ChunkAlloc);
+    SAFE_DELETE(it->second.m_ChunkPool);
   }
 
   if(m_ContextRecord)
@@ -1001,6 +1008,21 @@ GLResourceRecord *WrappedOpenGL::GetContextRecord()
   }
 }
 
+ChunkAllocator *WrappedOpenGL::GetContextChunkAllocator()
+{
+  GLContextTLSData *ret = (GLContextTLSData *)Threading::GetTLSValue(m_CurCtxDataTLS);
+  if(ret && ret->ctxAlloc)
+  {
+    return ret->ctxAlloc;
+  }
+  else
+  {
+    ContextData &dat = GetCtxData();
+    dat.CreateResourceRecord(this, GetCtx().ctx);
+    return dat.m_ChunkAlloc;
+  }
+}
+
 void WrappedOpenGL::CheckImplicitThread()
 {
   void *ctx = GetCtx().ctx;
@@ -1015,7 +1037,7 @@ void WrappedOpenGL::CheckImplicitThread()
       SCOPED_SERIALISE_CHUNK(GLChunk::ImplicitThreadSwitch);
       Serialise_ContextConfiguration(ser, m_LastCtx);
       Serialise_BeginCaptureFrame(ser);
-      GetContextRecord()->AddChunk(scope.Get());
+      GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
     }
 
     CheckQueuedInitialFetches(m_LastCtx);
@@ -1087,6 +1109,9 @@ void WrappedOpenGL::DeleteContext(void *contextHandle)
     ctxdata.m_ContextDataRecord = NULL;
   }
 
+  SAFE_DELETE(ctxdata.m_ChunkAlloc);
+  SAFE_DELETE(ctxdata.m_ChunkPool);
+
   m_LastContexts.removeOneIf(
       [contextHandle](const GLWindowingData &ctx) { return ctx.ctx == contextHandle; });
 
@@ -1142,6 +1167,12 @@ void WrappedOpenGL::ContextData::CreateResourceRecord(WrappedOpenGL *driver, voi
     m_ContextDataRecord->Length = 0;
     m_ContextDataRecord->InternalResource = true;
   }
+
+  if(m_ChunkPool == NULL)
+  {
+    m_ChunkPool = new ChunkPagePool(32 * 1024);
+    m_ChunkAlloc = new ChunkAllocator(*m_ChunkPool);
+  }
 }
 
 void WrappedOpenGL::CreateContext(GLWindowingData winData, void *shareContext,
@@ -1172,7 +1203,8 @@ void WrappedOpenGL::CreateContext(GLWindowingData winData, void *shareContext,
   if(attribsCreate)
     RenderDoc::Inst().AddDeviceFrameCapturer(ctxdata.ctx, this);
 
-  // re-configure callstack capture, since WrappedOpenGL constructor may run too early
+  // re-configure callstack capture and blob hashing, since WrappedOpenGL constructor may run too
+  // early
   uint32_t flags = m_ScratchSerialiser.GetChunkMetadataRecording();
 
   if(RenderDoc::Inst().GetCaptureOptions().captureCallstacks)
@@ -1181,6 +1213,7 @@ void WrappedOpenGL::CreateContext(GLWindowingData winData, void *shareContext,
     flags &= ~WriteSerialiser::ChunkCallstack;
 
   m_ScratchSerialiser.SetChunkMetadataRecording(flags);
+  m_ScratchSerialiser.SetBlobThreshold(Capture_BlobThreshold());
 }
 
 bool WrappedOpenGL::ForceSharedObjects(void *oldContext, void *newContext)
@@ -1325,11 +1358,12 @@ void WrappedOpenGL::ActivateContext(GLWindowingData winData)
     {
       tlsData->ctxPair = {winData.ctx, GetShareGroup(winData.ctx)};
       tlsData->ctxRecord = ctxdata.m_ContextDataRecord;
+      tlsData->ctxAlloc = ctxdata.m_ChunkAlloc;
     }
     else
     {
       tlsData = new GLContextTLSData(ContextPair({winData.ctx, GetShareGroup(winData.ctx)}),
-                                     ctxdata.m_ContextDataRecord);
+                                     ctxdata.m_ContextDataRecord, ctxdata.m_ChunkAlloc);
       m_CtxDataVector.push_back(tlsData);
 
       Threading::SetTLSValue(m_CurCtxDataTLS, tlsData);
@@ -1502,7 +1536,7 @@ void WrappedOpenGL::ActivateContext(GLWindowingData winData)
       USE_SCRATCH_SERIALISER();
       SCOPED_SERIALISE_CHUNK(GLChunk::MakeContextCurrent);
       Serialise_BeginCaptureFrame(ser);
-      GetContextRecord()->AddChunk(scope.Get());
+      GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
     }
 
     // also serialise out this context's backbuffer params
@@ -1510,7 +1544,7 @@ void WrappedOpenGL::ActivateContext(GLWindowingData winData)
       USE_SCRATCH_SERIALISER();
       SCOPED_SERIALISE_CHUNK(GLChunk::ContextConfiguration);
       Serialise_ContextConfiguration(ser, winData.ctx);
-      GetContextRecord()->AddChunk(scope.Get());
+      GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
     }
 
     // update the last context so we don't record an implicit switch
@@ -2072,7 +2106,7 @@ void WrappedOpenGL::SwapBuffers(WindowingSystem winSystem, void *windowHandle)
     SCOPED_SERIALISE_CHUNK(gl_CurChunk);
     Serialise_Present(ser);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
   }
 
   RenderDoc::Inst().AddActiveDriver(GetDriverType(), true);
@@ -2173,7 +2207,7 @@ void WrappedOpenGL::StartFrameCapture(void *dev, void *wnd)
     USE_SCRATCH_SERIALISER();
     SCOPED_SERIALISE_CHUNK(GLChunk::ContextConfiguration);
     Serialise_ContextConfiguration(ser, GetCtx().ctx);
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
   }
 
   // if we changed contexts above, pop back to where we were
@@ -2245,8 +2279,9 @@ bool WrappedOpenGL::EndFrameCapture(void *dev, void *wnd)
     {
       SectionProperties props;
 
-      // Compress with LZ4 so that it's fast
-      props.flags = SectionFlags::LZ4Compressed;
+      // Compress with LZ4 so that it's fast, in independent blocks so that it can be decompressed
+      // in parallel when loading
+      props.flags = SectionFlags::LZ4Compressed | SectionFlags::Seekable;
       props.version = m_SectionVersion;
       props.type = SectionType::FrameCapture;
 
@@ -2259,11 +2294,17 @@ bool WrappedOpenGL::EndFrameCapture(void *dev, void *wnd)
 
     uint64_t captureSectionSize = 0;
 
+    // large buffers in the frame capture, each stored once after it
+    RDCBlobStore blobs;
+
     {
       WriteSerialiser ser(captureWriter, Ownership::Stream);
 
       ser.SetChunkMetadataRecording(m_ScratchSerialiser.GetChunkMetadataRecording());
 
+      ser.SetBlobThreshold(Capture_BlobThreshold());
+      ser.SetBlobStore(&blobs);
+
       ser.SetUserData(GetResourceManager());
 
       {
@@ -2351,6 +2392,9 @@ bool WrappedOpenGL::EndFrameCapture(void *dev, void *wnd)
     RDCLOG("Captured GL frame with %f MB capture section in %f seconds",
            double(captureSectionSize) / (1024.0 * 1024.0), m_CaptureTimer.GetMilliseconds() / 1000.0);
 
+    if(rdc)
+      blobs.Write(*rdc);
+
     RenderDoc::Inst().FinishCaptureWriting(rdc, m_CapturedFrames.back().frameNumber);
 
     m_State = CaptureState::BackgroundCapturing;
@@ -2471,7 +2515,7 @@ bool WrappedOpenGL::EndFrameCapture(void *dev, void *wnd)
         USE_SCRATCH_SERIALISER();
         SCOPED_SERIALISE_CHUNK(GLChunk::ContextConfiguration);
         Serialise_ContextConfiguration(ser, GetCtx().ctx);
-        GetContextRecord()->AddChunk(scope.Get());
+        GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
       }
     }
 
@@ -2721,6 +2765,10 @@ void WrappedOpenGL::CleanupCapture()
   for(auto it = m_ContextData.begin(); it != m_ContextData.end(); ++it)
   {
     CleanupResourceRecord(it->second.m_ContextDataRecord, true);
+
+    // all chunks allocated from the context's pages have now been freed, so the pages can be reused
+    if(it->second.m_ChunkAlloc)
+      it->second.m_ChunkAlloc->Reset();
   }
 }
 
@@ -2998,6 +3046,9 @@ void WrappedOpenGL::AttemptCapture()
     for(auto it = m_ContextData.begin(); it != m_ContextData.end(); ++it)
     {
       CleanupResourceRecord(it->second.m_ContextDataRecord, false);
+
+      if(it->second.m_ChunkAlloc)
+        it->second.m_ChunkAlloc->Reset();
     }
   }
 }
@@ -3302,10 +3353,19 @@ ReplayStatus WrappedOpenGL::ReadLogInitialisation(RDCFile *rdc, bool storeStruct
     return ReplayStatus::FileIOFailed;
   }
 
+  SAFE_DELETE(m_Blobs);
+  m_Blobs = new RDCBlobStore;
+  if(!m_Blobs->Read(*rdc))
+  {
+    delete reader;
+    return ReplayStatus::FileCorrupted;
+  }
+
   ReadSerialiser ser(reader, Ownership::Stream);
 
   ser.SetStringDatabase(&m_StringDB);
   ser.SetUserData(GetResourceManager());
+  ser.SetBlobStore(m_Blobs);
 
   ser.ConfigureStructuredExport(&GetChunkName, storeStructuredBuffers, m_TimeBase, m_TimeFrequency);
 
@@ -5069,6 +5129,7 @@ ReplayStatus WrappedOpenGL::ContextReplayLog(CaptureState readType, uint32_t sta
   ser.SetStringDatabase(&m_StringDB);
   ser.SetUserData(GetResourceManager());
   ser.SetVersion(m_SectionVersion);
+  ser.SetBlobStore(m_Blobs);
 
   SDFile *prevFile = m_StructuredFile;
 
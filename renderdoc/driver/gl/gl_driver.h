@@ -178,6 +178,8 @@ private:
   std::set<rdcstr> m_StringDB;
 
   StreamReader *m_FrameReader = NULL;
+  // large buffers referenced from the frame capture, see Serialiser::SetBlobThreshold
+  RDCBlobStore *m_Blobs = NULL;
 
   static std::map<uint64_t, GLWindowingData> m_ActiveContexts;
 
@@ -396,6 +398,8 @@ private:
       RDCEraseEl(m_BufferRecord);
       m_VertexArrayRecord = m_FeedbackRecord = m_DrawFramebufferRecord = m_ContextDataRecord = NULL;
       m_ReadFramebufferRecord = NULL;
+      m_ChunkPool = NULL;
+      m_ChunkAlloc = NULL;
       m_Renderbuffer = ResourceId();
       m_TextureUnit = 0;
       m_ProgramPipeline = m_Program = 0;
@@ -511,6 +515,12 @@ private:
     ResourceId m_ContextDataResourceID;
     GLResourceRecord *m_ContextDataRecord;
 
+    // chunks recorded on this context are allocated from its own pages. A context is only current
+    // on one thread at a time so this needs no locking, and the pages are all released together
+    // once the frame has been written out instead of freeing each chunk individually.
+    ChunkPagePool *m_ChunkPool;
+    ChunkAllocator *m_ChunkAlloc;
+
     ResourceId m_ContextFBOID;
 
   private:
@@ -618,6 +628,7 @@ public:
   RDCDriver GetDriverType() { return m_DriverType; }
   ContextPair &GetCtx();
   GLResourceRecord *GetContextRecord();
+  ChunkAllocator *GetContextChunkAllocator();
 
   void CheckImplicitThread();
 
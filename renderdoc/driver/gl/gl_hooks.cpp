@@ -88,6 +88,7 @@ int ScopedPrinter::depth = 0;
 // useful on android where you can only debug by printf and the stack dumps are often corrupted when
 // the callstack overflows.
 #define SCOPED_GLCALL(funcname)           \
+  SCOPED_CALL_STATS(STRINGIZE(funcname)); \
   SCOPED_LOCK(glLock);                    \
   gl_CurChunk = GLChunk::funcname;        \
   if(glhook.enabled)                      \
@@ -99,6 +100,7 @@ int ScopedPrinter::depth = 0;
 #else
 
 #define SCOPED_GLCALL(funcname)           \
+  SCOPED_CALL_STATS(STRINGIZE(funcname)); \
   SCOPED_LOCK(glLock);                    \
   gl_CurChunk = GLChunk::funcname;        \
   if(glhook.enabled)                      \
@@ -3013,6 +3013,59 @@ void GLReplay::GetTextureData(ResourceId tex, const Subresource &sub,
     drv.glDeleteTextures(1, &tempTex);
 }
 
+void GLReplay::FetchResourceData(const rdcarray<ResourceDataRequest> &requests,
+                                 rdcarray<bytebuf> &results, rdcarray<bool> &fetched)
+{
+  results.clear();
+  results.resize(requests.size());
+  fetched.clear();
+  fetched.resize(requests.size());
+
+  if(requests.empty())
+    return;
+
+  // GL has no deferred command recording to inject copies into, but partial replays continue from
+  // the current state. So rather than replaying from the start of the frame for each event we
+  // replay once up to the first event, then incrementally on to each following event, reading back
+  // synchronously as we reach each one.
+  uint32_t curEvent = 0;
+
+  for(size_t i = 0; i < requests.size(); i++)
+  {
+    const ResourceDataRequest &req = requests[i];
+
+    if(i == 0)
+    {
+      ReplayLog(req.eventId, eReplay_Full);
+    }
+    else if(req.eventId != curEvent)
+    {
+      MakeCurrentReplayContext(&m_ReplayCtx);
+      m_pDriver->ReplayLog(curEvent + 1, req.eventId, eReplay_Full);
+
+      // the cached array slices are stale now
+      for(size_t c = 0; c < ARRAY_COUNT(m_GetTexturePrevData); c++)
+      {
+        delete[] m_GetTexturePrevData[c];
+        m_GetTexturePrevData[c] = NULL;
+      }
+    }
+
+    curEvent = req.eventId;
+
+    if(m_pDriver->m_Buffers.find(req.resourceId) != m_pDriver->m_Buffers.end())
+    {
+      GetBufferData(req.resourceId, req.byteOffset, req.byteSize, results[i]);
+      fetched[i] = true;
+    }
+    else if(m_pDriver->m_Textures.find(req.resourceId) != m_pDriver->m_Textures.end())
+    {
+      GetTextureData(req.resourceId, req.subresource, GetTextureDataParams(), results[i]);
+      fetched[i] = true;
+    }
+  }
+}
+
 void GLReplay::SetCustomShaderIncludes(const rdcarray<rdcstr> &directories)
 {
 }
@@ -244,6 +244,8 @@ struct GLResourceRecord : public ResourceRecord
     bool orphaned;
     bool persistent;
     byte *ptr;
+    // tracks the pages of a persistent direct map written since the last check against the shadow
+    MemoryTracking::Region *writeTracking;
   } Map;
 
   void VerifyDataType(GLenum target)
@@ -320,8 +322,12 @@ private:
 
 struct GLContextTLSData
 {
-  GLContextTLSData() : ctxPair({NULL, NULL}), ctxRecord(NULL) {}
-  GLContextTLSData(ContextPair p, GLResourceRecord *r) : ctxPair(p), ctxRecord(r) {}
+  GLContextTLSData() : ctxPair({NULL, NULL}), ctxRecord(NULL), ctxAlloc(NULL) {}
+  GLContextTLSData(ContextPair p, GLResourceRecord *r, ChunkAllocator *a)
+      : ctxPair(p), ctxRecord(r), ctxAlloc(a)
+  {
+  }
   ContextPair ctxPair;
   GLResourceRecord *ctxRecord;
+  ChunkAllocator *ctxAlloc;
 };
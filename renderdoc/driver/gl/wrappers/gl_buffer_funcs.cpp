@@ -25,9 +25,14 @@
 
 #include "../gl_driver.h"
 #include "common/common.h"
+#include "common/diff_ranges.h"
+#include "core/settings.h"
 #include "strings/string_utils.h"
 #include "tinyfiledialogs/tinyfiledialogs.h"
 
+RDOC_EXTERN_CONFIG(bool, Capture_MapWriteTracking);
+RDOC_EXTERN_CONFIG(uint32_t, Capture_MapDiffMergeGap);
+
 enum GLbufferbitfield
 {
   DYNAMIC_STORAGE_BIT = 0x0100,
@@ -423,7 +428,7 @@ bool WrappedOpenGL::Serialise_glNamedBufferStorageEXT(SerialiserType &ser, GLuin
   SERIALISE_ELEMENT_LOCAL(buffer, BufferRes(GetCtx(), bufferHandle));
 
   SERIALISE_ELEMENT_LOCAL(bytesize, (uint64_t)size);
-  SERIALISE_ELEMENT_ARRAY(data, bytesize);
+  SERIALISE_ELEMENT_ARRAY_INPLACE(data, bytesize);
 
   if(ser.IsWriting())
   {
@@ -575,7 +580,7 @@ bool WrappedOpenGL::Serialise_glNamedBufferDataEXT(SerialiserType &ser, GLuint b
   SERIALISE_ELEMENT_LOCAL(buffer, BufferRes(GetCtx(), bufferHandle));
 
   SERIALISE_ELEMENT_LOCAL(bytesize, (uint64_t)size);
-  SERIALISE_ELEMENT_ARRAY(data, bytesize);
+  SERIALISE_ELEMENT_ARRAY_INPLACE(data, bytesize);
 
   if(ser.IsWriting())
   {
@@ -961,7 +966,7 @@ bool WrappedOpenGL::Serialise_glNamedBufferSubDataEXT(SerialiserType &ser, GLuin
   SERIALISE_ELEMENT_LOCAL(offset, (uint64_t)offsetPtr);
 
   SERIALISE_ELEMENT_LOCAL(bytesize, (uint64_t)size);
-  SERIALISE_ELEMENT_ARRAY(data, bytesize).Important();
+  SERIALISE_ELEMENT_ARRAY_INPLACE(data, bytesize).Important();
 
   SERIALISE_CHECK_READ_ERRORS();
 
@@ -1419,7 +1424,7 @@ void WrappedOpenGL::glBindBufferBase(GLenum target, GLuint index, GLuint buffer)
       SCOPED_SERIALISE_CHUNK(gl_CurChunk);
       Serialise_glBindBufferBase(ser, target, index, buffer);
 
-      GetContextRecord()->AddChunk(scope.Get());
+      GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
     }
   }
 }
@@ -1563,7 +1568,7 @@ void WrappedOpenGL::glBindBufferRange(GLenum target, GLuint index, GLuint buffer
       SCOPED_SERIALISE_CHUNK(gl_CurChunk);
       Serialise_glBindBufferRange(ser, target, index, buffer, offset, size);
 
-      GetContextRecord()->AddChunk(scope.Get());
+      GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
     }
   }
 }
@@ -1742,7 +1747,7 @@ void WrappedOpenGL::glBindBuffersBase(GLenum target, GLuint first, GLsizei count
       SCOPED_SERIALISE_CHUNK(gl_CurChunk);
       Serialise_glBindBuffersBase(ser, target, first, count, buffers);
 
-      GetContextRecord()->AddChunk(scope.Get());
+      GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
     }
   }
 }
@@ -1966,7 +1971,7 @@ void WrappedOpenGL::glBindBuffersRange(GLenum target, GLuint first, GLsizei coun
       SCOPED_SERIALISE_CHUNK(gl_CurChunk);
       Serialise_glBindBuffersRange(ser, target, first, count, buffers, offsets, sizes);
 
-      GetContextRecord()->AddChunk(scope.Get());
+      GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
     }
   }
 }
@@ -2038,7 +2043,7 @@ void WrappedOpenGL::glInvalidateBufferData(GLuint buffer)
       SCOPED_SERIALISE_CHUNK(gl_CurChunk);
       Serialise_glInvalidateBufferData(ser, buffer);
 
-      GetContextRecord()->AddChunk(scope.Get());
+      GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
     }
     else
     {
@@ -2115,7 +2120,7 @@ void WrappedOpenGL::glInvalidateBufferSubData(GLuint buffer, GLintptr offset, GL
       SCOPED_SERIALISE_CHUNK(gl_CurChunk);
       Serialise_glInvalidateBufferSubData(ser, buffer, offset, length);
 
-      GetContextRecord()->AddChunk(scope.Get());
+      GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
     }
     else
     {
@@ -2703,6 +2708,10 @@ GLboolean WrappedOpenGL::glUnmapNamedBufferEXT(GLuint buffer)
 
     auto status = record->Map.status;
 
+    // stop tracking writes before the memory is unmapped
+    MemoryTracking::Untrack(record->Map.writeTracking);
+    record->Map.writeTracking = NULL;
+
     if(IsActiveCapturing(m_State))
     {
       GetResourceManager()->MarkDirtyResource(record->GetResourceID());
@@ -2734,7 +2743,7 @@ GLboolean WrappedOpenGL::glUnmapNamedBufferEXT(GLuint buffer)
             USE_SCRATCH_SERIALISER();
             SCOPED_SERIALISE_CHUNK(gl_CurChunk);
             Serialise_glUnmapNamedBufferEXT(ser, buffer);
-            GetContextRecord()->AddChunk(scope.Get());
+            GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
           }
           // if it was writeable, this is a problem while capturing a frame
           else if(record->Map.access & GL_MAP_WRITE_BIT)
@@ -2784,7 +2793,7 @@ GLboolean WrappedOpenGL::glUnmapNamedBufferEXT(GLuint buffer)
           USE_SCRATCH_SERIALISER();
           SCOPED_SERIALISE_CHUNK(gl_CurChunk);
           Serialise_glUnmapNamedBufferEXT(ser, buffer);
-          GetContextRecord()->AddChunk(scope.Get());
+          GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
         }
 
         {
@@ -2973,7 +2982,7 @@ void WrappedOpenGL::glFlushMappedNamedBufferRangeEXT(GLuint buffer, GLintptr off
           USE_SCRATCH_SERIALISER();
           SCOPED_SERIALISE_CHUNK(gl_CurChunk);
           Serialise_glFlushMappedNamedBufferRangeEXT(ser, buffer, offset, length);
-          GetContextRecord()->AddChunk(scope.Get());
+          GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
         }
         else
         {
@@ -3008,7 +3017,7 @@ void WrappedOpenGL::glFlushMappedNamedBufferRangeEXT(GLuint buffer, GLintptr off
         USE_SCRATCH_SERIALISER();
         SCOPED_SERIALISE_CHUNK(gl_CurChunk);
         Serialise_glFlushMappedNamedBufferRangeEXT(ser, buffer, offset, length);
-        GetContextRecord()->AddChunk(scope.Get());
+        GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
 
         // update the comparison buffer
         if(IsActiveCapturing(m_State) && record->GetShadowPtr(1))
@@ -3065,28 +3074,54 @@ void WrappedOpenGL::PersistentMapMemoryBarrier(const std::set<GLResourceRecord *
 
     if(record->Map.ptr)
     {
-      size_t diffStart = 0, diffEnd = record->Map.length;
-      bool found = true;
+      // the ranges of the map that could have changed
+      rdcarray<rdcpair<size_t, size_t>> ranges;
 
-      if(record->GetShadowPtr(0))
-        found = FindDiffRange(record->GetShadowPtr(0), record->Map.ptr, (size_t)record->Map.length,
-                              diffStart, diffEnd);
+      if(record->GetShadowPtr(0) && record->Map.writeTracking)
+      {
+        // only pages written since the last check can differ from the shadow
+        MemoryTracking::GetWrittenRanges(record->Map.writeTracking, ranges);
+      }
+      else
+      {
+        // start tracking writes before the whole map is read, so that anything written after
+        // that is caught next time
+        if(record->GetShadowPtr(0) == NULL && record->Map.writeTracking == NULL &&
+           record->Map.status == GLResourceRecord::Mapped_Direct && Capture_MapWriteTracking())
+          record->Map.writeTracking =
+              MemoryTracking::Track(record->Map.ptr, (size_t)record->Map.length);
+
+        ranges.push_back({0, (size_t)record->Map.length});
+      }
 
-      if(found && diffEnd > diffStart)
+      for(const rdcpair<size_t, size_t> &changed : ranges)
       {
-        // update the modified region in the 'comparison' shadow buffer for next check
-        if(record->GetShadowPtr(0) == NULL)
-          record->AllocShadowStorage(record->Map.length);
+        DiffRanges diffs;
+
+        if(record->GetShadowPtr(0))
+          FindDiffRanges(record->GetShadowPtr(0) + changed.first, record->Map.ptr + changed.first,
+                         changed.second - changed.first, Capture_MapDiffMergeGap(), diffs);
         else
-          memcpy(record->GetShadowPtr(0) + diffStart, record->Map.ptr + diffStart,
-                 diffEnd - diffStart);
+          diffs.push_back({0, changed.second - changed.first});
 
-        // we use our own flush function so it will serialise chunks when necessary, and it
-        // also handles copying into the persistent mapped pointer and flushing the real GL
-        // buffer
-        gl_CurChunk = GLChunk::CoherentMapWrite;
-        glFlushMappedNamedBufferRangeEXT(record->Resource.name, GLintptr(diffStart),
-                                         GLsizeiptr(diffEnd - diffStart));
+        for(const rdcpair<size_t, size_t> &diff : diffs)
+        {
+          size_t diffStart = changed.first + diff.first, diffEnd = changed.first + diff.second;
+
+          // update the modified region in the 'comparison' shadow buffer for next check
+          if(record->GetShadowPtr(0) == NULL)
+            record->AllocShadowStorage(record->Map.length);
+          else
+            memcpy(record->GetShadowPtr(0) + diffStart, record->Map.ptr + diffStart,
+                   diffEnd - diffStart);
+
+          // we use our own flush function so it will serialise chunks when necessary, and it
+          // also handles copying into the persistent mapped pointer and flushing the real GL
+          // buffer
+          gl_CurChunk = GLChunk::CoherentMapWrite;
+          glFlushMappedNamedBufferRangeEXT(record->Resource.name, GLintptr(diffStart),
+                                           GLsizeiptr(diffEnd - diffStart));
+        }
       }
     }
   }
@@ -3266,7 +3301,7 @@ void WrappedOpenGL::glTransformFeedbackBufferBase(GLuint xfb, GLuint index, GLui
 
     if(IsActiveCapturing(m_State))
     {
-      GetContextRecord()->AddChunk(scope.Get());
+      GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
     }
     else if(xfb != 0)
     {
@@ -3330,7 +3365,7 @@ void WrappedOpenGL::glTransformFeedbackBufferRange(GLuint xfb, GLuint index, GLu
 
     if(IsActiveCapturing(m_State))
     {
-      GetContextRecord()->AddChunk(scope.Get());
+      GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
       GetResourceManager()->MarkResourceFrameReferenced(BufferRes(GetCtx(), buffer),
                                                         eFrameRef_ReadBeforeWrite);
     }
@@ -3389,7 +3424,7 @@ void WrappedOpenGL::glBindTransformFeedback(GLenum target, GLuint id)
     SCOPED_SERIALISE_CHUNK(gl_CurChunk);
     Serialise_glBindTransformFeedback(ser, target, id);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
 
     if(record)
       GetResourceManager()->MarkResourceFrameReferenced(record->GetResourceID(), eFrameRef_Read);
@@ -3423,7 +3458,7 @@ void WrappedOpenGL::glBeginTransformFeedback(GLenum primitiveMode)
     SCOPED_SERIALISE_CHUNK(gl_CurChunk);
     Serialise_glBeginTransformFeedback(ser, primitiveMode);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
   }
 }
 
@@ -3448,7 +3483,7 @@ void WrappedOpenGL::glPauseTransformFeedback()
     SCOPED_SERIALISE_CHUNK(gl_CurChunk);
     Serialise_glPauseTransformFeedback(ser);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
   }
 }
 
@@ -3473,7 +3508,7 @@ void WrappedOpenGL::glResumeTransformFeedback()
     SCOPED_SERIALISE_CHUNK(gl_CurChunk);
     Serialise_glResumeTransformFeedback(ser);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
   }
 }
 
@@ -3500,7 +3535,7 @@ void WrappedOpenGL::glEndTransformFeedback()
     SCOPED_SERIALISE_CHUNK(gl_CurChunk);
     Serialise_glEndTransformFeedback(ser);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
   }
 }
 
@@ -4693,7 +4728,7 @@ void WrappedOpenGL::glBindVertexArray(GLuint array)
     SCOPED_SERIALISE_CHUNK(gl_CurChunk);
     Serialise_glBindVertexArray(ser, array);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
     if(record)
       GetResourceManager()->MarkVAOReferenced(record->Resource, eFrameRef_ReadBeforeWrite);
   }
@@ -5145,6 +5180,9 @@ void WrappedOpenGL::glDeleteBuffers(GLsizei n, const GLuint *buffers)
           m_PersistentMaps.erase(record);
           if(record->Map.access & GL_MAP_COHERENT_BIT)
             m_CoherentMaps.erase(record);
+
+          MemoryTracking::Untrack(record->Map.writeTracking);
+          record->Map.writeTracking = NULL;
         }
 
         // free any shadow storage
@@ -5403,7 +5441,7 @@ bool WrappedOpenGL::Serialise_glVertexAttrib(SerialiserType &ser, GLuint index,
       Serialise_glVertexAttrib(ser, index, count, eGL_NONE, GL_FALSE, vals,      \
                                AttribType(TypeOr | CONCAT(Attrib_, paramtype))); \
                                                                                  \
-      GetContextRecord()->AddChunk(scope.Get());                                 \
+      GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));       \
     }                                                                            \
   }
 
@@ -5462,7 +5500,7 @@ ATTRIB_FUNC(4, 4Nub, Attrib_N, GLubyte, GLubyte x, GLubyte y, GLubyte z, GLubyte
       Serialise_glVertexAttrib(ser, index, count, eGL_NONE, GL_FALSE, value,               \
                                AttribType(TypeOr | CONCAT(Attrib_, paramtype)));           \
                                                                                            \
-      GetContextRecord()->AddChunk(scope.Get());                                           \
+      GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));                 \
     }                                                                                      \
   }
 
@@ -5525,7 +5563,7 @@ ATTRIB_FUNC(4, 4Nusv, Attrib_N, GLushort)
       SCOPED_SERIALISE_CHUNK(gl_CurChunk);                                                     \
       Serialise_glVertexAttrib(ser, index, count, type, normalized, passparam, Attrib_packed); \
                                                                                                \
-      GetContextRecord()->AddChunk(scope.Get());                                               \
+      GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));                     \
     }                                                                                          \
   }
 
@@ -231,7 +231,7 @@ void WrappedOpenGL::glObjectPtrLabel(const void *ptr, GLsizei length, const GLch
 
     GetResourceManager()->SetName(id, DecodeLabel(length, label));
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
   }
 }
 
@@ -335,7 +335,7 @@ void WrappedOpenGL::glDebugMessageInsert(GLenum source, GLenum type, GLuint id,
     SCOPED_SERIALISE_CHUNK(gl_CurChunk);
     Serialise_glDebugMessageInsert(ser, source, type, id, severity, length, buf);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
   }
 }
 
@@ -347,7 +347,7 @@ void WrappedOpenGL::glPushGroupMarkerEXT(GLsizei length, const GLchar *marker)
     SCOPED_SERIALISE_CHUNK(gl_CurChunk);
     Serialise_glPushDebugGroup(ser, eGL_DEBUG_SOURCE_APPLICATION, 0, length, marker);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
   }
 }
 
@@ -359,7 +359,7 @@ void WrappedOpenGL::glPopGroupMarkerEXT()
     SCOPED_SERIALISE_CHUNK(gl_CurChunk);
     Serialise_glPopDebugGroup(ser);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
   }
 }
 
@@ -402,7 +402,7 @@ void WrappedOpenGL::glInsertEventMarkerEXT(GLsizei length, const GLchar *marker)
     SCOPED_SERIALISE_CHUNK(gl_CurChunk);
     Serialise_glInsertEventMarkerEXT(ser, length, marker);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
   }
 }
 
@@ -424,7 +424,7 @@ void WrappedOpenGL::glStringMarkerGREMEDY(GLsizei len, const void *string)
     SCOPED_SERIALISE_CHUNK(gl_CurChunk);
     Serialise_glInsertEventMarkerEXT(ser, len, (const GLchar *)string);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
   }
 }
 
@@ -482,7 +482,7 @@ void WrappedOpenGL::glPushDebugGroup(GLenum source, GLuint id, GLsizei length, c
     SCOPED_SERIALISE_CHUNK(gl_CurChunk);
     Serialise_glPushDebugGroup(ser, source, id, length, message);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
   }
 }
 
@@ -526,7 +526,7 @@ void WrappedOpenGL::glPopDebugGroup()
     SCOPED_SERIALISE_CHUNK(gl_CurChunk);
     Serialise_glPopDebugGroup(ser);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
   }
 }
 
@@ -371,7 +371,7 @@ void WrappedOpenGL::glDispatchCompute(GLuint num_groups_x, GLuint num_groups_y,
     SCOPED_SERIALISE_CHUNK(gl_CurChunk);
     Serialise_glDispatchCompute(ser, num_groups_x, num_groups_y, num_groups_z);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
   }
 }
 
@@ -480,7 +480,7 @@ void WrappedOpenGL::glDispatchComputeGroupSizeARB(GLuint num_groups_x, GLuint nu
     Serialise_glDispatchComputeGroupSizeARB(ser, num_groups_x, num_groups_y, num_groups_z,
                                             group_size_x, group_size_y, group_size_z);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
   }
 }
 
@@ -553,7 +553,7 @@ void WrappedOpenGL::glDispatchComputeIndirect(GLintptr indirect)
     SCOPED_SERIALISE_CHUNK(gl_CurChunk);
     Serialise_glDispatchComputeIndirect(ser, indirect);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
   }
 }
 
@@ -589,7 +589,7 @@ void WrappedOpenGL::glMemoryBarrier(GLbitfield barriers)
     SCOPED_SERIALISE_CHUNK(gl_CurChunk);
     Serialise_glMemoryBarrier(ser, barriers);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
   }
 }
 
@@ -625,7 +625,7 @@ void WrappedOpenGL::glMemoryBarrierByRegion(GLbitfield barriers)
     SCOPED_SERIALISE_CHUNK(gl_CurChunk);
     Serialise_glMemoryBarrierByRegion(ser, barriers);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
   }
 }
 
@@ -652,7 +652,7 @@ void WrappedOpenGL::glTextureBarrier()
     SCOPED_SERIALISE_CHUNK(gl_CurChunk);
     Serialise_glTextureBarrier(ser);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
   }
 }
 
@@ -722,7 +722,7 @@ void WrappedOpenGL::glDrawTransformFeedback(GLenum mode, GLuint id)
     SCOPED_SERIALISE_CHUNK(gl_CurChunk);
     Serialise_glDrawTransformFeedback(ser, mode, id);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
   }
 }
 
@@ -794,7 +794,7 @@ void WrappedOpenGL::glDrawTransformFeedbackInstanced(GLenum mode, GLuint id, GLs
     SCOPED_SERIALISE_CHUNK(gl_CurChunk);
     Serialise_glDrawTransformFeedbackInstanced(ser, mode, id, instancecount);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
   }
 }
 
@@ -865,7 +865,7 @@ void WrappedOpenGL::glDrawTransformFeedbackStream(GLenum mode, GLuint id, GLuint
     SCOPED_SERIALISE_CHUNK(gl_CurChunk);
     Serialise_glDrawTransformFeedbackStream(ser, mode, id, stream);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
   }
 }
 
@@ -941,7 +941,7 @@ void WrappedOpenGL::glDrawTransformFeedbackStreamInstanced(GLenum mode, GLuint i
     SCOPED_SERIALISE_CHUNK(gl_CurChunk);
     Serialise_glDrawTransformFeedbackStreamInstanced(ser, mode, id, stream, instancecount);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
   }
 }
 
@@ -1195,7 +1195,7 @@ void WrappedOpenGL::glDrawArrays(GLenum mode, GLint first, GLsizei count)
     SCOPED_SERIALISE_CHUNK(gl_CurChunk);
     Serialise_glDrawArrays(ser, mode, first, count);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
 
     RestoreClientMemoryArrays(clientMemory, eGL_NONE);
   }
@@ -1276,7 +1276,7 @@ void WrappedOpenGL::glDrawArraysIndirect(GLenum mode, const void *indirect)
     SCOPED_SERIALISE_CHUNK(gl_CurChunk);
     Serialise_glDrawArraysIndirect(ser, mode, indirect);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
   }
 }
 
@@ -1350,7 +1350,7 @@ void WrappedOpenGL::glDrawArraysInstanced(GLenum mode, GLint first, GLsizei coun
     SCOPED_SERIALISE_CHUNK(gl_CurChunk);
     Serialise_glDrawArraysInstanced(ser, mode, first, count, instancecount);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
 
     RestoreClientMemoryArrays(clientMemory, eGL_NONE);
   }
@@ -1430,7 +1430,7 @@ void WrappedOpenGL::glDrawArraysInstancedBaseInstance(GLenum mode, GLint first,
     SCOPED_SERIALISE_CHUNK(gl_CurChunk);
     Serialise_glDrawArraysInstancedBaseInstance(ser, mode, first, count, instancecount, baseinstance);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
 
     RestoreClientMemoryArrays(clientMemory, eGL_NONE);
   }
@@ -1506,7 +1506,7 @@ void WrappedOpenGL::glDrawElements(GLenum mode, GLsizei count, GLenum type, cons
     SCOPED_SERIALISE_CHUNK(gl_CurChunk);
     Serialise_glDrawElements(ser, mode, count, type, indices);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
 
     RestoreClientMemoryArrays(clientMemory, type);
   }
@@ -1593,7 +1593,7 @@ void WrappedOpenGL::glDrawElementsIndirect(GLenum mode, GLenum type, const void
     SCOPED_SERIALISE_CHUNK(gl_CurChunk);
     Serialise_glDrawElementsIndirect(ser, mode, type, indirect);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
   }
 }
 
@@ -1671,7 +1671,7 @@ void WrappedOpenGL::glDrawRangeElements(GLenum mode, GLuint start, GLuint end, G
     SCOPED_SERIALISE_CHUNK(gl_CurChunk);
     Serialise_glDrawRangeElements(ser, mode, start, end, count, type, indices);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
 
     RestoreClientMemoryArrays(clientMemory, type);
   }
@@ -1756,7 +1756,7 @@ void WrappedOpenGL::glDrawRangeElementsBaseVertex(GLenum mode, GLuint start, GLu
     SCOPED_SERIALISE_CHUNK(gl_CurChunk);
     Serialise_glDrawRangeElementsBaseVertex(ser, mode, start, end, count, type, indices, basevertex);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
 
     RestoreClientMemoryArrays(clientMemory, type);
   }
@@ -1835,7 +1835,7 @@ void WrappedOpenGL::glDrawElementsBaseVertex(GLenum mode, GLsizei count, GLenum
     SCOPED_SERIALISE_CHUNK(gl_CurChunk);
     Serialise_glDrawElementsBaseVertex(ser, mode, count, type, indices, basevertex);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
 
     RestoreClientMemoryArrays(clientMemory, type);
   }
@@ -1915,7 +1915,7 @@ void WrappedOpenGL::glDrawElementsInstanced(GLenum mode, GLsizei count, GLenum t
     SCOPED_SERIALISE_CHUNK(gl_CurChunk);
     Serialise_glDrawElementsInstanced(ser, mode, count, type, indices, instancecount);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
 
     RestoreClientMemoryArrays(clientMemory, type);
   }
@@ -2002,7 +2002,7 @@ void WrappedOpenGL::glDrawElementsInstancedBaseInstance(GLenum mode, GLsizei cou
     Serialise_glDrawElementsInstancedBaseInstance(ser, mode, count, type, indices, instancecount,
                                                   baseinstance);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
 
     RestoreClientMemoryArrays(clientMemory, type);
   }
@@ -2089,7 +2089,7 @@ void WrappedOpenGL::glDrawElementsInstancedBaseVertex(GLenum mode, GLsizei count
     Serialise_glDrawElementsInstancedBaseVertex(ser, mode, count, type, indices, instancecount,
                                                 basevertex);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
 
     RestoreClientMemoryArrays(clientMemory, type);
   }
@@ -2177,7 +2177,7 @@ void WrappedOpenGL::glDrawElementsInstancedBaseVertexBaseInstance(GLenum mode, G
     Serialise_glDrawElementsInstancedBaseVertexBaseInstance(
         ser, mode, count, type, indices, instancecount, basevertex, baseinstance);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
 
     RestoreClientMemoryArrays(clientMemory, type);
   }
@@ -2320,7 +2320,7 @@ void WrappedOpenGL::glMultiDrawArrays(GLenum mode, const GLint *first, const GLs
     SCOPED_SERIALISE_CHUNK(gl_CurChunk);
     Serialise_glMultiDrawArrays(ser, mode, first, count, drawcount);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
   }
 }
 
@@ -2487,7 +2487,7 @@ void WrappedOpenGL::glMultiDrawElements(GLenum mode, const GLsizei *count, GLenu
     SCOPED_SERIALISE_CHUNK(gl_CurChunk);
     Serialise_glMultiDrawElements(ser, mode, count, type, indices, drawcount);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
   }
 }
 
@@ -2660,7 +2660,7 @@ void WrappedOpenGL::glMultiDrawElementsBaseVertex(GLenum mode, const GLsizei *co
     SCOPED_SERIALISE_CHUNK(gl_CurChunk);
     Serialise_glMultiDrawElementsBaseVertex(ser, mode, count, type, indices, drawcount, basevertex);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
   }
 }
 
@@ -2876,7 +2876,7 @@ void WrappedOpenGL::glMultiDrawArraysIndirect(GLenum mode, const void *indirect,
     SCOPED_SERIALISE_CHUNK(gl_CurChunk);
     Serialise_glMultiDrawArraysIndirect(ser, mode, indirect, drawcount, stride);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
   }
 }
 
@@ -3102,7 +3102,7 @@ void WrappedOpenGL::glMultiDrawElementsIndirect(GLenum mode, GLenum type, const
     SCOPED_SERIALISE_CHUNK(gl_CurChunk);
     Serialise_glMultiDrawElementsIndirect(ser, mode, type, indirect, drawcount, stride);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
   }
 }
 
@@ -3330,7 +3330,7 @@ void WrappedOpenGL::glMultiDrawArraysIndirectCount(GLenum mode, const void *indi
     SCOPED_SERIALISE_CHUNK(gl_CurChunk);
     Serialise_glMultiDrawArraysIndirectCount(ser, mode, indirect, drawcount, maxdrawcount, stride);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
   }
 }
 
@@ -3566,7 +3566,7 @@ void WrappedOpenGL::glMultiDrawElementsIndirectCount(GLenum mode, GLenum type, c
     Serialise_glMultiDrawElementsIndirectCount(ser, mode, type, indirect, drawcount, maxdrawcount,
                                                stride);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
   }
 }
 
@@ -3673,7 +3673,7 @@ void WrappedOpenGL::glClearNamedFramebufferfv(GLuint framebuffer, GLenum buffer,
     SCOPED_SERIALISE_CHUNK(gl_CurChunk);
     Serialise_glClearNamedFramebufferfv(ser, framebuffer, buffer, drawbuffer, value);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
   }
 }
 
@@ -3706,7 +3706,7 @@ void WrappedOpenGL::glClearBufferfv(GLenum buffer, GLint drawbuffer, const GLflo
     SCOPED_SERIALISE_CHUNK(gl_CurChunk);
     Serialise_glClearNamedFramebufferfv(ser, framebuffer, buffer, drawbuffer, value);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
   }
 }
 
@@ -3798,7 +3798,7 @@ void WrappedOpenGL::glClearNamedFramebufferiv(GLuint framebuffer, GLenum buffer,
     SCOPED_SERIALISE_CHUNK(gl_CurChunk);
     Serialise_glClearNamedFramebufferiv(ser, framebuffer, buffer, drawbuffer, value);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
   }
 }
 
@@ -3831,7 +3831,7 @@ void WrappedOpenGL::glClearBufferiv(GLenum buffer, GLint drawbuffer, const GLint
     SCOPED_SERIALISE_CHUNK(gl_CurChunk);
     Serialise_glClearNamedFramebufferiv(ser, framebuffer, buffer, drawbuffer, value);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
   }
 }
 
@@ -3918,7 +3918,7 @@ void WrappedOpenGL::glClearNamedFramebufferuiv(GLuint framebuffer, GLenum buffer
     SCOPED_SERIALISE_CHUNK(gl_CurChunk);
     Serialise_glClearNamedFramebufferuiv(ser, framebuffer, buffer, drawbuffer, value);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
   }
 }
 
@@ -3951,7 +3951,7 @@ void WrappedOpenGL::glClearBufferuiv(GLenum buffer, GLint drawbuffer, const GLui
     SCOPED_SERIALISE_CHUNK(gl_CurChunk);
     Serialise_glClearNamedFramebufferuiv(ser, framebuffer, buffer, drawbuffer, value);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
   }
 }
 
@@ -4059,7 +4059,7 @@ void WrappedOpenGL::glClearNamedFramebufferfi(GLuint framebuffer, GLenum buffer,
     SCOPED_SERIALISE_CHUNK(gl_CurChunk);
     Serialise_glClearNamedFramebufferfi(ser, framebuffer, buffer, drawbuffer, depth, stencil);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
   }
 }
 
@@ -4092,7 +4092,7 @@ void WrappedOpenGL::glClearBufferfi(GLenum buffer, GLint drawbuffer, GLfloat dep
     SCOPED_SERIALISE_CHUNK(gl_CurChunk);
     Serialise_glClearNamedFramebufferfi(ser, framebuffer, buffer, drawbuffer, depth, stencil);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
   }
 }
 
@@ -4197,7 +4197,7 @@ void WrappedOpenGL::glClearNamedBufferDataEXT(GLuint buffer, GLenum internalform
     SCOPED_SERIALISE_CHUNK(gl_CurChunk);
     Serialise_glClearNamedBufferDataEXT(ser, buffer, internalformat, format, type, data);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
   }
 }
 
@@ -4236,7 +4236,7 @@ void WrappedOpenGL::glClearBufferData(GLenum target, GLenum internalformat, GLen
         Serialise_glClearNamedBufferDataEXT(ser, record->Resource.name, internalformat, format,
                                             type, data);
 
-        GetContextRecord()->AddChunk(scope.Get());
+        GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
       }
       else if(IsBackgroundCapturing(m_State))
       {
@@ -4354,7 +4354,7 @@ void WrappedOpenGL::glClearNamedBufferSubDataEXT(GLuint buffer, GLenum internalf
     Serialise_glClearNamedBufferSubDataEXT(ser, buffer, internalformat, offset, size, format, type,
                                            data);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
   }
 }
 
@@ -4400,7 +4400,7 @@ void WrappedOpenGL::glClearBufferSubData(GLenum target, GLenum internalformat, G
         Serialise_glClearNamedBufferSubDataEXT(ser, record->Resource.name, internalformat, offset,
                                                size, format, type, data);
 
-        GetContextRecord()->AddChunk(scope.Get());
+        GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
       }
     }
   }
@@ -4539,7 +4539,7 @@ void WrappedOpenGL::glClear(GLbitfield mask)
     SCOPED_SERIALISE_CHUNK(gl_CurChunk);
     Serialise_glClear(ser, mask);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
 
     GLint fbo;
     GL.glGetIntegerv(eGL_DRAW_FRAMEBUFFER_BINDING, &fbo);
@@ -4680,7 +4680,7 @@ void WrappedOpenGL::glClearTexImage(GLuint texture, GLint level, GLenum format,
     SCOPED_SERIALISE_CHUNK(gl_CurChunk);
     Serialise_glClearTexImage(ser, texture, level, format, type, data);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
     GetResourceManager()->MarkDirtyResource(TextureRes(GetCtx(), texture));
   }
 }
@@ -4831,7 +4831,7 @@ void WrappedOpenGL::glClearTexSubImage(GLuint texture, GLint level, GLint xoffse
     Serialise_glClearTexSubImage(ser, texture, level, xoffset, yoffset, zoffset, width, height,
                                  depth, format, type, data);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
     GetResourceManager()->MarkDirtyResource(TextureRes(GetCtx(), texture));
   }
 }
@@ -4870,7 +4870,7 @@ void WrappedOpenGL::glFlush()
     SCOPED_SERIALISE_CHUNK(gl_CurChunk);
     Serialise_glFlush(ser);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
   }
 }
 
@@ -4909,7 +4909,7 @@ void WrappedOpenGL::glFinish()
     SCOPED_SERIALISE_CHUNK(gl_CurChunk);
     Serialise_glFinish(ser);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
   }
 }
 
@@ -244,7 +244,7 @@ void WrappedOpenGL::glNamedFramebufferTextureEXT(GLuint framebuffer, GLenum atta
     }
     else
     {
-      GetContextRecord()->AddChunk(scope.Get());
+      GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
       GetResourceManager()->MarkFBOReferenced(record->Resource, eFrameRef_ReadBeforeWrite);
       GetResourceManager()->MarkResourceFrameReferenced(TextureRes(GetCtx(), texture),
                                                         eFrameRef_Read);
@@ -305,7 +305,7 @@ void WrappedOpenGL::glFramebufferTexture(GLenum target, GLenum attachment, GLuin
     }
     else
     {
-      GetContextRecord()->AddChunk(scope.Get());
+      GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
       GetResourceManager()->MarkFBOReferenced(record->Resource, eFrameRef_ReadBeforeWrite);
       GetResourceManager()->MarkResourceFrameReferenced(TextureRes(GetCtx(), texture),
                                                         eFrameRef_Read);
@@ -387,7 +387,7 @@ void WrappedOpenGL::glNamedFramebufferTexture1DEXT(GLuint framebuffer, GLenum at
     }
     else
     {
-      GetContextRecord()->AddChunk(scope.Get());
+      GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
       GetResourceManager()->MarkFBOReferenced(record->Resource, eFrameRef_ReadBeforeWrite);
       GetResourceManager()->MarkResourceFrameReferenced(TextureRes(GetCtx(), texture),
                                                         eFrameRef_Read);
@@ -450,7 +450,7 @@ void WrappedOpenGL::glFramebufferTexture1D(GLenum target, GLenum attachment, GLe
     }
     else
     {
-      GetContextRecord()->AddChunk(scope.Get());
+      GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
       GetResourceManager()->MarkFBOReferenced(record->Resource, eFrameRef_ReadBeforeWrite);
       GetResourceManager()->MarkResourceFrameReferenced(TextureRes(GetCtx(), texture),
                                                         eFrameRef_Read);
@@ -532,7 +532,7 @@ void WrappedOpenGL::glNamedFramebufferTexture2DEXT(GLuint framebuffer, GLenum at
     }
     else
     {
-      GetContextRecord()->AddChunk(scope.Get());
+      GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
       GetResourceManager()->MarkFBOReferenced(record->Resource, eFrameRef_ReadBeforeWrite);
       GetResourceManager()->MarkResourceFrameReferenced(TextureRes(GetCtx(), texture),
                                                         eFrameRef_Read);
@@ -595,7 +595,7 @@ void WrappedOpenGL::glFramebufferTexture2D(GLenum target, GLenum attachment, GLe
     }
     else
     {
-      GetContextRecord()->AddChunk(scope.Get());
+      GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
       GetResourceManager()->MarkFBOReferenced(record->Resource, eFrameRef_ReadBeforeWrite);
       GetResourceManager()->MarkResourceFrameReferenced(TextureRes(GetCtx(), texture),
                                                         eFrameRef_Read);
@@ -706,7 +706,7 @@ void WrappedOpenGL::glFramebufferTexture2DMultisampleEXT(GLenum target, GLenum a
     }
     else
     {
-      GetContextRecord()->AddChunk(scope.Get());
+      GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
       GetResourceManager()->MarkFBOReferenced(record->Resource, eFrameRef_ReadBeforeWrite);
       GetResourceManager()->MarkResourceFrameReferenced(TextureRes(GetCtx(), texture),
                                                         eFrameRef_Read);
@@ -793,7 +793,7 @@ void WrappedOpenGL::glNamedFramebufferTexture3DEXT(GLuint framebuffer, GLenum at
     }
     else
     {
-      GetContextRecord()->AddChunk(scope.Get());
+      GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
       GetResourceManager()->MarkFBOReferenced(record->Resource, eFrameRef_ReadBeforeWrite);
       GetResourceManager()->MarkResourceFrameReferenced(TextureRes(GetCtx(), texture),
                                                         eFrameRef_Read);
@@ -857,7 +857,7 @@ void WrappedOpenGL::glFramebufferTexture3D(GLenum target, GLenum attachment, GLe
     }
     else
     {
-      GetContextRecord()->AddChunk(scope.Get());
+      GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
       GetResourceManager()->MarkFBOReferenced(record->Resource, eFrameRef_ReadBeforeWrite);
       GetResourceManager()->MarkResourceFrameReferenced(TextureRes(GetCtx(), texture),
                                                         eFrameRef_Read);
@@ -936,7 +936,7 @@ void WrappedOpenGL::glNamedFramebufferRenderbufferEXT(GLuint framebuffer, GLenum
     }
     else
     {
-      GetContextRecord()->AddChunk(scope.Get());
+      GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
       GetResourceManager()->MarkFBOReferenced(record->Resource, eFrameRef_ReadBeforeWrite);
       GetResourceManager()->MarkResourceFrameReferenced(RenderbufferRes(GetCtx(), renderbuffer),
                                                         eFrameRef_Read);
@@ -995,7 +995,7 @@ void WrappedOpenGL::glFramebufferRenderbuffer(GLenum target, GLenum attachment,
     }
     else
     {
-      GetContextRecord()->AddChunk(scope.Get());
+      GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
       GetResourceManager()->MarkFBOReferenced(record->Resource, eFrameRef_ReadBeforeWrite);
       GetResourceManager()->MarkResourceFrameReferenced(RenderbufferRes(GetCtx(), renderbuffer),
                                                         eFrameRef_Read);
@@ -1078,7 +1078,7 @@ void WrappedOpenGL::glNamedFramebufferTextureLayerEXT(GLuint framebuffer, GLenum
     }
     else
     {
-      GetContextRecord()->AddChunk(scope.Get());
+      GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
       GetResourceManager()->MarkFBOReferenced(record->Resource, eFrameRef_ReadBeforeWrite);
       GetResourceManager()->MarkResourceFrameReferenced(TextureRes(GetCtx(), texture),
                                                         eFrameRef_Read);
@@ -1141,7 +1141,7 @@ void WrappedOpenGL::glFramebufferTextureLayer(GLenum target, GLenum attachment,
     }
     else
     {
-      GetContextRecord()->AddChunk(scope.Get());
+      GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
       GetResourceManager()->MarkFBOReferenced(record->Resource, eFrameRef_ReadBeforeWrite);
       GetResourceManager()->MarkResourceFrameReferenced(TextureRes(GetCtx(), texture),
                                                         eFrameRef_Read);
@@ -1260,7 +1260,7 @@ void WrappedOpenGL::glFramebufferTextureMultiviewOVR(GLenum target, GLenum attac
     }
     else
     {
-      GetContextRecord()->AddChunk(scope.Get());
+      GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
       GetResourceManager()->MarkFBOReferenced(record->Resource, eFrameRef_ReadBeforeWrite);
       GetResourceManager()->MarkResourceFrameReferenced(TextureRes(GetCtx(), texture),
                                                         eFrameRef_Read);
@@ -1378,7 +1378,7 @@ void WrappedOpenGL::glFramebufferTextureMultisampleMultiviewOVR(GLenum target, G
     }
     else
     {
-      GetContextRecord()->AddChunk(scope.Get());
+      GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
       GetResourceManager()->MarkFBOReferenced(record->Resource, eFrameRef_ReadBeforeWrite);
       GetResourceManager()->MarkResourceFrameReferenced(TextureRes(GetCtx(), texture),
                                                         eFrameRef_Read);
@@ -1496,7 +1496,7 @@ void WrappedOpenGL::glFramebufferReadBufferEXT(GLuint framebuffer, GLenum buf)
     SCOPED_SERIALISE_CHUNK(gl_CurChunk);
     Serialise_glFramebufferReadBufferEXT(ser, framebuffer, buf);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
     GetResourceManager()->MarkFBOReferenced(FramebufferRes(GetCtx(), framebuffer),
                                             eFrameRef_ReadBeforeWrite);
   }
@@ -1528,7 +1528,7 @@ void WrappedOpenGL::glReadBuffer(GLenum mode)
       SCOPED_SERIALISE_CHUNK(gl_CurChunk);
       Serialise_glFramebufferReadBufferEXT(ser, readrecord ? readrecord->Resource.name : 0, mode);
 
-      GetContextRecord()->AddChunk(scope.Get());
+      GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
       if(readrecord)
         GetResourceManager()->MarkFBOReferenced(readrecord->Resource, eFrameRef_ReadBeforeWrite);
     }
@@ -1573,7 +1573,7 @@ void WrappedOpenGL::glBindFramebuffer(GLenum target, GLuint framebuffer)
     SCOPED_SERIALISE_CHUNK(gl_CurChunk);
     Serialise_glBindFramebuffer(ser, target, framebuffer);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
   }
 
   if(IsCaptureMode(m_State))
@@ -1629,7 +1629,7 @@ void WrappedOpenGL::glFramebufferDrawBufferEXT(GLuint framebuffer, GLenum buf)
     SCOPED_SERIALISE_CHUNK(gl_CurChunk);
     Serialise_glFramebufferDrawBufferEXT(ser, framebuffer, buf);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
     GetResourceManager()->MarkFBOReferenced(FramebufferRes(GetCtx(), framebuffer),
                                             eFrameRef_ReadBeforeWrite);
   }
@@ -1660,7 +1660,7 @@ void WrappedOpenGL::glDrawBuffer(GLenum buf)
       SCOPED_SERIALISE_CHUNK(gl_CurChunk);
       Serialise_glFramebufferDrawBufferEXT(ser, drawrecord ? drawrecord->Resource.name : 0, buf);
 
-      GetContextRecord()->AddChunk(scope.Get());
+      GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
       if(drawrecord)
         GetResourceManager()->MarkFBOReferenced(drawrecord->Resource, eFrameRef_ReadBeforeWrite);
     }
@@ -1720,7 +1720,7 @@ void WrappedOpenGL::glFramebufferDrawBuffersEXT(GLuint framebuffer, GLsizei n, c
     SCOPED_SERIALISE_CHUNK(gl_CurChunk);
     Serialise_glFramebufferDrawBuffersEXT(ser, framebuffer, n, bufs);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
     GetResourceManager()->MarkFBOReferenced(FramebufferRes(GetCtx(), framebuffer),
                                             eFrameRef_ReadBeforeWrite);
   }
@@ -1754,7 +1754,7 @@ void WrappedOpenGL::glDrawBuffers(GLsizei n, const GLenum *bufs)
       else
         Serialise_glFramebufferDrawBuffersEXT(ser, 0, n, bufs);
 
-      GetContextRecord()->AddChunk(scope.Get());
+      GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
       if(drawrecord)
         GetResourceManager()->MarkFBOReferenced(drawrecord->Resource, eFrameRef_ReadBeforeWrite);
     }
@@ -1878,7 +1878,7 @@ void WrappedOpenGL::glInvalidateFramebuffer(GLenum target, GLsizei numAttachment
       else
         Serialise_glInvalidateNamedFramebufferData(ser, 0, numAttachments, attachments);
 
-      GetContextRecord()->AddChunk(scope.Get());
+      GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
       if(record)
         GetResourceManager()->MarkFBOReferenced(record->Resource, eFrameRef_ReadBeforeWrite);
     }
@@ -1921,7 +1921,7 @@ void WrappedOpenGL::glDiscardFramebufferEXT(GLenum target, GLsizei numAttachment
       else
         Serialise_glInvalidateNamedFramebufferData(ser, 0, numAttachments, attachments);
 
-      GetContextRecord()->AddChunk(scope.Get());
+      GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
       if(record)
         GetResourceManager()->MarkFBOReferenced(record->Resource, eFrameRef_ReadBeforeWrite);
     }
@@ -1952,7 +1952,7 @@ void WrappedOpenGL::glInvalidateNamedFramebufferData(GLuint framebuffer, GLsizei
       else
         Serialise_glInvalidateNamedFramebufferData(ser, 0, numAttachments, attachments);
 
-      GetContextRecord()->AddChunk(scope.Get());
+      GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
       if(record)
         GetResourceManager()->MarkFBOReferenced(record->Resource, eFrameRef_ReadBeforeWrite);
     }
@@ -2079,7 +2079,7 @@ void WrappedOpenGL::glInvalidateSubFramebuffer(GLenum target, GLsizei numAttachm
         Serialise_glInvalidateNamedFramebufferSubData(ser, 0, numAttachments, attachments, x, y,
                                                       width, height);
 
-      GetContextRecord()->AddChunk(scope.Get());
+      GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
       if(record)
         GetResourceManager()->MarkFBOReferenced(record->Resource, eFrameRef_ReadBeforeWrite);
     }
@@ -2113,7 +2113,7 @@ void WrappedOpenGL::glInvalidateNamedFramebufferSubData(GLuint framebuffer, GLsi
         Serialise_glInvalidateNamedFramebufferSubData(ser, 0, numAttachments, attachments, x, y,
                                                       width, height);
 
-      GetContextRecord()->AddChunk(scope.Get());
+      GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
       if(record)
         GetResourceManager()->MarkFBOReferenced(record->Resource, eFrameRef_ReadBeforeWrite);
     }
@@ -2307,7 +2307,7 @@ void WrappedOpenGL::glBlitNamedFramebuffer(GLuint readFramebuffer, GLuint drawFr
     Serialise_glBlitNamedFramebuffer(ser, readFramebuffer, drawFramebuffer, srcX0, srcY0, srcX1,
                                      srcY1, dstX0, dstY0, dstX1, dstY1, mask, filter);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
   }
 
   if(IsCaptureMode(m_State))
@@ -2344,7 +2344,7 @@ void WrappedOpenGL::glBlitFramebuffer(GLint srcX0, GLint srcY0, GLint srcX1, GLi
       Serialise_glBlitNamedFramebuffer(ser, readFramebuffer, drawFramebuffer, srcX0, srcY0, srcX1,
                                        srcY1, dstX0, dstY0, dstX1, dstY1, mask, filter);
 
-      GetContextRecord()->AddChunk(scope.Get());
+      GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
     }
 
     GetResourceManager()->MarkFBOReferenced(FramebufferRes(GetCtx(), readFramebuffer),
@@ -186,7 +186,7 @@ BOOL WrappedOpenGL::wglDXLockObjectsNV(HANDLE hDevice, GLint count, HANDLE *hObj
       SCOPED_SERIALISE_CHUNK(gl_CurChunk);
       Serialise_wglDXLockObjectsNV(ser, w->res);
 
-      GetContextRecord()->AddChunk(scope.Get());
+      GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
       GetResourceManager()->MarkResourceFrameReferenced(GetResourceManager()->GetResID(w->res),
                                                         eFrameRef_Read);
     }
@@ -660,7 +660,7 @@ void WrappedOpenGL::glMemoryObjectParameterivEXT(GLuint memoryObject, GLenum pna
 
     if(IsActiveCapturing(m_State))
     {
-      GetContextRecord()->AddChunk(scope.Get());
+      GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
       GetResourceManager()->MarkResourceFrameReferenced(record->GetResourceID(), eFrameRef_Read);
     }
     else
@@ -935,7 +935,7 @@ void WrappedOpenGL::glSemaphoreParameterui64vEXT(GLuint semaphore, GLenum pname,
 
     if(IsActiveCapturing(m_State))
     {
-      GetContextRecord()->AddChunk(scope.Get());
+      GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
       GetResourceManager()->MarkResourceFrameReferenced(record->GetResourceID(), eFrameRef_Read);
     }
     else
@@ -1136,7 +1136,7 @@ void WrappedOpenGL::glWaitSemaphoreEXT(GLuint semaphore, GLuint numBufferBarrier
     Serialise_glWaitSemaphoreEXT(ser, semaphore, numBufferBarriers, buffers, numTextureBarriers,
                                  textures, srcLayouts);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
     GetResourceManager()->MarkResourceFrameReferenced(ExtSemRes(GetCtx(), semaphore), eFrameRef_Read);
 
     for(GLuint b = 0; buffers && b < numBufferBarriers; b++)
@@ -1203,7 +1203,7 @@ void WrappedOpenGL::glSignalSemaphoreEXT(GLuint semaphore, GLuint numBufferBarri
     Serialise_glSignalSemaphoreEXT(ser, semaphore, numBufferBarriers, buffers, numTextureBarriers,
                                    textures, dstLayouts);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
     GetResourceManager()->MarkResourceFrameReferenced(ExtSemRes(GetCtx(), semaphore), eFrameRef_Read);
 
     for(GLuint b = 0; buffers && b < numBufferBarriers; b++)
@@ -1249,7 +1249,7 @@ GLboolean WrappedOpenGL::glAcquireKeyedMutexWin32EXT(GLuint memory, GLuint64 key
     SCOPED_SERIALISE_CHUNK(gl_CurChunk);
     Serialise_glAcquireKeyedMutexWin32EXT(ser, memory, key, timeout);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
     GetResourceManager()->MarkResourceFrameReferenced(ExtMemRes(GetCtx(), memory), eFrameRef_Read);
   }
 
@@ -1284,7 +1284,7 @@ GLboolean WrappedOpenGL::glReleaseKeyedMutexWin32EXT(GLuint memory, GLuint64 key
     SCOPED_SERIALISE_CHUNK(gl_CurChunk);
     Serialise_glReleaseKeyedMutexWin32EXT(ser, memory, key);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
     GetResourceManager()->MarkResourceFrameReferenced(ExtMemRes(GetCtx(), memory), eFrameRef_Read);
   }
 
@@ -382,7 +382,7 @@ void WrappedOpenGL::glBindTextures(GLuint first, GLsizei count, const GLuint *te
     SCOPED_SERIALISE_CHUNK(gl_CurChunk);
     Serialise_glBindTextures(ser, first, count, textures);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
 
     for(GLsizei i = 0; i < count; i++)
       if(textures != NULL && textures[i] != 0)
@@ -532,7 +532,7 @@ void WrappedOpenGL::glBindTextureUnit(GLuint unit, GLuint texture)
     SCOPED_SERIALISE_CHUNK(gl_CurChunk);
     Serialise_glBindTextureUnit(ser, unit, texture);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
     GetResourceManager()->MarkResourceFrameReferenced(TextureRes(GetCtx(), texture), eFrameRef_Read);
   }
 
@@ -677,7 +677,7 @@ void WrappedOpenGL::glBindImageTextures(GLuint first, GLsizei count, const GLuin
     SCOPED_SERIALISE_CHUNK(gl_CurChunk);
     Serialise_glBindImageTextures(ser, first, count, textures);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
   }
 }
 
@@ -852,7 +852,7 @@ void WrappedOpenGL::Common_glGenerateTextureMipmapEXT(GLResourceRecord *record,
     SCOPED_SERIALISE_CHUNK(gl_CurChunk);
     Serialise_glGenerateTextureMipmapEXT(ser, record->Resource.name, target);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
     GetResourceManager()->MarkDirtyResource(record->GetResourceID());
     GetResourceManager()->MarkResourceFrameReferenced(record->GetResourceID(),
                                                       eFrameRef_ReadBeforeWrite);
@@ -1055,7 +1055,7 @@ void WrappedOpenGL::glInvalidateTexImage(GLuint texture, GLint level)
       SCOPED_SERIALISE_CHUNK(gl_CurChunk);
       Serialise_glInvalidateTexImage(ser, texture, level);
 
-      GetContextRecord()->AddChunk(scope.Get());
+      GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
       GetResourceManager()->MarkDirtyResource(record->GetResourceID());
       GetResourceManager()->MarkResourceFrameReferenced(record->GetResourceID(),
                                                         eFrameRef_ReadBeforeWrite);
@@ -1211,7 +1211,7 @@ void WrappedOpenGL::glInvalidateTexSubImage(GLuint texture, GLint level, GLint x
       Serialise_glInvalidateTexSubImage(ser, texture, level, xoffset, yoffset, zoffset, width,
                                         height, depth);
 
-      GetContextRecord()->AddChunk(scope.Get());
+      GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
       GetResourceManager()->MarkDirtyResource(record->GetResourceID());
       GetResourceManager()->MarkResourceFrameReferenced(record->GetResourceID(),
                                                         eFrameRef_ReadBeforeWrite);
@@ -1343,7 +1343,7 @@ void WrappedOpenGL::glCopyImageSubData(GLuint srcName, GLenum srcTarget, GLint s
                                  dstTarget, dstLevel, dstX, dstY, dstZ, srcWidth, srcHeight,
                                  srcDepth);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
     GetResourceManager()->MarkDirtyResource(dstrecord->GetResourceID());
     GetResourceManager()->MarkResourceFrameReferenced(dstrecord->GetResourceID(),
                                                       eFrameRef_PartialWrite);
@@ -1492,7 +1492,7 @@ void WrappedOpenGL::Common_glCopyTextureSubImage1DEXT(GLResourceRecord *record,
     Serialise_glCopyTextureSubImage1DEXT(ser, record->Resource.name, target, level, xoffset, x, y,
                                          width);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
     GetResourceManager()->MarkDirtyResource(record->GetResourceID());
     GetResourceManager()->MarkResourceFrameReferenced(record->GetResourceID(),
                                                       eFrameRef_PartialWrite);
@@ -1608,7 +1608,7 @@ void WrappedOpenGL::Common_glCopyTextureSubImage2DEXT(GLResourceRecord *record,
     Serialise_glCopyTextureSubImage2DEXT(ser, record->Resource.name, target, level, xoffset,
                                          yoffset, x, y, width, height);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
     GetResourceManager()->MarkDirtyResource(record->GetResourceID());
     GetResourceManager()->MarkResourceFrameReferenced(record->GetResourceID(),
                                                       eFrameRef_PartialWrite);
@@ -1731,7 +1731,7 @@ void WrappedOpenGL::Common_glCopyTextureSubImage3DEXT(GLResourceRecord *record,
     Serialise_glCopyTextureSubImage3DEXT(ser, record->Resource.name, target, level, xoffset,
                                          yoffset, zoffset, x, y, width, height);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
     GetResourceManager()->MarkDirtyResource(record->GetResourceID());
     GetResourceManager()->MarkResourceFrameReferenced(record->GetResourceID(),
                                                       eFrameRef_PartialWrite);
@@ -1864,7 +1864,7 @@ void WrappedOpenGL::Common_glTextureParameteriEXT(GLResourceRecord *record, GLen
 
   if(IsActiveCapturing(m_State))
   {
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
     GetResourceManager()->MarkResourceFrameReferenced(record->GetResourceID(),
                                                       eFrameRef_ReadBeforeWrite);
   }
@@ -1980,7 +1980,7 @@ void WrappedOpenGL::Common_glTextureParameterivEXT(GLResourceRecord *record, GLe
 
   if(IsActiveCapturing(m_State))
   {
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
     GetResourceManager()->MarkResourceFrameReferenced(record->GetResourceID(),
                                                       eFrameRef_ReadBeforeWrite);
   }
@@ -2099,7 +2099,7 @@ void WrappedOpenGL::Common_glTextureParameterIivEXT(GLResourceRecord *record, GL
 
   if(IsActiveCapturing(m_State))
   {
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
     GetResourceManager()->MarkResourceFrameReferenced(record->GetResourceID(),
                                                       eFrameRef_ReadBeforeWrite);
   }
@@ -2218,7 +2218,7 @@ void WrappedOpenGL::Common_glTextureParameterIuivEXT(GLResourceRecord *record, G
 
   if(IsActiveCapturing(m_State))
   {
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
     GetResourceManager()->MarkResourceFrameReferenced(record->GetResourceID(),
                                                       eFrameRef_ReadBeforeWrite);
   }
@@ -2335,7 +2335,7 @@ void WrappedOpenGL::Common_glTextureParameterfEXT(GLResourceRecord *record, GLen
 
   if(IsActiveCapturing(m_State))
   {
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
     GetResourceManager()->MarkResourceFrameReferenced(record->GetResourceID(),
                                                       eFrameRef_ReadBeforeWrite);
   }
@@ -2451,7 +2451,7 @@ void WrappedOpenGL::Common_glTextureParameterfvEXT(GLResourceRecord *record, GLe
 
   if(IsActiveCapturing(m_State))
   {
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
     GetResourceManager()->MarkResourceFrameReferenced(record->GetResourceID(),
                                                       eFrameRef_ReadBeforeWrite);
   }
@@ -2546,7 +2546,7 @@ void WrappedOpenGL::glPixelStorei(GLenum pname, GLint param)
     SCOPED_SERIALISE_CHUNK(gl_CurChunk);
     Serialise_glPixelStorei(ser, pname, param);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
   }
 }
 
@@ -2633,7 +2633,7 @@ bool WrappedOpenGL::Serialise_glTextureImage1DEXT(SerialiserType &ser, GLuint te
 
   size_t subimageSize = GetByteSize(width, 1, 1, format, type);
 
-  SERIALISE_ELEMENT_ARRAY(pixels, subimageSize);
+  SERIALISE_ELEMENT_ARRAY_INPLACE(pixels, subimageSize);
 
   SAFE_DELETE_ARRAY(unpackedPixels);
 
@@ -2859,7 +2859,7 @@ bool WrappedOpenGL::Serialise_glTextureImage2DEXT(SerialiserType &ser, GLuint te
 
   size_t subimageSize = GetByteSize(width, height, 1, format, type);
 
-  SERIALISE_ELEMENT_ARRAY(pixels, subimageSize);
+  SERIALISE_ELEMENT_ARRAY_INPLACE(pixels, subimageSize);
 
   SAFE_DELETE_ARRAY(unpackedPixels);
 
@@ -3115,7 +3115,7 @@ bool WrappedOpenGL::Serialise_glTextureImage3DEXT(SerialiserType &ser, GLuint te
 
   size_t subimageSize = GetByteSize(width, height, depth, format, type);
 
-  SERIALISE_ELEMENT_ARRAY(pixels, subimageSize);
+  SERIALISE_ELEMENT_ARRAY_INPLACE(pixels, subimageSize);
 
   SAFE_DELETE_ARRAY(unpackedPixels);
 
@@ -3346,7 +3346,7 @@ bool WrappedOpenGL::Serialise_glCompressedTextureImage1DEXT(SerialiserType &ser,
   }
 
   SERIALISE_ELEMENT(imageSize);
-  SERIALISE_ELEMENT_ARRAY(pixels, imageSize);
+  SERIALISE_ELEMENT_ARRAY_INPLACE(pixels, imageSize);
 
   SAFE_DELETE_ARRAY(unpackedPixels);
 
@@ -3667,7 +3667,7 @@ bool WrappedOpenGL::Serialise_glCompressedTextureImage2DEXT(SerialiserType &ser,
   }
 
   SERIALISE_ELEMENT(imageSize);
-  SERIALISE_ELEMENT_ARRAY(pixels, imageSize);
+  SERIALISE_ELEMENT_ARRAY_INPLACE(pixels, imageSize);
 
   SAFE_DELETE_ARRAY(unpackedPixels);
 
@@ -3928,7 +3928,7 @@ bool WrappedOpenGL::Serialise_glCompressedTextureImage3DEXT(SerialiserType &ser,
   }
 
   SERIALISE_ELEMENT(imageSize);
-  SERIALISE_ELEMENT_ARRAY(pixels, imageSize);
+  SERIALISE_ELEMENT_ARRAY_INPLACE(pixels, imageSize);
 
   SAFE_DELETE_ARRAY(unpackedPixels);
 
@@ -4228,7 +4228,7 @@ void WrappedOpenGL::Common_glCopyTextureImage1DEXT(GLResourceRecord *record, GLe
     Serialise_glCopyTextureImage1DEXT(ser, record->Resource.name, target, level, internalformat, x,
                                       y, width, border);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
     GetResourceManager()->MarkDirtyResource(record->GetResourceID());
     GetResourceManager()->MarkResourceFrameReferenced(record->GetResourceID(),
                                                       eFrameRef_PartialWrite);
@@ -4391,7 +4391,7 @@ void WrappedOpenGL::Common_glCopyTextureImage2DEXT(GLResourceRecord *record, GLe
     Serialise_glCopyTextureImage2DEXT(ser, record->Resource.name, target, level, internalformat, x,
                                       y, width, height, border);
 
-    GetContextRecord()->AddChunk(scope.Get());
+    GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
     GetResourceManager()->MarkDirtyResource(record->GetResourceID());
     GetResourceManager()->MarkResourceFrameReferenced(record->GetResourceID(),
                                                       eFrameRef_PartialWrite);
@@ -5370,7 +5370,7 @@ void WrappedOpenGL::Common_glTextureSubImage1DEXT(GLResourceRecord *record, GLen
 
     if(IsActiveCapturing(m_State))
     {
-      GetContextRecord()->AddChunk(scope.Get());
+      GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
       GetResourceManager()->MarkDirtyResource(record->GetResourceID());
       GetResourceManager()->MarkResourceFrameReferenced(record->GetResourceID(),
                                                         eFrameRef_PartialWrite);
@@ -5598,7 +5598,7 @@ void WrappedOpenGL::Common_glTextureSubImage2DEXT(GLResourceRecord *record, GLen
 
     if(IsActiveCapturing(m_State))
     {
-      GetContextRecord()->AddChunk(scope.Get());
+      GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
       GetResourceManager()->MarkDirtyResource(record->GetResourceID());
       GetResourceManager()->MarkResourceFrameReferenced(record->GetResourceID(),
                                                         eFrameRef_PartialWrite);
@@ -5834,7 +5834,7 @@ void WrappedOpenGL::Common_glTextureSubImage3DEXT(GLResourceRecord *record, GLen
 
     if(IsActiveCapturing(m_State))
     {
-      GetContextRecord()->AddChunk(scope.Get());
+      GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
       GetResourceManager()->MarkDirtyResource(record->GetResourceID());
       GetResourceManager()->MarkResourceFrameReferenced(record->GetResourceID(),
                                                         eFrameRef_PartialWrite);
@@ -6052,7 +6052,7 @@ void WrappedOpenGL::Common_glCompressedTextureSubImage1DEXT(GLResourceRecord *re
 
     if(IsActiveCapturing(m_State))
     {
-      GetContextRecord()->AddChunk(scope.Get());
+      GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
       GetResourceManager()->MarkDirtyResource(record->GetResourceID());
       GetResourceManager()->MarkResourceFrameReferenced(record->GetResourceID(),
                                                         eFrameRef_PartialWrite);
@@ -6282,7 +6282,7 @@ void WrappedOpenGL::Common_glCompressedTextureSubImage2DEXT(GLResourceRecord *re
 
     if(IsActiveCapturing(m_State))
     {
-      GetContextRecord()->AddChunk(scope.Get());
+      GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
       GetResourceManager()->MarkDirtyResource(record->GetResourceID());
       GetResourceManager()->MarkResourceFrameReferenced(record->GetResourceID(),
                                                         eFrameRef_PartialWrite);
@@ -6518,7 +6518,7 @@ void WrappedOpenGL::Common_glCompressedTextureSubImage3DEXT(GLResourceRecord *re
 
     if(IsActiveCapturing(m_State))
     {
-      GetContextRecord()->AddChunk(scope.Get());
+      GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
       GetResourceManager()->MarkDirtyResource(record->GetResourceID());
       GetResourceManager()->MarkResourceFrameReferenced(record->GetResourceID(),
                                                         eFrameRef_PartialWrite);
@@ -6705,7 +6705,7 @@ void WrappedOpenGL::Common_glTextureBufferRangeEXT(ResourceId texId, GLenum targ
 
     if(IsActiveCapturing(m_State))
     {
-      GetContextRecord()->AddChunk(scope.Get());
+      GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
       GetResourceManager()->MarkDirtyResource(record->GetResourceID());
       GetResourceManager()->MarkResourceFrameReferenced(record->GetResourceID(), eFrameRef_Read);
 
@@ -7045,7 +7045,7 @@ void WrappedOpenGL::glTextureFoveationParametersQCOM(GLuint texture, GLuint laye
 
     if(IsActiveCapturing(m_State))
     {
-      GetContextRecord()->AddChunk(scope.Get());
+      GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));
       GetResourceManager()->MarkResourceFrameReferenced(record->GetResourceID(), eFrameRef_Read);
     }
     else
@@ -327,7 +327,7 @@ bool WrappedOpenGL::Serialise_glProgramUniformMatrix(SerialiserType &ser, GLuint
       const paramtype vals[] = {ARRAYLIST};                                                  \
       Serialise_glProgramUniformVector(ser, PROGRAM, location, 1, vals,                      \
                                        CONCAT(CONCAT(VEC, count), CONCAT(suffix, v)));       \
-      GetContextRecord()->AddChunk(scope.Get());                                             \
+      GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));                   \
     }                                                                                        \
     else if(IsBackgroundCapturing(m_State))                                                  \
     {                                                                                        \
@@ -430,7 +430,7 @@ UNIFORM_FUNC(4, d, GLdouble, GLdouble v0, GLdouble v1, GLdouble v2, GLdouble v3)
       SCOPED_SERIALISE_CHUNK(gl_CurChunk);                                                    \
       Serialise_glProgramUniformVector(ser, PROGRAM, location, count, value,                  \
                                        CONCAT(CONCAT(VEC, unicount), CONCAT(suffix, v)));     \
-      GetContextRecord()->AddChunk(scope.Get());                                              \
+      GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));                    \
     }                                                                                         \
     else if(IsBackgroundCapturing(m_State))                                                   \
     {                                                                                         \
@@ -512,7 +512,7 @@ UNIFORM_FUNC(4, d, GLdouble)
       SCOPED_SERIALISE_CHUNK(gl_CurChunk);                                               \
       Serialise_glProgramUniformMatrix(ser, PROGRAM, location, count, transpose, value,  \
                                        CONCAT(CONCAT(MAT, dim), suffix));                \
-      GetContextRecord()->AddChunk(scope.Get());                                         \
+      GetContextRecord()->AddChunk(scope.Get(GetContextChunkAllocator()));               \
     }                                                                                    \
     else if(IsBackgroundCapturing(m_State))                                              \
     {                                                                                    \
@@ -0,0 +1,798 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#include <algorithm>
+#include "core/settings.h"
+#include "vk_core.h"
+
+RDOC_CONFIG(uint32_t, Vulkan_ReplayCheckpointInterval, 0,
+            "The minimum number of events between replay checkpoints. Replaying to an event "
+            "restores the closest earlier checkpoint instead of replaying the whole frame. Writes "
+            "are found from resource usage, so captures that enable buffer device addresses or "
+            "descriptor indexing never use checkpoints. 0 disables checkpoints, which is the "
+            "default.");
+RDOC_CONFIG(uint32_t, Vulkan_ReplayCheckpointMemoryMB, 512,
+            "The GPU memory budget for replay checkpoints, in megabytes. The least recently used "
+            "checkpoints are freed to stay inside it.");
+
+static bool IsCheckpointWriteUsage(ResourceUsage usage)
+{
+  // anything that isn't known to only read is treated as a write, so an unusual write isn't missed
+  switch(usage)
+  {
+    case ResourceUsage::Unused:
+    case ResourceUsage::VertexBuffer:
+    case ResourceUsage::IndexBuffer:
+    case ResourceUsage::VS_Constants:
+    case ResourceUsage::HS_Constants:
+    case ResourceUsage::DS_Constants:
+    case ResourceUsage::GS_Constants:
+    case ResourceUsage::PS_Constants:
+    case ResourceUsage::CS_Constants:
+    case ResourceUsage::All_Constants:
+    case ResourceUsage::VS_Resource:
+    case ResourceUsage::HS_Resource:
+    case ResourceUsage::DS_Resource:
+    case ResourceUsage::GS_Resource:
+    case ResourceUsage::PS_Resource:
+    case ResourceUsage::CS_Resource:
+    case ResourceUsage::All_Resource:
+    case ResourceUsage::InputTarget:
+    case ResourceUsage::Indirect:
+    case ResourceUsage::ResolveSrc:
+    case ResourceUsage::CopySrc:
+    case ResourceUsage::Barrier: return false;
+    default: break;
+  }
+
+  return true;
+}
+
+static bool ImageStateChanged(const ImageState &state)
+{
+  for(auto it = state.subresourceStates.begin(); it != state.subresourceStates.end(); ++it)
+  {
+    const ImageSubresourceState &sub = it->state();
+    if(sub.newLayout != sub.oldLayout || sub.newQueueFamilyIndex != sub.oldQueueFamilyIndex)
+      return true;
+  }
+
+  return false;
+}
+
+// lays out every subresource of the image tightly packed in a buffer. Returns 0 for images that
+// can't be copied to a buffer directly.
+static VkDeviceSize GetCheckpointImageCopies(const ImageInfo &imageInfo,
+                                             rdcarray<VkBufferImageCopy> &copies)
+{
+  if(imageInfo.sampleCount > 1 || GetYUVPlaneCount(imageInfo.format) > 1)
+    return 0;
+
+  // must ensure offset remains valid. Must be multiple of block size, or 4, depending on format
+  VkDeviceSize bufAlignment = 4;
+  if(IsBlockFormat(imageInfo.format))
+    bufAlignment = (VkDeviceSize)GetByteSize(1, 1, 1, imageInfo.format, 0);
+
+  VkImageAspectFlags aspectFlags = FormatImageAspects(imageInfo.format);
+  VkFormat sizeFormat = GetDepthOnlyFormat(imageInfo.format);
+
+  VkDeviceSize bufOffset = 0;
+
+  for(uint32_t a = 0; a < imageInfo.layerCount; a++)
+  {
+    VkExtent3D extent = imageInfo.extent;
+
+    for(uint32_t m = 0; m < imageInfo.levelCount; m++)
+    {
+      VkBufferImageCopy region = {
+          0,
+          0,
+          0,
+          {aspectFlags, m, a, 1},
+          {
+              0, 0, 0,
+          },
+          extent,
+      };
+
+      bufOffset = AlignUp(bufOffset, bufAlignment);
+      region.bufferOffset = bufOffset;
+
+      if(aspectFlags == (VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT))
+      {
+        // depth and stencil are copied separately
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+        copies.push_back(region);
+
+        bufOffset += GetByteSize(extent.width, extent.height, extent.depth, sizeFormat, 0);
+        bufOffset = AlignUp(bufOffset, bufAlignment);
+
+        region.bufferOffset = bufOffset;
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_STENCIL_BIT;
+        copies.push_back(region);
+
+        bufOffset += GetByteSize(extent.width, extent.height, extent.depth, VK_FORMAT_S8_UINT, 0);
+      }
+      else
+      {
+        copies.push_back(region);
+
+        bufOffset += GetByteSize(extent.width, extent.height, extent.depth, sizeFormat, 0);
+      }
+
+      extent.width = RDCMAX(extent.width >> 1, 1U);
+      extent.height = RDCMAX(extent.height >> 1, 1U);
+      extent.depth = RDCMAX(extent.depth >> 1, 1U);
+    }
+  }
+
+  return bufOffset;
+}
+
+void WrappedVulkan::TrackReplayCheckpointChunk(VulkanChunk chunk, uint64_t nextOffset)
+{
+  // commands recorded into command buffers are handled per command buffer when the candidates are
+  // finalised
+  if(m_LastCmdBufferID != ResourceId())
+    return;
+
+  switch(chunk)
+  {
+    case VulkanChunk::vkQueueSubmit:
+    case VulkanChunk::vkQueueSubmit2KHR:
+    {
+      ReplayCheckpointCandidate candidate = {};
+      candidate.eventId = m_RootEventID;
+      candidate.chunkIndex = uint32_t(m_StructuredFile->chunks.size() - 1);
+      candidate.resumeOffset = nextOffset;
+      m_CheckpointCandidates.push_back(candidate);
+      break;
+    }
+    case VulkanChunk::vkUpdateDescriptorSets:
+    case VulkanChunk::vkUpdateDescriptorSetWithTemplate:
+    case VulkanChunk::vkResetQueryPool: m_CheckpointReplayChunks.push_back(m_CurChunkOffset); break;
+    // memory writes are recorded as usage, and stored in checkpoints like GPU writes
+    case VulkanChunk::vkUnmapMemory:
+    case VulkanChunk::vkFlushMappedMemoryRanges:
+    // synchronisation, markers and names don't affect anything we replay
+    case VulkanChunk::vkQueueWaitIdle:
+    case VulkanChunk::vkDeviceWaitIdle:
+    case VulkanChunk::vkGetFenceStatus:
+    case VulkanChunk::vkResetFences:
+    case VulkanChunk::vkWaitForFences:
+    case VulkanChunk::vkGetEventStatus:
+    case VulkanChunk::vkSetEvent:
+    case VulkanChunk::vkResetEvent:
+    case VulkanChunk::vkGetSemaphoreCounterValue:
+    case VulkanChunk::vkWaitSemaphores:
+    case VulkanChunk::vkSignalSemaphore:
+    case VulkanChunk::vkQueueBeginDebugUtilsLabelEXT:
+    case VulkanChunk::vkQueueEndDebugUtilsLabelEXT:
+    case VulkanChunk::vkQueueInsertDebugUtilsLabelEXT:
+    case VulkanChunk::vkDebugMarkerSetObjectNameEXT:
+    case VulkanChunk::vkSetDebugUtilsObjectNameEXT:
+    case VulkanChunk::vkQueuePresentKHR: break;
+    default:
+      if((uint32_t)chunk >= (uint32_t)SystemChunk::FirstDriverChunk)
+        m_CheckpointLimitOffset = RDCMIN(m_CheckpointLimitOffset, m_CurChunkOffset);
+      break;
+  }
+}
+
+void WrappedVulkan::FinaliseReplayCheckpointCandidates()
+{
+  // resuming after a submit skips recording any command buffers before it, so a submit is only a
+  // candidate if every command buffer recorded before it has been submitted for the last time.
+  rdcarray<rdcpair<uint32_t, uint32_t>> recordings;
+
+  for(int p = 0; p < ePartialNum; p++)
+  {
+    for(auto it = m_Partial[p].cmdBufferSubmits.begin(); it != m_Partial[p].cmdBufferSubmits.end();
+        ++it)
+    {
+      const BakedCmdBufferInfo &cmdInfo = m_BakedCmdBufferInfo[it->first];
+
+      uint32_t lastEvent = 0;
+      for(const Submission &sub : it->second)
+      {
+        // secondary command buffers only have absolute events once they've been executed
+        if(p == Primary || sub.rebased)
+          lastEvent = RDCMAX(lastEvent, sub.baseEvent + cmdInfo.eventCount);
+      }
+
+      recordings.push_back({cmdInfo.beginChunk, lastEvent});
+    }
+  }
+
+  std::sort(recordings.begin(), recordings.end());
+
+  rdcarray<ReplayCheckpointCandidate> valid;
+
+  size_t r = 0;
+  uint32_t lastSubmitted = 0;
+  for(const ReplayCheckpointCandidate &candidate : m_CheckpointCandidates)
+  {
+    if(candidate.resumeOffset > m_CheckpointLimitOffset)
+      break;
+
+    while(r < recordings.size() && recordings[r].first < candidate.chunkIndex)
+      lastSubmitted = RDCMAX(lastSubmitted, recordings[r++].second);
+
+    if(lastSubmitted < candidate.eventId)
+      valid.push_back(candidate);
+  }
+
+  RDCDEBUG("%zu of %zu queue submits can be replay checkpoints", valid.size(),
+           m_CheckpointCandidates.size());
+
+  m_CheckpointCandidates.swap(valid);
+}
+
+void WrappedVulkan::DisableReplayCheckpoints(const char *reason)
+{
+  if(Vulkan_ReplayCheckpointInterval() != 0 && !m_CheckpointsUnsupported)
+    RDCWARN("Replay checkpoints are disabled, capture uses %s which can write resources untracked",
+            reason);
+
+  m_CheckpointsUnsupported = true;
+}
+
+void WrappedVulkan::CreateReplayCheckpoint(uint64_t resumeOffset)
+{
+  const uint32_t interval = Vulkan_ReplayCheckpointInterval();
+
+  // action callbacks may modify what's replayed, so don't store anything from them
+  if(interval == 0 || m_ActionCallback || m_CheckpointsUnsupported)
+    return;
+
+  auto candIt = std::lower_bound(
+      m_CheckpointCandidates.begin(), m_CheckpointCandidates.end(), resumeOffset,
+      [](const ReplayCheckpointCandidate &c, uint64_t offs) { return c.resumeOffset < offs; });
+
+  if(candIt == m_CheckpointCandidates.end() || candIt->resumeOffset != resumeOffset ||
+     candIt->failed)
+    return;
+
+  ReplayCheckpointCandidate &candidate = *candIt;
+
+  // only take checkpoints the replay is going to continue past, so the submit has been executed in
+  // full rather than as a partial command buffer
+  if(candidate.eventId > m_LastEventID)
+    return;
+
+  size_t insertIdx = 0;
+  while(insertIdx < m_Checkpoints.size() && m_Checkpoints[insertIdx]->eventId <= candidate.eventId)
+    insertIdx++;
+
+  ReplayCheckpoint *prev = insertIdx > 0 ? m_Checkpoints[insertIdx - 1] : NULL;
+
+  if(prev && prev->eventId == candidate.eventId)
+    return;
+
+  const uint32_t prevEID = prev ? prev->eventId : 0;
+
+  if(candidate.eventId - prevEID < interval)
+    return;
+
+  // find everything written since the previous checkpoint
+  std::set<ResourceId> writtenMemory, writtenImages;
+
+  for(auto it = m_ResourceUses.begin(); it != m_ResourceUses.end(); ++it)
+  {
+    bool written = false;
+    for(const EventUsage &u : it->second)
+    {
+      if(u.eventId >= prevEID && u.eventId < candidate.eventId && IsCheckpointWriteUsage(u.usage))
+      {
+        written = true;
+        break;
+      }
+    }
+
+    if(!written)
+      continue;
+
+    const ResourceId id = it->first;
+
+    if(m_CreationInfo.m_Image.find(id) != m_CreationInfo.m_Image.end())
+    {
+      writtenImages.insert(id);
+    }
+    else if(m_CreationInfo.m_Buffer.find(id) != m_CreationInfo.m_Buffer.end())
+    {
+      // buffer contents are stored with the memory they're bound to
+      bool bound = false;
+      for(ResourceId parent : GetResourceDesc(GetResourceManager()->GetOriginalID(id)).parentResources)
+      {
+        if(!GetResourceManager()->HasLiveResource(parent))
+          continue;
+
+        ResourceId mem = GetResourceManager()->GetLiveID(parent);
+        if(m_CreationInfo.m_Memory.find(mem) != m_CreationInfo.m_Memory.end())
+        {
+          writtenMemory.insert(mem);
+          bound = true;
+        }
+      }
+
+      if(!bound)
+      {
+        RDCDEBUG("Can't checkpoint at %u, buffer %s has no memory", candidate.eventId,
+                 ToStr(id).c_str());
+        candidate.failed = true;
+        return;
+      }
+    }
+    else if(m_CreationInfo.m_Memory.find(id) != m_CreationInfo.m_Memory.end())
+    {
+      writtenMemory.insert(id);
+    }
+  }
+
+  VkDevice d = GetDev();
+  VkResult vkr = VK_SUCCESS;
+
+  ReplayCheckpoint *checkpoint = new ReplayCheckpoint;
+  checkpoint->eventId = candidate.eventId;
+  checkpoint->resumeOffset = candidate.resumeOffset;
+  checkpoint->lastUse = ++m_CheckpointUseCounter;
+
+  for(auto it = m_ImageStates.begin(); it != m_ImageStates.end(); ++it)
+  {
+    LockedConstImageStateRef state = it->second.LockRead();
+    if(ImageStateChanged(*state))
+      checkpoint->imageStates[it->first] = *state;
+  }
+
+  // share contents with the previous checkpoint for anything that hasn't been written since
+  if(prev)
+  {
+    for(ReplayCheckpointContents *contents : prev->contents)
+    {
+      if(writtenMemory.find(contents->id) == writtenMemory.end() &&
+         writtenImages.find(contents->id) == writtenImages.end())
+      {
+        contents->refCount++;
+        checkpoint->contents.push_back(contents);
+      }
+    }
+  }
+
+  rdcarray<ReplayCheckpointContents *> newContents;
+  rdcarray<VkDeviceSize> offsets;
+  VkDeviceSize blockSize = 0;
+  uint32_t memoryTypeBits = ~0U;
+  bool success = true;
+
+  auto addContents = [&](ResourceId id, bool image, VkDeviceSize size) {
+    VkBufferCreateInfo bufInfo = {
+        VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        NULL,
+        0,
+        size,
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+    };
+
+    VkBuffer buf = VK_NULL_HANDLE;
+    vkr = ObjDisp(d)->CreateBuffer(Unwrap(d), &bufInfo, NULL, &buf);
+    CheckVkResult(vkr);
+
+    if(vkr != VK_SUCCESS)
+    {
+      success = false;
+      return;
+    }
+
+    GetResourceManager()->WrapResource(Unwrap(d), buf);
+
+    VkMemoryRequirements mrq = {};
+    ObjDisp(d)->GetBufferMemoryRequirements(Unwrap(d), Unwrap(buf), &mrq);
+
+    blockSize = AlignUp(blockSize, mrq.alignment);
+    offsets.push_back(blockSize);
+    blockSize += mrq.size;
+    memoryTypeBits &= mrq.memoryTypeBits;
+
+    ReplayCheckpointContents *contents = new ReplayCheckpointContents;
+    contents->id = id;
+    contents->image = image;
+    contents->buf = buf;
+    contents->size = size;
+    contents->block = NULL;
+    contents->refCount = 1;
+    newContents.push_back(contents);
+  };
+
+  for(ResourceId id : writtenMemory)
+  {
+    const VulkanCreationInfo::Memory &memInfo = m_CreationInfo.m_Memory[id];
+
+    if(memInfo.wholeMemBuf == VK_NULL_HANDLE)
+    {
+      RDCDEBUG("Can't checkpoint at %u, memory %s has no whole memory buffer", candidate.eventId,
+               ToStr(id).c_str());
+      candidate.failed = true;
+      success = false;
+      break;
+    }
+
+    addContents(id, false, memInfo.wholeMemBufSize);
+
+    if(!success)
+      break;
+  }
+
+  for(auto it = writtenImages.begin(); success && it != writtenImages.end(); ++it)
+  {
+    LockedConstImageStateRef state = FindConstImageState(*it);
+
+    // images with no memory bound have no contents
+    if(!state || !state->isMemoryBound)
+      continue;
+
+    rdcarray<VkBufferImageCopy> copies;
+    VkDeviceSize size = GetCheckpointImageCopies(state->GetImageInfo(), copies);
+
+    if(size == 0)
+    {
+      RDCDEBUG("Can't checkpoint at %u, image %s can't be copied to a buffer", candidate.eventId,
+               ToStr(*it).c_str());
+      candidate.failed = true;
+      success = false;
+      break;
+    }
+
+    addContents(*it, true, size);
+  }
+
+  const uint64_t budget = uint64_t(Vulkan_ReplayCheckpointMemoryMB()) * 1024 * 1024;
+
+  if(success && blockSize > budget)
+  {
+    RDCDEBUG("Can't checkpoint at %u, %llu bytes is over the budget", candidate.eventId,
+             blockSize);
+    candidate.failed = true;
+    success = false;
+  }
+
+  // make space for the new contents, least recently used first. The previous checkpoint may be
+  // evicted too, what we share with it stays alive.
+  while(success && m_CheckpointMemory + blockSize > budget && !m_Checkpoints.empty())
+  {
+    size_t lru = 0;
+    for(size_t i = 1; i < m_Checkpoints.size(); i++)
+      if(m_Checkpoints[i]->lastUse < m_Checkpoints[lru]->lastUse)
+        lru = i;
+
+    EvictReplayCheckpoint(lru);
+
+    if(lru < insertIdx)
+      insertIdx--;
+  }
+
+  if(success && m_CheckpointMemory + blockSize > budget)
+    success = false;
+
+  ReplayCheckpointBlock *block = NULL;
+
+  if(success && !newContents.empty())
+  {
+    VkMemoryAllocateInfo allocInfo = {
+        VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO, NULL, blockSize,
+        GetGPULocalMemoryIndex(memoryTypeBits),
+    };
+
+    VkDeviceMemory mem = VK_NULL_HANDLE;
+    vkr = ObjDisp(d)->AllocateMemory(Unwrap(d), &allocInfo, NULL, &mem);
+
+    if(vkr != VK_SUCCESS)
+    {
+      RDCWARN("Failed to allocate %llu bytes for replay checkpoint: %s", blockSize,
+              ToStr(vkr).c_str());
+      success = false;
+    }
+    else
+    {
+      GetResourceManager()->WrapResource(Unwrap(d), mem);
+
+      block = new ReplayCheckpointBlock;
+      block->mem = mem;
+      block->size = blockSize;
+      block->refCount = (int32_t)newContents.size();
+
+      m_CheckpointMemory += blockSize;
+
+      for(size_t i = 0; i < newContents.size(); i++)
+      {
+        newContents[i]->block = block;
+
+        vkr = ObjDisp(d)->BindBufferMemory(Unwrap(d), Unwrap(newContents[i]->buf), Unwrap(mem),
+                                           offsets[i]);
+        CheckVkResult(vkr);
+      }
+    }
+  }
+
+  if(!success)
+  {
+    for(ReplayCheckpointContents *contents : newContents)
+    {
+      ObjDisp(d)->DestroyBuffer(Unwrap(d), Unwrap(contents->buf), NULL);
+      GetResourceManager()->ReleaseWrappedResource(contents->buf);
+      delete contents;
+    }
+
+    for(ReplayCheckpointContents *contents : checkpoint->contents)
+      ReleaseReplayCheckpointContents(contents);
+
+    delete checkpoint;
+    return;
+  }
+
+  if(!newContents.empty())
+  {
+    // wait for the frame's own work on any queue before copying from it
+    ObjDisp(d)->DeviceWaitIdle(Unwrap(d));
+
+    VkCommandBuffer cmd = GetNextCmd();
+
+    VkCommandBufferBeginInfo beginInfo = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO, NULL,
+                                          VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT};
+
+    vkr = ObjDisp(d)->BeginCommandBuffer(Unwrap(cmd), &beginInfo);
+    CheckVkResult(vkr);
+
+    VkMemoryBarrier memBarrier = {
+        VK_STRUCTURE_TYPE_MEMORY_BARRIER, NULL, VK_ACCESS_ALL_WRITE_BITS,
+        VK_ACCESS_TRANSFER_READ_BIT,
+    };
+
+    DoPipelineBarrier(cmd, 1, &memBarrier);
+
+    for(ReplayCheckpointContents *contents : newContents)
+    {
+      if(contents->image)
+      {
+        LockedImageStateRef state = FindImageState(contents->id);
+
+        rdcarray<VkBufferImageCopy> copies;
+        GetCheckpointImageCopies(state->GetImageInfo(), copies);
+
+        ImageBarrierSequence setupBarriers, cleanupBarriers;
+        state->TempTransition(m_QueueFamilyIdx, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                              VK_ACCESS_TRANSFER_READ_BIT, setupBarriers, cleanupBarriers,
+                              GetImageTransitionInfo());
+        InlineSetupImageBarriers(cmd, setupBarriers);
+        m_setupImageBarriers.Merge(setupBarriers);
+
+        ObjDisp(d)->CmdCopyImageToBuffer(Unwrap(cmd), Unwrap(state->wrappedHandle),
+                                         VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                                         Unwrap(contents->buf), (uint32_t)copies.size(),
+                                         copies.data());
+
+        InlineCleanupImageBarriers(cmd, cleanupBarriers);
+        m_cleanupImageBarriers.Merge(cleanupBarriers);
+      }
+      else
+      {
+        VkBufferCopy region = {0, 0, contents->size};
+
+        ObjDisp(d)->CmdCopyBuffer(Unwrap(cmd),
+                                  Unwrap(m_CreationInfo.m_Memory[contents->id].wholeMemBuf),
+                                  Unwrap(contents->buf), 1, &region);
+      }
+    }
+
+    vkr = ObjDisp(d)->EndCommandBuffer(Unwrap(cmd));
+    CheckVkResult(vkr);
+
+    SubmitAndFlushImageStateBarriers(m_setupImageBarriers);
+    SubmitCmds();
+    FlushQ();
+    SubmitAndFlushImageStateBarriers(m_cleanupImageBarriers);
+  }
+
+  checkpoint->contents.append(newContents);
+
+  RDCDEBUG("Created replay checkpoint at %u with %zu resources (%zu new, %llu bytes)",
+           checkpoint->eventId, checkpoint->contents.size(), newContents.size(), blockSize);
+
+  m_Checkpoints.insert(insertIdx, checkpoint);
+}
+
+WrappedVulkan::ReplayCheckpoint *WrappedVulkan::FindReplayCheckpoint(uint32_t endEventID)
+{
+  if(Vulkan_ReplayCheckpointInterval() == 0 || m_ActionCallback || m_CheckpointsUnsupported)
+    return NULL;
+
+  ReplayCheckpoint *ret = NULL;
+
+  for(ReplayCheckpoint *checkpoint : m_Checkpoints)
+  {
+    if(checkpoint->eventId > endEventID)
+      break;
+
+    ret = checkpoint;
+  }
+
+  if(ret)
+    ret->lastUse = ++m_CheckpointUseCounter;
+
+  return ret;
+}
+
+bool WrappedVulkan::RestoreReplayCheckpoint(ReadSerialiser &ser, const ReplayCheckpoint &checkpoint)
+{
+  // replay the chunks that checkpoints don't store
+  for(uint64_t offs : m_CheckpointReplayChunks)
+  {
+    if(offs >= checkpoint.resumeOffset)
+      break;
+
+    ser.GetReader()->SetOffset(offs);
+
+    m_CurChunkOffset = offs;
+    m_LastCmdBufferID = ResourceId();
+
+    VulkanChunk chunktype = ser.ReadChunk<VulkanChunk>();
+
+    bool success = ContextProcessChunk(ser, chunktype);
+
+    ser.EndChunk();
+
+    if(ser.GetReader()->IsErrored() || !success)
+      return false;
+  }
+
+  VkDevice d = GetDev();
+  VkResult vkr = VK_SUCCESS;
+
+  VkCommandBuffer cmd = GetNextCmd();
+
+  if(cmd == VK_NULL_HANDLE)
+    return false;
+
+  VkCommandBufferBeginInfo beginInfo = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO, NULL,
+                                        VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT};
+
+  vkr = ObjDisp(d)->BeginCommandBuffer(Unwrap(cmd), &beginInfo);
+  CheckVkResult(vkr);
+
+  VkMarkerRegion::Begin(StringFormat::Fmt("Restore replay checkpoint at %u", checkpoint.eventId),
+                        cmd);
+
+  // images whose contents are restored here go back to the state they were in at the start of the
+  // frame, unless the checkpoint has their state.
+  rdcflatmap<ResourceId, ImageState> finalStates = checkpoint.imageStates;
+
+  for(ReplayCheckpointContents *contents : checkpoint.contents)
+  {
+    if(contents->image)
+    {
+      LockedImageStateRef state = FindImageState(contents->id);
+      if(!state)
+        continue;
+
+      if(finalStates.find(contents->id) == finalStates.end())
+        finalStates[contents->id] = *state;
+
+      rdcarray<VkBufferImageCopy> copies;
+      GetCheckpointImageCopies(state->GetImageInfo(), copies);
+
+      ImageBarrierSequence setupBarriers;
+      state->DiscardContents();
+      state->Transition(m_QueueFamilyIdx, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0,
+                        VK_ACCESS_TRANSFER_WRITE_BIT, setupBarriers, GetImageTransitionInfo());
+      InlineSetupImageBarriers(cmd, setupBarriers);
+      m_setupImageBarriers.Merge(setupBarriers);
+
+      ObjDisp(d)->CmdCopyBufferToImage(Unwrap(cmd), Unwrap(contents->buf),
+                                       Unwrap(state->wrappedHandle),
+                                       VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                       (uint32_t)copies.size(), copies.data());
+    }
+    else
+    {
+      VkBufferCopy region = {0, 0, contents->size};
+
+      ObjDisp(d)->CmdCopyBuffer(Unwrap(cmd), Unwrap(contents->buf),
+                                Unwrap(m_CreationInfo.m_Memory[contents->id].wholeMemBuf), 1,
+                                &region);
+    }
+  }
+
+  VkMemoryBarrier memBarrier = {
+      VK_STRUCTURE_TYPE_MEMORY_BARRIER, NULL, VK_ACCESS_ALL_WRITE_BITS, VK_ACCESS_ALL_READ_BITS,
+  };
+
+  DoPipelineBarrier(cmd, 1, &memBarrier);
+
+  for(auto it = finalStates.begin(); it != finalStates.end(); ++it)
+  {
+    LockedImageStateRef state = FindImageState(it->first);
+    if(!state)
+      continue;
+
+    ImageBarrierSequence barriers;
+    state->Transition(it->second, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_ALL_READ_BITS, barriers,
+                      GetImageTransitionInfo());
+    InlineSetupImageBarriers(cmd, barriers);
+    m_cleanupImageBarriers.Merge(barriers);
+  }
+
+  VkMarkerRegion::End(cmd);
+
+  vkr = ObjDisp(d)->EndCommandBuffer(Unwrap(cmd));
+  CheckVkResult(vkr);
+
+  SubmitAndFlushImageStateBarriers(m_setupImageBarriers);
+  SubmitCmds();
+  FlushQ();
+  SubmitAndFlushImageStateBarriers(m_cleanupImageBarriers);
+
+  return true;
+}
+
+void WrappedVulkan::ReleaseReplayCheckpointContents(ReplayCheckpointContents *contents)
+{
+  if(--contents->refCount > 0)
+    return;
+
+  VkDevice d = GetDev();
+
+  ObjDisp(d)->DestroyBuffer(Unwrap(d), Unwrap(contents->buf), NULL);
+  GetResourceManager()->ReleaseWrappedResource(contents->buf);
+
+  ReplayCheckpointBlock *block = contents->block;
+
+  if(block && --block->refCount == 0)
+  {
+    ObjDisp(d)->FreeMemory(Unwrap(d), Unwrap(block->mem), NULL);
+    GetResourceManager()->ReleaseWrappedResource(block->mem);
+
+    m_CheckpointMemory -= block->size;
+
+    delete block;
+  }
+
+  delete contents;
+}
+
+void WrappedVulkan::EvictReplayCheckpoint(size_t idx)
+{
+  ReplayCheckpoint *checkpoint = m_Checkpoints[idx];
+
+  for(ReplayCheckpointContents *contents : checkpoint->contents)
+    ReleaseReplayCheckpointContents(contents);
+
+  delete checkpoint;
+
+  m_Checkpoints.erase(idx);
+}
+
+void WrappedVulkan::FreeReplayCheckpoints()
+{
+  while(!m_Checkpoints.empty())
+    EvictReplayCheckpoint(m_Checkpoints.size() - 1);
+}
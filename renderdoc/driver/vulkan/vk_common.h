@@ -768,6 +768,31 @@ DECLARE_REFLECTION_ENUM(VulkanChunk);
 
 SERIALISE_VK_HANDLES();
 
+// handles decode to the live resource, which stays the same across replays until a resource is
+// replaced, so they can be kept in a decoded chunk cache.
+#undef SERIALISE_HANDLE
+#define SERIALISE_HANDLE(type) DECLARE_DECODE_CACHEABLE(type)
+
+SERIALISE_VK_HANDLES();
+
+#undef SERIALISE_HANDLE
+#define SERIALISE_HANDLE(type) DECLARE_REFLECTION_STRUCT(type)
+
+// plain structs with no pointers or handles that commonly appear in commands
+DECLARE_DECODE_CACHEABLE(VkBufferCopy);
+DECLARE_DECODE_CACHEABLE(VkBufferImageCopy);
+DECLARE_DECODE_CACHEABLE(VkClearAttachment);
+DECLARE_DECODE_CACHEABLE(VkClearColorValue);
+DECLARE_DECODE_CACHEABLE(VkClearDepthStencilValue);
+DECLARE_DECODE_CACHEABLE(VkClearRect);
+DECLARE_DECODE_CACHEABLE(VkClearValue);
+DECLARE_DECODE_CACHEABLE(VkImageBlit);
+DECLARE_DECODE_CACHEABLE(VkImageCopy);
+DECLARE_DECODE_CACHEABLE(VkImageResolve);
+DECLARE_DECODE_CACHEABLE(VkImageSubresourceRange);
+DECLARE_DECODE_CACHEABLE(VkRect2D);
+DECLARE_DECODE_CACHEABLE(VkViewport);
+
 // declare reflect-able types
 
 // pNext structs - always have deserialise for the next chain
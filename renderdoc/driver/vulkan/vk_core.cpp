@@ -38,6 +38,13 @@
 #include "stb/stb_image_write.h"
 
 RDOC_EXTERN_CONFIG(bool, Vulkan_Debug_VerboseCommandRecording);
+RDOC_EXTERN_CONFIG(uint32_t, Capture_BlobThreshold);
+
+RDOC_CONFIG(bool, Vulkan_DecodedChunkCache, false,
+            "Keep the decoded parameters of the frame's chunks after replaying them, so that "
+            "replaying the frame again doesn't need to decode them again.");
+RDOC_CONFIG(uint32_t, Vulkan_DecodedChunkCacheMB, 256,
+            "The memory budget for Vulkan_DecodedChunkCache, in megabytes.");
 
 uint64_t VkInitParams::GetSerialiseSize()
 {
@@ -116,6 +123,8 @@ WrappedVulkan::WrappedVulkan()
 
   m_SectionVersion = VkInitParams::CurrentVersion;
 
+  m_IncrementalContents = new RDCIncrementalContents;
+
   rdcspv::Init();
   RenderDoc::Inst().RegisterShutdownFunction(&rdcspv::Shutdown);
 
@@ -170,6 +179,9 @@ WrappedVulkan::WrappedVulkan()
 
 WrappedVulkan::~WrappedVulkan()
 {
+  // no job can still be using the resource manager or initial contents once we're gone
+  FinishAsyncInitialStates(false);
+
   // records must be deleted before resource manager shutdown
   if(m_FrameCaptureRecord)
   {
@@ -190,6 +202,8 @@ WrappedVulkan::~WrappedVulkan()
   SAFE_DELETE(m_ResourceManager);
 
   SAFE_DELETE(m_FrameReader);
+  SAFE_DELETE(m_Blobs);
+  SAFE_DELETE(m_IncrementalContents);
 
   for(size_t i = 0; i < m_ThreadSerialisers.size(); i++)
     delete m_ThreadSerialisers[i];
@@ -240,7 +254,8 @@ void WrappedVulkan::CloseInitStateCmd()
   if(initStateCurCmd == VK_NULL_HANDLE)
     return;
 
-  VkMarkerRegion::End(initStateCurCmd);
+  if(IsReplayMode(m_State))
+    VkMarkerRegion::End(initStateCurCmd);
 
   VkResult vkr = ObjDisp(initStateCurCmd)->EndCommandBuffer(Unwrap(initStateCurCmd));
   CheckVkResult(vkr);
@@ -249,6 +264,26 @@ void WrappedVulkan::CloseInitStateCmd()
   initStateCurBatch = 0;
 }
 
+void WrappedVulkan::FlushInitStateBatch()
+{
+  CloseInitStateCmd();
+
+  SubmitAndFlushImageStateBarriers(m_setupImageBarriers);
+  SubmitCmds();
+  FlushQ();
+  SubmitAndFlushImageStateBarriers(m_cleanupImageBarriers);
+
+  VkDevice d = GetDev();
+
+  for(VkBuffer buf : m_InitStateBatchBuffers)
+  {
+    ObjDisp(d)->DestroyBuffer(Unwrap(d), Unwrap(buf), NULL);
+    GetResourceManager()->ReleaseWrappedResource(buf);
+  }
+
+  m_InitStateBatchBuffers.clear();
+}
+
 VkCommandBuffer WrappedVulkan::GetNextCmd()
 {
   VkCommandBuffer ret;
@@ -760,6 +795,7 @@ WriteSerialiser &WrappedVulkan::GetThreadSerialiser()
   ser->SetChunkMetadataRecording(flags);
   ser->SetUserData(GetResourceManager());
   ser->SetVersion(VkInitParams::CurrentVersion);
+  ser->SetBlobThreshold(Capture_BlobThreshold());
 
   Threading::SetTLSValue(threadSerialiserTLSSlot, (void *)ser);
 
@@ -1772,6 +1808,8 @@ void WrappedVulkan::StartFrameCapture(void *dev, void *wnd)
 
   m_SubmitCounter = 0;
 
+  m_DescriptorSetRefsCapture++;
+
   FrameDescription frame;
   frame.frameNumber = ~0U;
   frame.captureTime = Timing::GetUnixTimestamp();
@@ -1817,11 +1855,16 @@ void WrappedVulkan::StartFrameCapture(void *dev, void *wnd)
       CheckVkResult(vkr);
     }
 
+    // the readback copies are all submitted together once every resource has been prepared,
+    // rather than waiting on the GPU for each one in turn
+    m_PrepareInitStateBatch = true;
     GetResourceManager()->PrepareInitialContents();
-    SubmitAndFlushImageStateBarriers(m_setupImageBarriers);
-    SubmitCmds();
-    FlushQ();
-    SubmitAndFlushImageStateBarriers(m_cleanupImageBarriers);
+    m_PrepareInitStateBatch = false;
+
+    FlushInitStateBatch();
+
+    // the readbacks have finished, so they can be serialised while the frame is being captured
+    SerialiseInitialStatesAsync();
 
     {
       SCOPED_LOCK(m_CapDescriptorsLock);
@@ -1948,6 +1991,9 @@ bool WrappedVulkan::EndFrameCapture(void *dev, void *wnd)
         FreeAlignedBuffer((*it)->memMapState->refData);
         (*it)->memMapState->refData = NULL;
         (*it)->memMapState->needRefData = false;
+
+        MemoryTracking::Untrack((*it)->memMapState->writeTracking);
+        (*it)->memMapState->writeTracking = NULL;
       }
     }
 
@@ -2158,14 +2204,17 @@ bool WrappedVulkan::EndFrameCapture(void *dev, void *wnd)
   RDCFile *rdc =
       RenderDoc::Inst().CreateRDC(RDCDriver::Vulkan, m_CapturedFrames.back().frameNumber, fp);
 
+  const rdcstr captureFilename = RenderDoc::Inst().GetCurrentLogFile();
+
   StreamWriter *captureWriter = NULL;
 
   if(rdc)
   {
     SectionProperties props;
 
-    // Compress with LZ4 so that it's fast
-    props.flags = SectionFlags::LZ4Compressed;
+    // Compress with LZ4 so that it's fast, in independent blocks so that it can be decompressed
+    // in parallel when loading
+    props.flags = SectionFlags::LZ4Compressed | SectionFlags::Seekable;
     props.version = m_SectionVersion;
     props.type = SectionType::FrameCapture;
 
@@ -2178,11 +2227,17 @@ bool WrappedVulkan::EndFrameCapture(void *dev, void *wnd)
 
   uint64_t captureSectionSize = 0;
 
+  // large buffers in the frame capture, each stored once after it
+  RDCBlobStore blobs;
+
   {
     WriteSerialiser ser(captureWriter, Ownership::Stream);
 
     ser.SetChunkMetadataRecording(GetThreadSerialiser().GetChunkMetadataRecording());
 
+    ser.SetBlobThreshold(Capture_BlobThreshold());
+    ser.SetBlobStore(&blobs);
+
     ser.SetUserData(GetResourceManager());
 
     {
@@ -2195,6 +2250,8 @@ bool WrappedVulkan::EndFrameCapture(void *dev, void *wnd)
 
     GetResourceManager()->InsertReferencedChunks(ser);
 
+    FinishAsyncInitialStates(true);
+
     GetResourceManager()->InsertInitialContentsChunks(ser);
 
     RDCDEBUG("Creating Capture Scope");
@@ -2275,6 +2332,16 @@ bool WrappedVulkan::EndFrameCapture(void *dev, void *wnd)
   RDCLOG("Captured Vulkan frame with %f MB capture section in %f seconds",
          double(captureSectionSize) / (1024.0 * 1024.0), m_CaptureTimer.GetMilliseconds() / 1000.0);
 
+  if(rdc)
+  {
+    blobs.Write(*rdc);
+    m_IncrementalContents->EndCapture(*rdc, captureFilename);
+  }
+  else
+  {
+    m_IncrementalContents->DiscardCapture();
+  }
+
   RenderDoc::Inst().FinishCaptureWriting(rdc, m_CapturedFrames.back().frameNumber);
 
   m_HeaderChunk->Delete();
@@ -2312,6 +2379,10 @@ bool WrappedVulkan::DiscardFrameCapture(void *dev, void *wnd)
 
   RDCLOG("Discarding frame capture.");
 
+  FinishAsyncInitialStates(false);
+
+  m_IncrementalContents->DiscardCapture();
+
   RenderDoc::Inst().FinishCaptureWriting(NULL, m_CapturedFrames.back().frameNumber);
 
   m_CapturedFrames.pop_back();
@@ -2333,6 +2404,9 @@ bool WrappedVulkan::DiscardFrameCapture(void *dev, void *wnd)
         FreeAlignedBuffer((*it)->memMapState->refData);
         (*it)->memMapState->refData = NULL;
         (*it)->memMapState->needRefData = false;
+
+        MemoryTracking::Untrack((*it)->memMapState->writeTracking);
+        (*it)->memMapState->writeTracking = NULL;
       }
     }
   }
@@ -2492,10 +2566,27 @@ ReplayStatus WrappedVulkan::ReadLogInitialisation(RDCFile *rdc, bool storeStruct
     return ReplayStatus::FileIOFailed;
   }
 
+  SAFE_DELETE(m_Blobs);
+  m_Blobs = new RDCBlobStore;
+  if(!m_Blobs->Read(*rdc))
+  {
+    delete reader;
+    return ReplayStatus::FileCorrupted;
+  }
+
+  SAFE_DELETE(m_IncrementalContents);
+  m_IncrementalContents = new RDCIncrementalContents;
+  if(!m_IncrementalContents->Read(*rdc, rdc->GetFilename()))
+  {
+    delete reader;
+    return ReplayStatus::FileCorrupted;
+  }
+
   ReadSerialiser ser(reader, Ownership::Stream);
 
   ser.SetStringDatabase(&m_StringDB);
   ser.SetUserData(GetResourceManager());
+  ser.SetBlobStore(m_Blobs);
 
   ser.ConfigureStructuredExport(&GetChunkName, storeStructuredBuffers, m_TimeBase, m_TimeFrequency);
 
@@ -2681,6 +2772,17 @@ ReplayStatus WrappedVulkan::ContextReplayLog(CaptureState readType, uint32_t sta
   ser.SetStringDatabase(&m_StringDB);
   ser.SetUserData(GetResourceManager());
   ser.SetVersion(m_SectionVersion);
+  ser.SetBlobStore(m_Blobs);
+
+  if(IsActiveReplaying(m_State) && Vulkan_DecodedChunkCache())
+  {
+    m_DecodedChunks.SetBudget(uint64_t(Vulkan_DecodedChunkCacheMB()) * 1024 * 1024);
+    ser.SetDecodedChunkCache(&m_DecodedChunks);
+  }
+  else
+  {
+    m_DecodedChunks.Clear();
+  }
 
   SDFile *prevFile = m_StructuredFile;
 
@@ -2757,6 +2859,17 @@ ReplayStatus WrappedVulkan::ContextReplayLog(CaptureState readType, uint32_t sta
     // that we ended up selecting (the one that was closest)
     if(startEventID == endEventID && m_RootEventID != m_FirstEventID)
       m_FirstEventID = m_LastEventID = m_RootEventID;
+
+    // skip ahead to the closest checkpoint instead of replaying from the start of the frame
+    ReplayCheckpoint *checkpoint = partial ? NULL : FindReplayCheckpoint(endEventID);
+    if(checkpoint)
+    {
+      if(!RestoreReplayCheckpoint(ser, *checkpoint))
+        return ReplayStatus::APIReplayFailed;
+
+      ser.GetReader()->SetOffset(checkpoint->resumeOffset);
+      m_RootEventID = checkpoint->eventId;
+    }
   }
   else
   {
@@ -2835,8 +2948,16 @@ ReplayStatus WrappedVulkan::ContextReplayLog(CaptureState readType, uint32_t sta
          chunktype != VulkanChunk::vkEndCommandBuffer)
         m_BakedCmdBufferInfo[m_LastCmdBufferID].curEventID++;
     }
+
+    if(IsLoading(m_State))
+      TrackReplayCheckpointChunk(chunktype, ser.GetReader()->GetOffset());
+    else if(IsActiveReplaying(m_State) && !partial && m_LastCmdBufferID == ResourceId())
+      CreateReplayCheckpoint(ser.GetReader()->GetOffset());
   }
 
+  if(IsLoading(m_State))
+    FinaliseReplayCheckpointCandidates();
+
   if(!partial && !IsStructuredExporting(m_State))
     AddFrameTerminator(AMDRGPControl::GetEndTag());
 
@@ -24,6 +24,7 @@
 
 #pragma once
 
+#include "common/call_stats.h"
 #include "common/timing.h"
 #include "serialise/serialiser.h"
 #include "vk_common.h"
@@ -31,6 +32,7 @@
 #include "vk_manager.h"
 #include "vk_state.h"
 
+class RDCIncrementalContents;
 class VulkanShaderCache;
 class VulkanDebugManager;
 class VulkanResourceManager;
@@ -53,7 +55,7 @@ struct VkInitParams
   uint64_t GetSerialiseSize();
 
   // check if a frame capture section version is supported
-  static const uint64_t CurrentVersion = 0x13;
+  static const uint64_t CurrentVersion = 0x14;
   static bool IsSupportedVersion(uint64_t ver);
 };
 
@@ -191,6 +193,7 @@ struct VulkanActionTreeNode
     ser.ChunkMetadata().timestampMicro = Timing::GetTick();                                     \
     __VA_ARGS__;                                                                                \
     ser.ChunkMetadata().durationMicro = Timing::GetTick() - ser.ChunkMetadata().timestampMicro; \
+    CallStats::AddDriverTicks(ser.ChunkMetadata().durationMicro);                               \
   }
 
 // must be at the start of any function that serialises
@@ -323,12 +326,24 @@ private:
   uint64_t m_SectionVersion;
 
   StreamReader *m_FrameReader = NULL;
+  // large buffers referenced from the frame capture, see Serialiser::SetBlobThreshold
+  RDCBlobStore *m_Blobs = NULL;
+  // initial contents stored incrementally. While capturing this persists from one capture to the
+  // next, on replay it's read from the capture.
+  RDCIncrementalContents *m_IncrementalContents = NULL;
+  // decoded frame chunks kept between replays, see Vulkan_DecodedChunkCache
+  DecodedChunkCache m_DecodedChunks;
 
   std::set<rdcstr> m_StringDB;
 
   Threading::CriticalSection m_CapDescriptorsLock;
   std::set<VkDescriptorSet> m_CapDescriptors;
 
+  // protects each set's DescriptorSetRefs while submits gather and merge them. The capture counter
+  // is incremented for each frame capture, so that sets are only merged once per capture.
+  Threading::CriticalSection m_DescriptorSetRefsLock;
+  uint32_t m_DescriptorSetRefsCapture = 0;
+
   VkResourceRecord *m_FrameCaptureRecord;
   Chunk *m_HeaderChunk;
 
@@ -540,6 +555,24 @@ private:
   int initStateCurBatch = 0;
   VkCommandBuffer initStateCurCmd = VK_NULL_HANDLE;
 
+  // while preparing initial contents at capture start, readback copies are recorded into the
+  // batched init state command buffers and submitted together in FlushInitStateBatch. The
+  // temporary buffers they copy through are destroyed once that's done.
+  bool m_PrepareInitStateBatch = false;
+  rdcarray<VkBuffer> m_InitStateBatchBuffers;
+
+  // the resources read back at capture start, which are serialised to chunks on worker threads
+  // while the frame is captured. See SerialiseInitialStatesAsync
+  struct AsyncInitialState
+  {
+    ResourceId id;
+    VkInitialContents initial;
+    Chunk *chunk;
+  };
+  rdcarray<ResourceId> m_InitStateReadbacks;
+  rdcarray<AsyncInitialState> m_AsyncInitialStates;
+  rdcarray<Threading::Jobs::Job> m_AsyncInitialStateJobs;
+
   // Internal lumped/pooled memory allocations
 
   // Each memory scope gets a separate vector of allocation objects. The vector contains the list of
@@ -718,6 +751,70 @@ private:
   // All IDs are original IDs, not live.
   VulkanRenderState m_RenderState;
 
+  // replay checkpoints let a full replay start part-way through the frame. At queue submits that
+  // are safe to resume after, the contents of every resource written since the previous checkpoint
+  // are copied on the GPU. Contents that weren't written again are shared with the previous
+  // checkpoint, so each checkpoint is complete on its own and any of them can be evicted.
+  struct ReplayCheckpointBlock
+  {
+    VkDeviceMemory mem;
+    VkDeviceSize size;
+    int32_t refCount;
+  };
+
+  struct ReplayCheckpointContents
+  {
+    // live ID of the image or device memory
+    ResourceId id;
+    bool image;
+    VkBuffer buf;
+    VkDeviceSize size;
+    ReplayCheckpointBlock *block;
+    int32_t refCount;
+  };
+
+  struct ReplayCheckpoint
+  {
+    // the root event that replaying resumes at, and the offset of its chunk
+    uint32_t eventId;
+    uint64_t resumeOffset;
+    uint64_t lastUse;
+    rdcarray<ReplayCheckpointContents *> contents;
+    // the state of any image whose layout differs from the start of the frame
+    rdcflatmap<ResourceId, ImageState> imageStates;
+  };
+
+  // queue submits found while loading that a checkpoint could be taken after
+  struct ReplayCheckpointCandidate
+  {
+    uint32_t eventId;
+    uint32_t chunkIndex;
+    uint64_t resumeOffset;
+    bool failed;
+  };
+
+  rdcarray<ReplayCheckpointCandidate> m_CheckpointCandidates;
+  // offsets of root chunks that checkpoints don't store the effects of, like descriptor updates.
+  // These are cheap so they're replayed again when resuming from a checkpoint
+  rdcarray<uint64_t> m_CheckpointReplayChunks;
+  // checkpoints can't be resumed after the first root chunk we don't know how to skip
+  uint64_t m_CheckpointLimitOffset = ~0ULL;
+  // sorted by event ID
+  rdcarray<ReplayCheckpoint *> m_Checkpoints;
+  uint64_t m_CheckpointMemory = 0;
+  uint64_t m_CheckpointUseCounter = 0;
+  // set when the capture uses features that can write resources without it showing in their usage
+  bool m_CheckpointsUnsupported = false;
+
+  void DisableReplayCheckpoints(const char *reason);
+  void TrackReplayCheckpointChunk(VulkanChunk chunk, uint64_t nextOffset);
+  void FinaliseReplayCheckpointCandidates();
+  void CreateReplayCheckpoint(uint64_t resumeOffset);
+  ReplayCheckpoint *FindReplayCheckpoint(uint32_t endEventID);
+  bool RestoreReplayCheckpoint(ReadSerialiser &ser, const ReplayCheckpoint &checkpoint);
+  void EvictReplayCheckpoint(size_t idx);
+  void ReleaseReplayCheckpointContents(ReplayCheckpointContents *contents);
+
   bool InRerecordRange(ResourceId cmdid);
   bool HasRerecordCmdBuf(ResourceId cmdid);
   bool ShouldUpdateRenderState(ResourceId cmdid, bool forcePrimary = false);
@@ -1097,6 +1194,11 @@ public:
   VkCommandBuffer GetNextCmd();
   VkCommandBuffer GetInitStateCmd();
   void CloseInitStateCmd();
+  void FlushInitStateBatch();
+  void SerialiseInitialStatesAsync();
+  void FinishAsyncInitialStates(bool keep);
+  void FreeReplayCheckpoints();
+  void ClearDecodedChunkCache() { m_DecodedChunks.Clear(); }
   void RemovePendingCommandBuffer(VkCommandBuffer cmd);
   void AddPendingCommandBuffer(VkCommandBuffer cmd);
   void AddFreeCommandBuffer(VkCommandBuffer cmd);
@@ -0,0 +1,412 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#include <map>
+#include <set>
+#include "vk_debug.h"
+#include "vk_replay.h"
+
+/*
+ * Batched resource data fetching.
+ *
+ * Fetching resource contents at many events the simple way means seeking to each event in turn and
+ * reading back with a blocking submit, so the cost grows with the number of events times the
+ * length of the frame. Instead we replay the frame once with an action callback, and after each
+ * requested action we record copies of the requested resources into one shared readback buffer.
+ * Once the replay is finished and flushed all the results are read back together.
+ *
+ * Anything that can't be copied inline is left unfetched for the caller to fetch the slow way:
+ *  - memory objects, multisampled, YUV and combined depth-stencil images, which need more than a
+ *    plain copy.
+ *  - actions in secondary command buffers or in render passes with multiple subpasses, where we
+ *    can't stop and restart the pass.
+ *  - events that aren't actions, as we only get callbacks for actions.
+ *  - aliased events from command buffers submitted more than once, since the copy is only recorded
+ *    once.
+ */
+
+struct VulkanDataFetchCopy
+{
+  // the index of the request this copy fulfils
+  size_t request;
+  uint32_t eventId;
+
+  // unwrapped source, only one of these is set
+  VkBuffer srcBuffer;
+  VkImage srcImage;
+
+  // the wrapped image and subresource, to look up the image's layout at record time
+  ResourceId image;
+  VkImageAspectFlagBits aspect;
+  uint32_t mip;
+  uint32_t slice;
+
+  VkBufferCopy bufferRegion;
+  VkBufferImageCopy imageRegion;
+
+  VkDeviceSize readbackOffset;
+  VkDeviceSize size;
+};
+
+struct VulkanDataFetchCallback : public VulkanActionCallback
+{
+  VulkanDataFetchCallback(WrappedVulkan *vk, const rdcarray<VulkanDataFetchCopy> &copies,
+                          VkBuffer readback)
+      : m_pDriver(vk), m_Copies(copies), m_Readback(readback)
+  {
+    for(size_t i = 0; i < m_Copies.size(); i++)
+      m_EventCopies[m_Copies[i].eventId].push_back(i);
+
+    m_Recorded.resize(m_Copies.size());
+
+    m_pDriver->SetActionCB(this);
+  }
+  ~VulkanDataFetchCallback() { m_pDriver->SetActionCB(NULL); }
+  void PreDraw(uint32_t eid, VkCommandBuffer cmd) {}
+  bool PostDraw(uint32_t eid, VkCommandBuffer cmd)
+  {
+    RecordCopies(eid, cmd);
+    return false;
+  }
+  void PostRedraw(uint32_t eid, VkCommandBuffer cmd) {}
+  void PreDispatch(uint32_t eid, VkCommandBuffer cmd) {}
+  bool PostDispatch(uint32_t eid, VkCommandBuffer cmd)
+  {
+    RecordCopies(eid, cmd);
+    return false;
+  }
+  void PostRedispatch(uint32_t eid, VkCommandBuffer cmd) {}
+  void PreMisc(uint32_t eid, ActionFlags flags, VkCommandBuffer cmd) {}
+  bool PostMisc(uint32_t eid, ActionFlags flags, VkCommandBuffer cmd)
+  {
+    RecordCopies(eid, cmd);
+    return false;
+  }
+  void PostRemisc(uint32_t eid, ActionFlags flags, VkCommandBuffer cmd) {}
+  void PreEndCommandBuffer(VkCommandBuffer cmd) {}
+  void AliasEvent(uint32_t primary, uint32_t alias)
+  {
+    // the copies are only recorded once, so they would read the contents after whichever
+    // submission ran last. Leave both events to be fetched individually.
+    m_Aliased.insert(primary);
+    m_Aliased.insert(alias);
+  }
+  bool SplitSecondary() { return false; }
+  void PreCmdExecute(uint32_t baseEid, uint32_t secondaryFirst, uint32_t secondaryLast,
+                     VkCommandBuffer cmd)
+  {
+  }
+  void PostCmdExecute(uint32_t baseEid, uint32_t secondaryFirst, uint32_t secondaryLast,
+                      VkCommandBuffer cmd)
+  {
+  }
+
+  bool IsRecorded(size_t copy) const
+  {
+    return m_Recorded[copy] && m_Aliased.find(m_Copies[copy].eventId) == m_Aliased.end();
+  }
+
+private:
+  void RecordCopies(uint32_t eid, VkCommandBuffer cmd)
+  {
+    auto it = m_EventCopies.find(eid);
+    if(it == m_EventCopies.end() || !m_pDriver->IsCmdPrimary())
+      return;
+
+    VulkanRenderState &state = m_pDriver->GetCmdRenderState();
+
+    ResourceId rp = state.GetRenderPass();
+    if(rp != ResourceId() &&
+       m_pDriver->GetDebugManager()->GetRenderPassInfo(rp).subpasses.size() > 1)
+      return;
+
+    bool inPass = state.ActiveRenderPass();
+
+    if(inPass)
+    {
+      state.EndRenderPass(cmd);
+
+      // if dynamic rendering is in use and the renderpass just suspended, we need to be sure it is
+      // really finished. This will just store as we always patch the load/store ops.
+      state.FinishSuspendedRenderPass(cmd);
+    }
+
+    // make the action's writes available to the copies
+    VkMemoryBarrier memBarrier = {
+        VK_STRUCTURE_TYPE_MEMORY_BARRIER, NULL, VK_ACCESS_MEMORY_WRITE_BIT,
+        VK_ACCESS_TRANSFER_READ_BIT,
+    };
+    DoPipelineBarrier(cmd, 1, &memBarrier);
+
+    for(size_t c : it->second)
+    {
+      const VulkanDataFetchCopy &copy = m_Copies[c];
+
+      if(copy.srcBuffer != VK_NULL_HANDLE)
+      {
+        ObjDisp(cmd)->CmdCopyBuffer(Unwrap(cmd), copy.srcBuffer, m_Readback, 1,
+                                    &copy.bufferRegion);
+      }
+      else
+      {
+        VkImageLayout layout = m_pDriver->GetDebugManager()->GetImageLayout(
+            copy.image, copy.aspect, copy.mip, copy.slice);
+
+        VkImageMemoryBarrier barrier = {
+            VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            NULL,
+            VK_ACCESS_MEMORY_WRITE_BIT,
+            VK_ACCESS_TRANSFER_READ_BIT,
+            layout,
+            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            VK_QUEUE_FAMILY_IGNORED,
+            VK_QUEUE_FAMILY_IGNORED,
+            copy.srcImage,
+            {(VkImageAspectFlags)copy.aspect, copy.imageRegion.imageSubresource.mipLevel, 1,
+             copy.imageRegion.imageSubresource.baseArrayLayer, 1},
+        };
+        SanitiseOldImageLayout(barrier.oldLayout);
+
+        DoPipelineBarrier(cmd, 1, &barrier);
+
+        ObjDisp(cmd)->CmdCopyImageToBuffer(Unwrap(cmd), copy.srcImage,
+                                           VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, m_Readback, 1,
+                                           &copy.imageRegion);
+
+        // transition back to the layout the rest of the frame expects
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        barrier.newLayout = layout;
+        SanitiseNewImageLayout(barrier.newLayout);
+
+        DoPipelineBarrier(cmd, 1, &barrier);
+      }
+
+      m_Recorded[c] = true;
+    }
+
+    if(inPass)
+      state.BeginRenderPassAndApplyState(m_pDriver, cmd, VulkanRenderState::BindGraphics, true);
+  }
+
+  WrappedVulkan *m_pDriver;
+  const rdcarray<VulkanDataFetchCopy> &m_Copies;
+  VkBuffer m_Readback;
+
+  std::map<uint32_t, rdcarray<size_t>> m_EventCopies;
+  rdcarray<bool> m_Recorded;
+  std::set<uint32_t> m_Aliased;
+};
+
+void VulkanReplay::FetchResourceData(const rdcarray<ResourceDataRequest> &requests,
+                                     rdcarray<bytebuf> &results, rdcarray<bool> &fetched)
+{
+  results.clear();
+  results.resize(requests.size());
+  fetched.clear();
+  fetched.resize(requests.size());
+
+  rdcarray<VulkanDataFetchCopy> copies;
+  VkDeviceSize readbackSize = 0;
+
+  for(size_t i = 0; i < requests.size(); i++)
+  {
+    const ResourceDataRequest &req = requests[i];
+
+    WrappedVkRes *res = GetResourceManager()->GetCurrentResource(req.resourceId);
+
+    if(res == VK_NULL_HANDLE)
+      continue;
+
+    VulkanDataFetchCopy copy = {};
+    copy.request = i;
+    copy.eventId = req.eventId;
+
+    if(WrappedVkBuffer::IsAlloc(res))
+    {
+      uint64_t bufsize = m_pDriver->m_CreationInfo.m_Buffer[req.resourceId].size;
+
+      // same clamping as GetBufferData
+      if(req.byteOffset >= bufsize)
+        continue;
+
+      uint64_t len = req.byteSize;
+      if(len == 0 || len > bufsize)
+        len = bufsize;
+      len = RDCMIN(len, bufsize - req.byteOffset);
+
+      copy.srcBuffer = Unwrap(GetResourceManager()->GetCurrentHandle<VkBuffer>(req.resourceId));
+      copy.size = len;
+
+      readbackSize = AlignUp(readbackSize, (VkDeviceSize)16);
+
+      copy.bufferRegion.srcOffset = req.byteOffset;
+      copy.bufferRegion.dstOffset = readbackSize;
+      copy.bufferRegion.size = len;
+    }
+    else if(WrappedVkImage::IsAlloc(res))
+    {
+      auto it = m_pDriver->m_CreationInfo.m_Image.find(req.resourceId);
+      if(it == m_pDriver->m_CreationInfo.m_Image.end())
+        continue;
+
+      const VulkanCreationInfo::Image &imInfo = it->second;
+
+      VkImageAspectFlags aspects = FormatImageAspects(imInfo.format);
+
+      if(imInfo.samples > 1 || IsYUVFormat(imInfo.format) ||
+         ((aspects & VK_IMAGE_ASPECT_DEPTH_BIT) && (aspects & VK_IMAGE_ASPECT_STENCIL_BIT)))
+        continue;
+
+      {
+        LockedConstImageStateRef lockedImage = m_pDriver->FindConstImageState(req.resourceId);
+        if(!lockedImage || !lockedImage->isMemoryBound)
+          continue;
+      }
+
+      // mirror the subresource selection in GetTextureData
+      Subresource s = req.subresource;
+      s.slice = RDCMIN(uint32_t(imInfo.arrayLayers - 1), s.slice);
+      s.mip = RDCMIN(uint32_t(imInfo.mipLevels - 1), s.mip);
+
+      copy.srcImage = Unwrap(GetResourceManager()->GetCurrentHandle<VkImage>(req.resourceId));
+      copy.image = req.resourceId;
+      copy.aspect = (VkImageAspectFlagBits)aspects;
+      copy.mip = s.mip;
+      copy.slice = s.slice;
+      copy.size = GetByteSize(imInfo.extent.width, imInfo.extent.height, imInfo.extent.depth,
+                              imInfo.format, s.mip);
+
+      // buffer offsets for image copies must be a multiple of 4 and of the texel block size
+      VkDeviceSize align = 4 * GetByteSize(1, 1, 1, imInfo.format, 0);
+      readbackSize = ((readbackSize + align - 1) / align) * align;
+
+      copy.imageRegion.bufferOffset = readbackSize;
+      copy.imageRegion.imageSubresource = {
+          (VkImageAspectFlags)aspects, s.mip, imInfo.type == VK_IMAGE_TYPE_3D ? 0 : s.slice, 1,
+      };
+      copy.imageRegion.imageExtent.width = RDCMAX(1U, imInfo.extent.width >> s.mip);
+      copy.imageRegion.imageExtent.height = RDCMAX(1U, imInfo.extent.height >> s.mip);
+      copy.imageRegion.imageExtent.depth = RDCMAX(1U, imInfo.extent.depth >> s.mip);
+    }
+    else
+    {
+      continue;
+    }
+
+    copy.readbackOffset = readbackSize;
+    readbackSize += copy.size;
+
+    copies.push_back(copy);
+  }
+
+  if(copies.empty())
+    return;
+
+  VkDevice dev = m_pDriver->GetDev();
+  const VkDevDispatchTable *vt = ObjDisp(dev);
+
+  VkBufferCreateInfo bufInfo = {
+      VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+      NULL,
+      0,
+      readbackSize,
+      VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+  };
+
+  VkBuffer readbackBuf = VK_NULL_HANDLE;
+  VkResult vkr = vt->CreateBuffer(Unwrap(dev), &bufInfo, NULL, &readbackBuf);
+  CheckVkResult(vkr);
+
+  if(vkr != VK_SUCCESS)
+    return;
+
+  VkMemoryRequirements mrq = {0};
+
+  vt->GetBufferMemoryRequirements(Unwrap(dev), readbackBuf, &mrq);
+
+  VkMemoryAllocateInfo allocInfo = {
+      VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO, NULL, mrq.size,
+      m_pDriver->GetReadbackMemoryIndex(mrq.memoryTypeBits),
+  };
+
+  VkDeviceMemory readbackMem = VK_NULL_HANDLE;
+  vkr = vt->AllocateMemory(Unwrap(dev), &allocInfo, NULL, &readbackMem);
+  CheckVkResult(vkr);
+
+  if(vkr != VK_SUCCESS)
+  {
+    // too large to stage at once, everything falls back to individual fetches
+    vt->DestroyBuffer(Unwrap(dev), readbackBuf, NULL);
+    return;
+  }
+
+  vkr = vt->BindBufferMemory(Unwrap(dev), readbackBuf, readbackMem, 0);
+  CheckVkResult(vkr);
+
+  rdcarray<bool> recorded;
+  recorded.resize(copies.size());
+
+  {
+    VulkanDataFetchCallback cb(m_pDriver, copies, readbackBuf);
+
+    m_pDriver->ReplayLog(0, copies.back().eventId, eReplay_Full);
+    m_pDriver->SubmitCmds();
+    m_pDriver->FlushQ();
+
+    for(size_t i = 0; i < copies.size(); i++)
+      recorded[i] = cb.IsRecorded(i);
+  }
+
+  byte *pData = NULL;
+  vkr = vt->MapMemory(Unwrap(dev), readbackMem, 0, VK_WHOLE_SIZE, 0, (void **)&pData);
+  CheckVkResult(vkr);
+
+  if(vkr == VK_SUCCESS && pData)
+  {
+    VkMappedMemoryRange range = {
+        VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE, NULL, readbackMem, 0, VK_WHOLE_SIZE,
+    };
+
+    vkr = vt->InvalidateMappedMemoryRanges(Unwrap(dev), 1, &range);
+    CheckVkResult(vkr);
+
+    for(size_t i = 0; i < copies.size(); i++)
+    {
+      if(!recorded[i])
+        continue;
+
+      const VulkanDataFetchCopy &copy = copies[i];
+      bytebuf &data = results[copy.request];
+      data.assign(pData + copy.readbackOffset, (size_t)copy.size);
+      fetched[copy.request] = true;
+    }
+
+    vt->UnmapMemory(Unwrap(dev), readbackMem);
+  }
+
+  vt->DestroyBuffer(Unwrap(dev), readbackBuf, NULL);
+  vt->FreeMemory(Unwrap(dev), readbackMem, NULL);
+}
@@ -23,9 +23,17 @@
  ******************************************************************************/
 
 #include "core/settings.h"
+#include "serialise/rdcfile.h"
 #include "vk_core.h"
 #include "vk_debug.h"
 
+RDOC_CONFIG(uint32_t, Vulkan_AsyncInitialStatesMemoryLimitMB, 512,
+            "The memory in MB that initial contents may use when serialised on worker threads "
+            "while a frame is captured. Any past this limit are serialised when the capture ends, "
+            "as are all initial contents if this is 0.");
+RDOC_EXTERN_CONFIG(uint32_t, Capture_BlobThreshold);
+RDOC_EXTERN_CONFIG(bool, Capture_IncrementalInitialContents);
+
 // VKTODOLOW there's a lot of duplicated code in this file for creating a buffer to do
 // a memory copy and saving to disk.
 
@@ -112,8 +120,6 @@ bool WrappedVulkan::Prepare_InitialState(WrappedVkRes *res)
     }
 
     VkDevice d = GetDev();
-    // INITSTATEBATCH
-    VkCommandBuffer cmd = GetNextCmd();
 
     // must ensure offset remains valid. Must be multiple of block size, or 4, depending on format
     VkDeviceSize bufAlignment = 4;
@@ -264,8 +270,26 @@ bool WrappedVulkan::Prepare_InitialState(WrappedVkRes *res)
     VkCommandBufferBeginInfo beginInfo = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO, NULL,
                                           VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT};
 
-    vkr = ObjDisp(d)->BeginCommandBuffer(Unwrap(cmd), &beginInfo);
-    CheckVkResult(vkr);
+    // multisampled images are converted with a separate submit that's waited on, so they can't be
+    // batched and anything batched so far has to go first.
+    const bool batched = m_PrepareInitStateBatch && arrayIm == VK_NULL_HANDLE;
+
+    VkCommandBuffer cmd;
+
+    if(batched)
+    {
+      cmd = GetInitStateCmd();
+    }
+    else
+    {
+      if(!m_InitStateBatchBuffers.empty())
+        FlushInitStateBatch();
+
+      cmd = GetNextCmd();
+
+      vkr = ObjDisp(d)->BeginCommandBuffer(Unwrap(cmd), &beginInfo);
+      CheckVkResult(vkr);
+    }
 
     VkImageAspectFlags aspectFlags = FormatImageAspects(imageInfo.format);
 
@@ -411,16 +435,23 @@ bool WrappedVulkan::Prepare_InitialState(WrappedVkRes *res)
     InlineCleanupImageBarriers(cmd, cleanupBarriers);
     m_cleanupImageBarriers.Merge(cleanupBarriers);
 
-    vkr = ObjDisp(d)->EndCommandBuffer(Unwrap(cmd));
-    CheckVkResult(vkr);
+    if(batched)
+    {
+      m_InitStateBatchBuffers.push_back(dstBuf);
+    }
+    else
+    {
+      vkr = ObjDisp(d)->EndCommandBuffer(Unwrap(cmd));
+      CheckVkResult(vkr);
 
-    SubmitAndFlushImageStateBarriers(m_setupImageBarriers);
-    SubmitCmds();
-    FlushQ();
-    SubmitAndFlushImageStateBarriers(m_cleanupImageBarriers);
+      SubmitAndFlushImageStateBarriers(m_setupImageBarriers);
+      SubmitCmds();
+      FlushQ();
+      SubmitAndFlushImageStateBarriers(m_cleanupImageBarriers);
 
-    ObjDisp(d)->DestroyBuffer(Unwrap(d), Unwrap(dstBuf), NULL);
-    GetResourceManager()->ReleaseWrappedResource(dstBuf);
+      ObjDisp(d)->DestroyBuffer(Unwrap(d), Unwrap(dstBuf), NULL);
+      GetResourceManager()->ReleaseWrappedResource(dstBuf);
+    }
 
     if(arrayIm != VK_NULL_HANDLE)
     {
@@ -438,6 +469,9 @@ bool WrappedVulkan::Prepare_InitialState(WrappedVkRes *res)
 
     GetResourceManager()->SetInitialContents(id, initialContents);
 
+    if(m_PrepareInitStateBatch)
+      m_InitStateReadbacks.push_back(id);
+
     return true;
   }
   else if(type == eResDeviceMemory)
@@ -455,8 +489,6 @@ bool WrappedVulkan::Prepare_InitialState(WrappedVkRes *res)
     VkResult vkr = VK_SUCCESS;
 
     VkDevice d = GetDev();
-    // INITSTATEBATCH
-    VkCommandBuffer cmd = GetNextCmd();
 
     VkDeviceMemory datamem = ToUnwrappedHandle<VkDeviceMemory>(res);
     VkDeviceSize datasize = record->Length;
@@ -515,26 +547,44 @@ bool WrappedVulkan::Prepare_InitialState(WrappedVkRes *res)
                                        readbackmem.offs);
     CheckVkResult(vkr);
 
-    VkCommandBufferBeginInfo beginInfo = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO, NULL,
-                                          VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT};
+    VkCommandBuffer cmd;
 
-    vkr = ObjDisp(d)->BeginCommandBuffer(Unwrap(cmd), &beginInfo);
-    CheckVkResult(vkr);
+    if(m_PrepareInitStateBatch)
+    {
+      cmd = GetInitStateCmd();
+    }
+    else
+    {
+      cmd = GetNextCmd();
+
+      VkCommandBufferBeginInfo beginInfo = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO, NULL,
+                                            VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT};
+
+      vkr = ObjDisp(d)->BeginCommandBuffer(Unwrap(cmd), &beginInfo);
+      CheckVkResult(vkr);
+    }
 
     VkBufferCopy region = {0, 0, datasize};
 
     ObjDisp(d)->CmdCopyBuffer(Unwrap(cmd), Unwrap(record->memMapState->wholeMemBuf), Unwrap(dstBuf),
                               1, &region);
 
-    vkr = ObjDisp(d)->EndCommandBuffer(Unwrap(cmd));
-    CheckVkResult(vkr);
+    if(m_PrepareInitStateBatch)
+    {
+      m_InitStateBatchBuffers.push_back(dstBuf);
+      m_InitStateReadbacks.push_back(id);
+    }
+    else
+    {
+      vkr = ObjDisp(d)->EndCommandBuffer(Unwrap(cmd));
+      CheckVkResult(vkr);
 
-    // INITSTATEBATCH
-    SubmitCmds();
-    FlushQ();
+      SubmitCmds();
+      FlushQ();
 
-    ObjDisp(d)->DestroyBuffer(Unwrap(d), Unwrap(dstBuf), NULL);
-    GetResourceManager()->ReleaseWrappedResource(dstBuf);
+      ObjDisp(d)->DestroyBuffer(Unwrap(d), Unwrap(dstBuf), NULL);
+      GetResourceManager()->ReleaseWrappedResource(dstBuf);
+    }
 
     GetResourceManager()->SetInitialContents(id, VkInitialContents(type, readbackmem));
 
@@ -548,6 +598,91 @@ bool WrappedVulkan::Prepare_InitialState(WrappedVkRes *res)
   return false;
 }
 
+void WrappedVulkan::SerialiseInitialStatesAsync()
+{
+  rdcarray<ResourceId> readbacks;
+  readbacks.swap(m_InitStateReadbacks);
+
+  const uint64_t limit = uint64_t(Vulkan_AsyncInitialStatesMemoryLimitMB()) * 1024 * 1024;
+  uint64_t total = 0;
+
+  // readback memory is suballocated, and the same memory can't be mapped on two threads at once, so
+  // each job handles everything that was read back into one memory object.
+  std::map<VkDeviceMemory, rdcarray<size_t>> jobIndices;
+
+  for(ResourceId id : readbacks)
+  {
+    VkInitialContents initial = GetResourceManager()->GetInitialContents(id);
+
+    // sparse page tables are owned by the resource manager's copy, so leave those until the end
+    if(initial.mem.mem == VK_NULL_HANDLE || initial.sparseTables)
+      continue;
+
+    total += initial.mem.size;
+    if(total > limit)
+      break;
+
+    jobIndices[initial.mem.mem].push_back(m_AsyncInitialStates.size());
+    m_AsyncInitialStates.push_back({id, initial, NULL});
+  }
+
+  if(m_AsyncInitialStates.empty())
+    return;
+
+  RDCDEBUG("Serialising %u initial states (%llu bytes) on worker threads",
+           (uint32_t)m_AsyncInitialStates.size(), total);
+
+  const uint32_t chunkFlags = GetThreadSerialiser().GetChunkMetadataRecording();
+
+  for(auto it = jobIndices.begin(); it != jobIndices.end(); ++it)
+  {
+    rdcarray<size_t> indices = it->second;
+
+    m_AsyncInitialStateJobs.push_back(Threading::Jobs::Add([this, indices, chunkFlags]() {
+      WriteSerialiser ser(new StreamWriter(1024), Ownership::Stream);
+
+      ser.SetChunkMetadataRecording(chunkFlags);
+      ser.SetUserData(GetResourceManager());
+      ser.SetVersion(VkInitParams::CurrentVersion);
+      ser.SetBlobThreshold(Capture_BlobThreshold());
+
+      for(size_t idx : indices)
+      {
+        AsyncInitialState &state = m_AsyncInitialStates[idx];
+
+        SCOPED_SERIALISE_CHUNK(SystemChunk::InitialContents,
+                               GetSize_InitialState(state.id, state.initial));
+
+        Serialise_InitialState(ser, state.id, NULL, &state.initial);
+
+        state.chunk = scope.Get();
+      }
+    }));
+  }
+}
+
+void WrappedVulkan::FinishAsyncInitialStates(bool keep)
+{
+  if(m_AsyncInitialStates.empty())
+    return;
+
+  Threading::Jobs::Wait(m_AsyncInitialStateJobs);
+  m_AsyncInitialStateJobs.clear();
+
+  for(AsyncInitialState &state : m_AsyncInitialStates)
+  {
+    // only use the chunk if the initial contents it came from are still current
+    MemoryAllocation current = GetResourceManager()->GetInitialContents(state.id).mem;
+
+    if(keep && current.mem == state.initial.mem.mem && current.offs == state.initial.mem.offs)
+      GetResourceManager()->SetInitialChunk(state.id, state.chunk);
+    else
+      state.chunk->Delete();
+  }
+
+  m_AsyncInitialStates.clear();
+}
+
 uint64_t WrappedVulkan::GetSize_InitialState(ResourceId id, const VkInitialContents &initial)
 {
   uint64_t ret = 0;
@@ -1451,6 +1586,15 @@ bool WrappedVulkan::Serialise_InitialState(SerialiserType &ser, ResourceId id, V
     // Serialise this separately so that it can be used on reading to prepare the upload memory
     SERIALISE_ELEMENT(ContentsSize);
 
+    // incremental contents are stored in their own section of the capture instead of here, with
+    // only what changed since an earlier capture
+    bool Incremental = ser.IsWriting() && Capture_IncrementalInitialContents() && ContentsSize > 0;
+
+    if(ser.VersionAtLeast(0x14))
+    {
+      SERIALISE_ELEMENT(Incremental).Hidden();
+    }
+
     const VkDeviceSize nonCoherentAtomSize = GetDeviceProps().limits.nonCoherentAtomSize;
 
     // the memory/buffer that we allocated on read, to upload the initial contents.
@@ -1514,9 +1658,26 @@ bool WrappedVulkan::Serialise_InitialState(SerialiserType &ser, ResourceId id, V
         return false;
     }
 
-    // not using SERIALISE_ELEMENT_ARRAY so we can deliberately avoid allocation - we serialise
-    // directly into upload memory
-    ser.Serialise("Contents"_lit, Contents, ContentsSize, SerialiserFlags::NoFlags).Important();
+    if(Incremental)
+    {
+      if(ser.IsWriting() && Contents)
+      {
+        m_IncrementalContents->Add(id, Contents, ContentsSize);
+      }
+      else if(IsReplayingAndReading() && Contents &&
+              !m_IncrementalContents->Resolve(id, Contents, ContentsSize))
+      {
+        RDCERR("Initial contents of %s couldn't be read from the captures they're based on",
+               ToStr(id).c_str());
+        return false;
+      }
+    }
+    else
+    {
+      // not using SERIALISE_ELEMENT_ARRAY so we can deliberately avoid allocation - we serialise
+      // directly into upload memory
+      ser.Serialise("Contents"_lit, Contents, ContentsSize, SerialiserFlags::NoFlags).Important();
+    }
 
     // unmap the resource we mapped before - we need to do this on read and on write.
     if(!IsStructuredExporting(m_State) && mappedMem.mem != VK_NULL_HANDLE)
@@ -171,13 +171,13 @@ public:
     // we just have to leak ourselves.
     RDCASSERT(m_LiveResourceMap.empty());
     RDCASSERT(m_InitialContents.empty());
-    RDCASSERT(m_ResourceRecords.empty());
+    RDCASSERT(m_ResourceRecords.IsEmpty());
     RDCASSERT(m_CurrentResourceMap.empty());
     RDCASSERT(m_WrapperMap.empty());
 
     m_LiveResourceMap.clear();
     m_InitialContents.clear();
-    m_ResourceRecords.clear();
+    m_ResourceRecords.Clear();
     m_CurrentResourceMap.clear();
     m_WrapperMap.clear();
   }
@@ -4192,6 +4192,10 @@ void VulkanReplay::ReplaceResource(ResourceId from, ResourceId to)
 
   ClearPostVSCache();
   ClearFeedbackCache();
+
+  // checkpoints hold results from the old shader, and decoded chunks hold the old handles
+  m_pDriver->FreeReplayCheckpoints();
+  m_pDriver->ClearDecodedChunkCache();
 }
 
 void VulkanReplay::RemoveReplacement(ResourceId id)
@@ -4204,6 +4208,8 @@ void VulkanReplay::RemoveReplacement(ResourceId id)
 
     ClearPostVSCache();
     ClearFeedbackCache();
+    m_pDriver->FreeReplayCheckpoints();
+    m_pDriver->ClearDecodedChunkCache();
   }
 }
 
@@ -359,6 +359,8 @@ public:
   void GetBufferData(ResourceId buff, uint64_t offset, uint64_t len, bytebuf &retData);
   void GetTextureData(ResourceId tex, const Subresource &sub, const GetTextureDataParams &params,
                       bytebuf &data);
+  void FetchResourceData(const rdcarray<ResourceDataRequest> &requests,
+                         rdcarray<bytebuf> &results, rdcarray<bool> &fetched);
 
   void ReplaceResource(ResourceId from, ResourceId to);
   void RemoveReplacement(ResourceId id);
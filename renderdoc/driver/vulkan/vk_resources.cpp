@@ -3832,6 +3832,38 @@ void ImgRefs::Split(bool splitAspects, bool splitLevels, bool splitLayers)
   areLayersSplit = newSplitLayerCount > 1;
 }
 
+int32_t DescriptorSetRefs::DestroyEpoch = 0;
+
+DescriptorSetData::~DescriptorSetData()
+{
+  data.clear();
+  SAFE_DELETE(refs);
+}
+
+void DescriptorSetRefs::Set(DescriptorBindRefs &refs, uint32_t setVersion, uint32_t destroyEpoch)
+{
+  version = setVersion;
+  epoch = destroyEpoch;
+  mergedCapture = 0;
+
+  frameRefs.clear();
+  frameRefs.reserve(refs.bindFrameRefs.size());
+  for(auto it = refs.bindFrameRefs.begin(); it != refs.bindFrameRefs.end(); ++it)
+    frameRefs.push_back({it->first, it->second});
+
+  memRefs.swap(refs.bindMemRefs);
+  imageStates.swap(refs.bindImageStates);
+  storableRefs.swap(refs.storableRefs);
+
+  sparseRefs.clear();
+  for(VkResourceRecord *record : refs.sparseRefs)
+    sparseRefs.push_back(record->resInfo);
+
+  boundMemory.clear();
+  for(ResourceId mem : refs.boundMemory)
+    boundMemory.push_back(mem);
+}
+
 VkResourceRecord::~VkResourceRecord()
 {
   // bufferviews and imageviews have non-owning pointers to the sparseinfo struct
@@ -3846,6 +3878,7 @@ VkResourceRecord::~VkResourceRecord()
 
   if(resType == eResDeviceMemory && memMapState)
   {
+    MemoryTracking::Untrack(memMapState->writeTracking);
     FreeAlignedBuffer(memMapState->refData);
 
     SAFE_DELETE(memMapState);
@@ -3868,6 +3901,11 @@ VkResourceRecord::~VkResourceRecord()
   if(resType == eResDescriptorSetLayout || resType == eResDescriptorSet)
     SAFE_DELETE(descInfo);
 
+  // a descriptor set's cached references could point to this resource, so they must be rebuilt.
+  // Resources that were never gathered, like transient or staging resources, don't invalidate them
+  if(descriptorRefsCached)
+    DescriptorSetRefs::ResourceDestroyed();
+
   if(resType == eResPipelineLayout)
     SAFE_DELETE(pipeLayoutInfo);
 
@@ -1093,18 +1093,25 @@ struct CmdBufferRecordingInfo
 };
 
 struct DescSetLayout;
+struct DescriptorSetRefs;
 
 struct DescriptorSetData
 {
   DescriptorSetData() : layout(NULL) {}
   DescriptorSetData(const DescriptorSetData &) = delete;
   DescriptorSetData &operator=(const DescriptorSetData &) = delete;
-  ~DescriptorSetData() { data.clear(); }
+  ~DescriptorSetData();
   DescSetLayout *layout;
 
   // descriptor set bindings for this descriptor set. Filled out on
   // create from the layout.
   BindingStorage data;
+
+  // incremented whenever the bindings are written, so that cached references can be invalidated
+  uint32_t version = 0;
+
+  // references from the bindings, gathered at submit time while capturing. NULL until then
+  DescriptorSetRefs *refs = NULL;
 };
 
 // we used to cache these bindrefs at update time, but unfortunately many applications have
@@ -1118,6 +1125,45 @@ struct DescriptorBindRefs
   rdcflatmap<ResourceId, ImageState> bindImageStates;
   std::unordered_set<VkResourceRecord *> sparseRefs;
   std::unordered_set<VkResourceRecord *> storableRefs;
+  // all memory bound to buffers or images referenced above
+  std::unordered_set<ResourceId> boundMemory;
+};
+
+// the DescriptorBindRefs for a set, flattened and kept with the set once they've been gathered at
+// submit time. Sets with many descriptors are typically submitted many times more than they're
+// updated, so later submits can merge these in directly instead of walking every descriptor again.
+// They're rebuilt if the set is written, or if a resource that was read while gathering any set's
+// references is destroyed since the cached pointers may then be stale.
+struct DescriptorSetRefs
+{
+  void Set(DescriptorBindRefs &refs, uint32_t setVersion, uint32_t destroyEpoch);
+  bool IsCurrent(uint32_t setVersion, uint32_t destroyEpoch) const
+  {
+    return version == setVersion && epoch == destroyEpoch;
+  }
+
+  // called when a resource marked with descriptorRefsCached is destroyed
+  static void ResourceDestroyed() { Atomic::Inc32(&DestroyEpoch); }
+  static uint32_t GetDestroyEpoch() { return (uint32_t)Atomic::CmpExch32(&DestroyEpoch, 0, 0); }
+
+  // the set version and destroy epoch these references were gathered at
+  uint32_t version = 0;
+  uint32_t epoch = 0;
+
+  // the capture these references were last merged into. Frame and memory references are decided by
+  // the first use in a frame, so merging them again later in the frame changes nothing and can be
+  // skipped. Sparse mappings can be rebound without the set changing so those are always merged.
+  uint32_t mergedCapture = 0;
+
+  rdcarray<rdcpair<ResourceId, FrameRefType>> frameRefs;
+  std::unordered_map<ResourceId, MemRefs> memRefs;
+  rdcflatmap<ResourceId, ImageState> imageStates;
+  rdcarray<ResourceInfo *> sparseRefs;
+  std::unordered_set<VkResourceRecord *> storableRefs;
+  rdcarray<ResourceId> boundMemory;
+
+private:
+  static int32_t DestroyEpoch;
 };
 
 struct PipelineLayoutData
@@ -1146,6 +1192,8 @@ struct MemMapState
   // flush this may point to the readback memory so that we read from that fast copy instead of the
   // slow actual pointer.
   byte *cpuReadPtr = NULL;
+  // tracks the pages of a coherent map written since the last flush, when refData is valid
+  MemoryTracking::Region *writeTracking = NULL;
   Threading::CriticalSection mrLock;
 };
 
@@ -2195,6 +2243,8 @@ public:
   bool storable = false;
   bool dedicated = false;
   bool hasBDA = false;
+  // set once this record has been read while gathering a descriptor set's cached references
+  bool descriptorRefsCached = false;
 
   void MarkMemoryFrameReferenced(ResourceId mem, VkDeviceSize offset, VkDeviceSize size,
                                  FrameRefType refType);
@@ -652,6 +652,8 @@ VkResult WrappedVulkan::vkAllocateDescriptorSets(VkDevice device,
       {
         record->descInfo->data.reset();
       }
+
+      record->descInfo->version++;
     }
     else
     {
@@ -705,6 +707,7 @@ VkResult WrappedVulkan::vkResetDescriptorPool(VkDevice device, VkDescriptorPool
         {
           ((WrappedVkNonDispRes *)(*it)->Resource)->real = RealVkRes(0x123456);
           (*it)->descInfo->data.reset();
+          (*it)->descInfo->version++;
         }
 
         record->descPoolInfo->freelist.assign(record->pooledChildren);
@@ -1246,6 +1249,8 @@ void WrappedVulkan::vkUpdateDescriptorSets(VkDevice device, uint32_t writeCount,
       DescriptorSetSlot **binding = &record->descInfo->data.binds[descWrite.dstBinding];
       bytebuf &inlineData = record->descInfo->data.inlineBytes;
 
+      record->descInfo->version++;
+
       const DescSetLayout::Binding *layoutBinding = &layout.bindings[descWrite.dstBinding];
 
       FrameRefType ref = GetRefType(layoutBinding->descriptorType);
@@ -1362,6 +1367,8 @@ void WrappedVulkan::vkUpdateDescriptorSets(VkDevice device, uint32_t writeCount,
       RDCASSERT(pDescriptorCopies[i].dstBinding < dstrecord->descInfo->data.binds.size());
       RDCASSERT(pDescriptorCopies[i].srcBinding < srcrecord->descInfo->data.binds.size());
 
+      dstrecord->descInfo->version++;
+
       DescriptorSetSlot **dstbinding =
           &dstrecord->descInfo->data.binds[pDescriptorCopies[i].dstBinding];
       DescriptorSetSlot **srcbinding =
@@ -1674,6 +1681,8 @@ void WrappedVulkan::vkUpdateDescriptorSetWithTemplate(
       DescriptorSetSlot **binding = &record->descInfo->data.binds[entry.dstBinding];
       bytebuf &inlineData = record->descInfo->data.inlineBytes;
 
+      record->descInfo->version++;
+
       const DescSetLayout::Binding *layoutBinding = &layout.bindings[entry.dstBinding];
 
       FrameRefType ref = GetRefType(layoutBinding->descriptorType);
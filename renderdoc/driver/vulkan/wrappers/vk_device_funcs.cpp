@@ -66,6 +66,22 @@ static uint32_t GetPhysicalDeviceIndexFromHandle(VkPhysicalDevice physicalDevice
   return uint32_t((uintptr_t)LayerDisp(physicalDevice) - 0x100);
 }
 
+// whether descriptors can be accessed without the replay seeing which ones an action uses, either
+// because they're updated after being bound or because arrays are only partially written
+template <typename DescriptorIndexingFeatures>
+static bool UsesBindlessDescriptors(const DescriptorIndexingFeatures &features)
+{
+  return features.descriptorBindingUniformBufferUpdateAfterBind ||
+         features.descriptorBindingSampledImageUpdateAfterBind ||
+         features.descriptorBindingStorageImageUpdateAfterBind ||
+         features.descriptorBindingStorageBufferUpdateAfterBind ||
+         features.descriptorBindingUniformTexelBufferUpdateAfterBind ||
+         features.descriptorBindingStorageTexelBufferUpdateAfterBind ||
+         features.descriptorBindingUpdateUnusedWhilePending ||
+         features.descriptorBindingPartiallyBound ||
+         features.descriptorBindingVariableDescriptorCount || features.runtimeDescriptorArray;
+}
+
 static bool CheckTransferGranularity(VkExtent3D required, VkExtent3D check)
 {
   // if the required granularity is (0,0,0) then any is fine - the requirement is always satisfied.
@@ -919,6 +935,8 @@ void WrappedVulkan::Shutdown()
     }
   }
 
+  FreeReplayCheckpoints();
+
   FreeAllMemory(MemoryScope::InitialContents);
 
   // we do more in Shutdown than the equivalent vkDestroyInstance since on replay there's
@@ -2169,6 +2187,7 @@ bool WrappedVulkan::Serialise_vkCreateDevice(SerialiserType &ser, VkPhysicalDevi
 
     VkPhysicalDeviceDescriptorIndexingFeatures descIndexingFeatures = {};
     VkPhysicalDeviceVulkan12Features vulkan12Features = {};
+    bool bufferDeviceAddress = false;
 
     if(ObjDisp(physicalDevice)->GetPhysicalDeviceFeatures2)
     {
@@ -2245,6 +2264,8 @@ bool WrappedVulkan::Serialise_vkCreateDevice(SerialiserType &ser, VkPhysicalDevi
 
         m_SeparateDepthStencil |= (ext->separateDepthStencilLayouts != VK_FALSE);
 
+        bufferDeviceAddress |= (ext->bufferDeviceAddress != VK_FALSE);
+
         if(ext->bufferDeviceAddress && !avail.bufferDeviceAddressCaptureReplay)
         {
           m_FailedReplayStatus = ReplayStatus::APIHardwareUnsupported;
@@ -2420,6 +2441,8 @@ bool WrappedVulkan::Serialise_vkCreateDevice(SerialiserType &ser, VkPhysicalDevi
         CHECK_PHYS_EXT_FEATURE(bufferDeviceAddressCaptureReplay);
         CHECK_PHYS_EXT_FEATURE(bufferDeviceAddressMultiDevice);
 
+        bufferDeviceAddress |= (ext->bufferDeviceAddress != VK_FALSE);
+
         if(ext->bufferDeviceAddress && !avail.bufferDeviceAddressCaptureReplay)
         {
           m_FailedReplayStatus = ReplayStatus::APIHardwareUnsupported;
@@ -2439,6 +2462,8 @@ bool WrappedVulkan::Serialise_vkCreateDevice(SerialiserType &ser, VkPhysicalDevi
         CHECK_PHYS_EXT_FEATURE(bufferDeviceAddressCaptureReplay);
         CHECK_PHYS_EXT_FEATURE(bufferDeviceAddressMultiDevice);
 
+        bufferDeviceAddress |= (ext->bufferDeviceAddress != VK_FALSE);
+
         if(ext->bufferDeviceAddress && !avail.bufferDeviceAddressCaptureReplay)
         {
           m_FailedReplayStatus = ReplayStatus::APIHardwareUnsupported;
@@ -2871,6 +2896,14 @@ bool WrappedVulkan::Serialise_vkCreateDevice(SerialiserType &ser, VkPhysicalDevi
     if(availFeatures.imageCubeArray)
       enabledFeatures.imageCubeArray = true;
 
+    // replay checkpoints find what was written from resource usage, which misses writes through
+    // buffer device addresses or bindless descriptors
+    if(bufferDeviceAddress)
+      DisableReplayCheckpoints("buffer device addresses");
+    else if(vulkan12Features.descriptorIndexing || UsesBindlessDescriptors(vulkan12Features) ||
+            UsesBindlessDescriptors(descIndexingFeatures))
+      DisableReplayCheckpoints("descriptor indexing");
+
     bool descIndexingAllowsRBA = true;
 
     if(vulkan12Features.descriptorBindingUniformBufferUpdateAfterBind ||
@@ -3962,6 +3995,9 @@ void WrappedVulkan::vkDestroyDevice(VkDevice device, const VkAllocationCallbacks
   VkResult vkr = ObjDisp(m_Device)->DeviceWaitIdle(Unwrap(m_Device));
   CheckVkResult(vkr);
 
+  // initial states still being serialised by jobs read from memory that's about to be freed
+  FinishAsyncInitialStates(false);
+
   // MULTIDEVICE this function will need to check if the device is the one we
   // used for debugmanager/cmd pool etc, and only remove child queues and
   // resources (instead of doing full resource manager shutdown).
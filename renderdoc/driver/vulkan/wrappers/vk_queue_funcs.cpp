@@ -25,9 +25,12 @@
 #include <algorithm>
 #include "../vk_core.h"
 #include "../vk_debug.h"
+#include "common/diff_ranges.h"
 #include "core/settings.h"
 
 RDOC_EXTERN_CONFIG(bool, Vulkan_Debug_VerboseCommandRecording);
+RDOC_EXTERN_CONFIG(bool, Capture_MapWriteTracking);
+RDOC_EXTERN_CONFIG(uint32_t, Capture_MapDiffMergeGap);
 
 template <typename SerialiserType>
 bool WrappedVulkan::Serialise_vkGetDeviceQueue(SerialiserType &ser, VkDevice device,
@@ -938,58 +941,83 @@ void WrappedVulkan::CaptureQueueSubmit(VkQueue queue,
   {
     VulkanResourceManager *rm = GetResourceManager();
 
+    SCOPED_LOCK(m_DescriptorSetRefsLock);
+
+    // fetch this before gathering any references, so that if a resource is destroyed while we're
+    // gathering then the references are rebuilt next time
+    uint32_t destroyEpoch = DescriptorSetRefs::GetDestroyEpoch();
+
     // for each descriptor set, mark it referenced as well as all resources currently bound to it
     for(auto it = descriptorSets.begin(); it != descriptorSets.end(); ++it)
     {
       rm->MarkResourceFrameReferenced(GetResID(*it), eFrameRef_Read);
 
       VkResourceRecord *setrecord = GetRecord(*it);
+      DescriptorSetData *descInfo = setrecord->descInfo;
 
-      DescriptorBindRefs refs;
+      if(descInfo->refs == NULL)
+        descInfo->refs = new DescriptorSetRefs;
 
-      DescSetLayout *layout = setrecord->descInfo->layout;
+      DescriptorSetRefs &setRefs = *descInfo->refs;
 
-      for(size_t b = 0, num = layout->bindings.size(); b < num; b++)
+      // only walk the descriptors if they've changed since we last gathered references from them
+      if(!setRefs.IsCurrent(descInfo->version, destroyEpoch))
       {
-        const DescSetLayout::Binding &bind = layout->bindings[b];
+        DescriptorBindRefs refs;
 
-        // skip empty bindings
-        if(bind.descriptorType == VK_DESCRIPTOR_TYPE_MAX_ENUM ||
-           bind.descriptorType == VK_DESCRIPTOR_TYPE_INLINE_UNIFORM_BLOCK_EXT)
-          continue;
+        DescSetLayout *layout = descInfo->layout;
 
-        uint32_t count = bind.descriptorCount;
-        if(bind.variableSize)
-          count = setrecord->descInfo->data.variableDescriptorCount;
+        for(size_t b = 0, num = layout->bindings.size(); b < num; b++)
+        {
+          const DescSetLayout::Binding &bind = layout->bindings[b];
 
-        FrameRefType ref = GetRefType(bind.descriptorType);
+          // skip empty bindings
+          if(bind.descriptorType == VK_DESCRIPTOR_TYPE_MAX_ENUM ||
+             bind.descriptorType == VK_DESCRIPTOR_TYPE_INLINE_UNIFORM_BLOCK_EXT)
+            continue;
 
-        for(uint32_t a = 0; a < count; a++)
-          setrecord->descInfo->data.binds[b][a].AccumulateBindRefs(refs, rm, ref);
-      }
+          uint32_t count = bind.descriptorCount;
+          if(bind.variableSize)
+            count = descInfo->data.variableDescriptorCount;
 
-      for(auto refit = refs.bindFrameRefs.begin(); refit != refs.bindFrameRefs.end(); ++refit)
-      {
-        refdIDs.insert(refit->first);
-        GetResourceManager()->MarkResourceFrameReferenced(refit->first, refit->second);
-      }
+          FrameRefType ref = GetRefType(bind.descriptorType);
 
-      for(auto refit = refs.sparseRefs.begin(); refit != refs.sparseRefs.end(); ++refit)
-      {
-        GetResourceManager()->MarkSparseMapReferenced((*refit)->resInfo);
+          for(uint32_t a = 0; a < count; a++)
+            descInfo->data.binds[b][a].AccumulateBindRefs(refs, rm, ref);
+        }
+
+        setRefs.Set(refs, descInfo->version, destroyEpoch);
       }
 
-      UpdateImageStates(refs.bindImageStates);
-      GetResourceManager()->MergeReferencedMemory(refs.bindMemRefs);
+      // coherent maps are only flushed if something in this submit references them, so always
+      // count the memory bound in this set even if we don't need to merge its references again
+      for(ResourceId mem : setRefs.boundMemory)
+        refdIDs.insert(mem);
+
+      // vkQueueBindSparse can bind new memory to a sparse resource in this set without the set
+      // itself changing, so the sparse mappings are merged on every submit. Image states are also
+      // merged every time so they're composed with any transitions submitted since the last use.
+      for(const ResourceInfo *sparse : setRefs.sparseRefs)
+        rm->MarkSparseMapReferenced(sparse);
+
+      UpdateImageStates(setRefs.imageStates);
+
+      if(setRefs.mergedCapture == m_DescriptorSetRefsCapture)
+        continue;
+
+      setRefs.mergedCapture = m_DescriptorSetRefsCapture;
+
+      for(const rdcpair<ResourceId, FrameRefType> &ref : setRefs.frameRefs)
+        rm->MarkResourceFrameReferenced(ref.first, ref.second);
+
+      rm->MergeReferencedMemory(setRefs.memRefs);
 
       // for storage buffers we have to pessimise memory references because the order matters - if
       // the first recorded reference is a complete write then a later readbeforewrite won't
       // properly mark it as needing initial states preserved. So we do that here. Images are
       // handled separately
-      for(auto refit = refs.storableRefs.begin(); refit != refs.storableRefs.end(); ++refit)
-      {
-        GetResourceManager()->FixupStorageBufferMemory(refs.storableRefs);
-      }
+      if(!setRefs.storableRefs.empty())
+        rm->FixupStorageBufferMemory(setRefs.storableRefs);
     }
 
     GetResourceManager()->MarkResourceFrameReferenced(GetResID(queue), eFrameRef_Read);
@@ -1025,9 +1053,6 @@ void WrappedVulkan::CaptureQueueSubmit(VkQueue queue,
           continue;
         }
 
-        size_t diffStart = 0, diffEnd = 0;
-        bool found = true;
-
         // this causes vkFlushMappedMemoryRanges call to allocate and copy to refData
         // from serialised buffer. We want to copy *precisely* the serialised data,
         // otherwise there is a gap in time between serialising out a snapshot of
@@ -1114,29 +1139,54 @@ void WrappedVulkan::CaptureQueueSubmit(VkQueue queue,
           state.cpuReadPtr = state.mappedPtr;
         }
 
-        // if we have a previous set of data, compare.
-        // otherwise just serialise it all
-        if(state.refData)
-          found = FindDiffRange(((byte *)state.cpuReadPtr) + state.mapOffset, state.refData,
-                                (size_t)state.mapSize, diffStart, diffEnd);
+        // the ranges of the map that could have changed
+        rdcarray<rdcpair<size_t, size_t>> ranges;
+
+        if(state.refData && state.writeTracking)
+        {
+          // only pages written since the last flush can differ from the reference data
+          MemoryTracking::GetWrittenRanges(state.writeTracking, ranges);
+        }
         else
-          diffEnd = (size_t)state.mapSize;
+        {
+          // start tracking writes before we serialise the whole map, so that anything written
+          // after we read it is caught on the next flush. The GPU readback is used when reading the
+          // mapped pointer directly is too slow, so writes can't be tracked there.
+          if(!state.refData && !state.readbackOnGPU && Capture_MapWriteTracking())
+          {
+            MemoryTracking::Untrack(state.writeTracking);
+            state.writeTracking =
+                MemoryTracking::Track(state.mappedPtr + state.mapOffset, (size_t)state.mapSize);
+          }
 
-        // sanitise diff start/end. Since the mapped pointer might be written on another thread
-        // (or even the GPU) this could cause a difference to appear and disappear transiently. In
-        // this case FindDiffRange could find the difference when locating the start but not find
-        // it when locating the end. In this case we don't need to write the difference (the
-        // application is responsible for ensuring it's not writing to memory the GPU might need)
-        if(diffEnd <= diffStart)
-          found = false;
+          ranges.push_back({0, (size_t)state.mapSize});
+        }
+
+        bool flushed = false;
 
-        if(found)
+        for(const rdcpair<size_t, size_t> &changed : ranges)
         {
-          // MULTIDEVICE should find the device for this queue.
-          // MULTIDEVICE only want to flush maps associated with this queue
-          VkDevice dev = GetDev();
+          DiffRanges diffs;
+
+          // if we have a previous set of data, compare to find each range that changed.
+          // otherwise just serialise it all. Since the mapped pointer might be written on another
+          // thread (or even the GPU) a difference could appear and disappear transiently while we
+          // compare, but FindDiffRanges never returns empty ranges so that needs no special care.
+          if(state.refData)
+            FindDiffRanges(((byte *)state.cpuReadPtr) + state.mapOffset + changed.first,
+                           state.refData + changed.first, changed.second - changed.first,
+                           Capture_MapDiffMergeGap(), diffs);
+          else
+            diffs.push_back({0, changed.second - changed.first});
 
+          for(const rdcpair<size_t, size_t> &diff : diffs)
           {
+            size_t diffStart = changed.first + diff.first, diffEnd = changed.first + diff.second;
+
+            // MULTIDEVICE should find the device for this queue.
+            // MULTIDEVICE only want to flush maps associated with this queue
+            VkDevice dev = GetDev();
+
             RDCLOG("Persistent map flush forced for %s (%llu -> %llu)",
                    ToStr(record->GetResourceID()).c_str(), (uint64_t)diffStart, (uint64_t)diffEnd);
             VkMappedMemoryRange range = {
@@ -1147,9 +1197,12 @@ void WrappedVulkan::CaptureQueueSubmit(VkQueue queue,
                 diffEnd - diffStart,
             };
             InternalFlushMemoryRange(dev, range, true, capframe);
+
+            flushed = true;
           }
         }
-        else
+
+        if(!flushed)
         {
           RDCDEBUG("Persistent map flush not needed for %s", ToStr(record->GetResourceID()).c_str());
         }
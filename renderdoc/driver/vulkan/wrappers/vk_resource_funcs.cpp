@@ -732,6 +732,9 @@ void WrappedVulkan::vkFreeMemory(VkDevice device, VkDeviceMemory memory,
         memMapState->refData = NULL;
       }
 
+      MemoryTracking::Untrack(memMapState->writeTracking);
+      memMapState->writeTracking = NULL;
+
       // destroy the wholeMemBuf if it's one we allocated ourselves
       if(!memMapState->dedicated)
       {
@@ -1015,6 +1018,9 @@ void WrappedVulkan::vkUnmapMemory(VkDevice device, VkDeviceMemory mem)
 
     FreeAlignedBuffer(state.refData);
     state.refData = NULL;
+
+    MemoryTracking::Untrack(state.writeTracking);
+    state.writeTracking = NULL;
   }
 
   ObjDisp(device)->UnmapMemory(Unwrap(device), Unwrap(mem));
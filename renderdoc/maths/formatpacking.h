@@ -180,5 +180,11 @@ typedef uint8_t byte;
 struct ResourceFormat;
 FloatVector DecodeFormattedComponents(const ResourceFormat &fmt, const byte *data,
                                       bool *success = NULL);
+// decodes count elements spaced stride bytes apart. The results are identical to calling
+// DecodeFormattedComponents on each element, but common formats are converted in bulk
+void DecodeFormattedComponentsRow(const ResourceFormat &fmt, const byte *data, size_t stride,
+                                  size_t count, FloatVector *out);
+// blends count RGBA8 UNorm pixels over an opaque colour by their alpha, writing RGB8 UNorm.
+void BlendRGBA8OverColor(const byte *rgba, byte *rgb, size_t count, Vec3f col);
 void EncodeFormattedComponents(const ResourceFormat &fmt, FloatVector v, byte *data,
                                bool *success = NULL);
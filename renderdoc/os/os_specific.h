@@ -137,6 +137,25 @@ public:
   data m_Data;
 };
 
+template <class data>
+class SemaphoreTemplate
+{
+public:
+  SemaphoreTemplate();
+  ~SemaphoreTemplate();
+
+  // increments the count by numToWake, waking up to that many waiting threads
+  void Wake(uint32_t numToWake);
+  // blocks until the count is non-zero, then decrements it
+  void WaitForWake();
+
+  // no copying
+  SemaphoreTemplate &operator=(const SemaphoreTemplate &other) = delete;
+  SemaphoreTemplate(const SemaphoreTemplate &other) = delete;
+
+  data m_Data;
+};
+
 void Init();
 void Shutdown();
 uint64_t AllocateTLSSlot();
@@ -144,7 +163,7 @@ uint64_t AllocateTLSSlot();
 void *GetTLSValue(uint64_t slot);
 void SetTLSValue(uint64_t slot, void *value);
 
-// must typedef CriticalSectionTemplate<X> CriticalSection
+// must typedef CriticalSectionTemplate<X> CriticalSection, and likewise RWLock and Semaphore
 
 void SetCurrentThreadName(const rdcstr &name);
 
@@ -156,6 +175,9 @@ void DetachThread(ThreadHandle handle);
 void CloseThread(ThreadHandle handle);
 void Sleep(uint32_t milliseconds);
 
+// the number of logical processors available, always at least 1
+uint32_t NumberOfCores();
+
 // kind of windows specific, to handle this case:
 // http://blogs.msdn.com/b/oldnewthing/archive/2013/11/05/10463645.aspx
 void KeepModuleAlive();
@@ -230,6 +252,26 @@ int64_t Inc64(int64_t *i);
 int64_t Dec64(int64_t *i);
 int64_t ExchAdd64(int64_t *i, int64_t a);
 int32_t CmpExch32(int32_t *dest, int32_t oldVal, int32_t newVal);
+int32_t Exch32(int32_t *dest, int32_t newVal);
+};
+
+// tracks which pages of some memory are written, so that only those pages need to be compared to
+// find what changed
+namespace MemoryTracking
+{
+struct Region;
+
+// starts tracking writes to the given readable and writable memory. Returns NULL if writes can't
+// be tracked on this platform or for this memory, in which case all of it must be compared.
+Region *Track(void *base, size_t size);
+
+// stops tracking writes. Must be called before the memory is unmapped or freed
+void Untrack(Region *region);
+
+// returns the [start, end) byte ranges of the memory written since tracking began or since the
+// last call. This is conservative, anything in a written page or partially covered page is
+// included even if it hasn't changed.
+void GetWrittenRanges(Region *region, rdcarray<rdcpair<size_t, size_t>> &ranges);
 };
 
 namespace Callstack
@@ -321,6 +363,12 @@ void fseek64(FILE *f, uint64_t offset, int origin);
 
 void ftruncateat(FILE *f, uint64_t length);
 
+// maps the first length bytes of a file into memory. Writes to the mapping are private and never
+// reach the file. Returns NULL if the file can't be mapped, in which case it should be read
+// normally
+byte *fmap(FILE *f, uint64_t length);
+void funmap(byte *mapping, uint64_t length);
+
 bool fflush(FILE *f);
 
 bool feof(FILE *f);
@@ -0,0 +1,509 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#include <errno.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "common/common.h"
+#include "common/threading.h"
+#include "os/os_specific.h"
+
+// Write tracking works by protecting the pages read-only. The first write to each page faults, and
+// the signal handler marks the page as written and makes it writable again before returning so the
+// write goes through. Reading back the written pages protects them again for next time.
+//
+// Only pages entirely inside a region are protected, so that we never change the protection of
+// memory that isn't ours. Any partial pages at the start or end are always reported as written.
+//
+// Note that writes from the kernel, e.g. read() into tracked memory, fail with EFAULT instead of
+// faulting, so this is only suitable for memory that's written directly by the application.
+
+namespace MemoryTracking
+{
+struct Region
+{
+  byte *base;
+  size_t size;
+
+  // the fully covered pages which are protected
+  byte *pageBegin;
+  byte *pageEnd;
+
+  // one bit per page, set from the signal handler
+  uint64_t *written;
+  size_t numWords;
+};
+
+static const size_t MaxRegions = 256;
+
+// read from the signal handler, so only ever updated atomically
+static Region *regions[MaxRegions] = {};
+static Threading::SpinLock regionsLock;
+
+// the number of signal handlers currently looking at regions, so they aren't freed under them
+static int32_t handlersRunning = 0;
+
+static size_t pageSize = 0;
+
+static struct sigaction oldSegvAction, oldBusAction;
+
+static void WriteFaultHandler(int signum, siginfo_t *info, void *context)
+{
+  int saved_errno = errno;
+
+  Atomic::Inc32(&handlersRunning);
+
+  byte *addr = (byte *)info->si_addr;
+  bool handled = false;
+
+  for(size_t i = 0; i < MaxRegions && !handled; i++)
+  {
+    Region *r = __atomic_load_n(&regions[i], __ATOMIC_ACQUIRE);
+
+    if(r && addr >= r->pageBegin && addr < r->pageEnd)
+    {
+      size_t page = size_t(addr - r->pageBegin) / pageSize;
+      __atomic_fetch_or(&r->written[page / 64], 1ULL << (page % 64), __ATOMIC_ACQ_REL);
+      mprotect(r->pageBegin + page * pageSize, pageSize, PROT_READ | PROT_WRITE);
+      handled = true;
+    }
+  }
+
+  Atomic::Dec32(&handlersRunning);
+
+  errno = saved_errno;
+
+  if(handled)
+    return;
+
+  // not one of ours, pass it on to whoever was handling it before
+  struct sigaction &old = signum == SIGBUS ? oldBusAction : oldSegvAction;
+
+  if(old.sa_flags & SA_SIGINFO)
+  {
+    old.sa_sigaction(signum, info, context);
+  }
+  else if(old.sa_handler == SIG_DFL)
+  {
+    // restore the default handling, so that when the faulting instruction re-runs it crashes as it
+    // would have without us
+    sigaction(signum, &old, NULL);
+  }
+  else if(old.sa_handler != SIG_IGN)
+  {
+    old.sa_handler(signum);
+  }
+}
+
+static void InstallHandler(int signum, struct sigaction &oldAction)
+{
+  // check every time since someone else may have installed their own handler over ours, in which
+  // case we go back on top and pass on to theirs instead
+  struct sigaction current = {};
+  sigaction(signum, NULL, &current);
+
+  if((current.sa_flags & SA_SIGINFO) && current.sa_sigaction == &WriteFaultHandler)
+    return;
+
+  struct sigaction action = {};
+  sigemptyset(&action.sa_mask);
+  action.sa_flags = SA_SIGINFO | SA_RESTART | SA_NODEFER;
+  action.sa_sigaction = &WriteFaultHandler;
+
+  sigaction(signum, &action, &oldAction);
+}
+
+static void InstallHandlers()
+{
+  if(pageSize == 0)
+    pageSize = (size_t)sysconf(_SC_PAGESIZE);
+
+  InstallHandler(SIGSEGV, oldSegvAction);
+  // some platforms raise SIGBUS for writes to protected pages
+  InstallHandler(SIGBUS, oldBusAction);
+}
+
+static void RemoveRegion(Region *region)
+{
+  {
+    SCOPED_SPINLOCK(regionsLock);
+    for(size_t i = 0; i < MaxRegions; i++)
+    {
+      if(regions[i] == region)
+      {
+        __atomic_store_n(&regions[i], (Region *)NULL, __ATOMIC_RELEASE);
+        break;
+      }
+    }
+  }
+
+  // wait for any handler that might have found the region before it was removed
+  while(Atomic::CmpExch32(&handlersRunning, 0, 0) != 0)
+    Threading::Sleep(0);
+
+  delete[] region->written;
+  delete region;
+}
+
+Region *Track(void *base, size_t size)
+{
+  {
+    SCOPED_SPINLOCK(regionsLock);
+    InstallHandlers();
+  }
+
+  byte *begin = AlignUpPtr((byte *)base, pageSize);
+  byte *end = (byte *)(uintptr_t((byte *)base + size) & ~uintptr_t(pageSize - 1));
+
+  // no whole pages to protect, nothing can be gained
+  if(end <= begin)
+    return NULL;
+
+  const size_t numPages = size_t(end - begin) / pageSize;
+
+  Region *region = new Region;
+  region->base = (byte *)base;
+  region->size = size;
+  region->pageBegin = begin;
+  region->pageEnd = end;
+  region->numWords = (numPages + 63) / 64;
+  region->written = new uint64_t[region->numWords];
+  memset(region->written, 0, region->numWords * sizeof(uint64_t));
+
+  bool added = false;
+  {
+    SCOPED_SPINLOCK(regionsLock);
+    for(size_t i = 0; i < MaxRegions; i++)
+    {
+      if(regions[i] == NULL)
+      {
+        __atomic_store_n(&regions[i], region, __ATOMIC_RELEASE);
+        added = true;
+        break;
+      }
+    }
+  }
+
+  if(!added)
+  {
+    RDCWARN("Too many regions with write tracking, falling back to comparing %p", base);
+    delete[] region->written;
+    delete region;
+    return NULL;
+  }
+
+  if(mprotect(begin, size_t(end - begin), PROT_READ) != 0)
+  {
+    RDCWARN("Couldn't protect %p for write tracking: %d", base, errno);
+    RemoveRegion(region);
+    return NULL;
+  }
+
+  return region;
+}
+
+void Untrack(Region *region)
+{
+  if(!region)
+    return;
+
+  mprotect(region->pageBegin, size_t(region->pageEnd - region->pageBegin), PROT_READ | PROT_WRITE);
+
+  RemoveRegion(region);
+}
+
+void GetWrittenRanges(Region *region, rdcarray<rdcpair<size_t, size_t>> &ranges)
+{
+  ranges.clear();
+
+  if(!region)
+    return;
+
+  auto addRange = [&ranges](size_t start, size_t end) {
+    if(!ranges.empty() && ranges.back().second == start)
+      ranges.back().second = end;
+    else
+      ranges.push_back({start, end});
+  };
+
+  const size_t pagesOffset = size_t(region->pageBegin - region->base);
+  const size_t numPages = size_t(region->pageEnd - region->pageBegin) / pageSize;
+
+  if(pagesOffset > 0)
+    addRange(0, pagesOffset);
+
+  const size_t NoRun = ~size_t(0);
+  size_t runStart = NoRun;
+  uint64_t bits = 0;
+
+  // go one past the last page, so that a run reaching the end is finished
+  for(size_t page = 0; page <= numPages; page++)
+  {
+    if((page % 64) == 0 && page < numPages)
+      bits = __atomic_exchange_n(&region->written[page / 64], 0ULL, __ATOMIC_ACQ_REL);
+
+    if(page < numPages && (bits & (1ULL << (page % 64))))
+    {
+      if(runStart == NoRun)
+        runStart = page;
+      continue;
+    }
+
+    if(runStart != NoRun)
+    {
+      // protect the pages again before returning, so that anything written after this is caught
+      // next time. Anything written in between will be picked up by the caller's comparison.
+      mprotect(region->pageBegin + runStart * pageSize, (page - runStart) * pageSize, PROT_READ);
+
+      addRange(pagesOffset + runStart * pageSize, pagesOffset + page * pageSize);
+      runStart = NoRun;
+    }
+  }
+
+  const size_t pagesEnd = size_t(region->pageEnd - region->base);
+  if(pagesEnd < region->size)
+    addRange(pagesEnd, region->size);
+}
+};
+
+#if ENABLED(ENABLE_UNIT_TESTS)
+
+#include "catch/catch.hpp"
+#include "common/formatting.h"
+#include "common/timing.h"
+#include "strings/string_utils.h"
+
+// simulates a persistently mapped region that the application writes into, with a reference copy
+// of the contents from the last time it was checked, the same as a coherent map while capturing.
+struct SimulatedMap
+{
+  SimulatedMap(size_t size) : size(size)
+  {
+    mapped = (byte *)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    reference = AllocAlignedBuffer(size);
+    memset(reference, 0, size);
+  }
+
+  ~SimulatedMap()
+  {
+    munmap(mapped, size);
+    FreeAlignedBuffer(reference);
+  }
+
+  // updates the reference with any differences in the given ranges, returning how many bytes were
+  // compared
+  size_t Flush(const rdcarray<rdcpair<size_t, size_t>> &ranges)
+  {
+    size_t compared = 0;
+    for(const rdcpair<size_t, size_t> &range : ranges)
+    {
+      size_t diffStart = 0, diffEnd = 0;
+      if(FindDiffRange(mapped + range.first, reference + range.first, range.second - range.first,
+                       diffStart, diffEnd) &&
+         diffEnd > diffStart)
+      {
+        memcpy(reference + range.first + diffStart, mapped + range.first + diffStart,
+               diffEnd - diffStart);
+      }
+      compared += range.second - range.first;
+    }
+    return compared;
+  }
+
+  size_t size;
+  byte *mapped;
+  byte *reference;
+};
+
+TEST_CASE("Test page write tracking", "[osspecific][writetracking]")
+{
+  const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+  const size_t numPages = 64;
+
+  SimulatedMap map(page * numPages);
+
+  rdcarray<rdcpair<size_t, size_t>> ranges;
+
+  SECTION("Only written pages are reported")
+  {
+    MemoryTracking::Region *region = MemoryTracking::Track(map.mapped, map.size);
+    REQUIRE(region);
+
+    MemoryTracking::GetWrittenRanges(region, ranges);
+    CHECK(ranges.empty());
+
+    map.mapped[page * 3 + 5] = 1;
+    map.mapped[page * 4] = 2;
+    map.mapped[page * 10 + page - 1] = 3;
+    map.mapped[page * 63] = 4;
+
+    MemoryTracking::GetWrittenRanges(region, ranges);
+    REQUIRE(ranges.size() == 3);
+    CHECK(ranges[0].first == page * 3);
+    CHECK(ranges[0].second == page * 5);
+    CHECK(ranges[1].first == page * 10);
+    CHECK(ranges[1].second == page * 11);
+    CHECK(ranges[2].first == page * 63);
+    CHECK(ranges[2].second == page * 64);
+
+    // pages are tracked again after being reported
+    MemoryTracking::GetWrittenRanges(region, ranges);
+    CHECK(ranges.empty());
+
+    map.mapped[page * 10] = 5;
+
+    MemoryTracking::GetWrittenRanges(region, ranges);
+    REQUIRE(ranges.size() == 1);
+    CHECK(ranges[0].first == page * 10);
+    CHECK(ranges[0].second == page * 11);
+
+    MemoryTracking::Untrack(region);
+
+    // untracked memory is writable as normal
+    map.mapped[page * 20] = 6;
+    CHECK(map.mapped[page * 20] == 6);
+  };
+
+  SECTION("Partial pages are always reported")
+  {
+    MemoryTracking::Region *region = MemoryTracking::Track(map.mapped + 16, map.size - 32);
+    REQUIRE(region);
+
+    MemoryTracking::GetWrittenRanges(region, ranges);
+    REQUIRE(ranges.size() == 2);
+    CHECK(ranges[0].first == 0);
+    CHECK(ranges[0].second == page - 16);
+    CHECK(ranges[1].first == page * (numPages - 1) - 16);
+    CHECK(ranges[1].second == map.size - 32);
+
+    map.mapped[page + 100] = 1;
+
+    MemoryTracking::GetWrittenRanges(region, ranges);
+    REQUIRE(ranges.size() == 2);
+    CHECK(ranges[0].first == 0);
+    CHECK(ranges[0].second == page * 2 - 16);
+
+    MemoryTracking::Untrack(region);
+
+    // too small to contain a whole page
+    CHECK(MemoryTracking::Track(map.mapped + 16, page) == NULL);
+  };
+
+  SECTION("Written data matches a full comparison")
+  {
+    MemoryTracking::Region *region = MemoryTracking::Track(map.mapped, map.size);
+    REQUIRE(region);
+
+    const uint32_t numThreads = 4;
+
+    for(uint32_t frame = 0; frame < 20; frame++)
+    {
+      // write from several threads at once, like an application filling an upload heap
+      rdcarray<Threading::ThreadHandle> threads;
+      for(uint32_t t = 0; t < numThreads; t++)
+      {
+        threads.push_back(Threading::CreateThread([&map, frame, t, page]() {
+          uint32_t rng = frame * 7919 + t * 104729 + 1;
+          for(int i = 0; i < 16; i++)
+          {
+            rng = rng * 1664525U + 1013904223U;
+            size_t offs = (rng >> 8) % map.size;
+            // each thread writes its own bytes in the page so the result is deterministic
+            offs = (offs & ~size_t(numThreads - 1)) + t;
+            map.mapped[offs] = byte(rng >> 24) | 1;
+          }
+        }));
+      }
+
+      for(Threading::ThreadHandle t : threads)
+      {
+        Threading::JoinThread(t);
+        Threading::CloseThread(t);
+      }
+
+      MemoryTracking::GetWrittenRanges(region, ranges);
+      map.Flush(ranges);
+
+      CHECK(memcmp(map.mapped, map.reference, map.size) == 0);
+    }
+
+    MemoryTracking::Untrack(region);
+  };
+}
+
+TEST_CASE("Benchmark page write tracking", "[.][benchmark][writetracking]")
+{
+  const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+  const size_t size = 256 * 1024 * 1024;
+  const uint32_t frames = 10;
+
+  SimulatedMap map(size);
+
+  rdcarray<rdcpair<size_t, size_t>> ranges;
+  rdcstr results;
+
+  for(size_t writtenPages : {1, 64, 1024, 16384})
+  {
+    auto writeFrame = [&](uint32_t frame) {
+      for(size_t i = 0; i < writtenPages; i++)
+        map.mapped[((i * 7 + frame) * page) % size] = byte(frame + 1);
+    };
+
+    PerformanceTimer timer;
+
+    ranges = {{0, size}};
+    for(uint32_t frame = 0; frame < frames; frame++)
+    {
+      writeFrame(frame);
+      map.Flush(ranges);
+    }
+
+    double fullTime = timer.GetMilliseconds() / frames;
+
+    MemoryTracking::Region *region = MemoryTracking::Track(map.mapped, size);
+    REQUIRE(region);
+
+    timer.Restart();
+
+    for(uint32_t frame = 0; frame < frames; frame++)
+    {
+      writeFrame(frame);
+      MemoryTracking::GetWrittenRanges(region, ranges);
+      map.Flush(ranges);
+    }
+
+    double trackedTime = timer.GetMilliseconds() / frames;
+
+    MemoryTracking::Untrack(region);
+
+    results += StringFormat::Fmt("\n%6zu pages written: %8.3f ms compared, %8.3f ms tracked",
+                                 writtenPages, fullTime, trackedTime);
+  }
+
+  WARN("Per frame cost for a " << size / (1024 * 1024) << "MB persistent map:" << results.c_str());
+}
+
+#endif    // ENABLED(ENABLE_UNIT_TESTS)
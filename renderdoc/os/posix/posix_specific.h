@@ -104,6 +104,14 @@ struct pthreadRWLockData
   pthread_rwlockattr_t attr;
 };
 typedef RWLockTemplate<pthreadRWLockData> RWLock;
+
+struct pthreadSemaphoreData
+{
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  uint32_t count;
+};
+typedef SemaphoreTemplate<pthreadSemaphoreData> Semaphore;
 };
 
 namespace Bits
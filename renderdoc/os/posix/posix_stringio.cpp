@@ -32,6 +32,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/file.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <time.h>
@@ -441,6 +442,28 @@ void ftruncateat(FILE *f, uint64_t length)
   ::ftruncate(fd, (off_t)length);
 }
 
+byte *fmap(FILE *f, uint64_t length)
+{
+  if(length == 0 || length > (uint64_t)SIZE_MAX)
+    return NULL;
+
+  void *ret = ::mmap(NULL, (size_t)length, PROT_READ | PROT_WRITE, MAP_PRIVATE, ::fileno(f), 0);
+
+  if(ret == MAP_FAILED)
+  {
+    RDCWARN("Couldn't map %llu bytes of file - errno %d", length, errno);
+    return NULL;
+  }
+
+  return (byte *)ret;
+}
+
+void funmap(byte *mapping, uint64_t length)
+{
+  if(mapping)
+    ::munmap(mapping, (size_t)length);
+}
+
 bool fflush(FILE *f)
 {
   return ::fflush(f) == 0;
@@ -1656,3 +1656,19 @@ void Process::Shutdown()
 {
   // nothing to do
 }
+
+// write tracking isn't implemented on windows, tracked memory is always compared in full
+
+MemoryTracking::Region *MemoryTracking::Track(void *base, size_t size)
+{
+  return NULL;
+}
+
+void MemoryTracking::Untrack(Region *region)
+{
+}
+
+void MemoryTracking::GetWrittenRanges(Region *region, rdcarray<rdcpair<size_t, size_t>> &ranges)
+{
+  ranges.clear();
+}
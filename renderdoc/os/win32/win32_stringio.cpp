@@ -655,6 +655,41 @@ void ftruncateat(FILE *f, uint64_t length)
   ::_chsize_s(fd, (int64_t)length);
 }
 
+byte *fmap(FILE *f, uint64_t length)
+{
+  if(length == 0 || length > (uint64_t)SIZE_MAX)
+    return NULL;
+
+  HANDLE file = (HANDLE)::_get_osfhandle(::_fileno(f));
+
+  if(file == INVALID_HANDLE_VALUE)
+    return NULL;
+
+  HANDLE mapping = CreateFileMappingW(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+
+  if(mapping == NULL)
+  {
+    RDCWARN("Couldn't create file mapping - error %u", GetLastError());
+    return NULL;
+  }
+
+  void *ret = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, (SIZE_T)length);
+
+  // the view keeps the mapping object alive
+  CloseHandle(mapping);
+
+  if(ret == NULL)
+    RDCWARN("Couldn't map %llu bytes of file - error %u", length, GetLastError());
+
+  return (byte *)ret;
+}
+
+void funmap(byte *mapping, uint64_t length)
+{
+  if(mapping)
+    UnmapViewOfFile(mapping);
+}
+
 bool fflush(FILE *f)
 {
   return ::fflush(f) == 0;
@@ -83,6 +83,11 @@ int32_t CmpExch32(int32_t *dest, int32_t oldVal, int32_t newVal)
 {
   return (int32_t)InterlockedCompareExchange((volatile LONG *)dest, newVal, oldVal);
 }
+
+int32_t Exch32(int32_t *dest, int32_t newVal)
+{
+  return (int32_t)InterlockedExchange((volatile LONG *)dest, newVal);
+}
 };
 
 namespace Threading
@@ -151,6 +156,26 @@ void RWLock::ReadUnlock()
   ReleaseSRWLockShared(&m_Data);
 }
 
+Semaphore::SemaphoreTemplate()
+{
+  m_Data = CreateSemaphore(NULL, 0, LONG_MAX, NULL);
+}
+
+Semaphore::~SemaphoreTemplate()
+{
+  CloseHandle(m_Data);
+}
+
+void Semaphore::Wake(uint32_t numToWake)
+{
+  ReleaseSemaphore(m_Data, (LONG)numToWake, NULL);
+}
+
+void Semaphore::WaitForWake()
+{
+  WaitForSingleObject(m_Data, INFINITE);
+}
+
 struct ThreadInitData
 {
   std::function<void()> entryFunc;
@@ -355,4 +380,11 @@ void Sleep(uint32_t milliseconds)
 {
   ::Sleep((DWORD)milliseconds);
 }
+
+uint32_t NumberOfCores()
+{
+  SYSTEM_INFO info = {};
+  GetSystemInfo(&info);
+  return info.dwNumberOfProcessors > 0 ? uint32_t(info.dwNumberOfProcessors) : 1U;
+}
 };
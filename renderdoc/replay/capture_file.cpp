@@ -354,6 +354,29 @@ rdcpair<ReplayStatus, IReplayController *> CaptureFile::OpenCapture(const Replay
   if(!m_RDC || m_RDC->ErrorCode() != ContainerError::NoError)
     return rdcpair<ReplayStatus, IReplayController *>(ReplayStatus::InternalError, NULL);
 
+  // resource contents stored incrementally need every capture they're based on, so check those are
+  // all there before loading rather than failing part way through
+  {
+    RDCIncrementalContents incremental;
+    rdcstr missing;
+
+    if(!incremental.Read(*m_RDC, m_RDC->GetFilename()))
+    {
+      m_ErrorString = "Incremental resource contents are corrupted.";
+      return rdcpair<ReplayStatus, IReplayController *>(ReplayStatus::FileCorrupted, NULL);
+    }
+
+    if(!incremental.FindBases(missing))
+    {
+      m_ErrorString = StringFormat::Fmt(
+          "Capture stores resource contents incrementally and needs the earlier capture '%s' "
+          "next to it, as it was when this capture was made.",
+          missing.c_str());
+      RDCERR("%s", m_ErrorString.c_str());
+      return rdcpair<ReplayStatus, IReplayController *>(ReplayStatus::FileNotFound, NULL);
+    }
+  }
+
   ReplayController *render = new ReplayController();
   ReplayStatus ret;
 
@@ -474,7 +497,7 @@ ReplayStatus CaptureFile::Convert(const rdcstr &filename, const rdcstr &filetype
     }
 
     SectionProperties frameCapture;
-    frameCapture.flags = SectionFlags::ZstdCompressed;
+    frameCapture.flags = SectionFlags::ZstdCompressed | SectionFlags::Seekable;
     frameCapture.type = SectionType::FrameCapture;
     frameCapture.name = ToStr(frameCapture.type);
     frameCapture.version = file->version;
@@ -495,7 +518,7 @@ ReplayStatus CaptureFile::Convert(const rdcstr &filename, const rdcstr &filetype
   {
     // otherwise write it straight, but compress it to zstd
     SectionProperties props = m_RDC->GetSectionProperties(frameCaptureIndex);
-    props.flags = SectionFlags::ZstdCompressed;
+    props.flags = SectionFlags::ZstdCompressed | SectionFlags::Seekable;
 
     StreamWriter *writer = output.WriteSection(props);
     StreamReader *reader = m_RDC->ReadSection(frameCaptureIndex);
@@ -521,6 +544,10 @@ ReplayStatus CaptureFile::Convert(const rdcstr &filename, const rdcstr &filetype
     if(props.type == SectionType::FrameCapture)
       continue;
 
+    // a frame capture written from structured data has all buffers inline, so blobs aren't needed
+    if(props.type == SectionType::Blobs && frameCaptureIndex == -1)
+      continue;
+
     StreamWriter *writer = output.WriteSection(props);
     StreamReader *reader = m_RDC->ReadSection(i);
 
@@ -196,6 +196,15 @@ void DummyDriver::GetTextureData(ResourceId tex, const Subresource &sub,
   data.clear();
 }
 
+void DummyDriver::FetchResourceData(const rdcarray<ResourceDataRequest> &requests,
+                                    rdcarray<bytebuf> &results, rdcarray<bool> &fetched)
+{
+  results.clear();
+  results.resize(requests.size());
+  fetched.clear();
+  fetched.resize(requests.size());
+}
+
 void DummyDriver::BuildTargetShader(ShaderEncoding sourceEncoding, const bytebuf &source,
                                     const rdcstr &entry, const ShaderCompileFlags &compileFlags,
                                     ShaderStage type, ResourceId &id, rdcstr &errors)
@@ -28,6 +28,7 @@
 #include "api/replay/version.h"
 #include "common/common.h"
 #include "common/formatting.h"
+#include "common/profiler.h"
 #include "core/core.h"
 #include "maths/camera.h"
 #include "maths/formatpacking.h"
@@ -956,12 +957,26 @@ extern "C" RENDERDOC_API int RENDERDOC_CC RENDERDOC_RunFunctionalTests(int pytho
   return mainFunc((int)wideArgStrings.size(), wideArgStrings.data());
 }
 
-extern "C" RENDERDOC_API void RENDERDOC_CC RENDERDOC_BeginProfileRegion(const rdcstr &name)
+RENDERDOC_API int32_t RENDERDOC_ProfileRegionsActive = 0;
+
+extern "C" RENDERDOC_API void RENDERDOC_CC RENDERDOC_BeginProfileRegion(const char *name)
 {
   Superluminal::BeginProfileRange(name);
+  Profiler::BeginRegion(name);
 }
 
 extern "C" RENDERDOC_API void RENDERDOC_CC RENDERDOC_EndProfileRegion()
 {
   Superluminal::EndProfileRange();
+  Profiler::EndRegion();
+}
+
+extern "C" RENDERDOC_API void RENDERDOC_CC RENDERDOC_SetProfileRecording(bool enabled)
+{
+  Profiler::SetRecording(enabled);
+}
+
+extern "C" RENDERDOC_API bool RENDERDOC_CC RENDERDOC_WriteProfileTrace(const rdcstr &filename)
+{
+  return Profiler::WriteTrace(filename);
 }
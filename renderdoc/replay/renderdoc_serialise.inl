@@ -97,6 +97,19 @@ void DoSerialise(SerialiserType &ser, EnvironmentModification &el)
   SIZE_CHECK(56);
 }
 
+template <class SerialiserType>
+void DoSerialise(SerialiserType &ser, APICallStatistics &el)
+{
+  SERIALISE_MEMBER(name);
+  SERIALISE_MEMBER(capturing);
+  SERIALISE_MEMBER(callCount);
+  SERIALISE_MEMBER(totalMicroseconds);
+  SERIALISE_MEMBER(driverMicroseconds);
+  SERIALISE_MEMBER(serialisedBytes);
+
+  SIZE_CHECK(64);
+}
+
 template <class SerialiserType>
 void DoSerialise(SerialiserType &ser, CaptureOptions &el)
 {
@@ -865,6 +878,18 @@ void DoSerialise(SerialiserType &ser, Subresource &el)
   SIZE_CHECK(12);
 }
 
+template <typename SerialiserType>
+void DoSerialise(SerialiserType &ser, ResourceDataRequest &el)
+{
+  SERIALISE_MEMBER(eventId);
+  SERIALISE_MEMBER(resourceId);
+  SERIALISE_MEMBER(subresource);
+  SERIALISE_MEMBER(byteOffset);
+  SERIALISE_MEMBER(byteSize);
+
+  SIZE_CHECK(48);
+}
+
 template <typename SerialiserType>
 void DoSerialise(SerialiserType &ser, ModificationValue &el)
 {
@@ -2336,6 +2361,7 @@ INSTANTIATE_SERIALISE_TYPE(ExecuteResult)
 INSTANTIATE_SERIALISE_TYPE(PathEntry)
 INSTANTIATE_SERIALISE_TYPE(SectionProperties)
 INSTANTIATE_SERIALISE_TYPE(EnvironmentModification)
+INSTANTIATE_SERIALISE_TYPE(APICallStatistics)
 INSTANTIATE_SERIALISE_TYPE(CaptureOptions)
 INSTANTIATE_SERIALISE_TYPE(ResourceFormat)
 INSTANTIATE_SERIALISE_TYPE(Bindpoint)
@@ -2385,6 +2411,7 @@ INSTANTIATE_SERIALISE_TYPE(Uuid)
 INSTANTIATE_SERIALISE_TYPE(CounterDescription)
 INSTANTIATE_SERIALISE_TYPE(PixelValue)
 INSTANTIATE_SERIALISE_TYPE(Subresource)
+INSTANTIATE_SERIALISE_TYPE(ResourceDataRequest)
 INSTANTIATE_SERIALISE_TYPE(PixelModification)
 INSTANTIATE_SERIALISE_TYPE(EventUsage)
 INSTANTIATE_SERIALISE_TYPE(CounterResult)
@@ -24,27 +24,48 @@
  ******************************************************************************/
 
 #include "replay_controller.h"
+#include <algorithm>
 #include <string.h>
 #include <time.h>
 #include "common/dds_readwrite.h"
+#include "common/image_write.h"
+#include "common/threading.h"
+#include "core/settings.h"
 #include "driver/ihv/amd/amd_isa.h"
 #include "driver/ihv/amd/amd_rgp.h"
-#include "jpeg-compressor/jpgd.h"
-#include "jpeg-compressor/jpge.h"
 #include "maths/formatpacking.h"
 #include "os/os_specific.h"
 #include "serialise/rdcfile.h"
 #include "serialise/serialiser.h"
-#include "stb/stb_image.h"
 #include "stb/stb_image_write.h"
 #include "strings/string_utils.h"
-#include "tinyexr/tinyexr.h"
+
+RDOC_CONFIG(uint32_t, Replay_PrefetchDistance, 2,
+            "When prefetching is enabled, how many actions after and before the current event to "
+            "speculatively fetch data for.");
+
+RDOC_CONFIG(uint32_t, Replay_PrefetchCacheSize, 8,
+            "When prefetching is enabled, how many events' pipeline states to keep cached. Eight "
+            "times as many output min/max values are kept.");
 
 static void fileWriteFunc(void *context, void *data, int size)
 {
   FileIO::fwrite(data, 1, size, (FILE *)context);
 }
 
+template <typename T>
+static void TrimPrefetchCache(rdcarray<T> &cache, size_t maxSize, uint32_t currentEvent)
+{
+  // evict oldest first, but never the current event's data since that's what will be restored
+  for(size_t i = 0; cache.size() > maxSize && i < cache.size();)
+  {
+    if(cache[i].eventId == currentEvent)
+      i++;
+    else
+      cache.erase(i);
+  }
+}
+
 ReplayController::ReplayController()
 {
   m_ThreadID = Threading::GetCurrentID();
@@ -73,6 +94,10 @@ void ReplayController::SetFrameEvent(uint32_t eventId, bool force)
 
   if(eventId != m_EventID || force)
   {
+    // a forced refresh means the replay may now differ, so nothing prefetched can be trusted
+    if(force)
+      ClearPrefetched();
+
     m_EventID = eventId;
 
     m_pDevice->ReplayLog(eventId, eReplay_WithoutDraw);
@@ -84,8 +109,242 @@ void ReplayController::SetFrameEvent(uint32_t eventId, bool force)
     m_pDevice->ReplayLog(eventId, eReplay_OnlyDraw);
     FatalErrorCheck();
 
-    FetchPipelineState(eventId);
+    if(!RestorePipelineState(eventId))
+    {
+      FetchPipelineState(eventId);
+      StorePipelineState(eventId);
+    }
+
+    PlanPrefetch(eventId);
+  }
+}
+
+void ReplayController::SetPrefetchEnabled(bool enabled)
+{
+  CHECK_REPLAY_THREAD();
+
+  m_PrefetchEnabled = enabled;
+  ClearPrefetched();
+}
+
+bool ReplayController::PrefetchStep()
+{
+  CHECK_REPLAY_THREAD();
+
+  RENDERDOC_PROFILEFUNCTION();
+
+  while(!m_PrefetchQueue.empty())
+  {
+    if(m_FatalError != ReplayStatus::Succeeded)
+    {
+      m_PrefetchQueue.clear();
+      break;
+    }
+
+    uint32_t eventId = m_PrefetchQueue.takeAt(0);
+
+    const ActionDescription *action = GetActionByEID(eventId);
+
+    if(action == NULL)
+      continue;
+
+    bool needState = true;
+    bool needPostVS = bool(action->flags & ActionFlags::Drawcall);
+
+    for(const PrefetchedPipelineState &s : m_PrefetchedStates)
+    {
+      if(s.eventId == eventId)
+      {
+        needState = false;
+        needPostVS = needPostVS && !s.postVS;
+        break;
+      }
+    }
+
+    rdcarray<ResourceId> targets;
+    for(ResourceId id : action->outputs)
+      if(id != ResourceId())
+        targets.push_back(id);
+    if(action->depthOut != ResourceId())
+      targets.push_back(action->depthOut);
+
+    targets.removeIf([this, eventId](const ResourceId &id) {
+      for(const PrefetchedMinMax &m : m_PrefetchedMinMax)
+        if(m.eventId == eventId && m.texture == id && m.sub == Subresource() &&
+           m.typeCast == CompType::Typeless)
+          return true;
+      return false;
+    });
+
+    // skip events that have everything cached already without replaying at all
+    if(!needState && !needPostVS && targets.empty())
+      continue;
+
+    m_pDevice->ReplayLog(eventId, eReplay_WithoutDraw);
+    m_pDevice->ReplayLog(eventId, eReplay_OnlyDraw);
+    FatalErrorCheck();
+
+    if(needState)
+    {
+      FetchPipelineState(eventId);
+      StorePipelineState(eventId);
+    }
+
+    for(ResourceId id : targets)
+    {
+      PrefetchedMinMax m = {};
+      m.eventId = eventId;
+      m.texture = id;
+      m.typeCast = CompType::Typeless;
+      m.minmax.first = {{0.0f, 0.0f, 0.0f, 0.0f}};
+      m.minmax.second = {{1.0f, 1.0f, 1.0f, 1.0f}};
+
+      m_pDevice->GetMinMax(m_pDevice->GetLiveID(id), m.sub, m.typeCast,
+                           &m.minmax.first.floatValue[0], &m.minmax.second.floatValue[0]);
+      FatalErrorCheck();
+
+      m_PrefetchedMinMax.push_back(m);
+    }
+
+    TrimPrefetchCache(m_PrefetchedMinMax, Replay_PrefetchCacheSize() * 8, m_EventID);
+
+    // the driver keeps post-transform data cached itself, so initialising it is enough
+    if(needPostVS)
+    {
+      m_pDevice->InitPostVSBuffers(eventId);
+      FatalErrorCheck();
+
+      for(PrefetchedPipelineState &s : m_PrefetchedStates)
+        if(s.eventId == eventId)
+          s.postVS = true;
+    }
+
+    // return to the current event so the next real request sees the state it expects
+    ReturnToCurrentEvent();
+
+    break;
+  }
+
+  return !m_PrefetchQueue.empty();
+}
+
+void ReplayController::ReturnToCurrentEvent()
+{
+  m_pDevice->ReplayLog(m_EventID, eReplay_WithoutDraw);
+  m_pDevice->ReplayLog(m_EventID, eReplay_OnlyDraw);
+  FatalErrorCheck();
+
+  if(!RestorePipelineState(m_EventID))
+    FetchPipelineState(m_EventID);
+}
+
+void ReplayController::PlanPrefetch(uint32_t eventId)
+{
+  m_PrefetchQueue.clear();
+
+  if(!m_PrefetchEnabled || m_Actions.empty())
+    return;
+
+  // find the nearest action to prefetch around. Events that aren't actions, or markers, have no
+  // entry in the table so search forward and then backward.
+  const ActionDescription *cur = NULL;
+  for(size_t i = eventId; i < m_Actions.size() && cur == NULL; i++)
+    if(m_Actions[i] && m_Actions[i]->children.empty())
+      cur = m_Actions[i];
+  for(size_t i = RDCMIN(size_t(eventId), m_Actions.size()); i > 0 && cur == NULL; i--)
+    if(m_Actions[i - 1] && m_Actions[i - 1]->children.empty())
+      cur = m_Actions[i - 1];
+
+  if(cur == NULL)
+    return;
+
+  // if the current event isn't itself an action, the nearest action is worth prefetching too
+  if(cur->eventId != eventId)
+    m_PrefetchQueue.push_back(cur->eventId);
+
+  // interleave next and previous so that stepping in either direction benefits. Stepping forward
+  // is more common so it goes first.
+  const ActionDescription *next = cur->next;
+  const ActionDescription *prev = cur->previous;
+  for(uint32_t i = 0; i < Replay_PrefetchDistance(); i++)
+  {
+    if(next)
+    {
+      m_PrefetchQueue.push_back(next->eventId);
+      next = next->next;
+    }
+    if(prev)
+    {
+      m_PrefetchQueue.push_back(prev->eventId);
+      prev = prev->previous;
+    }
+  }
+}
+
+void ReplayController::ClearPrefetched()
+{
+  m_PrefetchQueue.clear();
+  m_PrefetchedStates.clear();
+  m_PrefetchedMinMax.clear();
+}
+
+void ReplayController::StorePipelineState(uint32_t eventId)
+{
+  if(!m_PrefetchEnabled)
+    return;
+
+  PrefetchedPipelineState *s = NULL;
+  for(PrefetchedPipelineState &p : m_PrefetchedStates)
+    if(p.eventId == eventId)
+      s = &p;
+
+  if(s == NULL)
+  {
+    m_PrefetchedStates.push_back(PrefetchedPipelineState());
+    s = &m_PrefetchedStates.back();
+    s->eventId = eventId;
+    s->postVS = false;
+  }
+
+  // only the state for the capture's API is filled out, so that's all that needs to be kept
+  if(m_APIProps.pipelineType == GraphicsAPI::D3D11)
+    s->d3d11 = m_D3D11PipelineState;
+  else if(m_APIProps.pipelineType == GraphicsAPI::D3D12)
+    s->d3d12 = m_D3D12PipelineState;
+  else if(m_APIProps.pipelineType == GraphicsAPI::OpenGL)
+    s->gl = m_GLPipelineState;
+  else if(m_APIProps.pipelineType == GraphicsAPI::Vulkan)
+    s->vulkan = m_VulkanPipelineState;
+
+  TrimPrefetchCache(m_PrefetchedStates, RDCMAX(1U, Replay_PrefetchCacheSize()), m_EventID);
+}
+
+bool ReplayController::RestorePipelineState(uint32_t eventId)
+{
+  if(!m_PrefetchEnabled)
+    return false;
+
+  for(const PrefetchedPipelineState &s : m_PrefetchedStates)
+  {
+    if(s.eventId != eventId)
+      continue;
+
+    // m_PipeState already points at these members, only their contents change. The drivers'
+    // SavePipelineState only fills in these structs and per-event caches, so skipping it is safe.
+    // D3D11 also tracks the output merger, which it updates on every replay instead.
+    if(m_APIProps.pipelineType == GraphicsAPI::D3D11)
+      m_D3D11PipelineState = s.d3d11;
+    else if(m_APIProps.pipelineType == GraphicsAPI::D3D12)
+      m_D3D12PipelineState = s.d3d12;
+    else if(m_APIProps.pipelineType == GraphicsAPI::OpenGL)
+      m_GLPipelineState = s.gl;
+    else if(m_APIProps.pipelineType == GraphicsAPI::Vulkan)
+      m_VulkanPipelineState = s.vulkan;
+
+    return true;
   }
+
+  return false;
 }
 
 const D3D11Pipe::State *ReplayController::GetD3D11PipelineState()
@@ -553,6 +812,175 @@ bytebuf ReplayController::GetTextureData(ResourceId tex, const Subresource &sub)
   return ret;
 }
 
+rdcarray<bytebuf> ReplayController::FetchResourceData(const rdcarray<ResourceDataRequest> &requests,
+                                                      uint64_t memoryCap,
+                                                      RENDERDOC_ResourceDataCallback callback)
+{
+  CHECK_REPLAY_THREAD();
+  RENDERDOC_PROFILEFUNCTION();
+
+  rdcarray<bytebuf> ret;
+
+  if(requests.empty())
+    return ret;
+
+  if(!callback)
+    ret.resize(requests.size());
+
+  std::map<ResourceId, const BufferDescription *> buffers;
+  for(const BufferDescription &b : m_Buffers)
+    buffers[b.resourceId] = &b;
+
+  std::map<ResourceId, const TextureDescription *> textures;
+  for(const TextureDescription &t : m_Textures)
+    textures[t.resourceId] = &t;
+
+  // the drivers replay forwards through the frame, so handle the requests in event order. Markers
+  // are remapped to their last child event the same way SetFrameEvent does.
+  rdcarray<ResourceDataRequest> sorted = requests;
+  for(ResourceDataRequest &req : sorted)
+  {
+    auto it = m_EventRemap.find(req.eventId);
+    if(it != m_EventRemap.end())
+      req.eventId = it->second;
+  }
+
+  rdcarray<size_t> order;
+  order.resize(requests.size());
+  for(size_t i = 0; i < order.size(); i++)
+    order[i] = i;
+
+  std::stable_sort(order.begin(), order.end(), [&sorted](size_t a, size_t b) {
+    return sorted[a].eventId < sorted[b].eventId;
+  });
+
+  // estimate how much each request will copy, to split the work into passes under the memory cap
+  auto estimateSize = [&buffers, &textures](const ResourceDataRequest &req) -> uint64_t {
+    auto bit = buffers.find(req.resourceId);
+    if(bit != buffers.end())
+    {
+      uint64_t length = bit->second->length;
+      if(req.byteOffset >= length)
+        return 0;
+      if(req.byteSize == 0)
+        return length - req.byteOffset;
+      return RDCMIN(req.byteSize, length - req.byteOffset);
+    }
+
+    auto tit = textures.find(req.resourceId);
+    if(tit != textures.end())
+    {
+      const TextureDescription &tex = *tit->second;
+      uint32_t mip = RDCMIN(req.subresource.mip, RDCMAX(tex.mips, 1U) - 1);
+      uint64_t texels = uint64_t(RDCMAX(1U, tex.width >> mip)) * RDCMAX(1U, tex.height >> mip);
+      if(tex.type == TextureType::Texture3D)
+        texels *= RDCMAX(1U, tex.depth >> mip);
+      // block compressed sizes are per-block, so this over-estimates them, which is fine
+      return texels * RDCMAX(tex.format.ElementSize(), 4U);
+    }
+
+    return 0;
+  };
+
+  uint32_t prevEvent = ~0U;
+
+  auto deliver = [&](size_t idx, bytebuf &data) {
+    if(callback)
+      callback((uint32_t)idx, data);
+    else
+      ret[idx].swap(data);
+  };
+
+  size_t passStart = 0;
+  while(passStart < order.size())
+  {
+    // take requests until the cap would be exceeded, always at least one so we make progress
+    size_t passEnd = passStart;
+    uint64_t passSize = 0;
+    while(passEnd < order.size())
+    {
+      uint64_t size = estimateSize(sorted[order[passEnd]]);
+      if(memoryCap > 0 && passEnd > passStart && passSize + size > memoryCap)
+        break;
+      passSize += size;
+      passEnd++;
+    }
+
+    rdcarray<ResourceDataRequest> passRequests;
+    for(size_t i = passStart; i < passEnd; i++)
+    {
+      ResourceDataRequest req = sorted[order[i]];
+      req.resourceId = m_pDevice->GetLiveID(req.resourceId);
+      if(req.resourceId == ResourceId())
+        RDCERR("Couldn't get Live ID for %s fetching resource data",
+               ToStr(sorted[order[i]].resourceId).c_str());
+      passRequests.push_back(req);
+    }
+
+    rdcarray<bytebuf> passResults;
+    rdcarray<bool> passFetched;
+    m_pDevice->FetchResourceData(passRequests, passResults, passFetched);
+    FatalErrorCheck();
+
+    passResults.resize(passRequests.size());
+    passFetched.resize(passRequests.size());
+
+    // fetch anything the driver couldn't in its replay individually
+    for(size_t i = 0; i < passRequests.size(); i++)
+    {
+      const ResourceDataRequest &req = passRequests[i];
+
+      if(!passFetched[i] && req.resourceId != ResourceId())
+      {
+        if(req.eventId != prevEvent)
+        {
+          m_pDevice->ReplayLog(req.eventId, eReplay_Full);
+          FatalErrorCheck();
+          prevEvent = req.eventId;
+        }
+
+        if(textures.find(sorted[order[passStart + i]].resourceId) != textures.end())
+          m_pDevice->GetTextureData(req.resourceId, req.subresource, GetTextureDataParams(),
+                                    passResults[i]);
+        else
+          m_pDevice->GetBufferData(req.resourceId, req.byteOffset, req.byteSize, passResults[i]);
+        FatalErrorCheck();
+      }
+
+      deliver(order[passStart + i], passResults[i]);
+    }
+
+    // any further fallback needs to replay again since the next pass will have moved the replay
+    prevEvent = ~0U;
+
+    passStart = passEnd;
+  }
+
+  // put the replay back where it was. Nothing was changed so prefetched data is still valid
+  ReturnToCurrentEvent();
+
+  return ret;
+}
+
+// splats one channel of each pixel across the others and sets alpha to full, for a greyscale image
+// of one channel
+static void ExtractChannel(byte *data, size_t numPixels, const ResourceFormat &fmt,
+                           uint32_t channel)
+{
+  const uint32_t compWidth = fmt.compByteWidth;
+  const uint32_t pixelStride = fmt.compCount * compWidth;
+  const uint32_t max = ~0U;
+
+  for(size_t i = 0; i < numPixels; i++, data += pixelStride)
+  {
+    uint32_t val = 0;
+    memcpy(&val, data + channel * compWidth, compWidth);
+
+    for(uint32_t c = 0; c < fmt.compCount; c++)
+      memcpy(data + c * compWidth, c == 3 ? &max : &val, compWidth);
+  }
+}
+
 bool ReplayController::SaveTexture(const TextureSave &saveData, const rdcstr &path)
 {
   CHECK_REPLAY_THREAD();
@@ -720,7 +1148,7 @@ bool ReplayController::SaveTexture(const TextureSave &saveData, const rdcstr &pa
     // otherwise take all mips, as by default
   }
 
-  rdcarray<byte *> subdata;
+  rdcarray<bytebuf> subdata;
 
   bool downcast = false;
 
@@ -869,18 +1297,13 @@ bool ReplayController::SaveTexture(const TextureSave &saveData, const rdcstr &pa
       if(data.empty())
       {
         RDCERR("Couldn't get bytes for mip %u, slice %u", mip, slice);
-
-        for(size_t i = 0; i < subdata.size(); i++)
-          delete[] subdata[i];
-
         return false;
       }
 
       if(td.depth == 1)
       {
-        byte *bytes = new byte[data.size()];
-        memcpy(bytes, data.data(), data.size());
-        subdata.push_back(bytes);
+        subdata.push_back(bytebuf());
+        subdata.back().swap(data);
         continue;
       }
 
@@ -905,10 +1328,8 @@ bool ReplayController::SaveTexture(const TextureSave &saveData, const rdcstr &pa
       // then make sure we get it
       if(numSlices == 1)
       {
-        byte *depthslice = new byte[mipSlicePitch];
-        byte *b = data.data() + mipSlicePitch * sliceOffset;
-        memcpy(depthslice, b, slicePitch);
-        subdata.push_back(depthslice);
+        subdata.push_back(bytebuf());
+        subdata.back().assign(data.data() + mipSlicePitch * sliceOffset, mipSlicePitch);
 
         continue;
       }
@@ -920,81 +1341,99 @@ bool ReplayController::SaveTexture(const TextureSave &saveData, const rdcstr &pa
       // add each depth slice as a separate subdata
       for(uint32_t di = 0; di < d; di++)
       {
-        byte *depthslice = new byte[mipSlicePitch];
-
-        memcpy(depthslice, b, mipSlicePitch);
-
-        subdata.push_back(depthslice);
+        subdata.push_back(bytebuf());
+        subdata.back().assign(b, mipSlicePitch);
 
         b += mipSlicePitch;
       }
     }
   }
 
-  // should have been handled above, but verify incoming data is RGBA8 or RGBA32
-  if(sd.slice.slicesAsGrid && (td.format.compByteWidth == 1 || td.format.compByteWidth == 4) &&
-     td.format.compCount == 4 && !td.format.Special())
-  {
-    uint32_t sliceWidth = td.width;
-    uint32_t sliceHeight = td.height;
+  // if we want a grayscale image of one channel, splat it across all channels
+  // and set alpha to full
+  const bool extractChannel = sd.channelExtract >= 0 &&
+                              td.format.type == ResourceFormatType::Regular &&
+                              (td.format.compByteWidth == 1 || td.format.compByteWidth == 4) &&
+                              (uint32_t)sd.channelExtract < td.format.compCount;
 
-    uint32_t sliceGridHeight = (td.arraysize * td.depth) / sd.slice.sliceGridWidth;
-    if((td.arraysize * td.depth) % sd.slice.sliceGridWidth != 0)
-      sliceGridHeight++;
+  FILE *f = FileIO::fopen(path, FileIO::WriteBinary);
 
-    td.width *= sd.slice.sliceGridWidth;
-    td.height *= sliceGridHeight;
+  if(!f)
+  {
+    RDCERR("Couldn't write to path %s, error: %s", path.c_str(), FileIO::ErrorString().c_str());
+    return false;
+  }
 
-    uint32_t pixelStride = td.format.compCount * td.format.compByteWidth;
+  if(sd.destType == FileType::DDS)
+  {
+    if(extractChannel)
+    {
+      const uint32_t pixelStride = td.format.compCount * td.format.compByteWidth;
 
-    byte *combinedData = new byte[td.width * td.height * pixelStride];
+      Threading::Jobs::ParallelFor(0, (uint32_t)subdata.size(), [&](uint32_t i) {
+        ExtractChannel(subdata[i].data(), subdata[i].size() / pixelStride, td.format,
+                       sd.channelExtract);
+      });
+    }
 
-    memset(combinedData, 0, td.width * td.height * pixelStride);
+    write_dds_data ddsData;
 
-    for(size_t i = 0; i < subdata.size(); i++)
-    {
-      uint32_t gridx = (uint32_t)i % sd.slice.sliceGridWidth;
-      uint32_t gridy = (uint32_t)i / sd.slice.sliceGridWidth;
+    ResourceFormat saveFmt = td.format;
+    // use typeCast to inform typeless saving, otherwise it will get lost
+    if(saveFmt.compType == CompType::Typeless)
+      saveFmt.compType = sd.typeCast;
 
-      uint32_t yoffs = gridy * sliceHeight;
-      uint32_t xoffs = gridx * sliceWidth;
+    ddsData.width = td.width;
+    ddsData.height = td.height;
+    ddsData.depth = td.depth;
+    ddsData.format = saveFmt;
+    ddsData.mips = numMips;
+    ddsData.slices = numSlices / td.depth;
+    for(bytebuf &sub : subdata)
+      ddsData.subresources.push_back(sub.data());
+    ddsData.cubemap = td.cubemap && numSlices == 6;
 
-      for(uint32_t y = 0; y < sliceHeight; y++)
-      {
-        for(uint32_t x = 0; x < sliceWidth; x++)
-        {
-          uint32_t *srcpix = (uint32_t *)&subdata[i][(y * sliceWidth + x) * pixelStride + 0];
-          uint32_t *dstpix =
-              (uint32_t *)&combinedData[((y + yoffs) * td.width + x + xoffs) * pixelStride + 0];
+    if(singleSlice)
+      ddsData.depth = ddsData.slices = 1;
 
-          memcpy(dstpix, srcpix, pixelStride);
-        }
-      }
+    success = write_dds_to_file(f, ddsData);
 
-      delete[] subdata[i];
-    }
+    FileIO::fclose(f);
 
-    subdata.resize(1);
-    subdata[0] = combinedData;
-    rowPitch = td.width * 4;
+    return success;
   }
 
-  // should have been handled above, but verify incoming data is RGBA8 or RGBA32 and 6 slices
-  if(sd.slice.cubeCruciform && (td.format.compByteWidth == 1 || td.format.compByteWidth == 4) &&
-     td.format.compCount == 4 && !td.format.Special() && subdata.size() == 6)
-  {
-    uint32_t sliceWidth = td.width;
-    uint32_t sliceHeight = td.height;
-
-    td.width *= 4;
-    td.height *= 3;
+  // everything else writes a single image, made up of a grid of cells that each show one
+  // subresource. Normally that's a single cell, unless slices are being laid out as a grid or a
+  // cube cruciform. Rows of the image are assembled from the cells as the writers ask for them, so
+  // we don't need a combined copy of every slice.
+  const uint32_t cellWidth = td.width;
+  const uint32_t cellHeight = td.height;
 
-    uint32_t pixelStride = td.format.compCount * td.format.compByteWidth;
+  uint32_t cellsX = 1;
+  rdcarray<int32_t> cellSubresource = {0};
 
-    byte *combinedData = new byte[td.width * td.height * pixelStride];
+  // should have been handled above, but verify incoming data is RGBA8 or RGBA32
+  if(sd.slice.slicesAsGrid && (td.format.compByteWidth == 1 || td.format.compByteWidth == 4) &&
+     td.format.compCount == 4 && !td.format.Special())
+  {
+    uint32_t sliceGridHeight = (td.arraysize * td.depth) / sd.slice.sliceGridWidth;
+    if((td.arraysize * td.depth) % sd.slice.sliceGridWidth != 0)
+      sliceGridHeight++;
 
-    memset(combinedData, 0, td.width * td.height * pixelStride);
+    cellsX = sd.slice.sliceGridWidth;
+    cellSubresource.resize(cellsX * sliceGridHeight);
+    for(size_t i = 0; i < cellSubresource.size(); i++)
+      cellSubresource[i] = i < subdata.size() ? int32_t(i) : -1;
 
+    td.width *= sd.slice.sliceGridWidth;
+    td.height *= sliceGridHeight;
+  }
+  // should have been handled above, but verify incoming data is RGBA8 or RGBA32 and 6 slices
+  else if(sd.slice.cubeCruciform &&
+          (td.format.compByteWidth == 1 || td.format.compByteWidth == 4) &&
+          td.format.compCount == 4 && !td.format.Special() && subdata.size() == 6)
+  {
     /*
      Y X=0   1   2   3
      =     +---+
@@ -1013,404 +1452,220 @@ bool ReplayController::SaveTexture(const TextureSave &saveData, const rdcstr &pa
     uint32_t gridx[6] = {2, 0, 1, 1, 1, 3};
     uint32_t gridy[6] = {1, 1, 0, 2, 1, 1};
 
-    for(size_t i = 0; i < subdata.size(); i++)
-    {
-      uint32_t yoffs = gridy[i] * sliceHeight;
-      uint32_t xoffs = gridx[i] * sliceWidth;
+    cellsX = 4;
+    cellSubresource.fill(4 * 3, -1);
+    for(int32_t i = 0; i < 6; i++)
+      cellSubresource[gridy[i] * 4 + gridx[i]] = i;
 
-      for(uint32_t y = 0; y < sliceHeight; y++)
-      {
-        for(uint32_t x = 0; x < sliceWidth; x++)
-        {
-          uint32_t *srcpix = (uint32_t *)&subdata[i][(y * sliceWidth + x) * pixelStride + 0];
-          uint32_t *dstpix =
-              (uint32_t *)&combinedData[((y + yoffs) * td.width + x + xoffs) * pixelStride + 0];
+    td.width *= 4;
+    td.height *= 3;
+  }
 
-          memcpy(dstpix, srcpix, pixelStride);
-        }
-      }
+  ResourceFormat saveFmt = td.format;
+  if(saveFmt.compType == CompType::Typeless)
+    saveFmt.compType = sd.typeCast;
+  if(saveFmt.compType == CompType::Typeless)
+    saveFmt.compType = saveFmt.compByteWidth == 4 ? CompType::Float : CompType::UNorm;
 
-      delete[] subdata[i];
-    }
+  uint32_t pixelStride = saveFmt.ElementSize();
 
-    subdata.resize(1);
-    subdata[0] = combinedData;
-    rowPitch = td.width * 4;
-  }
+  // 24-bit depth still has a stride of 4 bytes.
+  if(saveFmt.compType == CompType::Depth && pixelStride == 3)
+    pixelStride = 4;
 
-  int numComps = td.format.compCount;
+  const size_t cellRowBytes = size_t(cellWidth) * pixelStride;
 
-  // if we want a grayscale image of one channel, splat it across all channels
-  // and set alpha to full
-  if(sd.channelExtract >= 0 && td.format.type == ResourceFormatType::Regular &&
-     (td.format.compByteWidth == 1 || td.format.compByteWidth == 4) &&
-     (uint32_t)sd.channelExtract < td.format.compCount)
-  {
-    uint32_t pixelStride = td.format.compCount * td.format.compByteWidth;
-    uint32_t compWidth = td.format.compByteWidth;
-    uint32_t compCount = td.format.compCount;
+  // returns row y of the image in the source format. When there's more than one cell the row is
+  // assembled in scratch, with empty cells left black
+  auto sourceRow = [&](uint32_t y, bytebuf &scratch) -> const byte * {
+    const uint32_t cellY = y / cellHeight;
+    const size_t offset = (y % cellHeight) * cellRowBytes;
 
-    uint32_t val = 0;
-    uint32_t max = ~0U;
+    if(cellSubresource.size() == 1)
+      return subdata[0].data() + offset;
 
-    for(uint32_t y = 0; y < td.height; y++)
+    scratch.resize(cellRowBytes * cellsX);
+    for(uint32_t x = 0; x < cellsX; x++)
     {
-      for(uint32_t x = 0; x < td.width; x++)
-      {
-        memcpy(&val, &subdata[0][(y * td.width + x) * pixelStride + sd.channelExtract * compWidth],
-               td.format.compByteWidth);
+      const int32_t sub = cellSubresource[cellY * cellsX + x];
+      byte *dst = scratch.data() + x * cellRowBytes;
 
-        switch(compCount)
-        {
-          case 4:
-            memcpy(&subdata[0][(y * td.width + x) * pixelStride + 3 * compWidth], &max,
-                   td.format.compByteWidth);
-            DELIBERATE_FALLTHROUGH();
-          case 3:
-            memcpy(&subdata[0][(y * td.width + x) * pixelStride + 2 * compWidth], &val,
-                   td.format.compByteWidth);
-            DELIBERATE_FALLTHROUGH();
-          case 2:
-            memcpy(&subdata[0][(y * td.width + x) * pixelStride + 1 * compWidth], &val,
-                   td.format.compByteWidth);
-            DELIBERATE_FALLTHROUGH();
-          case 1:
-            memcpy(&subdata[0][(y * td.width + x) * pixelStride + 0 * compWidth], &val,
-                   td.format.compByteWidth);
-            break;
-        }
-      }
+      if(sub >= 0)
+        memcpy(dst, subdata[sub].data() + offset, cellRowBytes);
+      else
+        memset(dst, 0, cellRowBytes);
     }
-  }
+    return scratch.data();
+  };
+
+  int numComps = td.format.compCount;
 
   // handle formats that don't support alpha
-  if(numComps == 4 && (sd.destType == FileType::BMP || sd.destType == FileType::JPG))
+  const bool removeAlpha =
+      numComps == 4 && (sd.destType == FileType::BMP || sd.destType == FileType::JPG);
+
+  // assume that (R,G,0) is better mapping than (Y,A) for 2 component data
+  const bool expandRG =
+      numComps == 2 && (sd.destType == FileType::BMP || sd.destType == FileType::JPG ||
+                        sd.destType == FileType::PNG || sd.destType == FileType::TGA);
+
+  if(removeAlpha || expandRG)
+    numComps = 3;
+
+  Vec3f alphaCols[3];
   {
-    byte *nonalpha = new byte[td.width * td.height * 3];
+    FloatVector cols[3] = {sd.alphaCol, RenderDoc::Inst().DarkCheckerboardColor(),
+                           RenderDoc::Inst().LightCheckerboardColor()};
+
+    for(int i = 0; i < 3; i++)
+      alphaCols[i] = Vec3f(ConvertLinearToSRGB(cols[i].x), ConvertLinearToSRGB(cols[i].y),
+                           ConvertLinearToSRGB(cols[i].z));
+  }
+
+  // converts rows of the image to 8-bit with numComps channels, for the LDR formats. The source is
+  // always RGBA8 here, since we downcast for anything else.
+  ImageRowsCallback convertRows8 = [&](uint32_t y, uint32_t numRows, byte *dst) {
+    bytebuf scratch, extracted;
 
-    for(uint32_t y = 0; y < td.height; y++)
+    for(uint32_t row = y; row < y + numRows; row++, dst += td.width * numComps)
     {
-      for(uint32_t x = 0; x < td.width; x++)
+      const byte *src = sourceRow(row, scratch);
+
+      if(extractChannel)
       {
-        byte r = subdata[0][(y * td.width + x) * 4 + 0];
-        byte g = subdata[0][(y * td.width + x) * 4 + 1];
-        byte b = subdata[0][(y * td.width + x) * 4 + 2];
-        byte a = subdata[0][(y * td.width + x) * 4 + 3];
+        extracted.assign(src, td.width * pixelStride);
+        ExtractChannel(extracted.data(), td.width, td.format, sd.channelExtract);
+        src = extracted.data();
+      }
 
-        if(sd.alpha != AlphaMapping::Discard)
+      if(removeAlpha && sd.alpha == AlphaMapping::Discard)
+      {
+        for(uint32_t x = 0; x < td.width; x++)
+          memcpy(dst + x * 3, src + x * 4, 3);
+      }
+      else if(removeAlpha && sd.alpha == AlphaMapping::BlendToCheckerboard)
+      {
+        // blend a checker square at a time
+        for(uint32_t x = 0; x < td.width; x += 64)
         {
-          Vec4f col = Vec4f(sd.alphaCol.x, sd.alphaCol.y, sd.alphaCol.z);
-          if(sd.alpha == AlphaMapping::BlendToCheckerboard)
-          {
-            bool lightSquare = ((x / 64) % 2) == ((y / 64) % 2);
-            col = lightSquare ? RenderDoc::Inst().LightCheckerboardColor()
-                              : RenderDoc::Inst().DarkCheckerboardColor();
-          }
-
-          col.x = ConvertLinearToSRGB(col.x);
-          col.y = ConvertLinearToSRGB(col.y);
-          col.z = ConvertLinearToSRGB(col.z);
-
-          FloatVector pixel = FloatVector(float(r) / 255.0f, float(g) / 255.0f, float(b) / 255.0f,
-                                          float(a) / 255.0f);
-
-          pixel.x = pixel.x * pixel.w + col.x * (1.0f - pixel.w);
-          pixel.y = pixel.y * pixel.w + col.y * (1.0f - pixel.w);
-          pixel.z = pixel.z * pixel.w + col.z * (1.0f - pixel.w);
-
-          r = byte(pixel.x * 255.0f);
-          g = byte(pixel.y * 255.0f);
-          b = byte(pixel.z * 255.0f);
+          bool lightSquare = ((x / 64) % 2) == ((row / 64) % 2);
+          BlendRGBA8OverColor(src + x * 4, dst + x * 3, RDCMIN(64U, td.width - x),
+                              alphaCols[lightSquare ? 2 : 1]);
         }
-
-        nonalpha[(y * td.width + x) * 3 + 0] = r;
-        nonalpha[(y * td.width + x) * 3 + 1] = g;
-        nonalpha[(y * td.width + x) * 3 + 2] = b;
+      }
+      else if(removeAlpha)
+      {
+        BlendRGBA8OverColor(src, dst, td.width, alphaCols[0]);
+      }
+      else if(expandRG)
+      {
+        for(uint32_t x = 0; x < td.width; x++)
+        {
+          dst[x * 3 + 0] = src[x * 2 + 0];
+          dst[x * 3 + 1] = src[x * 2 + 1];
+          // if we're greyscaling the image, then keep the greyscale here.
+          dst[x * 3 + 2] = sd.channelExtract >= 0 ? src[x * 2 + 0] : 0;
+        }
+      }
+      else
+      {
+        memcpy(dst, src, td.width * numComps);
       }
     }
+  };
 
-    delete[] subdata[0];
-
-    subdata[0] = nonalpha;
-
-    numComps = 3;
-    rowPitch = td.width * 3;
-  }
+  // converts rows of the image to RGBA32 float, for the HDR formats
+  ImageRowsCallback convertRowsFloat = [&](uint32_t y, uint32_t numRows, byte *dst) {
+    bytebuf scratch;
+    FloatVector *pixels = (FloatVector *)dst;
 
-  // assume that (R,G,0) is better mapping than (Y,A) for 2 component data
-  if(numComps == 2 && (sd.destType == FileType::BMP || sd.destType == FileType::JPG ||
-                       sd.destType == FileType::PNG || sd.destType == FileType::TGA))
-  {
-    byte *rg0 = new byte[td.width * td.height * 3];
-
-    for(uint32_t y = 0; y < td.height; y++)
+    for(uint32_t row = y; row < y + numRows; row++, pixels += td.width)
     {
+      DecodeFormattedComponentsRow(saveFmt, sourceRow(row, scratch), pixelStride, td.width, pixels);
+
       for(uint32_t x = 0; x < td.width; x++)
       {
-        byte r = subdata[0][(y * td.width + x) * 2 + 0];
-        byte g = subdata[0][(y * td.width + x) * 2 + 1];
+        FloatVector &pixel = pixels[x];
 
-        rg0[(y * td.width + x) * 3 + 0] = r;
-        rg0[(y * td.width + x) * 3 + 1] = g;
-        rg0[(y * td.width + x) * 3 + 2] = 0;
+        // HDR can't represent negative values
+        if(sd.destType == FileType::HDR)
+        {
+          pixel.x = RDCMAX(pixel.x, 0.0f);
+          pixel.y = RDCMAX(pixel.y, 0.0f);
+          pixel.z = RDCMAX(pixel.z, 0.0f);
+          pixel.w = RDCMAX(pixel.w, 0.0f);
+        }
 
-        // if we're greyscaling the image, then keep the greyscale here.
-        if(sd.channelExtract >= 0)
-          rg0[(y * td.width + x) * 3 + 2] = r;
+        if(sd.channelExtract >= 0 && sd.channelExtract < 4)
+        {
+          pixel.x = pixel.y = pixel.z = (&pixel.x)[sd.channelExtract];
+          pixel.w = 1.0f;
+        }
       }
     }
+  };
 
-    delete[] subdata[0];
-
-    subdata[0] = rg0;
+  if(sd.destType == FileType::BMP || sd.destType == FileType::TGA)
+  {
+    // stb writes these from a whole image, so convert it all up front
+    const size_t rowBytes = td.width * numComps;
 
-    numComps = 3;
-    rowPitch = td.width * 3;
-  }
+    bytebuf image;
+    image.resize(rowBytes * td.height);
 
-  FILE *f = FileIO::fopen(path, FileIO::WriteBinary);
+    Threading::Jobs::ParallelFor(
+        0, td.height, [&](uint32_t y) { convertRows8(y, 1, image.data() + y * rowBytes); });
 
-  if(!f)
-  {
-    success = false;
-    RDCERR("Couldn't write to path %s, error: %s", path.c_str(), FileIO::ErrorString().c_str());
-  }
-  else
-  {
-    if(sd.destType == FileType::DDS)
-    {
-      write_dds_data ddsData;
-
-      ResourceFormat saveFmt = td.format;
-      // use typeCast to inform typeless saving, otherwise it will get lost
-      if(saveFmt.compType == CompType::Typeless)
-        saveFmt.compType = sd.typeCast;
-
-      ddsData.width = td.width;
-      ddsData.height = td.height;
-      ddsData.depth = td.depth;
-      ddsData.format = saveFmt;
-      ddsData.mips = numMips;
-      ddsData.slices = numSlices / td.depth;
-      ddsData.subresources = subdata;
-      ddsData.cubemap = td.cubemap && numSlices == 6;
-
-      if(singleSlice)
-        ddsData.depth = ddsData.slices = 1;
-
-      success = write_dds_to_file(f, ddsData);
-    }
-    else if(sd.destType == FileType::BMP)
+    if(sd.destType == FileType::BMP)
     {
       int ret = stbi_write_bmp_to_func(fileWriteFunc, (void *)f, td.width, td.height, numComps,
-                                       subdata[0]);
+                                       image.data());
       success = (ret != 0);
 
       if(!success)
         RDCERR("stbi_write_bmp_to_func failed: %d", ret);
     }
-    else if(sd.destType == FileType::PNG)
-    {
-      int ret = stbi_write_png_to_func(fileWriteFunc, (void *)f, td.width, td.height, numComps,
-                                       subdata[0], rowPitch);
-      success = (ret != 0);
-
-      if(!success)
-        RDCERR("stbi_write_png_to_func failed: %d", ret);
-    }
-    else if(sd.destType == FileType::TGA)
+    else
     {
       int ret = stbi_write_tga_to_func(fileWriteFunc, (void *)f, td.width, td.height, numComps,
-                                       subdata[0]);
+                                       image.data());
       success = (ret != 0);
 
       if(!success)
         RDCERR("stbi_write_tga_to_func failed: %d", ret);
     }
-    else if(sd.destType == FileType::JPG)
-    {
-      jpge::params p;
-      p.m_quality = sd.jpegQuality;
-
-      int len = td.width * td.height * td.format.compCount;
-      // ensure buffer is at least 1024
-      if(len < 1024)
-        len = 1024;
-
-      char *jpgdst = new char[len];
-
-      success = jpge::compress_image_to_jpeg_file_in_memory(jpgdst, len, td.width, td.height,
-                                                            numComps, subdata[0], p);
-
-      if(!success)
-        RDCERR("jpge::compress_image_to_jpeg_file_in_memory failed");
-
-      if(success)
-        fwrite(jpgdst, 1, len, f);
-
-      delete[] jpgdst;
-    }
-    else if(sd.destType == FileType::HDR || sd.destType == FileType::EXR)
-    {
-      float *fldata = NULL;
-      float *abgr[4] = {NULL, NULL, NULL, NULL};
-
-      if(sd.destType == FileType::HDR)
-      {
-        fldata = new float[td.width * td.height * 4];
-      }
-      else
-      {
-        abgr[0] = new float[td.width * td.height];
-        abgr[1] = new float[td.width * td.height];
-        abgr[2] = new float[td.width * td.height];
-        abgr[3] = new float[td.width * td.height];
-      }
-
-      byte *srcData = subdata[0];
-
-      ResourceFormat saveFmt = td.format;
-      if(saveFmt.compType == CompType::Typeless)
-        saveFmt.compType = sd.typeCast;
-      if(saveFmt.compType == CompType::Typeless)
-        saveFmt.compType = saveFmt.compByteWidth == 4 ? CompType::Float : CompType::UNorm;
-
-      uint32_t pixStride = saveFmt.ElementSize();
-
-      // 24-bit depth still has a stride of 4 bytes.
-      if(saveFmt.compType == CompType::Depth && pixStride == 3)
-        pixStride = 4;
-
-      for(uint32_t y = 0; y < td.height; y++)
-      {
-        for(uint32_t x = 0; x < td.width; x++)
-        {
-          FloatVector pixel = DecodeFormattedComponents(saveFmt, srcData);
-          srcData += pixStride;
-
-          // HDR can't represent negative values
-          if(sd.destType == FileType::HDR)
-          {
-            pixel.x = RDCMAX(pixel.x, 0.0f);
-            pixel.y = RDCMAX(pixel.y, 0.0f);
-            pixel.z = RDCMAX(pixel.z, 0.0f);
-            pixel.w = RDCMAX(pixel.w, 0.0f);
-          }
-
-          if(sd.channelExtract == 0)
-          {
-            pixel.y = pixel.z = pixel.x;
-            pixel.w = 1.0f;
-          }
-          else if(sd.channelExtract == 1)
-          {
-            pixel.x = pixel.z = pixel.y;
-            pixel.w = 1.0f;
-          }
-          else if(sd.channelExtract == 2)
-          {
-            pixel.x = pixel.y = pixel.z;
-            pixel.w = 1.0f;
-          }
-          else if(sd.channelExtract == 3)
-          {
-            pixel.x = pixel.y = pixel.z = pixel.w;
-            pixel.w = 1.0f;
-          }
-
-          if(fldata)
-          {
-            fldata[(y * td.width + x) * 4 + 0] = pixel.x;
-            fldata[(y * td.width + x) * 4 + 1] = pixel.y;
-            fldata[(y * td.width + x) * 4 + 2] = pixel.z;
-            fldata[(y * td.width + x) * 4 + 3] = pixel.w;
-          }
-          else
-          {
-            abgr[0][(y * td.width + x)] = pixel.w;
-            abgr[1][(y * td.width + x)] = pixel.z;
-            abgr[2][(y * td.width + x)] = pixel.y;
-            abgr[3][(y * td.width + x)] = pixel.x;
-          }
-        }
-      }
-
-      if(sd.destType == FileType::HDR)
-      {
-        int ret = stbi_write_hdr_to_func(fileWriteFunc, (void *)f, td.width, td.height, 4, fldata);
-        success = (ret != 0);
-
-        if(!success)
-          RDCERR("stbi_write_hdr_to_func failed: %d", ret);
-      }
-      else if(sd.destType == FileType::EXR)
-      {
-        const char *err = NULL;
-
-        EXRHeader exrHeader;
-        InitEXRHeader(&exrHeader);
-
-        EXRImage exrImage;
-        InitEXRImage(&exrImage);
-
-        int pixTypes[4] = {TINYEXR_PIXELTYPE_FLOAT, TINYEXR_PIXELTYPE_FLOAT,
-                           TINYEXR_PIXELTYPE_FLOAT, TINYEXR_PIXELTYPE_FLOAT};
-        int reqTypes[4] = {TINYEXR_PIXELTYPE_HALF, TINYEXR_PIXELTYPE_HALF, TINYEXR_PIXELTYPE_HALF,
-                           TINYEXR_PIXELTYPE_HALF};
-
-        if(saveFmt.compByteWidth == 4)
-        {
-          for(size_t channel = 0; channel < 4; channel++)
-          {
-            reqTypes[channel] = TINYEXR_PIXELTYPE_FLOAT;
-          }
-        }
-
-        // must be in this order as many viewers don't pay attention to channels and just assume
-        // they are in this order
-        EXRChannelInfo bgraChannels[4] = {
-            {"A"}, {"B"}, {"G"}, {"R"},
-        };
-
-        exrHeader.num_channels = 4;
-        exrHeader.channels = bgraChannels;
-        exrImage.images = (unsigned char **)abgr;
-        exrImage.width = td.width;
-        exrImage.height = td.height;
-        exrHeader.pixel_types = pixTypes;
-        exrHeader.requested_pixel_types = reqTypes;
-
-        unsigned char *mem = NULL;
-
-        size_t ret = SaveEXRImageToMemory(&exrImage, &exrHeader, &mem, &err);
+  }
+  else if(sd.destType == FileType::PNG)
+  {
+    success = write_png_to_file(f, td.width, td.height, numComps, convertRows8);
 
-        success = (ret > 0);
-        if(success)
-          FileIO::fwrite(mem, 1, ret, f);
-        else
-          RDCERR("Error saving EXR file %d: '%s'", ret, err);
+    if(!success)
+      RDCERR("Failed to write PNG");
+  }
+  else if(sd.destType == FileType::JPG)
+  {
+    success = write_jpg_to_file(f, td.width, td.height, numComps, sd.jpegQuality, convertRows8);
 
-        free(mem);
-      }
+    if(!success)
+      RDCERR("Failed to write JPG");
+  }
+  else if(sd.destType == FileType::HDR)
+  {
+    success = write_hdr_to_file(f, td.width, td.height, convertRowsFloat);
 
-      if(fldata)
-      {
-        delete[] fldata;
-      }
-      else
-      {
-        delete[] abgr[0];
-        delete[] abgr[1];
-        delete[] abgr[2];
-        delete[] abgr[3];
-      }
-    }
+    if(!success)
+      RDCERR("Failed to write HDR");
+  }
+  else if(sd.destType == FileType::EXR)
+  {
+    success =
+        write_exr_to_file(f, td.width, td.height, saveFmt.compByteWidth == 4, convertRowsFloat);
 
-    FileIO::fclose(f);
+    if(!success)
+      RDCERR("Failed to write EXR");
   }
 
-  for(size_t i = 0; i < subdata.size(); i++)
-    delete[] subdata[i];
+  FileIO::fclose(f);
 
   return success;
 }
@@ -1570,6 +1825,28 @@ rdcpair<PixelValue, PixelValue> ReplayController::GetMinMax(ResourceId textureId
 {
   CHECK_REPLAY_THREAD();
 
+  // only textures from the capture are cached, since replay-created textures such as custom shader
+  // outputs can change contents without the event changing
+  bool cacheable = false;
+  if(m_PrefetchEnabled)
+  {
+    for(const TextureDescription &tex : m_Textures)
+    {
+      if(tex.resourceId == textureId)
+      {
+        cacheable = true;
+        break;
+      }
+    }
+  }
+
+  if(cacheable)
+  {
+    for(const PrefetchedMinMax &m : m_PrefetchedMinMax)
+      if(m.eventId == m_EventID && m.texture == textureId && m.sub == sub && m.typeCast == typeCast)
+        return m.minmax;
+  }
+
   PixelValue minval = {{0.0f, 0.0f, 0.0f, 0.0f}};
   PixelValue maxval = {{1.0f, 1.0f, 1.0f, 1.0f}};
 
@@ -1577,6 +1854,13 @@ rdcpair<PixelValue, PixelValue> ReplayController::GetMinMax(ResourceId textureId
                        &maxval.floatValue[0]);
   FatalErrorCheck();
 
+  if(cacheable)
+  {
+    m_PrefetchedMinMax.push_back(
+        {m_EventID, textureId, sub, typeCast, make_rdcpair(minval, maxval)});
+    TrimPrefetchCache(m_PrefetchedMinMax, Replay_PrefetchCacheSize() * 8, m_EventID);
+  }
+
   return make_rdcpair(minval, maxval);
 }
 
@@ -136,6 +136,9 @@ public:
 
   void SetFrameEvent(uint32_t eventId, bool force);
 
+  void SetPrefetchEnabled(bool enabled);
+  bool PrefetchStep();
+
   const D3D11Pipe::State *GetD3D11PipelineState();
   const D3D12Pipe::State *GetD3D12PipelineState();
   const GLPipe::State *GetGLPipelineState();
@@ -198,6 +201,8 @@ public:
 
   bytebuf GetBufferData(ResourceId buff, uint64_t offset, uint64_t len);
   bytebuf GetTextureData(ResourceId buff, const Subresource &sub);
+  rdcarray<bytebuf> FetchResourceData(const rdcarray<ResourceDataRequest> &requests,
+                                      uint64_t memoryCap, RENDERDOC_ResourceDataCallback callback);
 
   bool SaveTexture(const TextureSave &saveData, const rdcstr &path);
 
@@ -226,6 +231,12 @@ private:
 
   void FetchPipelineState(uint32_t eventId);
 
+  void ReturnToCurrentEvent();
+  void PlanPrefetch(uint32_t eventId);
+  void ClearPrefetched();
+  void StorePipelineState(uint32_t eventId);
+  bool RestorePipelineState(uint32_t eventId);
+
   ActionDescription *GetActionByEID(uint32_t eventId);
   bool ContainsMarker(const rdcarray<ActionDescription> &actions);
   bool PassEquivalent(const ActionDescription &a, const ActionDescription &b);
@@ -254,6 +265,32 @@ private:
   VKPipe::State m_VulkanPipelineState;
   PipeState m_PipeState;
 
+  // speculatively fetched data for actions near the current event, filled by PrefetchStep. Each
+  // cache is small and bounded, evicting the oldest entry other than the current event's.
+  struct PrefetchedPipelineState
+  {
+    uint32_t eventId;
+    bool postVS;
+    D3D11Pipe::State d3d11;
+    D3D12Pipe::State d3d12;
+    GLPipe::State gl;
+    VKPipe::State vulkan;
+  };
+
+  struct PrefetchedMinMax
+  {
+    uint32_t eventId;
+    ResourceId texture;
+    Subresource sub;
+    CompType typeCast;
+    rdcpair<PixelValue, PixelValue> minmax;
+  };
+
+  bool m_PrefetchEnabled = false;
+  rdcarray<uint32_t> m_PrefetchQueue;
+  rdcarray<PrefetchedPipelineState> m_PrefetchedStates;
+  rdcarray<PrefetchedMinMax> m_PrefetchedMinMax;
+
   rdcarray<ReplayOutput *> m_Outputs;
 
   rdcarray<ResourceDescription> m_Resources;
@@ -178,6 +178,13 @@ public:
   virtual void GetTextureData(ResourceId tex, const Subresource &sub,
                               const GetTextureDataParams &params, bytebuf &data) = 0;
 
+  // fetch a batch of buffer/texture contents at the given events, ideally with a single replay.
+  // The requests refer to live IDs and are sorted by event. fetched[i] is set if results[i] holds
+  // the data, otherwise the caller falls back to seeking to the event and using
+  // GetBufferData/GetTextureData. A fetched result can legitimately be empty.
+  virtual void FetchResourceData(const rdcarray<ResourceDataRequest> &requests,
+                                 rdcarray<bytebuf> &results, rdcarray<bool> &fetched) = 0;
+
   virtual void BuildTargetShader(ShaderEncoding sourceEncoding, const bytebuf &source,
                                  const rdcstr &entry, const ShaderCompileFlags &compileFlags,
                                  ShaderStage type, ResourceId &id, rdcstr &errors) = 0;
@@ -36,62 +36,71 @@ ReplayStatus exportChrome(const rdcstr &filename, const RDCFile &rdc, const SDFi
   if(!f)
     return ReplayStatus::FileIOFailed;
 
-  rdcstr str;
+  StreamWriter writer(f, Ownership::Stream);
 
   // add header, customise this as needed.
-  str = R"({
+  rdcstr str = R"({
   "displayTimeUnit": "ns",
   "traceEvents": [)";
 
-  const char *category = "Initialisation";
+  writer.Write(str.data(), str.size());
 
-  // stupid JSON not allowing trailing ,s :(
-  bool first = true;
+  const StructuredChunkList &chunks = structData.chunks;
 
-  int i = 0;
-  int numChunks = structData.chunks.count();
-
-  for(const SDChunk *chunk : structData.chunks)
+  // chunks from the first driver chunk onwards are in the frame capture, find where that starts so
+  // each chunk can be formatted independently
+  size_t frameStart = chunks.size();
+  for(size_t i = 0; i < chunks.size(); i++)
   {
-    if(chunk->metadata.chunkID == (uint32_t)SystemChunk::FirstDriverChunk + 1)
-      category = "Frame Capture";
+    if(chunks[i]->metadata.chunkID == (uint32_t)SystemChunk::FirstDriverChunk + 1)
+    {
+      frameStart = i;
+      break;
+    }
+  }
+
+  auto formatChunks = [&chunks, frameStart](size_t begin, size_t end, rdcstr &out) {
+    for(size_t i = begin; i < end; i++)
+    {
+      const SDChunk *chunk = chunks[i];
 
-    if(!first)
-      str += ",";
+      const char *category = i >= frameStart ? "Frame Capture" : "Initialisation";
 
-    first = false;
+      // stupid JSON not allowing trailing ,s :(
+      if(i > 0)
+        out += ",";
 
-    const char *fmt = R"(
+      const char *fmt = R"(
     { "name": "%s", "cat": "%s", "ph": "B", "ts": %llu, "pid": 5, "tid": %u },
     { "ph": "E", "ts": %llu, "pid": 5, "tid": %u })";
 
-    if(chunk->metadata.durationMicro == 0)
-    {
-      fmt = R"(
+      if(chunk->metadata.durationMicro == 0)
+      {
+        fmt = R"(
     { "name": "%s", "cat": "%s", "ph": "i", "ts": %llu, "pid": 5, "tid": %u })";
-    }
-
-    str += StringFormat::Fmt(
-        fmt, chunk->name.c_str(), category, chunk->metadata.timestampMicro, chunk->metadata.threadID,
-        chunk->metadata.timestampMicro + chunk->metadata.durationMicro, chunk->metadata.threadID);
+      }
 
-    if(progress)
-      progress(float(i) / float(numChunks));
+      out += StringFormat::Fmt(fmt, chunk->name.c_str(), category, chunk->metadata.timestampMicro,
+                               chunk->metadata.threadID,
+                               chunk->metadata.timestampMicro + chunk->metadata.durationMicro,
+                               chunk->metadata.threadID);
+    }
+  };
 
-    i++;
-  }
+  // stream the events out in batches rather than building the whole trace in memory
+  StreamWriteOrdered(&writer, chunks.size(), 256, formatChunks, progress);
 
   if(progress)
     progress(1.0f);
 
   // end trace events
-  str += "\n  ]\n}";
+  str = "\n  ]\n}";
 
-  FileIO::fwrite(str.data(), 1, str.size(), f);
+  writer.Write(str.data(), str.size());
 
-  FileIO::fclose(f);
+  writer.Finish();
 
-  return ReplayStatus::Succeeded;
+  return writer.IsErrored() ? ReplayStatus::FileIOFailed : ReplayStatus::Succeeded;
 }
 
 static ConversionRegistration XMLConversionRegistration(
@@ -71,6 +71,14 @@ struct xml_file_writer : pugi::xml_writer
   void write(const void *data, size_t size) { stream.Write(data, size); }
 };
 
+struct xml_string_writer : pugi::xml_writer
+{
+  rdcstr &str;
+
+  xml_string_writer(rdcstr &s) : str(s) {}
+  void write(const void *data, size_t size) { str.append((const char *)data, size); }
+};
+
 // avoid &, <, and > since they throw off the ascii alignment
 static constexpr bool IsXMLPrintable(const char c)
 {
@@ -284,16 +292,154 @@ static void Obj2XML(pugi::xml_node &parent, SDObject &child)
   }
 }
 
+static void Section2XML(pugi::xml_node &xRoot, const RDCFile &file, int i)
+{
+  const SectionProperties &props = file.GetSectionProperties(i);
+
+  StreamReader *reader = file.ReadSection(i);
+
+  if(props.type == SectionType::ExtendedThumbnail)
+  {
+    ExtThumbnailHeader thumbHeader = {};
+    if(reader->Read(thumbHeader))
+    {
+      // don't need to read the data, that's handled in Buffers2ZIP
+      bool succeeded = reader->SkipBytes(thumbHeader.len) && !reader->IsErrored();
+      if(succeeded && (uint32_t)thumbHeader.format < (uint32_t)FileType::Count)
+      {
+        pugi::xml_node xExtThumbnail = xRoot.append_child("extended_thumbnail");
+
+        xExtThumbnail.append_attribute("width") = thumbHeader.width;
+        xExtThumbnail.append_attribute("height") = thumbHeader.height;
+        xExtThumbnail.append_attribute("length") = thumbHeader.len;
+
+        if(thumbHeader.format == FileType::JPG)
+          xExtThumbnail.text() = "ext_thumb.jpg";
+        else if(thumbHeader.format == FileType::PNG)
+          xExtThumbnail.text() = "ext_thumb.png";
+        else if(thumbHeader.format == FileType::Raw)
+          xExtThumbnail.text() = "ext_thumb.raw";
+        else
+          RDCERR("Unexpected extended thumbnail format %s", ToStr(thumbHeader.format).c_str());
+      }
+    }
+
+    delete reader;
+    return;
+  }
+  else if(props.type == SectionType::EmbeddedLogfile)
+  {
+    pugi::xml_node xLogfile = xRoot.append_child("diagnostic_log");
+    xLogfile.text() = "diagnostic.log";
+
+    delete reader;
+    return;
+  }
+
+  pugi::xml_node xSection = xRoot.append_child("section");
+
+  if(props.flags & SectionFlags::ASCIIStored)
+    xSection.append_attribute("ascii");
+  if(props.flags & SectionFlags::LZ4Compressed)
+    xSection.append_attribute("lz4");
+  if(props.flags & SectionFlags::ZstdCompressed)
+    xSection.append_attribute("zstd");
+  if(props.flags & SectionFlags::Seekable)
+    xSection.append_attribute("seekable");
+
+  pugi::xml_node name = xSection.append_child("name");
+  name.text() = props.name.c_str();
+
+  pugi::xml_node secVer = xSection.append_child("version");
+  secVer.text() = props.version;
+
+  pugi::xml_node type = xSection.append_child("type");
+  type.text() = (uint32_t)props.type;
+
+  bytebuf contents;
+  contents.resize((size_t)reader->GetSize());
+  reader->Read(contents.data(), reader->GetSize());
+
+  pugi::xml_node data = xSection.append_child("data");
+
+  if(props.flags & SectionFlags::ASCIIStored)
+  {
+    // insert the contents literally
+    data.text().set((char *)contents.data());
+  }
+  else
+  {
+    // encode to simple hex. Not efficient, but easy.
+    rdcstr hexdata;
+    hexdata.reserve(contents.size() * 2);
+    HexEncode(contents, hexdata);
+    data.text().set(hexdata.c_str());
+  }
+
+  delete reader;
+}
+
+static void Chunk2XML(pugi::xml_node &xChunks, SDChunk *chunk)
+{
+  pugi::xml_node xChunk = xChunks.append_child("chunk");
+
+  xChunk.append_attribute("id") = chunk->metadata.chunkID;
+  xChunk.append_attribute("name") = chunk->name.c_str();
+  xChunk.append_attribute("length") = chunk->metadata.length;
+  if(chunk->metadata.threadID)
+    xChunk.append_attribute("threadID") = chunk->metadata.threadID;
+  if(chunk->metadata.timestampMicro)
+    xChunk.append_attribute("timestamp") = chunk->metadata.timestampMicro;
+  if(chunk->metadata.durationMicro >= 0)
+    xChunk.append_attribute("duration") = chunk->metadata.durationMicro;
+  if(chunk->metadata.flags & SDChunkFlags::HasCallstack)
+  {
+    pugi::xml_node stack = xChunk.append_child("callstack");
+
+    for(size_t i = 0; i < chunk->metadata.callstack.size(); i++)
+    {
+      stack.append_child("address").text() = chunk->metadata.callstack[i];
+    }
+  }
+
+  if(chunk->metadata.flags & SDChunkFlags::OpaqueChunk)
+  {
+    xChunk.append_attribute("opaque") = true;
+
+    RDCASSERT(chunk->NumChildren() > 0);
+    pugi::xml_node opaque = xChunk.append_child("buffer");
+    opaque.append_attribute("byteLength") = chunk->GetChild(0)->type.byteSize;
+    opaque.text() = chunk->GetChild(0)->data.basic.u;
+  }
+  else
+  {
+    for(size_t o = 0; o < chunk->NumChildren(); o++)
+      Obj2XML(xChunk, *chunk->GetChild(o));
+  }
+}
+
+// prints each top-level node of doc as if it were a child of a node at depth - 1
+static void PrintXMLNodes(pugi::xml_writer &writer, pugi::xml_document &doc, unsigned int depth)
+{
+  for(pugi::xml_node node = doc.first_child(); node; node = node.next_sibling())
+    node.print(writer, "\t", pugi::format_default, pugi::encoding_auto, depth);
+}
+
 static ReplayStatus Structured2XML(const rdcstr &filename, const RDCFile &file, uint64_t version,
                                    const StructuredChunkList &chunks,
                                    RENDERDOC_ProgressCallback progress)
 {
-  pugi::xml_document doc;
+  xml_file_writer writer(filename);
 
-  pugi::xml_node xRoot = doc.append_child("rdc");
+  // the document is never built in memory as a whole. Instead each part is generated in its own
+  // small document and printed at the depth it has in the full document, giving identical output
+  rdcstr str = "<?xml version=\"1.0\"?>\n<rdc>\n";
+  writer.write(str.data(), str.size());
 
   {
-    pugi::xml_node xHeader = xRoot.append_child("header");
+    pugi::xml_document doc;
+
+    pugi::xml_node xHeader = doc.append_child("header");
 
     pugi::xml_node xDriver = xHeader.append_child("driver");
     xDriver.append_attribute("id") = (uint32_t)file.GetDriver();
@@ -325,6 +471,8 @@ static ReplayStatus Structured2XML(const rdcstr &filename, const RDCFile &file,
 
     xTimebase.append_attribute("base") = file.GetTimestampBase();
     xTimebase.append_attribute("frequency") = file.GetTimestampFrequency();
+
+    PrintXMLNodes(writer, doc, 1);
   }
 
   if(progress)
@@ -333,144 +481,63 @@ static ReplayStatus Structured2XML(const rdcstr &filename, const RDCFile &file,
   // write all other sections
   for(int i = 0; i < file.NumSections(); i++)
   {
-    const SectionProperties &props = file.GetSectionProperties(i);
-
-    if(props.type == SectionType::FrameCapture)
-      continue;
-
-    StreamReader *reader = file.ReadSection(i);
-
-    if(props.type == SectionType::ExtendedThumbnail)
-    {
-      ExtThumbnailHeader thumbHeader = {};
-      if(reader->Read(thumbHeader))
-      {
-        // don't need to read the data, that's handled in Buffers2ZIP
-        bool succeeded = reader->SkipBytes(thumbHeader.len) && !reader->IsErrored();
-        if(succeeded && (uint32_t)thumbHeader.format < (uint32_t)FileType::Count)
-        {
-          pugi::xml_node xExtThumbnail = xRoot.append_child("extended_thumbnail");
-
-          xExtThumbnail.append_attribute("width") = thumbHeader.width;
-          xExtThumbnail.append_attribute("height") = thumbHeader.height;
-          xExtThumbnail.append_attribute("length") = thumbHeader.len;
-
-          if(thumbHeader.format == FileType::JPG)
-            xExtThumbnail.text() = "ext_thumb.jpg";
-          else if(thumbHeader.format == FileType::PNG)
-            xExtThumbnail.text() = "ext_thumb.png";
-          else if(thumbHeader.format == FileType::Raw)
-            xExtThumbnail.text() = "ext_thumb.raw";
-          else
-            RDCERR("Unexpected extended thumbnail format %s", ToStr(thumbHeader.format).c_str());
-        }
-      }
-
-      delete reader;
-      continue;
-    }
-    else if(props.type == SectionType::EmbeddedLogfile)
-    {
-      pugi::xml_node xLogfile = xRoot.append_child("diagnostic_log");
-      xLogfile.text() = "diagnostic.log";
+    SectionType type = file.GetSectionProperties(i).type;
 
-      delete reader;
+    // blobs are exported inline in the chunks that reference them
+    if(type == SectionType::FrameCapture || type == SectionType::Blobs)
       continue;
-    }
-
-    pugi::xml_node xSection = xRoot.append_child("section");
 
-    if(props.flags & SectionFlags::ASCIIStored)
-      xSection.append_attribute("ascii");
-    if(props.flags & SectionFlags::LZ4Compressed)
-      xSection.append_attribute("lz4");
-    if(props.flags & SectionFlags::ZstdCompressed)
-      xSection.append_attribute("zstd");
+    pugi::xml_document doc;
+    pugi::xml_node xRoot = doc;
 
-    pugi::xml_node name = xSection.append_child("name");
-    name.text() = props.name.c_str();
+    Section2XML(xRoot, file, i);
 
-    pugi::xml_node secVer = xSection.append_child("version");
-    secVer.text() = props.version;
-
-    pugi::xml_node type = xSection.append_child("type");
-    type.text() = (uint32_t)props.type;
-
-    bytebuf contents;
-    contents.resize((size_t)reader->GetSize());
-    reader->Read(contents.data(), reader->GetSize());
-
-    pugi::xml_node data = xSection.append_child("data");
-
-    if(props.flags & SectionFlags::ASCIIStored)
-    {
-      // insert the contents literally
-      data.text().set((char *)contents.data());
-    }
-    else
-    {
-      // encode to simple hex. Not efficient, but easy.
-      rdcstr hexdata;
-      hexdata.reserve(contents.size() * 2);
-      HexEncode(contents, hexdata);
-      data.text().set(hexdata.c_str());
-    }
-
-    delete reader;
+    PrintXMLNodes(writer, doc, 1);
   }
 
   if(progress)
     progress(StructuredProgress(0.2f));
 
-  pugi::xml_node xChunks = xRoot.append_child("chunks");
-
-  xChunks.append_attribute("version") = version;
-
-  for(size_t c = 0; c < chunks.size(); c++)
+  if(chunks.empty())
   {
-    pugi::xml_node xChunk = xChunks.append_child("chunk");
-    SDChunk *chunk = chunks[c];
-
-    xChunk.append_attribute("id") = chunk->metadata.chunkID;
-    xChunk.append_attribute("name") = chunk->name.c_str();
-    xChunk.append_attribute("length") = chunk->metadata.length;
-    if(chunk->metadata.threadID)
-      xChunk.append_attribute("threadID") = chunk->metadata.threadID;
-    if(chunk->metadata.timestampMicro)
-      xChunk.append_attribute("timestamp") = chunk->metadata.timestampMicro;
-    if(chunk->metadata.durationMicro >= 0)
-      xChunk.append_attribute("duration") = chunk->metadata.durationMicro;
-    if(chunk->metadata.flags & SDChunkFlags::HasCallstack)
-    {
-      pugi::xml_node stack = xChunk.append_child("callstack");
+    str = StringFormat::Fmt("\t<chunks version=\"%llu\" />\n", version);
+    writer.write(str.data(), str.size());
+  }
+  else
+  {
+    str = StringFormat::Fmt("\t<chunks version=\"%llu\">\n", version);
+    writer.write(str.data(), str.size());
 
-      for(size_t i = 0; i < chunk->metadata.callstack.size(); i++)
+    // format chunks on multiple threads in batches, each into its own document
+    auto formatChunks = [&chunks](size_t begin, size_t end, rdcstr &out) {
+      xml_string_writer stringWriter(out);
+      pugi::xml_document doc;
+
+      for(size_t c = begin; c < end; c++)
       {
-        stack.append_child("address").text() = chunk->metadata.callstack[i];
-      }
-    }
+        doc.reset();
 
-    if(chunk->metadata.flags & SDChunkFlags::OpaqueChunk)
-    {
-      xChunk.append_attribute("opaque") = true;
+        pugi::xml_node xChunks = doc;
+        Chunk2XML(xChunks, chunks[c]);
 
-      RDCASSERT(chunk->NumChildren() > 0);
-      pugi::xml_node opaque = xChunk.append_child("buffer");
-      opaque.append_attribute("byteLength") = chunk->GetChild(0)->type.byteSize;
-      opaque.text() = chunk->GetChild(0)->data.basic.u;
-    }
-    else
-    {
-      for(size_t o = 0; o < chunk->NumChildren(); o++)
-        Obj2XML(xChunk, *chunk->GetChild(o));
-    }
+        PrintXMLNodes(stringWriter, doc, 2);
+      }
+    };
 
+    RENDERDOC_ProgressCallback chunkProgress;
     if(progress)
-      progress(StructuredProgress(0.2f + 0.8f * (float(c) / float(chunks.size()))));
+      chunkProgress = [progress](float p) { progress(StructuredProgress(0.2f + 0.8f * p)); };
+
+    StreamWriteOrdered(&writer.stream, chunks.size(), 64, formatChunks, chunkProgress);
+
+    str = "\t</chunks>\n";
+    writer.write(str.data(), str.size());
   }
 
-  xml_file_writer writer(filename);
-  doc.save(writer);
+  str = "</rdc>\n";
+  writer.write(str.data(), str.size());
+
+  writer.stream.Finish();
 
   return writer.stream.IsErrored() ? ReplayStatus::FileIOFailed : ReplayStatus::Succeeded;
 }
@@ -717,6 +784,8 @@ static ReplayStatus XML2Structured(const rdcstr &xml, const ThumbTypeAndData &th
       props.flags |= SectionFlags::LZ4Compressed;
     if(xSection.attribute("zstd"))
       props.flags |= SectionFlags::ZstdCompressed;
+    if(xSection.attribute("seekable"))
+      props.flags |= SectionFlags::Seekable;
 
     pugi::xml_node name = xSection.child("name");
     if(!name)
@@ -1088,3 +1157,115 @@ static ConversionRegistration XMLOnlyConversionRegistration(
 easier to work with but it cannot then be imported.)",
         false,
     });
+
+#if ENABLED(ENABLE_UNIT_TESTS)
+
+#include "catch/catch.hpp"
+#include "common/timing.h"
+#include "core/core.h"
+
+static void MakeExportTestChunks(SDFile &file, size_t numChunks)
+{
+  for(size_t i = 0; i < numChunks; i++)
+  {
+    SDChunk *chunk = new SDChunk(StringFormat::Fmt("Chunk%zu", i));
+    chunk->metadata.chunkID = 1000 + uint32_t(i % 7);
+    chunk->metadata.threadID = 1 + (i % 3);
+    chunk->metadata.timestampMicro = int64_t(i * 10);
+    chunk->metadata.durationMicro = int64_t(i % 5);
+
+    chunk->AddAndOwnChild(makeSDUInt32("index"_lit, uint32_t(i)));
+    chunk->AddAndOwnChild(makeSDString("label"_lit, StringFormat::Fmt("label %zu", i)));
+
+    SDObject *arr = chunk->AddAndOwnChild(makeSDArray("values"_lit));
+    for(uint32_t v = 0; v < 4; v++)
+      arr->AddAndOwnChild(makeSDFloat("$el"_lit, float(i) + v * 0.5f));
+
+    file.chunks.push_back(chunk);
+  }
+}
+
+TEST_CASE("Structured XML export", "[codecs]")
+{
+  RDCFile rdc;
+  rdc.SetData(RDCDriver::Vulkan, "Vulkan", 0, NULL, 0, 1.0);
+
+  SDFile file;
+  file.version = 5;
+
+  const size_t numChunks = 1000;
+  MakeExportTestChunks(file, numChunks);
+
+  rdcstr filename = FileIO::GetTempFolderFilename() + "renderdoc_xml_export_test.xml";
+
+  REQUIRE(exportXMLOnly(filename, rdc, file, NULL) == ReplayStatus::Succeeded);
+
+  rdcstr xml;
+  REQUIRE(FileIO::ReadAll(filename, xml));
+
+  FileIO::Delete(filename);
+
+  SECTION("Chunks are written in order")
+  {
+    int32_t offs = 0;
+    for(size_t i = 0; i < numChunks; i++)
+    {
+      offs = xml.find(StringFormat::Fmt("name=\"Chunk%zu\"", i), offs);
+      CAPTURE(i);
+      REQUIRE(offs >= 0);
+    }
+  }
+
+  SECTION("The export can be imported again")
+  {
+    StreamReader reader((const byte *)xml.data(), xml.size());
+
+    RDCFile imported;
+    SDFile importedFile;
+    REQUIRE(importXMLZ(rdcstr(), reader, &imported, importedFile, NULL) == ReplayStatus::Succeeded);
+
+    CHECK(importedFile.version == 5);
+    REQUIRE(importedFile.chunks.size() == numChunks);
+
+    for(size_t i = 0; i < numChunks; i++)
+    {
+      CAPTURE(i);
+      CHECK(importedFile.chunks[i]->name == file.chunks[i]->name);
+      CHECK(importedFile.chunks[i]->metadata.timestampMicro ==
+            file.chunks[i]->metadata.timestampMicro);
+      CHECK(importedFile.chunks[i]->HasEqualValue(file.chunks[i]));
+    }
+  }
+}
+
+TEST_CASE("Benchmark structured exporters", "[.][benchmark][codecs]")
+{
+  RDCFile rdc;
+  rdc.SetData(RDCDriver::Vulkan, "Vulkan", 0, NULL, 0, 1.0);
+
+  SDFile file;
+
+  const size_t numChunks = 200000;
+  MakeExportTestChunks(file, numChunks);
+
+  rdcstr filename = FileIO::GetTempFolderFilename() + "renderdoc_export_benchmark";
+
+  const char *types[] = {"xml", "chrome.json"};
+
+  for(const char *type : types)
+  {
+    CaptureExporter exporter = RenderDoc::Inst().GetCaptureExporter(type);
+    REQUIRE(exporter);
+
+    PerformanceTimer timer;
+    REQUIRE(exporter(filename, rdc, file, NULL) == ReplayStatus::Succeeded);
+    double seconds = timer.GetMilliseconds() / 1000.0;
+
+    WARN(StringFormat::Fmt("%s export: %zu chunks in %.3fs, %.0f chunks/s", type, numChunks,
+                           seconds, double(numChunks) / seconds));
+  }
+
+  FileIO::Delete(filename);
+}
+
+#endif
@@ -190,4 +190,206 @@ TEST_CASE("Test ZSTD compression/decompression", "[streamio][zstd]")
   delete[] randomData;
 };
 
+static void TestSeekableStream(bool lz4)
+{
+  // not a multiple of either block size, so the last block is partial
+  const uint64_t dataSize = 4 * 1024 * 1024 + 12345;
+
+  byte *data = new byte[(size_t)dataSize];
+
+  // mix of compressible runs and random data
+  for(uint64_t i = 0; i < dataSize; i++)
+    data[i] = (i / 4096) % 3 == 0 ? byte(rand() & 0xff) : byte(i / 1024);
+
+  StreamWriter buf(StreamWriter::DefaultScratchSize);
+
+  {
+    Compressor *comp = NULL;
+    if(lz4)
+      comp = new LZ4Compressor(&buf, Ownership::Nothing, true);
+    else
+      comp = new ZSTDCompressor(&buf, Ownership::Nothing, true);
+
+    StreamWriter writer(comp, Ownership::Stream);
+
+    // write in odd-sized pieces to cross block boundaries
+    for(uint64_t offs = 0; offs < dataSize; offs += 100000)
+      writer.Write(data + offs, RDCMIN(dataSize - offs, (uint64_t)100000));
+
+    writer.Finish();
+
+    CHECK_FALSE(writer.IsErrored());
+    CHECK(writer.GetOffset() == dataSize);
+  }
+
+  auto makeReader = [&](bool seekable) {
+    Decompressor *decomp = NULL;
+    StreamReader *compressed = new StreamReader(buf.GetData(), buf.GetOffset());
+    if(lz4)
+      decomp = new LZ4Decompressor(compressed, Ownership::Stream, seekable);
+    else
+      decomp = new ZSTDDecompressor(compressed, Ownership::Stream, seekable);
+
+    return new StreamReader(decomp, dataSize, Ownership::Stream);
+  };
+
+  byte *readData = new byte[(size_t)dataSize];
+
+  SECTION("Sequential read without the index")
+  {
+    StreamReader *reader = makeReader(false);
+
+    reader->Read(readData, dataSize);
+
+    CHECK_FALSE(reader->IsErrored());
+    CHECK(reader->AtEnd());
+    CHECK_FALSE(memcmp(readData, data, (size_t)dataSize));
+
+    delete reader;
+  }
+
+  SECTION("Parallel read of the whole stream")
+  {
+    StreamReader *reader = makeReader(true);
+
+    reader->Read(readData, dataSize);
+
+    CHECK_FALSE(reader->IsErrored());
+    CHECK(reader->AtEnd());
+    CHECK_FALSE(memcmp(readData, data, (size_t)dataSize));
+
+    delete reader;
+  }
+
+  SECTION("Random access")
+  {
+    StreamReader *reader = makeReader(true);
+
+    const uint64_t offsets[] = {
+        3 * 1024 * 1024 + 17, 5, 64 * 1024 - 3, 128 * 1024, dataSize - 100, 1024 * 1024 - 1, 0,
+    };
+
+    for(uint64_t offs : offsets)
+    {
+      const uint64_t len = RDCMIN(dataSize - offs, (uint64_t)300000);
+
+      reader->SetOffset(offs);
+      CHECK(reader->GetOffset() == offs);
+
+      reader->Read(readData, len);
+
+      CHECK_FALSE(reader->IsErrored());
+      CHECK_FALSE(memcmp(readData, data + offs, (size_t)len));
+    }
+
+    // seeking to the end is allowed, reading past it is not
+    reader->SetOffset(dataSize);
+    CHECK(reader->AtEnd());
+    CHECK_FALSE(reader->IsErrored());
+
+    delete reader;
+  }
+
+  delete[] readData;
+  delete[] data;
+}
+
+TEST_CASE("Test seekable LZ4 compression/decompression", "[streamio][lz4]")
+{
+  TestSeekableStream(true);
+};
+
+TEST_CASE("Test seekable ZSTD compression/decompression", "[streamio][zstd]")
+{
+  TestSeekableStream(false);
+};
+
+static void TestParallelCompression(bool lz4)
+{
+  // large enough to cycle through the compressor's pages several times, with a partial last block
+  const uint64_t dataSize = 9 * 1024 * 1024 + 777;
+
+  byte *data = new byte[(size_t)dataSize];
+
+  for(uint64_t i = 0; i < dataSize; i++)
+    data[i] = (i / 4096) % 3 == 0 ? byte(rand() & 0xff) : byte(i / 1024);
+
+  auto compress = [&](uint32_t numThreads, uint64_t size, StreamWriter &buf) {
+    Compressor *comp = NULL;
+    if(numThreads == 0)
+      comp = lz4 ? (Compressor *)new LZ4Compressor(&buf, Ownership::Nothing, true)
+                 : (Compressor *)new ZSTDCompressor(&buf, Ownership::Nothing, true);
+    else
+      comp = lz4 ? (Compressor *)new LZ4ParallelCompressor(&buf, Ownership::Nothing, numThreads)
+                 : (Compressor *)new ZSTDParallelCompressor(&buf, Ownership::Nothing, numThreads);
+
+    StreamWriter writer(comp, Ownership::Stream);
+
+    for(uint64_t offs = 0; offs < size; offs += 100000)
+      writer.Write(data + offs, RDCMIN(size - offs, (uint64_t)100000));
+
+    writer.Finish();
+
+    CHECK_FALSE(writer.IsErrored());
+    CHECK(writer.GetOffset() == size);
+  };
+
+  StreamWriter serial(StreamWriter::DefaultScratchSize);
+  compress(0, dataSize, serial);
+
+  for(uint32_t numThreads : {1U, 3U})
+  {
+    StreamWriter parallel(StreamWriter::DefaultScratchSize);
+    compress(numThreads, dataSize, parallel);
+
+    // the output should be byte-for-byte what the serial compressor produces
+    REQUIRE(parallel.GetOffset() == serial.GetOffset());
+    CHECK_FALSE(memcmp(parallel.GetData(), serial.GetData(), (size_t)serial.GetOffset()));
+
+    StreamReader *compressed = new StreamReader(parallel.GetData(), parallel.GetOffset());
+    Decompressor *decomp = NULL;
+    if(lz4)
+      decomp = new LZ4Decompressor(compressed, Ownership::Stream, true);
+    else
+      decomp = new ZSTDDecompressor(compressed, Ownership::Stream, true);
+
+    StreamReader reader(decomp, dataSize, Ownership::Stream);
+
+    byte *readData = new byte[(size_t)dataSize];
+
+    reader.Read(readData, dataSize);
+
+    CHECK_FALSE(reader.IsErrored());
+    CHECK(reader.AtEnd());
+    CHECK_FALSE(memcmp(readData, data, (size_t)dataSize));
+
+    delete[] readData;
+  }
+
+  // an empty stream is just the block index
+  {
+    StreamWriter emptySerial(StreamWriter::DefaultScratchSize);
+    StreamWriter emptyParallel(StreamWriter::DefaultScratchSize);
+
+    compress(0, 0, emptySerial);
+    compress(2, 0, emptyParallel);
+
+    REQUIRE(emptyParallel.GetOffset() == emptySerial.GetOffset());
+    CHECK_FALSE(
+        memcmp(emptyParallel.GetData(), emptySerial.GetData(), (size_t)emptySerial.GetOffset()));
+  }
+
+  delete[] data;
+}
+
+TEST_CASE("Test parallel LZ4 compression matches serial", "[streamio][lz4]")
+{
+  TestParallelCompression(true);
+};
+
+TEST_CASE("Test parallel ZSTD compression matches serial", "[streamio][zstd]")
+{
+  TestParallelCompression(false);
+};
+
 #endif    // ENABLED(ENABLE_UNIT_TESTS)
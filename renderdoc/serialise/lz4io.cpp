@@ -23,10 +23,13 @@
  ******************************************************************************/
 
 #include "lz4io.h"
+#include "api/replay/stringise.h"
 
 static const uint64_t lz4BlockSize = 64 * 1024;
+static const int lz4Acceleration = 20;
 
-LZ4Compressor::LZ4Compressor(StreamWriter *write, Ownership own) : Compressor(write, own)
+LZ4Compressor::LZ4Compressor(StreamWriter *write, Ownership own, bool seekable)
+    : Compressor(write, own), m_Seekable(seekable)
 {
   m_Page[0] = AllocAlignedBuffer(lz4BlockSize);
   m_Page[1] = AllocAlignedBuffer(lz4BlockSize);
@@ -34,6 +37,8 @@ LZ4Compressor::LZ4Compressor(StreamWriter *write, Ownership own) : Compressor(wr
 
   m_PageOffset = 0;
 
+  m_Index.blockSize = (uint32_t)lz4BlockSize;
+
   m_LZ4Comp = LZ4_createStream();
 }
 
@@ -115,7 +120,24 @@ bool LZ4Compressor::Finish()
   // precisely 64kb in size
   // only the last one can be smaller, so we only write a partial page when finishing.
   // Calling Write() after Finish() is illegal
-  return FlushPage0();
+  if(!m_Seekable)
+    return FlushPage0();
+
+  // seekable streams don't need a trailing empty block, and instead end with the block index
+  bool success = true;
+
+  if(m_PageOffset > 0)
+    success &= FlushPage0();
+
+  // if we encountered a stream error this will be NULL
+  if(!m_CompressBuffer)
+    return false;
+
+  m_Index.offsets.push_back(m_CompressedOffset);
+
+  success &= m_Index.Write(m_Write);
+
+  return success;
 }
 
 bool LZ4Compressor::FlushPage0()
@@ -124,12 +146,27 @@ bool LZ4Compressor::FlushPage0()
   if(!m_CompressBuffer)
     return false;
 
+  int32_t compSize = 0;
+
   // m_PageOffset is the amount written, usually equal to lz4BlockSize except the last block.
-  int32_t compSize =
-      LZ4_compress_fast_continue(m_LZ4Comp, (const char *)m_Page[0], (char *)m_CompressBuffer,
-                                 (int)m_PageOffset, (int)LZ4_COMPRESSBOUND(lz4BlockSize), 20);
+  if(m_Seekable)
+  {
+    // compress without any history from previous blocks, so this block can be decompressed alone.
+    compSize = LZ4_compress_fast_extState(m_LZ4Comp, (const char *)m_Page[0],
+                                          (char *)m_CompressBuffer, (int)m_PageOffset,
+                                          (int)LZ4_COMPRESSBOUND(lz4BlockSize), lz4Acceleration);
+
+    m_Index.offsets.push_back(m_CompressedOffset);
+    m_Index.uncompressedSize += m_PageOffset;
+  }
+  else
+  {
+    compSize = LZ4_compress_fast_continue(m_LZ4Comp, (const char *)m_Page[0],
+                                          (char *)m_CompressBuffer, (int)m_PageOffset,
+                                          (int)LZ4_COMPRESSBOUND(lz4BlockSize), lz4Acceleration);
+  }
 
-  if(compSize < 0)
+  if(compSize < 0 || (compSize == 0 && m_PageOffset > 0))
   {
     RDCERR("Error compressing: %i", compSize);
     FreeAlignedBuffer(m_Page[0]);
@@ -144,6 +181,8 @@ bool LZ4Compressor::FlushPage0()
   success &= m_Write->Write(compSize);
   success &= m_Write->Write(m_CompressBuffer, compSize);
 
+  m_CompressedOffset += sizeof(compSize) + compSize;
+
   // swap pages
   std::swap(m_Page[0], m_Page[1]);
 
@@ -153,7 +192,47 @@ bool LZ4Compressor::FlushPage0()
   return success;
 }
 
-LZ4Decompressor::LZ4Decompressor(StreamReader *read, Ownership own) : Decompressor(read, own)
+class LZ4BlockCodec : public ParallelCompressor::BlockCodec
+{
+public:
+  LZ4BlockCodec() { m_LZ4Comp = LZ4_createStream(); }
+  ~LZ4BlockCodec() { LZ4_freeStream(m_LZ4Comp); }
+  bool CompressBlock(const byte *src, uint64_t srcSize, bytebuf &out)
+  {
+    const size_t offs = out.size();
+    out.resize(offs + sizeof(int32_t) + LZ4_COMPRESSBOUND(lz4BlockSize));
+
+    // same as a seekable LZ4Compressor - independent blocks prefixed with their compressed size
+    int32_t compSize = LZ4_compress_fast_extState(
+        m_LZ4Comp, (const char *)src, (char *)out.data() + offs + sizeof(int32_t), (int)srcSize,
+        (int)LZ4_COMPRESSBOUND(lz4BlockSize), lz4Acceleration);
+
+    if(compSize <= 0)
+    {
+      RDCERR("Error compressing: %i", compSize);
+      out.resize(offs);
+      return false;
+    }
+
+    memcpy(out.data() + offs, &compSize, sizeof(compSize));
+    out.resize(offs + sizeof(compSize) + compSize);
+
+    return true;
+  }
+
+private:
+  LZ4_stream_t *m_LZ4Comp;
+};
+
+LZ4ParallelCompressor::LZ4ParallelCompressor(StreamWriter *write, Ownership own,
+                                             uint32_t numThreads)
+    : ParallelCompressor(write, own, (uint32_t)lz4BlockSize, numThreads,
+                         []() { return new LZ4BlockCodec(); })
+{
+}
+
+LZ4Decompressor::LZ4Decompressor(StreamReader *read, Ownership own, bool seekable)
+    : Decompressor(read, own), m_Seekable(seekable)
 {
   m_Page[0] = AllocAlignedBuffer(lz4BlockSize);
   m_Page[1] = AllocAlignedBuffer(lz4BlockSize);
@@ -165,6 +244,20 @@ LZ4Decompressor::LZ4Decompressor(StreamReader *read, Ownership own) : Decompress
   m_LZ4Decomp = LZ4_createStreamDecode();
 
   LZ4_setStreamDecode(m_LZ4Decomp, NULL, 0);
+
+  if(m_Seekable)
+  {
+    if(!m_Index.Read(m_Read))
+    {
+      RDCERR("Couldn't read block index for seekable LZ4 stream");
+      FreeBuffers();
+    }
+    else if(m_Index.blockSize != lz4BlockSize)
+    {
+      RDCERR("Unexpected block size %u in seekable LZ4 stream", m_Index.blockSize);
+      FreeBuffers();
+    }
+  }
 }
 
 LZ4Decompressor::~LZ4Decompressor()
@@ -180,7 +273,8 @@ bool LZ4Decompressor::Recompress(Compressor *comp)
 {
   bool success = true;
 
-  while(success && !m_Read->AtEnd())
+  // seekable streams have the block index after the last block, so we can't just read to the end
+  while(success && (m_Seekable ? m_Block < m_Index.NumBlocks() : !m_Read->AtEnd()))
   {
     success &= FillPage0();
     if(success)
@@ -229,6 +323,27 @@ bool LZ4Decompressor::Read(void *data, uint64_t numBytes)
 
   while(success && numBytes > 0)
   {
+    // if the stream is seekable and we're reading several whole blocks, decompress them straight
+    // into the destination in parallel. The last block might be partial so it always goes through
+    // the normal path.
+    if(m_Seekable && numBytes >= 2 * lz4BlockSize && m_Block + 1 < m_Index.NumBlocks())
+    {
+      uint64_t numBlocks = RDCMIN(numBytes / lz4BlockSize, m_Index.NumBlocks() - 1 - m_Block);
+
+      success &= ReadBlocksParallel(dst, numBlocks);
+
+      if(!success)
+        return success;
+
+      dst += numBlocks * lz4BlockSize;
+      numBytes -= numBlocks * lz4BlockSize;
+
+      // the page no longer holds the block before m_Block, so it can't be used
+      m_PageOffset = m_PageLength = 0;
+
+      continue;
+    }
+
     success &= FillPage0();
 
     if(!success)
@@ -251,6 +366,132 @@ bool LZ4Decompressor::Read(void *data, uint64_t numBytes)
   return success;
 }
 
+bool LZ4Decompressor::SetOffset(uint64_t offs)
+{
+  if(!m_Seekable)
+    return Decompressor::SetOffset(offs);
+
+  // if we encountered a stream error this will be NULL
+  if(!m_CompressBuffer)
+    return false;
+
+  if(offs > m_Index.uncompressedSize)
+  {
+    RDCERR("Seeking to %llu past the end of the stream (%llu bytes)", offs,
+           m_Index.uncompressedSize);
+    return false;
+  }
+
+  const uint64_t block = offs / lz4BlockSize;
+
+  // if we already have this block decompressed we can just move within it
+  if(m_PageLength > 0 && block + 1 == m_Block)
+  {
+    m_PageOffset = offs - block * lz4BlockSize;
+    return true;
+  }
+
+  m_Block = block;
+  m_PageOffset = m_PageLength = 0;
+
+  // nothing to decompress if we're seeking to the end of a stream that finishes on a block boundary
+  if(block == m_Index.NumBlocks())
+    return true;
+
+  m_Read->SetOffset(m_Index.offsets[block]);
+
+  if(m_Read->IsErrored())
+  {
+    RDCERR("Error seeking to block %llu", block);
+    FreeBuffers();
+    return false;
+  }
+
+  if(!FillPage0())
+    return false;
+
+  m_PageOffset = offs - block * lz4BlockSize;
+
+  return true;
+}
+
+bool LZ4Decompressor::ReadBlocksParallel(byte *dst, uint64_t numBlocks)
+{
+  // bound how much compressed data we read in at once
+  const uint64_t maxBatchBlocks = 256;
+
+  while(numBlocks > 0)
+  {
+    const uint64_t batchBlocks = RDCMIN(numBlocks, maxBatchBlocks);
+    const uint64_t firstBlock = m_Block;
+    const uint64_t compStart = m_Index.offsets[firstBlock];
+    const uint64_t compLength = m_Index.offsets[firstBlock + batchBlocks] - compStart;
+
+    // blocks are read in order, so the underlying stream is already at the first one
+    RDCASSERTEQUAL(m_Read->GetOffset(), compStart);
+
+    // if the compressed data is already in memory, e.g. in a mapped file, decompress it in place
+    const byte *compData = m_Read->ReadInPlace(compLength);
+
+    if(!compData)
+    {
+      m_Staging.resize((size_t)compLength);
+
+      if(!m_Read->Read(m_Staging.data(), compLength))
+      {
+        RDCERR("Error reading %llu compressed blocks", batchBlocks);
+        FreeBuffers();
+        return false;
+      }
+
+      compData = m_Staging.data();
+    }
+
+    bool success = ParallelProcessBlocks(
+        (uint32_t)batchBlocks, [this, dst, compData, firstBlock, compStart](uint32_t i) {
+          const uint64_t blockStart = m_Index.offsets[firstBlock + i] - compStart;
+          const uint64_t blockLength = m_Index.offsets[firstBlock + i + 1] - compStart - blockStart;
+
+          int32_t compSize = 0;
+
+          if(blockLength < sizeof(compSize))
+            return false;
+
+          memcpy(&compSize, compData + blockStart, sizeof(compSize));
+
+          if(compSize < 0 || uint64_t(compSize) + sizeof(compSize) != blockLength)
+            return false;
+
+          int32_t decompSize = LZ4_decompress_safe(
+              (const char *)compData + blockStart + sizeof(compSize),
+              (char *)dst + i * lz4BlockSize, compSize, (int)lz4BlockSize);
+
+          return decompSize == (int32_t)lz4BlockSize;
+        });
+
+    if(!success)
+    {
+      RDCERR("Error decompressing blocks %llu to %llu", firstBlock, firstBlock + batchBlocks - 1);
+      FreeBuffers();
+      return false;
+    }
+
+    m_Block += batchBlocks;
+    dst += batchBlocks * lz4BlockSize;
+    numBlocks -= batchBlocks;
+  }
+
+  return true;
+}
+
+void LZ4Decompressor::FreeBuffers()
+{
+  FreeAlignedBuffer(m_Page[0]);
+  FreeAlignedBuffer(m_Page[1]);
+  FreeAlignedBuffer(m_CompressBuffer);
+  m_Page[0] = m_Page[1] = m_CompressBuffer = NULL;
+}
+
 bool LZ4Decompressor::FillPage0()
 {
   // swap pages
@@ -260,6 +501,13 @@ bool LZ4Decompressor::FillPage0()
 
   bool success = true;
 
+  if(m_Seekable && m_Block >= m_Index.NumBlocks())
+  {
+    RDCERR("Reading past the last block in seekable stream");
+    FreeBuffers();
+    return false;
+  }
+
   success &= m_Read->Read(compSize);
   if(!success || compSize < 0 || compSize > (int)LZ4_COMPRESSBOUND(lz4BlockSize))
   {
@@ -270,7 +518,13 @@ bool LZ4Decompressor::FillPage0()
     m_Page[0] = m_Page[1] = m_CompressBuffer = NULL;
     return false;
   }
-  success &= m_Read->Read(m_CompressBuffer, compSize);
+  const byte *compData = m_Read->ReadInPlace(compSize);
+
+  if(!compData)
+  {
+    success &= m_Read->Read(m_CompressBuffer, compSize);
+    compData = m_CompressBuffer;
+  }
 
   if(!success)
   {
@@ -282,8 +536,20 @@ bool LZ4Decompressor::FillPage0()
     return false;
   }
 
-  int32_t decompSize = LZ4_decompress_safe_continue(m_LZ4Decomp, (const char *)m_CompressBuffer,
-                                                    (char *)m_Page[0], compSize, lz4BlockSize);
+  int32_t decompSize = 0;
+
+  if(m_Seekable)
+  {
+    // blocks are independent, there's no history to decompress with
+    decompSize =
+        LZ4_decompress_safe((const char *)compData, (char *)m_Page[0], compSize, lz4BlockSize);
+    m_Block++;
+  }
+  else
+  {
+    decompSize = LZ4_decompress_safe_continue(m_LZ4Decomp, (const char *)compData,
+                                              (char *)m_Page[0], compSize, lz4BlockSize);
+  }
 
   if(decompSize < 0)
   {
@@ -30,7 +30,9 @@
 class LZ4Compressor : public Compressor
 {
 public:
-  LZ4Compressor(StreamWriter *write, Ownership own);
+  // if seekable is true, each block is compressed independently and a block index is written on
+  // Finish() - see SeekableBlockIndex
+  LZ4Compressor(StreamWriter *write, Ownership own, bool seekable = false);
   ~LZ4Compressor();
 
   bool Write(const void *data, uint64_t numBytes);
@@ -43,25 +45,46 @@ private:
   byte *m_CompressBuffer;
   uint64_t m_PageOffset;
 
+  bool m_Seekable;
+  uint64_t m_CompressedOffset = 0;
+  SeekableBlockIndex m_Index;
+
   LZ4_stream_t *m_LZ4Comp;
 };
 
+// writes the same seekable stream as LZ4Compressor, with blocks compressed on worker threads
+class LZ4ParallelCompressor : public ParallelCompressor
+{
+public:
+  LZ4ParallelCompressor(StreamWriter *write, Ownership own, uint32_t numThreads);
+};
+
 class LZ4Decompressor : public Decompressor
 {
 public:
-  LZ4Decompressor(StreamReader *read, Ownership own);
+  // seekable must match how the stream was compressed
+  LZ4Decompressor(StreamReader *read, Ownership own, bool seekable = false);
   ~LZ4Decompressor();
 
   bool Recompress(Compressor *comp);
   bool Read(void *data, uint64_t numBytes);
+  bool SetOffset(uint64_t offs);
 
 private:
   bool FillPage0();
+  bool ReadBlocksParallel(byte *dst, uint64_t numBlocks);
+  void FreeBuffers();
 
   byte *m_Page[2];
   byte *m_CompressBuffer;
   uint64_t m_PageOffset;
   uint64_t m_PageLength;
 
+  bool m_Seekable;
+  // the next block that FillPage0 will decompress, when seekable
+  uint64_t m_Block = 0;
+  SeekableBlockIndex m_Index;
+  bytebuf m_Staging;
+
   LZ4_streamDecode_t *m_LZ4Decomp;
 };
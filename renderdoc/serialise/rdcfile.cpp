@@ -27,11 +27,37 @@
 #include "api/replay/version.h"
 #include "common/dds_readwrite.h"
 #include "common/formatting.h"
+#include "common/threading.h"
+#include "core/settings.h"
 #include "jpeg-compressor/jpge.h"
 #include "stb/stb_image.h"
+#include "strings/string_utils.h"
+#include "zstd/xxhash.h"
 #include "lz4io.h"
 #include "zstdio.h"
 
+RDOC_CONFIG(uint32_t, Capture_CompressionThreads, 0,
+            "The number of job worker threads used at once to compress seekable sections when "
+            "writing captures. 0 picks a number based on the available CPU cores, 1 compresses on "
+            "the writing thread.");
+
+RDOC_CONFIG(uint32_t, Capture_BlobThreshold, 0,
+            "Byte buffers at least this large are stored once per capture and referenced by "
+            "hash, so that repeated data like identical texture uploads is only saved once. 0 "
+            "disables this.");
+
+RDOC_CONFIG(bool, Capture_IncrementalInitialContents, false,
+            "Store the initial contents of resources incrementally across consecutive captures, "
+            "so that each capture only stores the pages that changed since an earlier one. Opening "
+            "such a capture needs the earlier captures it refers to next to it, unmodified and "
+            "under their original filenames. Deleting or replacing an earlier capture, including "
+            "temporary captures that are discarded or replaced without being saved, leaves every "
+            "later capture that refers to it unable to open.");
+
+RDOC_CONFIG(bool, Replay_MemoryMapCaptures, true,
+            "Map capture files into memory when opening them, so that uncompressed data can be "
+            "read in place instead of being copied.");
+
 // not provided by tinyexr, just do by hand
 bool is_exr_file(FILE *f)
 {
@@ -136,6 +162,26 @@ bool is_exr_file(FILE *f)
    }
  };
 
+ // compressed sections are a series of blocks, each of which is stored as:
+ BlockHeader
+ {
+   uint32_t compressedLength;
+   byte compressedData[compressedLength];
+ }
+
+ // in LZ4 sections each block may reference data in the block before, so the section must be
+ // decompressed from the start. If the section flags contain SectionFlags::Seekable then every
+ // block is independent and the blocks are followed by an index that allows random access:
+ SeekableBlockIndex
+ {
+   uint64_t blockOffsets[numBlocks + 1]; // offset of each block from the start of the section
+                                         // data, followed by the offset of the end of the blocks
+   uint64_t uncompressedLength;          // total uncompressed length of all blocks
+   uint64_t numBlocks;
+   uint32_t blockSize;                   // uncompressed size of all blocks but the last
+   uint32_t magic = 'RDBI';
+ }
+
  // remainder of the file is tightly packed/unaligned section structures.
  // The first section must always be the actual frame capture data in
  // binary form, other sections can follow in any order
@@ -229,6 +275,29 @@ struct BinarySectionHeader
   // char name[sectionNameLength];
   // byte data[sectionLength];
 };
+
+// the contents of a SectionType::Blobs section start with this header, followed by the tightly
+// packed table of blobs then all of their data.
+struct BlobsHeader
+{
+  uint64_t numBlobs;
+  uint64_t dataSize;
+};
+
+static const uint64_t BlobsVersion = 1;
+
+// the contents of a SectionType::IncrementalContents section start with this header, followed by
+// each resource's entry then all of their data.
+struct IncrementalContentsHeader
+{
+  // identifies the capture, so that a different capture saved under the same name isn't mistaken
+  // for it when it's used as a base
+  uint64_t captureID;
+  uint64_t numEntries;
+  uint64_t dataSize;
+};
+
+static const uint64_t IncrementalContentsVersion = 2;
 };
 
 #define SETERROR(error, ...)                        \
@@ -246,10 +315,20 @@ struct BinarySectionHeader
 
 RDCFile::~RDCFile()
 {
+  ReleaseMapping();
+
   if(m_File)
     FileIO::fclose(m_File);
 }
 
+void RDCFile::ReleaseMapping()
+{
+  // any readers still using the mapping keep it alive until they're done
+  if(m_Mapping)
+    m_Mapping->Release();
+  m_Mapping = NULL;
+}
+
 void RDCFile::Open(const rdcstr &path)
 {
   // silently fail when opening the empty string, to allow 'releasing' a capture file by opening an
@@ -307,6 +386,14 @@ void RDCFile::Open(const rdcstr &path)
   uint64_t fileSize = FileIO::ftell64(m_File);
   FileIO::fseek64(m_File, 0, SEEK_SET);
 
+  if(Replay_MemoryMapCaptures())
+  {
+    byte *mapping = FileIO::fmap(m_File, fileSize);
+    if(mapping)
+      m_Mapping = new StreamMemory(mapping, fileSize,
+                                   [mapping, fileSize]() { FileIO::funmap(mapping, fileSize); });
+  }
+
   StreamReader reader(m_File, fileSize, Ownership::Nothing);
 
   Init(reader);
@@ -680,6 +767,8 @@ void RDCFile::SetData(RDCDriver driver, const rdcstr &driverName, uint64_t machi
 
 void RDCFile::Create(const rdcstr &filename)
 {
+  ReleaseMapping();
+
   m_File = FileIO::fopen(filename, FileIO::WriteBinary);
   m_Filename = filename;
 
@@ -836,22 +925,35 @@ StreamReader *RDCFile::ReadSection(int index) const
 
   const SectionProperties &props = m_Sections[index];
   SectionLocation offsetSize = m_SectionLocations[index];
-  FileIO::fseek64(m_File, offsetSize.dataOffset, SEEK_SET);
 
-  StreamReader *fileReader = new StreamReader(m_File, offsetSize.diskLength, Ownership::Nothing);
+  StreamReader *fileReader = NULL;
+
+  // read straight out of the mapping if we have one. Uncompressed sections are then never copied,
+  // and compressed sections are decompressed from it directly
+  if(m_Mapping && offsetSize.dataOffset + offsetSize.diskLength <= m_Mapping->GetSize())
+  {
+    fileReader = new StreamReader(m_Mapping, offsetSize.dataOffset, offsetSize.diskLength);
+  }
+  else
+  {
+    FileIO::fseek64(m_File, offsetSize.dataOffset, SEEK_SET);
+    fileReader = new StreamReader(m_File, offsetSize.diskLength, Ownership::Nothing);
+  }
 
   StreamReader *compReader = NULL;
 
+  const bool seekable = bool(props.flags & SectionFlags::Seekable);
+
   if(props.flags & SectionFlags::LZ4Compressed)
   {
     // the user will delete the compressed reader, and then it will delete the compressor and the
     // file reader
-    compReader = new StreamReader(new LZ4Decompressor(fileReader, Ownership::Stream),
+    compReader = new StreamReader(new LZ4Decompressor(fileReader, Ownership::Stream, seekable),
                                   props.uncompressedSize, Ownership::Stream);
   }
   else if(props.flags & SectionFlags::ZstdCompressed)
   {
-    compReader = new StreamReader(new ZSTDDecompressor(fileReader, Ownership::Stream),
+    compReader = new StreamReader(new ZSTDDecompressor(fileReader, Ownership::Stream, seekable),
                                   props.uncompressedSize, Ownership::Stream);
   }
 
@@ -883,6 +985,9 @@ StreamWriter *RDCFile::WriteSection(const SectionProperties &props)
     return w;
   }
 
+  // the file is about to change underneath the mapping, so stop using it for new readers
+  ReleaseMapping();
+
   // re-open the file as read-write
   {
     uint64_t offs = FileIO::ftell64(m_File);
@@ -1165,19 +1270,40 @@ StreamWriter *RDCFile::WriteSection(const SectionProperties &props)
 
   StreamWriter *compWriter = NULL;
 
+  const bool seekable = bool(props.flags & SectionFlags::Seekable);
+
+  // seekable blocks are independent so they can be compressed in parallel. The output is the same
+  // either way
+  uint32_t numThreads = 1;
+  if(seekable)
+  {
+    numThreads = Capture_CompressionThreads();
+    if(numThreads == 0)
+      numThreads = RDCMIN(Threading::NumberOfCores(), 4U);
+  }
+
+  // the user will delete the compressed writer, and then it will delete the compressor and the
+  // file writer
+  Compressor *compressor = NULL;
+
   if(props.flags & SectionFlags::LZ4Compressed)
   {
-    // the user will delete the compressed writer, and then it will delete the compressor and the
-    // file writer
-    compWriter =
-        new StreamWriter(new LZ4Compressor(fileWriter, Ownership::Stream), Ownership::Stream);
+    if(numThreads > 1)
+      compressor = new LZ4ParallelCompressor(fileWriter, Ownership::Stream, numThreads);
+    else
+      compressor = new LZ4Compressor(fileWriter, Ownership::Stream, seekable);
   }
   else if(props.flags & SectionFlags::ZstdCompressed)
   {
-    compWriter =
-        new StreamWriter(new ZSTDCompressor(fileWriter, Ownership::Stream), Ownership::Stream);
+    if(numThreads > 1)
+      compressor = new ZSTDParallelCompressor(fileWriter, Ownership::Stream, numThreads);
+    else
+      compressor = new ZSTDCompressor(fileWriter, Ownership::Stream, seekable);
   }
 
+  if(compressor)
+    compWriter = new StreamWriter(compressor, Ownership::Stream);
+
   uint64_t dataOffset = FileIO::ftell64(m_File);
 
   m_CurrentWritingProps = props;
@@ -1244,6 +1370,571 @@ StreamWriter *RDCFile::WriteSection(const SectionProperties &props)
   return compWriter ? compWriter : fileWriter;
 }
 
+bool RDCFile::TakeMemorySections(RDCFile &src)
+{
+  if(src.m_File || src.m_MemorySections.size() != src.m_Sections.size())
+  {
+    RDCERR("Sections can only be taken from a capture held in memory");
+    return false;
+  }
+
+  bool success = true;
+
+  for(size_t i = 0; success && i < src.m_MemorySections.size(); i++)
+  {
+    StreamWriter *writer = WriteSection(src.m_Sections[i]);
+
+    writer->Write(src.m_MemorySections[i].data(), src.m_MemorySections[i].size());
+    writer->Finish();
+
+    success = !writer->IsErrored();
+
+    delete writer;
+
+    bytebuf().swap(src.m_MemorySections[i]);
+  }
+
+  src.m_MemorySections.clear();
+  src.m_Sections.clear();
+
+  return success;
+}
+
+uint64_t RDCBlobStore::Add(const byte *data, uint64_t length, uint64_t hash)
+{
+  auto it = m_Lookup.find(hash);
+  if(it != m_Lookup.end())
+  {
+    const BlobEntry &blob = m_Blobs[(size_t)it->second];
+
+    // a matching hash is almost certainly the same data, but check to be sure. On a collision the
+    // new data is just added as a separate blob.
+    if(blob.length == length && memcmp(m_Data.data() + blob.offset, data, (size_t)length) == 0)
+    {
+      m_DuplicateBytes += length;
+      return it->second;
+    }
+  }
+
+  BlobEntry blob;
+  blob.hash = hash;
+  blob.offset = m_Data.size();
+  blob.length = length;
+
+  uint64_t id = m_Blobs.size();
+
+  m_Blobs.push_back(blob);
+  m_Data.append(data, (size_t)length);
+
+  if(it == m_Lookup.end())
+    m_Lookup[hash] = id;
+
+  return id;
+}
+
+const byte *RDCBlobStore::Get(uint64_t id, uint64_t hash, uint64_t length) const
+{
+  if(id >= m_Blobs.size())
+    return NULL;
+
+  const BlobEntry &blob = m_Blobs[(size_t)id];
+
+  if(blob.hash != hash || blob.length != length)
+    return NULL;
+
+  return m_Data.data() + blob.offset;
+}
+
+void RDCBlobStore::Clear()
+{
+  m_Blobs.clear();
+  m_Data.clear();
+  m_Lookup.clear();
+  m_DuplicateBytes = 0;
+}
+
+bool RDCBlobStore::Write(RDCFile &rdc) const
+{
+  if(m_Blobs.empty())
+    return true;
+
+  BlobsHeader header = {};
+  header.numBlobs = m_Blobs.size();
+  header.dataSize = m_Data.size();
+
+  SectionProperties props;
+  props.type = SectionType::Blobs;
+  props.version = BlobsVersion;
+  props.flags = SectionFlags::LZ4Compressed | SectionFlags::Seekable;
+
+  StreamWriter *writer = rdc.WriteSection(props);
+
+  writer->Write(header);
+  writer->Write(m_Blobs.data(), m_Blobs.byteSize());
+  writer->Write(m_Data.data(), m_Data.size());
+
+  writer->Finish();
+
+  bool success = !writer->IsErrored();
+
+  delete writer;
+
+  RDCLOG("Stored %zu unique blobs totalling %llu bytes, %llu bytes of duplicates removed",
+         m_Blobs.size(), (uint64_t)m_Data.size(), m_DuplicateBytes);
+
+  return success;
+}
+
+bool RDCBlobStore::Read(const RDCFile &rdc)
+{
+  Clear();
+
+  int sectionIdx = rdc.SectionIndex(SectionType::Blobs);
+
+  if(sectionIdx < 0)
+    return true;
+
+  if(rdc.GetSectionProperties(sectionIdx).version != BlobsVersion)
+  {
+    RDCERR("Unsupported blob section version %llu", rdc.GetSectionProperties(sectionIdx).version);
+    return false;
+  }
+
+  StreamReader *reader = rdc.ReadSection(sectionIdx);
+
+  BlobsHeader header = {};
+  reader->Read(header);
+
+  bool valid = !reader->IsErrored() &&
+               header.numBlobs * sizeof(BlobEntry) + header.dataSize ==
+                   reader->GetSize() - reader->GetOffset();
+
+  if(valid)
+  {
+    m_Blobs.resize((size_t)header.numBlobs);
+    reader->Read(m_Blobs.data(), m_Blobs.byteSize());
+
+    m_Data.resize((size_t)header.dataSize);
+    reader->Read(m_Data.data(), m_Data.size());
+
+    valid = !reader->IsErrored();
+
+    for(const BlobEntry &blob : m_Blobs)
+      valid = valid && blob.offset + blob.length <= m_Data.size();
+  }
+
+  delete reader;
+
+  if(!valid)
+  {
+    RDCERR("Blob section is corrupted");
+    Clear();
+  }
+
+  return valid;
+}
+
+const uint64_t RDCIncrementalContents::PageSize;
+
+RDCIncrementalContents::~RDCIncrementalContents()
+{
+  for(auto it = m_Bases.begin(); it != m_Bases.end(); ++it)
+    delete it->second;
+}
+
+void RDCIncrementalContents::Add(ResourceId id, const byte *data, uint64_t length)
+{
+  const uint64_t numPages = (length + PageSize - 1) / PageSize;
+
+  rdcarray<uint64_t> hashes;
+  hashes.resize((size_t)numPages);
+
+  for(uint64_t p = 0; p < numPages; p++)
+  {
+    const uint64_t offs = p * PageSize;
+    hashes[(size_t)p] = XXH64(data + offs, (size_t)RDCMIN(PageSize, length - offs), 0);
+  }
+
+  SCOPED_LOCK(m_Lock);
+
+  Entry entry;
+  entry.id = id;
+  entry.length = length;
+  entry.dataOffset = m_Data.size();
+
+  // the last capture that stored this resource can only be used as a base if the size is the same
+  const History *prev = NULL;
+  auto it = m_History.find(id);
+  if(it != m_History.end() && it->second.length == length)
+  {
+    prev = &it->second;
+    entry.base = prev->capture;
+    entry.baseID = prev->captureID;
+  }
+
+  // store each run of changed pages, which is every page if there's no base
+  uint64_t p = 0;
+  while(p < numPages)
+  {
+    if(prev && prev->pageHashes[(size_t)p] == hashes[(size_t)p])
+    {
+      p++;
+      continue;
+    }
+
+    uint64_t end = p + 1;
+    while(end < numPages && !(prev && prev->pageHashes[(size_t)end] == hashes[(size_t)end]))
+      end++;
+
+    StoredRange range;
+    range.offset = p * PageSize;
+    range.length = RDCMIN(end * PageSize, length) - range.offset;
+
+    entry.ranges.push_back(range);
+    m_Data.append(data + range.offset, (size_t)range.length);
+
+    p = end;
+  }
+
+  // if a resource is added twice, the latest contents win
+  auto existing = m_EntryLookup.find(id);
+  if(existing != m_EntryLookup.end())
+  {
+    m_Entries[existing->second] = entry;
+  }
+  else
+  {
+    m_EntryLookup[id] = m_Entries.size();
+    m_Entries.push_back(entry);
+  }
+
+  m_PendingHashes[id].swap(hashes);
+}
+
+uint64_t RDCIncrementalContents::GenerateCaptureID(const rdcstr &filename)
+{
+  static int32_t counter = 0;
+
+  struct
+  {
+    uint64_t timestamp;
+    uint64_t tick;
+    uint32_t pid;
+    int32_t counter;
+  } unique = {
+      Timing::GetUnixTimestamp(), Timing::GetTick(), Process::GetCurrentPID(),
+      Atomic::Inc32(&counter),
+  };
+
+  uint64_t ret = XXH64(&unique, sizeof(unique), XXH64(filename.c_str(), filename.size(), 0));
+
+  // 0 is never used, so that it can't match an uninitialised ID
+  return ret ? ret : 1;
+}
+
+bool RDCIncrementalContents::EndCapture(RDCFile &rdc, const rdcstr &filename)
+{
+  SCOPED_LOCK(m_Lock);
+
+  bool success = true;
+
+  if(!m_Entries.empty())
+  {
+    IncrementalContentsHeader header = {};
+    header.captureID = GenerateCaptureID(filename);
+    header.numEntries = m_Entries.size();
+    header.dataSize = m_Data.size();
+
+    SectionProperties props;
+    props.type = SectionType::IncrementalContents;
+    props.version = IncrementalContentsVersion;
+    props.flags = SectionFlags::LZ4Compressed | SectionFlags::Seekable;
+
+    StreamWriter *writer = rdc.WriteSection(props);
+
+    writer->Write(header);
+
+    for(const Entry &entry : m_Entries)
+    {
+      writer->Write(entry.id);
+      writer->Write(entry.length);
+      writer->Write(entry.dataOffset);
+      writer->Write((uint64_t)entry.ranges.size());
+      writer->Write(entry.baseID);
+      writer->Write((uint64_t)entry.base.size());
+      writer->Write(entry.base.c_str(), entry.base.size());
+      writer->Write(entry.ranges.data(), entry.ranges.byteSize());
+    }
+
+    writer->Write(m_Data.data(), m_Data.size());
+
+    writer->Finish();
+
+    success = !writer->IsErrored();
+
+    delete writer;
+
+    RDCLOG("Stored %zu resources incrementally in %llu bytes", m_Entries.size(),
+           (uint64_t)m_Data.size());
+
+    // this capture is only a base for later captures if it was written successfully
+    if(success)
+    {
+      for(const Entry &entry : m_Entries)
+      {
+        History &history = m_History[entry.id];
+        history.capture = get_basename(filename);
+        history.captureID = header.captureID;
+        history.length = entry.length;
+        history.pageHashes.swap(m_PendingHashes[entry.id]);
+      }
+    }
+  }
+
+  m_Entries.clear();
+  m_EntryLookup.clear();
+  m_Data.clear();
+  m_PendingHashes.clear();
+
+  return success;
+}
+
+void RDCIncrementalContents::DiscardCapture()
+{
+  SCOPED_LOCK(m_Lock);
+
+  m_Entries.clear();
+  m_EntryLookup.clear();
+  m_Data.clear();
+  m_PendingHashes.clear();
+}
+
+bool RDCIncrementalContents::Read(const RDCFile &rdc, const rdcstr &filename)
+{
+  m_Entries.clear();
+  m_EntryLookup.clear();
+  m_Data.clear();
+  m_Filename = filename;
+  m_CaptureID = 0;
+
+  int sectionIdx = rdc.SectionIndex(SectionType::IncrementalContents);
+
+  if(sectionIdx < 0)
+    return true;
+
+  if(rdc.GetSectionProperties(sectionIdx).version != IncrementalContentsVersion)
+  {
+    RDCERR("Unsupported incremental contents section version %llu",
+           rdc.GetSectionProperties(sectionIdx).version);
+    return false;
+  }
+
+  StreamReader *reader = rdc.ReadSection(sectionIdx);
+
+  IncrementalContentsHeader header = {};
+  reader->Read(header);
+
+  bool valid = !reader->IsErrored() && header.dataSize <= reader->GetSize();
+
+  m_CaptureID = header.captureID;
+
+  for(uint64_t i = 0; valid && i < header.numEntries; i++)
+  {
+    Entry entry;
+    uint64_t numRanges = 0, baseLength = 0;
+
+    reader->Read(entry.id);
+    reader->Read(entry.length);
+    reader->Read(entry.dataOffset);
+    reader->Read(numRanges);
+    reader->Read(entry.baseID);
+    reader->Read(baseLength);
+
+    valid = !reader->IsErrored() &&
+            baseLength + numRanges * sizeof(StoredRange) <= reader->GetSize() - reader->GetOffset();
+
+    if(!valid)
+      break;
+
+    entry.base.resize((size_t)baseLength);
+    reader->Read(entry.base.data(), baseLength);
+
+    entry.ranges.resize((size_t)numRanges);
+    reader->Read(entry.ranges.data(), entry.ranges.byteSize());
+
+    // every range must be within the resource, with its data within the section
+    uint64_t dataEnd = entry.dataOffset;
+    for(const StoredRange &range : entry.ranges)
+    {
+      valid = valid && range.offset + range.length <= entry.length;
+      dataEnd += range.length;
+    }
+
+    valid = valid && !reader->IsErrored() && dataEnd <= header.dataSize;
+
+    m_EntryLookup[entry.id] = m_Entries.size();
+    m_Entries.push_back(entry);
+  }
+
+  if(valid)
+  {
+    valid = header.dataSize == reader->GetSize() - reader->GetOffset();
+
+    if(valid)
+    {
+      m_Data.resize((size_t)header.dataSize);
+      reader->Read(m_Data.data(), m_Data.size());
+      valid = !reader->IsErrored();
+    }
+  }
+
+  delete reader;
+
+  if(!valid)
+  {
+    RDCERR("Incremental contents section is corrupted");
+    m_Entries.clear();
+    m_EntryLookup.clear();
+    m_Data.clear();
+  }
+
+  return valid;
+}
+
+// each capture refers to an earlier one, so a long chain means the captures are malformed
+static const uint32_t MaxBaseDepth = 1000;
+
+bool RDCIncrementalContents::Resolve(ResourceId id, byte *data, uint64_t length)
+{
+  return Resolve(id, data, length, 0);
+}
+
+bool RDCIncrementalContents::Resolve(ResourceId id, byte *data, uint64_t length, uint32_t depth)
+{
+  if(depth > MaxBaseDepth)
+  {
+    RDCERR("Too many base captures resolving incremental contents for %s", ToStr(id).c_str());
+    return false;
+  }
+
+  auto it = m_EntryLookup.find(id);
+
+  if(it == m_EntryLookup.end())
+    return false;
+
+  const Entry &entry = m_Entries[it->second];
+
+  if(entry.length != length)
+  {
+    RDCERR("Incremental contents for %s are %llu bytes, expected %llu", ToStr(id).c_str(),
+           entry.length, length);
+    return false;
+  }
+
+  if(!entry.base.empty())
+  {
+    RDCIncrementalContents *base = GetBase(entry.base, entry.baseID);
+
+    if(!base || !base->Resolve(id, data, length, depth + 1))
+    {
+      RDCERR("Couldn't read contents of %s from base capture '%s'", ToStr(id).c_str(),
+             GetBasePath(entry.base).c_str());
+      return false;
+    }
+  }
+
+  uint64_t dataOffset = entry.dataOffset;
+
+  for(const StoredRange &range : entry.ranges)
+  {
+    memcpy(data + range.offset, m_Data.data() + dataOffset, (size_t)range.length);
+    dataOffset += range.length;
+  }
+
+  return true;
+}
+
+bool RDCIncrementalContents::FindBases(rdcstr &missing)
+{
+  return FindBases(missing, 0);
+}
+
+bool RDCIncrementalContents::FindBases(rdcstr &missing, uint32_t depth)
+{
+  if(depth > MaxBaseDepth)
+  {
+    RDCERR("Too many base captures referred to by '%s'", m_Filename.c_str());
+    missing = m_Filename;
+    return false;
+  }
+
+  for(const Entry &entry : m_Entries)
+  {
+    if(entry.base.empty())
+      continue;
+
+    bool seen = m_Bases.find(entry.base) != m_Bases.end();
+
+    RDCIncrementalContents *base = GetBase(entry.base, entry.baseID);
+
+    if(!base)
+    {
+      missing = GetBasePath(entry.base);
+      return false;
+    }
+
+    // only walk each base once, most entries refer to the same one
+    if(!seen && !base->FindBases(missing, depth + 1))
+      return false;
+  }
+
+  return true;
+}
+
+rdcstr RDCIncrementalContents::GetBasePath(const rdcstr &base) const
+{
+  // bases are stored by filename so that captures can be moved together
+  return get_dirname(m_Filename) + "/" + get_basename(base);
+}
+
+RDCIncrementalContents *RDCIncrementalContents::GetBase(const rdcstr &base, uint64_t baseID)
+{
+  auto it = m_Bases.find(base);
+  if(it != m_Bases.end())
+    return it->second && it->second->m_CaptureID == baseID ? it->second : NULL;
+
+  RDCIncrementalContents *ret = NULL;
+
+  // a capture read from memory has nowhere to find its bases
+  if(!m_Filename.empty())
+  {
+    rdcstr path = GetBasePath(base);
+
+    RDCFile rdc;
+    rdc.Open(path);
+
+    if(rdc.ErrorCode() == ContainerError::NoError)
+    {
+      ret = new RDCIncrementalContents;
+
+      if(!ret->Read(rdc, path))
+        SAFE_DELETE(ret);
+    }
+  }
+
+  // remember failures too, so that the capture isn't opened again for every resource
+  m_Bases[base] = ret;
+
+  if(ret && ret->m_CaptureID != baseID)
+  {
+    RDCERR("'%s' isn't the capture that '%s' was made from, it's been replaced since",
+           GetBasePath(base).c_str(), m_Filename.c_str());
+    return NULL;
+  }
+
+  return ret;
+}
+
 FILE *RDCFile::StealImageFileHandle(rdcstr &filename)
 {
   if(m_Driver != RDCDriver::Image)
@@ -24,6 +24,7 @@
 
 #pragma once
 
+#include <unordered_map>
 #include "core/core.h"
 #include "streamio.h"
 
@@ -84,6 +85,8 @@ public:
   void Create(const rdcstr &filename);
 
   ContainerError ErrorCode() const { return m_Error; }
+  // the file this was opened from or created as, or empty if it's only in memory
+  const rdcstr &GetFilename() const { return m_Filename; }
   rdcstr ErrorString() const { return m_ErrorString; }
   RDCDriver GetDriver() const { return m_Driver; }
   const rdcstr &GetDriverName() const { return m_DriverName; }
@@ -97,6 +100,9 @@ public:
   const SectionProperties &GetSectionProperties(int index) const { return m_Sections[index]; }
   StreamReader *ReadSection(int index) const;
   StreamWriter *WriteSection(const SectionProperties &props);
+  // for a file that was never created on disk and so holds its sections in memory, writes each of
+  // its sections to this file. The memory is freed as each section is written.
+  bool TakeMemorySections(RDCFile &src);
 
   // Only valid if GetDriver returns RDCDriver::Image, passes over the underlying FILE * for use
   // loading the image directly, since the RDC container isn't there to read from a section.
@@ -104,8 +110,11 @@ public:
 
 private:
   void Init(StreamReader &reader);
+  void ReleaseMapping();
 
   FILE *m_File = NULL;
+  // the file mapped into memory, if possible, so that sections can be read in place
+  StreamMemory *m_Mapping = NULL;
   rdcstr m_Filename;
   bytebuf m_Buffer;
 
@@ -134,3 +143,131 @@ private:
   rdcarray<SectionLocation> m_SectionLocations;
   rdcarray<bytebuf> m_MemorySections;
 };
+
+// Large byte buffers from a frame capture, each stored once in a SectionType::Blobs section and
+// referenced by hash. While capturing, blobs are added as buffers are written and the section is
+// written after the frame capture. On replay the section is read back and buffers are looked up as
+// the frame capture is read. See Serialiser::SetBlobThreshold.
+class RDCBlobStore
+{
+public:
+  // adds a blob and returns the ID to reference it with. If identical data has already been added
+  // that blob's ID is returned instead.
+  uint64_t Add(const byte *data, uint64_t length, uint64_t hash);
+
+  // returns the blob's data, or NULL if there's no matching blob
+  const byte *Get(uint64_t id, uint64_t hash, uint64_t length) const;
+
+  size_t NumBlobs() const { return m_Blobs.size(); }
+  uint64_t GetDataSize() const { return m_Data.size(); }
+  // the total size of all buffers that were added as duplicates and so didn't need storing
+  uint64_t GetDuplicateBytes() const { return m_DuplicateBytes; }
+  void Clear();
+
+  // writes the blob section, if there are any blobs
+  bool Write(RDCFile &rdc) const;
+  // reads the blob section, if the capture has one
+  bool Read(const RDCFile &rdc);
+
+private:
+  struct BlobEntry
+  {
+    uint64_t hash;
+    uint64_t offset;
+    uint64_t length;
+  };
+
+  rdcarray<BlobEntry> m_Blobs;
+  bytebuf m_Data;
+  // hash -> ID of the first blob with that hash, for finding duplicates
+  std::unordered_map<uint64_t, uint64_t> m_Lookup;
+  uint64_t m_DuplicateBytes = 0;
+};
+
+// The contents of resources stored incrementally across consecutive captures, in a
+// SectionType::IncrementalContents section. While capturing, the page hashes of each resource are
+// kept from one capture to the next, so that a capture only stores the pages that changed since
+// the last capture that stored the resource along with that capture's filename and unique ID. Base
+// captures are found by filename next to the capture that refers to them, and must have the same ID
+// so that a different capture saved under the same name isn't used. On replay the chain of base
+// captures is followed to rebuild the full contents. See Capture_IncrementalInitialContents.
+class RDCIncrementalContents
+{
+public:
+  // the granularity that changes are found at
+  static const uint64_t PageSize = 4096;
+
+  ~RDCIncrementalContents();
+
+  // adds a resource's contents to the capture being made. This can be called from several threads
+  // at once.
+  void Add(ResourceId id, const byte *data, uint64_t length);
+  // writes the section for the capture being made, if anything was added. filename is where the
+  // capture will be on disk, for later captures to refer to.
+  bool EndCapture(RDCFile &rdc, const rdcstr &filename);
+  // forgets everything added since the last capture ended
+  void DiscardCapture();
+
+  // reads the section from a capture, if it has one. filename is where the capture was read from,
+  // so that base captures which were moved along with it can still be found.
+  bool Read(const RDCFile &rdc, const rdcstr &filename);
+  // fills data with a resource's full contents, reading base captures as needed. Returns false if
+  // the capture doesn't store the resource or a base capture couldn't be read.
+  bool Resolve(ResourceId id, byte *data, uint64_t length);
+  // opens every base capture in the chain, returning false with the path of the first one that
+  // couldn't be read or isn't the capture that was referred to
+  bool FindBases(rdcstr &missing);
+
+  // the number of bytes stored, either for the capture being made or the capture that was read
+  uint64_t GetDataSize() const { return m_Data.size(); }
+
+private:
+  struct StoredRange
+  {
+    uint64_t offset;
+    uint64_t length;
+  };
+
+  struct Entry
+  {
+    ResourceId id;
+    uint64_t length;
+    // where the data for the ranges starts, stored one after another
+    uint64_t dataOffset;
+    // the capture holding any contents that aren't in ranges, or empty if ranges covers everything
+    rdcstr base;
+    uint64_t baseID = 0;
+    rdcarray<StoredRange> ranges;
+  };
+
+  struct History
+  {
+    rdcstr capture;
+    uint64_t captureID;
+    uint64_t length;
+    rdcarray<uint64_t> pageHashes;
+  };
+
+  bool Resolve(ResourceId id, byte *data, uint64_t length, uint32_t depth);
+  bool FindBases(rdcstr &missing, uint32_t depth);
+  rdcstr GetBasePath(const rdcstr &base) const;
+  RDCIncrementalContents *GetBase(const rdcstr &base, uint64_t baseID);
+  static uint64_t GenerateCaptureID(const rdcstr &filename);
+
+  Threading::CriticalSection m_Lock;
+
+  rdcarray<Entry> m_Entries;
+  std::unordered_map<ResourceId, size_t> m_EntryLookup;
+  bytebuf m_Data;
+
+  // while capturing, the page hashes of each resource from the last capture that stored it. The
+  // hashes for the capture being made only replace them once it's written.
+  std::unordered_map<ResourceId, History> m_History;
+  std::unordered_map<ResourceId, rdcarray<uint64_t>> m_PendingHashes;
+
+  // while replaying, where the capture was read from and the base captures it refers to, which are
+  // read as they're needed
+  rdcstr m_Filename;
+  uint64_t m_CaptureID = 0;
+  std::map<rdcstr, RDCIncrementalContents *> m_Bases;
+};
@@ -26,8 +26,12 @@
 #define SERIALISER_IMPL
 
 #include "serialiser.h"
+#include "common/call_stats.h"
+#include "common/threading.h"
 #include "core/core.h"
+#include "rdcfile.h"
 #include "strings/string_utils.h"
+#include "zstd/xxhash.h"
 
 #if ENABLED(RDOC_DEVEL)
 
@@ -106,6 +110,54 @@ Serialiser<SerialiserMode::Reading>::~Serialiser()
     delete m_Read;
 }
 
+template <>
+void Serialiser<SerialiserMode::Reading>::BeginDecodedChunk()
+{
+  m_DecodeMode = DecodeMode::None;
+  m_DecodeNesting = 0;
+
+  // the structured data needs everything decoded
+  if(!m_DecodeCache || m_ExportStructured || m_Structuriser)
+    return;
+
+  auto it = m_DecodeCache->m_Chunks.find(m_LastChunkOffset);
+  if(it != m_DecodeCache->m_Chunks.end())
+  {
+    m_DecodeMode = DecodeMode::Playback;
+    m_DecodeElement = it->second.firstElement;
+    m_DecodeEnd = it->second.firstElement + it->second.numElements;
+  }
+  else if(m_DecodeCache->GetMemoryUsage() < m_DecodeCache->m_Budget &&
+          m_DecodeCache->m_Elements.size() < UINT32_MAX)
+  {
+    m_DecodeMode = DecodeMode::Record;
+    m_DecodeElement = (uint32_t)m_DecodeCache->m_Elements.size();
+    m_DecodeDataStart = m_DecodeCache->m_Data.size();
+  }
+}
+
+template <>
+void Serialiser<SerialiserMode::Reading>::EndDecodedChunk()
+{
+  if(m_DecodeMode == DecodeMode::Record)
+  {
+    uint32_t numElements = uint32_t(m_DecodeCache->m_Elements.size() - m_DecodeElement);
+
+    // don't keep anything from a chunk that failed to read
+    if(m_Read->IsErrored() || numElements == 0)
+    {
+      m_DecodeCache->m_Elements.resize(m_DecodeElement);
+      m_DecodeCache->m_Data.resize((size_t)m_DecodeDataStart);
+    }
+    else
+    {
+      m_DecodeCache->m_Chunks[m_LastChunkOffset] = {m_DecodeElement, numElements};
+    }
+  }
+
+  m_DecodeMode = DecodeMode::None;
+}
+
 template <>
 uint32_t Serialiser<SerialiserMode::Reading>::BeginChunk(uint32_t, uint64_t)
 {
@@ -188,7 +240,7 @@ uint32_t Serialiser<SerialiserMode::Reading>::BeginChunk(uint32_t, uint64_t)
     if(name.empty())
       name = "<Unknown Chunk>";
 
-    SDChunk *chunk = new SDChunk(name);
+    SDChunk *chunk = SDObjectArena::Get(*m_StructuredFile).New<SDChunk>(InternString(name));
     chunk->metadata = m_ChunkMetadata;
 
     m_StructuredFile->chunks.push_back(chunk);
@@ -197,6 +249,8 @@ uint32_t Serialiser<SerialiserMode::Reading>::BeginChunk(uint32_t, uint64_t)
     m_InternalElement = 0;
   }
 
+  BeginDecodedChunk();
+
   return chunkID;
 }
 
@@ -210,7 +264,7 @@ void Serialiser<SerialiserMode::Reading>::SkipCurrentChunk()
 
     SDObject &current = *m_StructureStack.back();
 
-    SDObject &obj = *current.AddAndOwnChild(new SDObject("Opaque chunk"_lit, "Byte Buffer"_lit));
+    SDObject &obj = *current.AddAndOwnChild(NewObject("Opaque chunk"_lit, "Byte Buffer"_lit));
 
     obj.type.basetype = SDBasic::Buffer;
     obj.type.byteSize = m_ChunkMetadata.length;
@@ -262,6 +316,8 @@ void Serialiser<SerialiserMode::Reading>::SkipCurrentChunk()
 template <>
 void Serialiser<SerialiserMode::Reading>::EndChunk()
 {
+  EndDecodedChunk();
+
   if(ExportStructure())
   {
     RDCASSERTMSG("Object Stack is imbalanced!", m_StructureStack.size() <= 1,
@@ -345,6 +401,12 @@ uint32_t Serialiser<SerialiserMode::Writing>::BeginChunk(uint32_t chunkID, uint6
   RDCASSERTMSG("Beginning a chunk inside another chunk", m_ChunkMetadata.chunkID == 0,
                m_ChunkMetadata.chunkID);
 
+  m_ChunkStartOffset = m_Write->GetOffset();
+
+  // if the writer was rewound to discard data, forget any blobs that were in it
+  while(!m_BlobRanges.empty() && m_BlobRanges.back().sizeOffset >= m_ChunkStartOffset)
+    m_BlobRanges.pop_back();
+
   {
     // chunk index needs to be valid
     RDCASSERT(chunkID > 0);
@@ -450,7 +512,7 @@ uint32_t Serialiser<SerialiserMode::Writing>::BeginChunk(uint32_t chunkID, uint6
     if(name.empty())
       name = "<Unknown Chunk>";
 
-    SDChunk *chunk = new SDChunk(name);
+    SDChunk *chunk = SDObjectArena::Get(*m_StructuredFile).New<SDChunk>(InternString(name));
     chunk->metadata = m_ChunkMetadata;
 
     m_StructuredFile->chunks.push_back(chunk);
@@ -554,6 +616,189 @@ void Serialiser<SerialiserMode::Writing>::EndChunk()
   m_Write->Flush();
 }
 
+// a blob reference takes up as many bytes as the buffer it replaces, modulo the chunk alignment,
+// so that anything aligned after it in a chunk stays aligned when recorded chunks are rewritten.
+// The reference itself is the blob's hash followed by its ID in the store, then padding.
+static uint64_t BlobReferenceLength(uint64_t byteSize, uint64_t alignment)
+{
+  const uint64_t refSize = sizeof(uint64_t) * 2;
+  return refSize + (byteSize - refSize) % alignment;
+}
+
+static const byte BlobPadding[64] = {};
+
+template <>
+bool Serialiser<SerialiserMode::Writing>::BeginBlob(const byte *data, uint64_t byteSize)
+{
+  if(m_BlobThreshold == 0 || data == NULL || byteSize < m_BlobThreshold)
+    return false;
+
+  m_BlobHash = XXH64(data, (size_t)byteSize, 0);
+
+  // with a store the reference can be written immediately
+  if(m_BlobStore)
+    return true;
+
+  // otherwise the buffer is written as normal, and replaced if the chunk is written to a capture
+  ChunkBlobRange range = {};
+  range.sizeOffset = (uint32_t)m_Write->GetOffset();
+  range.hash = m_BlobHash;
+  m_BlobRanges.push_back(range);
+
+  return false;
+}
+
+template <>
+bool Serialiser<SerialiserMode::Reading>::BeginBlob(const byte *data, uint64_t byteSize)
+{
+  return false;
+}
+
+template <>
+void Serialiser<SerialiserMode::Writing>::WriteBlobReference(const byte *data, uint64_t byteSize)
+{
+  uint64_t id = m_BlobStore->Add(data, byteSize, m_BlobHash);
+
+  m_Write->Write(m_BlobHash);
+  m_Write->Write(id);
+  m_Write->Write(BlobPadding, BlobReferenceLength(byteSize, ChunkAlignment) - sizeof(uint64_t) * 2);
+}
+
+template <>
+void Serialiser<SerialiserMode::Reading>::WriteBlobReference(const byte *data, uint64_t byteSize)
+{
+}
+
+template <>
+void Serialiser<SerialiserMode::Writing>::ReadBlobReference(byte *data, uint64_t byteSize)
+{
+}
+
+template <>
+void Serialiser<SerialiserMode::Reading>::ReadBlobReference(byte *data, uint64_t byteSize)
+{
+  uint64_t hash = 0, id = 0;
+  m_Read->Read(hash);
+  m_Read->Read(id);
+  m_Read->Read(NULL, BlobReferenceLength(byteSize, ChunkAlignment) - sizeof(uint64_t) * 2);
+
+  const byte *blob = m_BlobStore ? m_BlobStore->Get(id, hash, byteSize) : NULL;
+
+  if(blob == NULL)
+  {
+    RDCERR("Byte buffer of %llu bytes references missing blob %llu", byteSize, id);
+    if(data)
+      memset(data, 0, (size_t)byteSize);
+    return;
+  }
+
+  if(data)
+    memcpy(data, blob, (size_t)byteSize);
+}
+
+template <>
+uint64_t Serialiser<SerialiserMode::Writing>::GetBlobStoreSize() const
+{
+  return m_BlobStore ? m_BlobStore->GetDataSize() : 0;
+}
+
+template <>
+uint64_t Serialiser<SerialiserMode::Reading>::GetBlobStoreSize() const
+{
+  return m_BlobStore ? m_BlobStore->GetDataSize() : 0;
+}
+
+template <>
+void Serialiser<SerialiserMode::Writing>::WriteChunkWithBlobs(const byte *data, uint64_t length,
+                                                              const ChunkBlobRange *ranges,
+                                                              uint32_t numRanges)
+{
+  // find the chunk's length in its header, in the same order that BeginChunk writes it
+  uint32_t c = 0;
+  memcpy(&c, data, sizeof(c));
+
+  uint64_t lengthOffset = sizeof(c);
+
+  if(c & ChunkCallstack)
+  {
+    uint32_t numFrames = 0;
+    memcpy(&numFrames, data + lengthOffset, sizeof(numFrames));
+    lengthOffset += sizeof(numFrames) + numFrames * sizeof(uint64_t);
+  }
+
+  if(c & ChunkThreadID)
+    lengthOffset += sizeof(uint64_t);
+  if(c & ChunkDuration)
+    lengthOffset += sizeof(int64_t);
+  if(c & ChunkTimestamp)
+    lengthOffset += sizeof(int64_t);
+
+  uint64_t lengthSize = (c & Chunk64BitSize) ? sizeof(uint64_t) : sizeof(uint32_t);
+
+  // each buffer that's replaced shrinks the chunk by a multiple of the chunk alignment
+  uint64_t shrink = 0;
+  uint64_t end = lengthOffset + lengthSize;
+  for(uint32_t i = 0; i < numRanges; i++)
+  {
+    uint64_t byteSize = 0;
+    if(ranges[i].sizeOffset >= end && ranges[i].sizeOffset + sizeof(byteSize) <= length)
+      memcpy(&byteSize, data + ranges[i].sizeOffset, sizeof(byteSize));
+
+    uint64_t dataOffset = AlignUp(ranges[i].sizeOffset + sizeof(byteSize), ChunkAlignment);
+
+    if(byteSize < MinBlobSize || dataOffset + byteSize > length)
+    {
+      RDCERR("Invalid blob range in chunk %u, writing chunk unmodified", c & ChunkIndexMask);
+      m_Write->Write(data, length);
+      return;
+    }
+
+    shrink += byteSize - BlobReferenceLength(byteSize, ChunkAlignment);
+    end = dataOffset + byteSize;
+  }
+
+  m_Write->Write(data, lengthOffset);
+
+  if(c & Chunk64BitSize)
+  {
+    uint64_t chunkLength = 0;
+    memcpy(&chunkLength, data + lengthOffset, sizeof(chunkLength));
+    m_Write->Write(chunkLength - shrink);
+  }
+  else
+  {
+    uint32_t chunkLength = 0;
+    memcpy(&chunkLength, data + lengthOffset, sizeof(chunkLength));
+    m_Write->Write(uint32_t(chunkLength - shrink));
+  }
+
+  uint64_t cur = lengthOffset + lengthSize;
+
+  for(uint32_t i = 0; i < numRanges; i++)
+  {
+    uint64_t byteSize = 0;
+    memcpy(&byteSize, data + ranges[i].sizeOffset, sizeof(byteSize));
+
+    uint64_t dataOffset = AlignUp(ranges[i].sizeOffset + sizeof(byteSize), ChunkAlignment);
+
+    // everything up to the buffer is unchanged
+    m_Write->Write(data + cur, ranges[i].sizeOffset - cur);
+
+    m_Write->Write(byteSize | BlobReferenceFlag);
+
+    // the alignment padding before the buffer's data is the same
+    m_Write->Write(data + ranges[i].sizeOffset + sizeof(byteSize),
+                   dataOffset - ranges[i].sizeOffset - sizeof(byteSize));
+
+    m_BlobHash = ranges[i].hash;
+    WriteBlobReference(data + dataOffset, byteSize);
+
+    cur = dataOffset + byteSize;
+  }
+
+  m_Write->Write(data + cur, length - cur);
+}
+
 template <>
 void Serialiser<SerialiserMode::Writing>::WriteStructuredFile(const SDFile &file,
                                                               RENDERDOC_ProgressCallback progress)
@@ -620,8 +865,10 @@ void Serialiser<SerialiserMode::Writing>::WriteStructuredFile(const SDFile &file
 
     if(m_ChunkMetadata.length == 0)
     {
-      m_Write->Write(scratchWriter.GetWriter()->GetData(), scratchWriter.GetWriter()->GetOffset());
-      scratchWriter.GetWriter()->Rewind();
+      StreamWriter *scratch = scratchWriter.GetWriter();
+
+      m_Write->Write(scratch->GetData(), scratch->GetOffset());
+      scratch->Rewind();
     }
 
     if(progress)
@@ -1007,11 +1254,20 @@ Chunk *Chunk::Create(Serialiser<SerialiserMode::Writing> &ser, uint16_t chunkTyp
   RDCASSERT(ser.GetWriter()->GetOffset() < 0xffffffff);
   uint32_t length = (uint32_t)ser.GetWriter()->GetOffset();
 
+  CallStats::AddSerialisedBytes(length);
+
+  // any large buffers that can be stored as blobs are remembered after the chunk's data. A chunk
+  // can only track so many, any more are left in place.
+  rdcarray<ChunkBlobRange> &blobRanges = ser.GetBlobRanges();
+  uint8_t numBlobs = (uint8_t)RDCMIN(blobRanges.size(), (size_t)0xff);
+
+  size_t allocSize = (size_t)length + numBlobs * sizeof(ChunkBlobRange);
+
   byte *data = NULL;
   if(allocator)
   {
     // try to allocate from the allocator
-    data = allocator->AllocAlignedBuffer(length);
+    data = allocator->AllocAlignedBuffer(allocSize);
 
     // if we couldn't satisfy the allocation then pretend we never had an allocator in the first
     // place. We'll externally allocate the chunk and the data.
@@ -1021,11 +1277,13 @@ Chunk *Chunk::Create(Serialiser<SerialiserMode::Writing> &ser, uint16_t chunkTyp
 
   // if we don't have an allocator or we gave up on it above, allocate the data externally
   if(!allocator)
-    data = AllocAlignedBuffer(length);
+    data = AllocAlignedBuffer(allocSize);
 
   memcpy(data, ser.GetWriter()->GetData(), (size_t)length);
+  memcpy(data + length, blobRanges.data(), numBlobs * sizeof(ChunkBlobRange));
 
   ser.GetWriter()->Rewind();
+  blobRanges.clear();
 
   Chunk *ret = NULL;
 
@@ -1045,6 +1303,7 @@ Chunk *Chunk::Create(Serialiser<SerialiserMode::Writing> &ser, uint16_t chunkTyp
 
   ret->m_Length = length;
   ret->m_ChunkType = chunkType;
+  ret->m_NumBlobs = numBlobs;
   ret->m_Data = data;
 
   if(allocator == NULL)
@@ -25,7 +25,9 @@
 #pragma once
 
 #include <set>
+#include <unordered_map>
 #include "api/replay/structured_data.h"
+#include "serialise/structured_arena.h"
 #include "common/formatting.h"
 #include "streamio.h"
 
@@ -51,10 +53,32 @@ void Deserialise(const T &el)
 
 typedef rdcstr (*ChunkLookup)(uint32_t chunkType);
 
+// types whose decoded value is self-contained - no pointers to memory allocated while reading, and
+// nothing to free in Deserialise - can be copied out of a DecodedChunkCache instead of being
+// decoded again. Other types opt in with DECLARE_DECODE_CACHEABLE.
+template <class T>
+struct IsDecodeCacheable
+{
+  static const bool value = std::is_arithmetic<T>::value || std::is_enum<T>::value;
+};
+
+#define DECLARE_DECODE_CACHEABLE(type) \
+  template <>                          \
+  struct IsDecodeCacheable<type>       \
+  {                                    \
+    static const bool value = true;    \
+  };
+
+DECLARE_DECODE_CACHEABLE(ResourceId);
+
 enum class SerialiserFlags
 {
   NoFlags = 0x0,
   AllocateMemory = 0x1,
+  // when combined with AllocateMemory for a byte buffer, if the stream is already in memory the
+  // buffer points directly into it instead of being allocated and copied. Such buffers must not be
+  // modified or kept, and must be released with Serialiser::FreeBuffer.
+  ReadInPlace = 0x2,
 };
 
 BITMASK_OPERATORS(SerialiserFlags);
@@ -79,6 +103,69 @@ enum class SerialiserMode
 };
 
 struct CompressedFileIO;
+class RDCBlobStore;
+
+// keeps the decoded values of the top-level elements in chunks that have been read, keyed by the
+// chunk's offset in the stream. Reading the same chunk again with the cache set copies each value
+// out instead of decoding it, which for handles saves looking up the live resource every time.
+// Only elements serialised with the SERIALISE_ELEMENT macros and of an IsDecodeCacheable type are
+// kept, anything else in the chunk is read from the stream as normal.
+//
+// The decoded values are only valid as long as whatever they were decoded against, so the cache
+// must be cleared if e.g. the live resource for an ID changes.
+class DecodedChunkCache
+{
+public:
+  // chunks stop being added once the memory used reaches the budget
+  void SetBudget(uint64_t bytes) { m_Budget = bytes; }
+  void Clear()
+  {
+    m_Chunks.clear();
+    m_Elements.clear();
+    m_Data.clear();
+  }
+
+  size_t GetNumChunks() const { return m_Chunks.size(); }
+  uint64_t GetMemoryUsage() const
+  {
+    return m_Data.byteSize() + m_Elements.byteSize() +
+           m_Chunks.size() * (sizeof(uint64_t) + sizeof(Chunk));
+  }
+
+private:
+  template <SerialiserMode sertype>
+  friend class Serialiser;
+
+  struct Element
+  {
+    // how many bytes the element takes up in the stream, to skip over
+    uint64_t streamSize;
+    // where the decoded bytes are in m_Data
+    uint64_t offset;
+    uint64_t size;
+  };
+
+  struct Chunk
+  {
+    uint32_t firstElement;
+    uint32_t numElements;
+  };
+
+  std::unordered_map<uint64_t, Chunk> m_Chunks;
+  rdcarray<Element> m_Elements;
+  bytebuf m_Data;
+  uint64_t m_Budget = 0;
+};
+
+// the location of a large byte buffer within a recorded chunk, so that it can be replaced with a
+// reference into a blob store when the chunk is written to a capture. See SetBlobThreshold
+struct ChunkBlobRange
+{
+  // offset of the buffer's serialised size from the start of the chunk
+  uint32_t sizeOffset;
+  uint32_t padding;
+  uint64_t hash;
+};
 
 template <SerialiserMode sertype>
 class Serialiser
@@ -119,6 +206,13 @@ public:
   void SetErrored() { IsReading() ? m_Read->SetErrored() : m_Write->SetErrored(); }
   StreamWriter *GetWriter() { return m_Write; }
   StreamReader *GetReader() { return m_Read; }
+  // frees a byte buffer allocated when reading with SerialiserFlags::AllocateMemory
+  void FreeBuffer(void *buffer) const
+  {
+    if(m_Read && m_Read->IsInPlace(buffer))
+      return;
+    FreeAlignedBuffer((byte *)buffer);
+  }
   uint32_t GetChunkMetadataRecording() { return m_ChunkFlags; }
   void SetChunkMetadataRecording(uint32_t flags);
   void SetChunkTimestampBasis(uint64_t base, double freq)
@@ -137,6 +231,9 @@ public:
   void *GetUserData() { return m_pUserData; }
   void SetUserData(void *userData) { m_pUserData = userData; }
   void SetStringDatabase(std::set<rdcstr> *db) { m_ExtStringDB = db; }
+  // when reading, keep decoded elements in cache and copy them out of it when the same chunk is
+  // read again. Has no effect while exporting structured data. See DecodedChunkCache
+  void SetDecodedChunkCache(DecodedChunkCache *cache) { m_DecodeCache = cache; }
   // jumps to the byte after the current chunk, can be called any time after BeginChunk
   void SkipCurrentChunk();
 
@@ -152,6 +249,21 @@ public:
   // support seeking to fixup lengths, while also not requiring conservative length estimates
   // up-front
   void SetStreamingMode(bool stream) { m_DataStreaming = stream; }
+  // when writing, byte buffers of at least threshold bytes are hashed so that they can be stored
+  // once per capture in a blob store and referenced by their hash. If a store is set the buffers
+  // are written as references straight away, otherwise their locations are kept with each Chunk so
+  // that Chunk::Write can replace them once the chunk is written to a serialiser with a store.
+  // When reading, references are resolved from the store. A threshold of 0 disables this.
+  void SetBlobThreshold(uint64_t threshold)
+  {
+    // a reference needs some space, and there's no benefit to referencing tiny buffers
+    m_BlobThreshold = threshold == 0 ? 0 : RDCMAX(threshold, uint64_t(MinBlobSize));
+  }
+  void SetBlobStore(RDCBlobStore *store) { m_BlobStore = store; }
+  RDCBlobStore *GetBlobStore() { return m_BlobStore; }
+  rdcarray<ChunkBlobRange> &GetBlobRanges() { return m_BlobRanges; }
+  void WriteChunkWithBlobs(const byte *data, uint64_t length, const ChunkBlobRange *ranges,
+                           uint32_t numRanges);
   SDFile &GetStructuredFile() { return *m_StructuredFile; }
   void WriteStructuredFile(const SDFile &file, RENDERDOC_ProgressCallback progress);
   void SetActionChunk() { m_ActionChunk = true; }
@@ -199,7 +311,7 @@ public:
   {
     if(ExportStructure())
     {
-      m_StructureStack.back()->data.str = ToStr(el);
+      m_StructureStack.back()->data.str = InternString(ToStr(el));
       m_StructureStack.back()->type.flags |= SDTypeFlags::HasCustomString;
     }
   }
@@ -226,7 +338,7 @@ public:
 
       SDObject &current = *m_StructureStack.back();
 
-      SDObject &obj = *current.AddAndOwnChild(new SDObject(name, TypeName<T>()));
+      SDObject &obj = *current.AddAndOwnChild(NewObject(name, TypeName<T>()));
       m_StructureStack.push_back(&obj);
 
       obj.type.byteSize = sizeof(T);
@@ -242,6 +354,35 @@ public:
     return *this;
   }
 
+  // serialise a top-level element of a chunk, as the SERIALISE_ELEMENT macros do. This is the same
+  // as Serialise except that when reading with a DecodedChunkCache, the element can come from the
+  // cache.
+  template <class T>
+  Serialiser &SerialiseElement(const rdcliteral &name, T &el)
+  {
+    return SerialiseElement(
+        name, el,
+        std::integral_constant<bool, IsDecodeCacheable<T>::value && !std::is_const<T>::value>());
+  }
+
+  template <class T>
+  Serialiser &SerialiseElement(const rdcliteral &name, T *&el, uint64_t arrayCount,
+                               SerialiserFlags flags)
+  {
+    // byte buffers have their own allocation, and can be read in place
+    return SerialiseElement(
+        name, el, arrayCount, flags,
+        std::integral_constant<bool, IsDecodeCacheable<T>::value && !std::is_const<T>::value &&
+                                         !std::is_same<T, byte>::value>());
+  }
+
+  template <class T>
+  Serialiser &SerialiseElement(const rdcliteral &name, const T *&el, uint64_t arrayCount,
+                               SerialiserFlags flags)
+  {
+    return SerialiseElement(name, (T *&)el, arrayCount, flags);
+  }
+
   // special function for serialising buffers
   Serialiser &Serialise(const rdcliteral &name, byte *&el, uint64_t byteSize,
                         SerialiserFlags flags = SerialiserFlags::NoFlags)
@@ -250,15 +391,13 @@ public:
     if(IsWriting() && el == NULL)
       byteSize = 0;
 
-    {
-      m_InternalElement++;
-      DoSerialise(*this, byteSize);
-      m_InternalElement--;
-    }
+    bool blobRef = IsWriting() && BeginBlob(el, byteSize);
+
+    SerialiseBufferSize(byteSize, blobRef);
 
     if(IsReading())
     {
-      VerifyArraySize(byteSize);
+      VerifyArraySize(byteSize, blobRef);
     }
 
     if(ExportStructure())
@@ -271,7 +410,7 @@ public:
 
       SDObject &current = *m_StructureStack.back();
 
-      SDObject &obj = *current.AddAndOwnChild(new SDObject(name, "Byte Buffer"_lit));
+      SDObject &obj = *current.AddAndOwnChild(NewObject(name, "Byte Buffer"_lit));
       m_StructureStack.push_back(&obj);
 
       obj.type.basetype = SDBasic::Buffer;
@@ -279,6 +418,7 @@ public:
     }
 
     byte *tempAlloc = NULL;
+    bool readInPlace = false;
 
     {
       if(IsWriting())
@@ -286,7 +426,9 @@ public:
         // ensure byte alignment
         m_Write->AlignTo<ChunkAlignment>();
 
-        if(el)
+        if(blobRef)
+          WriteBlobReference(el, byteSize);
+        else if(el)
           m_Write->Write(el, byteSize);
         else
           RDCASSERT(byteSize == 0);
@@ -302,10 +444,23 @@ public:
 #if !defined(__COVERITY__)
         if(!m_Structuriser && (flags & SerialiserFlags::AllocateMemory))
         {
-          if(byteSize > 0)
+          const byte *inPlace = NULL;
+          if((flags & SerialiserFlags::ReadInPlace) && !blobRef)
+            inPlace = m_Read->ReadInPlace(byteSize, ChunkAlignment);
+
+          if(inPlace)
+          {
+            el = (byte *)inPlace;
+            readInPlace = true;
+          }
+          else if(byteSize > 0)
+          {
             el = AllocAlignedBuffer(byteSize);
+          }
           else
+          {
             el = NULL;
+          }
         }
 
         // if we're exporting the buffers, make sure to always alloc space to read the data, so we
@@ -320,7 +475,10 @@ public:
         }
 #endif
 
-        m_Read->Read(el, byteSize);
+        if(blobRef)
+          ReadBlobReference(el, byteSize);
+        else if(!readInPlace)
+          m_Read->Read(el, byteSize);
       }
     }
 
@@ -359,15 +517,13 @@ public:
   {
     uint64_t count = (uint64_t)el.size();
 
-    {
-      m_InternalElement++;
-      DoSerialise(*this, count);
-      m_InternalElement--;
-    }
+    bool blobRef = IsWriting() && BeginBlob(el.data(), count);
+
+    SerialiseBufferSize(count, blobRef);
 
     if(IsReading())
     {
-      VerifyArraySize(count);
+      VerifyArraySize(count, blobRef);
     }
 
     if(ExportStructure())
@@ -380,7 +536,7 @@ public:
 
       SDObject &current = *m_StructureStack.back();
 
-      SDObject &obj = *current.AddAndOwnChild(new SDObject(name, "Byte Buffer"_lit));
+      SDObject &obj = *current.AddAndOwnChild(NewObject(name, "Byte Buffer"_lit));
       m_StructureStack.push_back(&obj);
 
       obj.type.basetype = SDBasic::Buffer;
@@ -392,7 +548,11 @@ public:
       {
         // ensure byte alignment
         m_Write->AlignTo<ChunkAlignment>();
-        m_Write->Write(el.data(), count);
+
+        if(blobRef)
+          WriteBlobReference(el.data(), count);
+        else
+          m_Write->Write(el.data(), count);
       }
       else if(IsReading())
       {
@@ -401,7 +561,10 @@ public:
 
         el.resize((size_t)count);
 
-        m_Read->Read(el.data(), count);
+        if(blobRef)
+          ReadBlobReference(el.data(), count);
+        else
+          m_Read->Read(el.data(), count);
       }
     }
 
@@ -492,7 +655,7 @@ public:
 
       SDObject &parent = *m_StructureStack.back();
 
-      SDObject &arr = *parent.AddAndOwnChild(new SDObject(name, TypeName<T>()));
+      SDObject &arr = *parent.AddAndOwnChild(NewObject(name, TypeName<T>()));
       m_StructureStack.push_back(&arr);
 
       arr.type.basetype = SDBasic::Array;
@@ -503,7 +666,7 @@ public:
 
       for(size_t i = 0; i < N; i++)
       {
-        SDObject &obj = *arr.AddAndOwnChild(new SDObject("$el"_lit, TypeName<T>()));
+        SDObject &obj = *arr.AddAndOwnChild(NewObject("$el"_lit, TypeName<T>()));
         m_StructureStack.push_back(&obj);
 
         // default to struct. This will be overwritten if appropriate
@@ -597,6 +760,7 @@ public:
     if(IsReading())
     {
       VerifyArraySize(arrayCount);
+      m_LastArrayCount = arrayCount;
     }
 
     if(ExportStructure())
@@ -609,7 +773,7 @@ public:
 
       SDObject &parent = *m_StructureStack.back();
 
-      SDObject &arr = *parent.AddAndOwnChild(new SDObject(name, TypeName<T>()));
+      SDObject &arr = *parent.AddAndOwnChild(NewObject(name, TypeName<T>()));
       m_StructureStack.push_back(&arr);
 
       arr.type.basetype = SDBasic::Array;
@@ -645,7 +809,7 @@ public:
       {
         for(uint64_t i = 0; el && i < arrayCount; i++)
         {
-          SDObject &obj = *arr.AddAndOwnChild(new SDObject("$el"_lit, TypeName<T>()));
+          SDObject &obj = *arr.AddAndOwnChild(NewObject("$el"_lit, TypeName<T>()));
           m_StructureStack.push_back(&obj);
 
           // default to struct. This will be overwritten if appropriate
@@ -712,7 +876,7 @@ public:
 
       SDObject &parent = *m_StructureStack.back();
 
-      SDObject &arr = *parent.AddAndOwnChild(new SDObject(name, TypeName<U>()));
+      SDObject &arr = *parent.AddAndOwnChild(NewObject(name, TypeName<U>()));
       m_StructureStack.push_back(&arr);
 
       arr.type.basetype = SDBasic::Array;
@@ -738,7 +902,7 @@ public:
       {
         for(size_t i = 0; i < (size_t)size; i++)
         {
-          SDObject &obj = *arr.AddAndOwnChild(new SDObject("$el"_lit, TypeName<U>()));
+          SDObject &obj = *arr.AddAndOwnChild(NewObject("$el"_lit, TypeName<U>()));
           m_StructureStack.push_back(&obj);
 
           // default to struct. This will be overwritten if appropriate
@@ -791,7 +955,7 @@ public:
 
       SDObject &parent = *m_StructureStack.back();
 
-      SDObject &arr = *parent.AddAndOwnChild(new SDObject(name, TypeName<U>()));
+      SDObject &arr = *parent.AddAndOwnChild(NewObject(name, TypeName<U>()));
       m_StructureStack.push_back(&arr);
 
       arr.type.basetype = SDBasic::Array;
@@ -802,7 +966,7 @@ public:
 
       for(size_t i = 0; i < N; i++)
       {
-        SDObject &obj = *arr.AddAndOwnChild(new SDObject("$el"_lit, TypeName<U>()));
+        SDObject &obj = *arr.AddAndOwnChild(NewObject("$el"_lit, TypeName<U>()));
         m_StructureStack.push_back(&obj);
 
         // default to struct. This will be overwritten if appropriate
@@ -867,7 +1031,7 @@ public:
 
       SDObject &parent = *m_StructureStack.back();
 
-      SDObject &arr = *parent.AddAndOwnChild(new SDObject(name, "pair"_lit));
+      SDObject &arr = *parent.AddAndOwnChild(NewObject(name, "pair"_lit));
       m_StructureStack.push_back(&arr);
 
       arr.type.basetype = SDBasic::Struct;
@@ -876,7 +1040,7 @@ public:
       arr.ReserveChildren(2);
 
       {
-        SDObject &obj = *arr.AddAndOwnChild(new SDObject("first"_lit, TypeName<U>()));
+        SDObject &obj = *arr.AddAndOwnChild(NewObject("first"_lit, TypeName<U>()));
         m_StructureStack.push_back(&obj);
 
         // default to struct. This will be overwritten if appropriate
@@ -889,7 +1053,7 @@ public:
       }
 
       {
-        SDObject &obj = *arr.AddAndOwnChild(new SDObject("second"_lit, TypeName<V>()));
+        SDObject &obj = *arr.AddAndOwnChild(NewObject("second"_lit, TypeName<V>()));
         m_StructureStack.push_back(&obj);
 
         // default to struct. This will be overwritten if appropriate
@@ -979,7 +1143,7 @@ public:
       {
         SDObject &parent = *m_StructureStack.back();
 
-        SDObject &nullable = *parent.AddAndOwnChild(new SDObject(name, TypeName<T>()));
+        SDObject &nullable = *parent.AddAndOwnChild(NewObject(name, TypeName<T>()));
 
         nullable.type.basetype = SDBasic::Null;
         nullable.type.byteSize = 0;
@@ -1065,7 +1229,7 @@ public:
 
       SDObject &current = *m_StructureStack.back();
 
-      SDObject &obj = *current.AddAndOwnChild(new SDObject(name, "Byte Buffer"_lit));
+      SDObject &obj = *current.AddAndOwnChild(NewObject(name, "Byte Buffer"_lit));
       m_StructureStack.push_back(&obj);
 
       obj.type.basetype = SDBasic::Buffer;
@@ -1398,6 +1562,151 @@ protected:
   void SetStructuriser(bool s) { m_Structuriser = s; }
 private:
   static const uint64_t ChunkAlignment = 64;
+
+  // set in the serialised size of a byte buffer that's stored as a reference into a blob store
+  static const uint64_t BlobReferenceFlag = 0x8000000000000000ULL;
+  static const uint64_t MinBlobSize = 256;
+
+  // serialises the size of a byte buffer, flagging or detecting a blob reference
+  void SerialiseBufferSize(uint64_t &byteSize, bool &blobRef)
+  {
+    uint64_t serialisedSize = byteSize;
+    if(blobRef)
+      serialisedSize |= BlobReferenceFlag;
+
+    m_InternalElement++;
+    DoSerialise(*this, serialisedSize);
+    m_InternalElement--;
+
+    if(IsReading())
+    {
+      blobRef = (serialisedSize & BlobReferenceFlag) != 0;
+      byteSize = serialisedSize & ~BlobReferenceFlag;
+    }
+  }
+
+  // See SetBlobThreshold. Returns true if the buffer should be written as a reference
+  bool BeginBlob(const byte *data, uint64_t byteSize);
+  void WriteBlobReference(const byte *data, uint64_t byteSize);
+  void ReadBlobReference(byte *data, uint64_t byteSize);
+  uint64_t GetBlobStoreSize() const;
+
+  template <class T>
+  Serialiser &SerialiseElement(const rdcliteral &name, T &el, std::false_type)
+  {
+    return Serialise(name, el);
+  }
+
+  template <class T>
+  Serialiser &SerialiseElement(const rdcliteral &name, T &el, std::true_type)
+  {
+    if(!IsReading() || m_DecodeMode == DecodeMode::None || m_DecodeNesting > 0)
+      return Serialise(name, el);
+
+    if(m_DecodeMode == DecodeMode::Playback)
+    {
+      const byte *decoded = PeekDecodedElement(sizeof(T), sizeof(T));
+      if(decoded)
+      {
+        memcpy(&el, decoded, sizeof(T));
+        return *this;
+      }
+
+      return Serialise(name, el);
+    }
+
+    uint64_t start = m_Read->GetOffset();
+
+    m_DecodeNesting++;
+    Serialise(name, el);
+    m_DecodeNesting--;
+
+    RecordDecodedElement(start, &el, sizeof(T));
+
+    return *this;
+  }
+
+  template <class T>
+  Serialiser &SerialiseElement(const rdcliteral &name, T *&el, uint64_t arrayCount,
+                               SerialiserFlags flags, std::false_type)
+  {
+    return Serialise(name, el, arrayCount, flags);
+  }
+
+  template <class T>
+  Serialiser &SerialiseElement(const rdcliteral &name, T *&el, uint64_t arrayCount,
+                               SerialiserFlags flags, std::true_type)
+  {
+    // cached arrays are allocated the same way as read arrays, to be freed the same way
+    if(!IsReading() || m_DecodeMode == DecodeMode::None || m_DecodeNesting > 0 ||
+       !(flags & SerialiserFlags::AllocateMemory))
+      return Serialise(name, el, arrayCount, flags);
+
+    if(m_DecodeMode == DecodeMode::Playback)
+    {
+      uint64_t size = 0;
+      const byte *decoded = PeekDecodedElement(0, sizeof(T), &size);
+      if(decoded)
+      {
+        el = size > 0 ? new T[size_t(size / sizeof(T))] : NULL;
+        if(el)
+          memcpy(el, decoded, (size_t)size);
+        return *this;
+      }
+
+      return Serialise(name, el, arrayCount, flags);
+    }
+
+    uint64_t start = m_Read->GetOffset();
+
+    m_LastArrayCount = 0;
+
+    m_DecodeNesting++;
+    Serialise(name, el, arrayCount, flags);
+    m_DecodeNesting--;
+
+    RecordDecodedElement(start, el, el ? m_LastArrayCount * sizeof(T) : 0);
+
+    return *this;
+  }
+
+  // returns the next cached element and skips over it in the stream, if its size is as expected.
+  // Otherwise stops using the cache for the rest of the chunk and returns NULL, so the element is
+  // read normally. A size of 0 accepts any multiple of elemSize, returned in actualSize.
+  const byte *PeekDecodedElement(uint64_t size, uint64_t elemSize, uint64_t *actualSize = NULL)
+  {
+    const DecodedChunkCache::Element *elem =
+        m_DecodeElement < m_DecodeEnd ? &m_DecodeCache->m_Elements[m_DecodeElement] : NULL;
+
+    if(!elem || (size > 0 && elem->size != size) || (elem->size % elemSize) != 0)
+    {
+      m_DecodeMode = DecodeMode::None;
+      return NULL;
+    }
+
+    if(actualSize)
+      *actualSize = elem->size;
+
+    m_DecodeElement++;
+    m_Read->SkipBytes(elem->streamSize);
+
+    return m_DecodeCache->m_Data.data() + elem->offset;
+  }
+
+  void RecordDecodedElement(uint64_t streamStart, const void *decoded, uint64_t size)
+  {
+    DecodedChunkCache::Element elem;
+    elem.streamSize = m_Read->GetOffset() - streamStart;
+    elem.offset = m_DecodeCache->m_Data.size();
+    elem.size = size;
+
+    m_DecodeCache->m_Elements.push_back(elem);
+    m_DecodeCache->m_Data.append((const byte *)decoded, (size_t)size);
+  }
+
+  void BeginDecodedChunk();
+  void EndDecodedChunk();
+
   template <class SerialiserMode, typename T, bool isEnum = std::is_enum<T>::value>
   struct SerialiseDispatch
   {
@@ -1420,9 +1729,10 @@ private:
     }
   };
 
-  void VerifyArraySize(uint64_t &count)
+  void VerifyArraySize(uint64_t &count, bool blobRef = false)
   {
-    uint64_t size = m_Read->GetSize();
+    // blob references aren't stored in the stream, so check them against the blob store instead
+    uint64_t size = blobRef ? GetBlobStoreSize() : m_Read->GetSize();
 
     // for streaming, just take 4GB as a 'semi reasonable' upper limit for array sizes
     if(m_DataStreaming)
@@ -1495,6 +1805,34 @@ private:
   uint64_t m_LastChunkOffset = 0;
   uint64_t m_ChunkFixup = 0;
 
+  // where the chunk currently being written starts
+  uint64_t m_ChunkStartOffset = 0;
+
+  // See SetBlobThreshold
+  RDCBlobStore *m_BlobStore = NULL;
+  uint64_t m_BlobThreshold = 0;
+  uint64_t m_BlobHash = 0;
+  rdcarray<ChunkBlobRange> m_BlobRanges;
+
+  // See SetDecodedChunkCache
+  enum class DecodeMode
+  {
+    None,
+    Record,
+    Playback,
+  };
+
+  DecodedChunkCache *m_DecodeCache = NULL;
+  DecodeMode m_DecodeMode = DecodeMode::None;
+  // elements serialised inside a cached element aren't cached themselves
+  int m_DecodeNesting = 0;
+  // when recording, where this chunk's elements begin. When playing back, the next element
+  uint32_t m_DecodeElement = 0;
+  uint32_t m_DecodeEnd = 0;
+  uint64_t m_DecodeDataStart = 0;
+  // the count read by the last dynamically sized array
+  uint64_t m_LastArrayCount = 0;
+
   bool m_ExportStructured = false;
   bool m_ExportBuffers = false;
   int m_InternalElement = 0;
@@ -1515,6 +1853,24 @@ private:
   // external storage - so the string storage can persist after the lifetime of the serialiser
   std::set<rdcstr> *m_ExtStringDB = NULL;
 
+  // objects added to the structured file are allocated from its arena, unless we're structurising
+  // into an external object which the file doesn't own.
+  SDObject *NewObject(const rdcinflexiblestr &name, const rdcinflexiblestr &type)
+  {
+    if(m_Structuriser)
+      return new SDObject(name, type);
+    return SDObjectArena::Get(*m_StructuredFile).New<SDObject>(name, type);
+  }
+
+  // similarly strings that are likely to repeat, like chunk names or enum values, are interned in
+  // the file's arena
+  rdcinflexiblestr InternString(const rdcstr &s)
+  {
+    if(m_Structuriser)
+      return s;
+    return SDObjectArena::Get(*m_StructuredFile).Intern(s);
+  }
+
   const char *StringDB(const rdcstr &s)
   {
     if(m_ExtStringDB)
@@ -1531,6 +1887,25 @@ private:
   FileIO::LogFileHandle *m_DebugDumpLog = NULL;
 };
 
+// only implemented for writing, declared here so it isn't implicitly instantiated by Chunk::Write
+template <>
+void Serialiser<SerialiserMode::Writing>::WriteChunkWithBlobs(const byte *data, uint64_t length,
+                                                              const ChunkBlobRange *ranges,
+                                                              uint32_t numRanges);
+
+template <>
+bool Serialiser<SerialiserMode::Writing>::BeginBlob(const byte *data, uint64_t byteSize);
+template <>
+bool Serialiser<SerialiserMode::Reading>::BeginBlob(const byte *data, uint64_t byteSize);
+template <>
+void Serialiser<SerialiserMode::Writing>::WriteBlobReference(const byte *data, uint64_t byteSize);
+template <>
+void Serialiser<SerialiserMode::Reading>::WriteBlobReference(const byte *data, uint64_t byteSize);
+template <>
+void Serialiser<SerialiserMode::Writing>::ReadBlobReference(byte *data, uint64_t byteSize);
+template <>
+void Serialiser<SerialiserMode::Reading>::ReadBlobReference(byte *data, uint64_t byteSize);
+
 #ifndef SERIALISER_IMPL
 class WriteSerialiser : public Serialiser<SerialiserMode::Writing>
 {
@@ -1796,11 +2171,14 @@ public:
     Chunk *ret = new Chunk();
     ret->m_Length = m_Length;
     ret->m_ChunkType = m_ChunkType;
+    ret->m_NumBlobs = m_NumBlobs;
+
+    size_t allocSize = (size_t)m_Length + m_NumBlobs * sizeof(ChunkBlobRange);
 
-    ret->m_Data = AllocAlignedBuffer(m_Length);
+    ret->m_Data = AllocAlignedBuffer(allocSize);
     ret->m_FromAllocator = false;
 
-    memcpy(ret->m_Data, m_Data, (size_t)m_Length);
+    memcpy(ret->m_Data, m_Data, allocSize);
 
 #if ENABLED(RDOC_DEVEL)
     Atomic::Inc64(&m_LiveChunks);
@@ -1812,6 +2190,12 @@ public:
 
   void Write(Serialiser<SerialiserMode::Writing> &ser)
   {
+    if(m_NumBlobs > 0 && ser.GetBlobStore())
+    {
+      ser.WriteChunkWithBlobs(m_Data, m_Length, GetBlobRanges(), m_NumBlobs);
+      return;
+    }
+
     ser.GetWriter()->Write((const void *)m_Data, (size_t)m_Length);
   }
 
@@ -1820,10 +2204,18 @@ private:
   Chunk(const Chunk &) = delete;
   Chunk &operator=(const Chunk &) = delete;
 
+  // any blob ranges are stored in the data allocation, after the chunk itself
+  const ChunkBlobRange *GetBlobRanges() const
+  {
+    return (const ChunkBlobRange *)(m_Data + m_Length);
+  }
   uint16_t m_ChunkType;
 
   bool m_FromAllocator = false;
 
+  // the number of large buffers in the chunk that can be stored as blobs. See SetBlobThreshold
+  uint8_t m_NumBlobs = 0;
+
   uint32_t m_Length;
   byte *m_Data;
 
@@ -1931,7 +2323,7 @@ struct ScopedDeserialiseArray<SerialiserType, void *>
   ~ScopedDeserialiseArray()
   {
     if(m_Ser.IsReading())
-      FreeAlignedBuffer((byte *)*m_El);
+      m_Ser.FreeBuffer((void *)*m_El);
   }
   const SerialiserType &m_Ser;
   void **m_El;
@@ -1947,7 +2339,7 @@ struct ScopedDeserialiseArray<SerialiserType, const void *>
   ~ScopedDeserialiseArray()
   {
     if(m_Ser.IsReading())
-      FreeAlignedBuffer((byte *)*m_El);
+      m_Ser.FreeBuffer((void *)*m_El);
   }
   const SerialiserType &m_Ser;
   const void **m_El;
@@ -1960,7 +2352,7 @@ struct ScopedDeserialiseArray<SerialiserType, byte *>
   ~ScopedDeserialiseArray()
   {
     if(m_Ser.IsReading())
-      FreeAlignedBuffer(*m_El);
+      m_Ser.FreeBuffer(*m_El);
   }
   const SerialiserType &m_Ser;
   byte **m_El;
@@ -1975,7 +2367,7 @@ struct ScopedDeserialiseArray<SerialiserType, byte *>
 #define SERIALISE_ELEMENT(obj)                                                               \
   ScopedDeserialise<decltype(GET_SERIALISER), decltype(obj)> CONCAT(deserialise_, __LINE__)( \
       GET_SERIALISER, obj);                                                                  \
-  GET_SERIALISER.Serialise(STRING_LITERAL(#obj), obj)
+  GET_SERIALISER.SerialiseElement(STRING_LITERAL(#obj), obj)
 
 // for _TYPED serialises, we need to first clear the object to 0 since the typed alias might not
 // write it all. This is mostly only when co-oercing a BOOL type to bool, where only one byte gets
@@ -1996,7 +2388,18 @@ struct ScopedDeserialiseArray<SerialiserType, byte *>
   (void)CONCAT(dummy_array_count, __LINE__);                                                      \
   ScopedDeserialiseArray<decltype(GET_SERIALISER), decltype(obj)> CONCAT(deserialise_, __LINE__)( \
       GET_SERIALISER, &obj, count);                                                               \
-  GET_SERIALISER.Serialise(STRING_LITERAL(#obj), obj, count, SerialiserFlags::AllocateMemory)
+  GET_SERIALISER.SerialiseElement(STRING_LITERAL(#obj), obj, count,                               \
+                                  SerialiserFlags::AllocateMemory)
+
+// for byte buffers that are only read within the chunk, this avoids a copy when the stream is in
+// memory (e.g. a memory-mapped capture). See SerialiserFlags::ReadInPlace
+#define SERIALISE_ELEMENT_ARRAY_INPLACE(obj, count)                                               \
+  uint64_t CONCAT(dummy_array_count, __LINE__) = 0;                                               \
+  (void)CONCAT(dummy_array_count, __LINE__);                                                      \
+  ScopedDeserialiseArray<decltype(GET_SERIALISER), decltype(obj)> CONCAT(deserialise_, __LINE__)( \
+      GET_SERIALISER, &obj, count);                                                               \
+  GET_SERIALISER.Serialise(STRING_LITERAL(#obj), obj, count,                                      \
+                           SerialiserFlags::AllocateMemory | SerialiserFlags::ReadInPlace)
 
 #define SERIALISE_ELEMENT_OPT(obj)                                           \
   ScopedDeserialiseNullable<decltype(GET_SERIALISER), decltype(obj)> CONCAT( \
@@ -2009,7 +2412,7 @@ struct ScopedDeserialiseArray<SerialiserType, byte *>
       GET_SERIALISER, obj);                                                                   \
   if(GET_SERIALISER.IsWriting())                                                              \
     obj = (inValue);                                                                          \
-  GET_SERIALISER.Serialise(STRING_LITERAL(#obj), obj)
+  GET_SERIALISER.SerialiseElement(STRING_LITERAL(#obj), obj)
 
 // these macros are for use when implementing a DoSerialise function
 #define SERIALISE_MEMBER(obj) ser.Serialise(STRING_LITERAL(#obj), el.obj)
@@ -23,6 +23,9 @@
  ******************************************************************************/
 
 #include "serialiser.h"
+#include "common/timing.h"
+#include "rdcfile.h"
+#include "strings/string_utils.h"
 
 #if ENABLED(ENABLE_UNIT_TESTS)
 
@@ -595,6 +598,79 @@ TEST_CASE("Read/writing large buffers", "[serialiser]")
   FileIO::Delete(filename);
 };
 
+TEST_CASE("Read byte buffers in place from memory", "[serialiser]")
+{
+  bytebuf buffer;
+  buffer.resize(100 * 1024);
+  for(size_t i = 0; i < buffer.size(); i++)
+    buffer[i] = byte((rand() & 0xff0) >> 4);
+
+  StreamWriter *buf = new StreamWriter(StreamWriter::DefaultScratchSize);
+
+  {
+    WriteSerialiser ser(buf, Ownership::Nothing);
+
+    byte *data = buffer.data();
+    uint64_t size = buffer.size();
+
+    ser.WriteChunk(1);
+    ser.Serialise("data"_lit, data, size);
+    ser.Serialise("copy"_lit, data, size);
+    ser.EndChunk();
+  }
+
+  // copy into aligned memory standing in for a file mapping
+  byte *backing = AllocAlignedBuffer(buf->GetOffset());
+  memcpy(backing, buf->GetData(), (size_t)buf->GetOffset());
+
+  bool released = false;
+  StreamMemory *memory =
+      new StreamMemory(backing, buf->GetOffset(), [backing, &released]() {
+        FreeAlignedBuffer(backing);
+        released = true;
+      });
+
+  StreamReader *reader = new StreamReader(memory, 0, buf->GetOffset());
+
+  // the reader keeps the memory alive after the creator's reference is gone
+  memory->Release();
+  CHECK_FALSE(released);
+
+  {
+    ReadSerialiser ser(reader, Ownership::Stream);
+
+    CHECK(ser.ReadChunk<uint32_t>() == 1);
+
+    byte *inPlace = NULL;
+    byte *copy = NULL;
+    uint64_t size = buffer.size();
+
+    ser.Serialise("data"_lit, inPlace, size,
+                  SerialiserFlags::AllocateMemory | SerialiserFlags::ReadInPlace);
+    REQUIRE(inPlace);
+    CHECK(inPlace >= backing);
+    CHECK(inPlace < backing + buf->GetOffset());
+    CHECK_FALSE(memcmp(inPlace, buffer.data(), buffer.size()));
+
+    ser.Serialise("copy"_lit, copy, size, SerialiserFlags::AllocateMemory);
+    REQUIRE(copy);
+    CHECK((copy < backing || copy >= backing + buf->GetOffset()));
+    CHECK_FALSE(memcmp(copy, buffer.data(), buffer.size()));
+
+    ser.EndChunk();
+
+    CHECK_FALSE(ser.IsErrored());
+
+    // only the copy is actually freed
+    ser.FreeBuffer(inPlace);
+    ser.FreeBuffer(copy);
+  }
+
+  CHECK(released);
+
+  delete buf;
+};
+
 TEST_CASE("Read/write chunk metadata", "[serialiser]")
 {
   StreamWriter *buf = new StreamWriter(StreamWriter::DefaultScratchSize);
@@ -840,6 +916,774 @@ TEST_CASE("Verify multiple chunks can be merged", "[serialiser][chunks]")
   delete buf;
 };
 
+TEST_CASE("Large byte buffers are stored once as blobs", "[serialiser][chunks]")
+{
+  // odd sizes, so that references have to keep later data aligned
+  bytebuf repeated, unique, small;
+  repeated.resize(64 * 1024 + 7);
+  unique.resize(8 * 1024 + 33);
+  small.resize(100);
+  for(size_t i = 0; i < repeated.size(); i++)
+    repeated[i] = byte((rand() & 0xff0) >> 4);
+  for(size_t i = 0; i < unique.size(); i++)
+    unique[i] = byte((rand() & 0xff0) >> 4);
+  for(size_t i = 0; i < small.size(); i++)
+    small[i] = byte(i);
+
+  const uint64_t threshold = 4096;
+
+  auto writeContents = [&](WriteSerialiser &ser) {
+    byte *data = repeated.data();
+    uint64_t size = repeated.size();
+    ser.Serialise("first"_lit, data, size);
+
+    uint32_t marker = 0xdeadbeef;
+    ser.Serialise("marker"_lit, marker);
+
+    ser.Serialise("second"_lit, repeated);
+    ser.Serialise("unique"_lit, unique);
+    ser.Serialise("small"_lit, small);
+
+    marker = 0xf00dcafe;
+    ser.Serialise("marker"_lit, marker);
+  };
+
+  // a chunk recorded as the drivers do during capture, without a blob store
+  Chunk *recorded = NULL;
+  {
+    WriteSerialiser ser(new StreamWriter(StreamWriter::DefaultScratchSize), Ownership::Stream);
+
+    ser.SetChunkMetadataRecording(WriteSerialiser::ChunkThreadID);
+    ser.SetBlobThreshold(threshold);
+
+    SCOPED_SERIALISE_CHUNK(1U);
+    writeContents(ser);
+
+    recorded = scope.Get();
+  }
+
+  Chunk *duplicate = recorded->Duplicate();
+
+  StreamWriter *buf = new StreamWriter(StreamWriter::DefaultScratchSize);
+
+  RDCBlobStore store;
+  {
+    WriteSerialiser ser(buf, Ownership::Nothing);
+
+    ser.SetChunkMetadataRecording(WriteSerialiser::ChunkThreadID);
+    ser.SetBlobThreshold(threshold);
+    ser.SetBlobStore(&store);
+
+    recorded->Write(ser);
+    duplicate->Write(ser);
+
+    {
+      SCOPED_SERIALISE_CHUNK(2U);
+      writeContents(ser);
+    }
+
+    REQUIRE_FALSE(ser.IsErrored());
+  }
+
+  recorded->Delete();
+  duplicate->Delete();
+
+  CHECK(store.NumBlobs() == 2);
+  CHECK(store.GetDuplicateBytes() == repeated.size() * 5 + unique.size() * 2);
+  CHECK(buf->GetOffset() < repeated.size());
+
+  // the rewritten chunk lengths must still be correct to walk the stream
+  {
+    ReadSerialiser ser(new StreamReader(buf->GetData(), buf->GetOffset()), Ownership::Stream);
+
+    for(uint32_t expected : {1U, 1U, 2U})
+    {
+      CHECK(ser.ReadChunk<uint32_t>() == expected);
+      ser.SkipCurrentChunk();
+      ser.EndChunk();
+    }
+
+    CHECK(ser.GetReader()->AtEnd());
+    CHECK_FALSE(ser.IsErrored());
+  }
+
+  auto readContents = [&](RDCBlobStore *blobs) {
+    ReadSerialiser ser(new StreamReader(buf->GetData(), buf->GetOffset()), Ownership::Stream);
+
+    ser.SetBlobStore(blobs);
+
+    for(uint32_t expected : {1U, 1U, 2U})
+    {
+      CHECK(ser.ReadChunk<uint32_t>() == expected);
+
+      // the size is read from the stream, as with SERIALISE_ELEMENT_ARRAY
+      byte *first = NULL;
+      ser.Serialise("first"_lit, first, 0,
+                    SerialiserFlags::AllocateMemory | SerialiserFlags::ReadInPlace);
+      REQUIRE(first);
+      CHECK_FALSE(memcmp(first, repeated.data(), repeated.size()));
+      ser.FreeBuffer(first);
+
+      uint32_t marker = 0;
+      ser.Serialise("marker"_lit, marker);
+      CHECK(marker == 0xdeadbeef);
+
+      bytebuf second, uniqueRead, smallRead;
+      ser.Serialise("second"_lit, second);
+      ser.Serialise("unique"_lit, uniqueRead);
+      ser.Serialise("small"_lit, smallRead);
+
+      CHECK((second == repeated));
+      CHECK((uniqueRead == unique));
+      CHECK((smallRead == small));
+
+      ser.Serialise("marker"_lit, marker);
+      CHECK(marker == 0xf00dcafe);
+
+      ser.EndChunk();
+    }
+
+    CHECK_FALSE(ser.IsErrored());
+  };
+
+  SECTION("Reading resolves references")
+  {
+    readContents(&store);
+  }
+
+  SECTION("Storing the blobs in a capture")
+  {
+    RDCFile rdc;
+    rdc.SetData(RDCDriver::Vulkan, "Vulkan", 0, NULL, 0, 1.0);
+
+    REQUIRE(store.Write(rdc));
+
+    RDCBlobStore loaded;
+    REQUIRE(loaded.Read(rdc));
+    CHECK(loaded.NumBlobs() == store.NumBlobs());
+
+    readContents(&loaded);
+  }
+
+  delete buf;
+};
+
+TEST_CASE("Resource contents are stored incrementally across captures", "[serialiser][incremental]")
+{
+  const uint64_t PageSize = RDCIncrementalContents::PageSize;
+
+  rdcstr dir = FileIO::GetTempFolderFilename() + "/rdoc_incremental_test";
+  rdcstr paths[3] = {dir + "/first.rdc", dir + "/second.rdc", dir + "/third.rdc"};
+
+  FileIO::CreateParentDirectory(paths[0]);
+
+  auto fill = [](bytebuf &buf, size_t size) {
+    buf.resize(size);
+    for(size_t i = 0; i < buf.size(); i++)
+      buf[i] = byte((rand() & 0xff0) >> 4);
+  };
+
+  // a few synthetic resources, one that isn't a whole number of pages
+  ResourceId a = ResourceIDGen::GetNewUniqueID();
+  ResourceId b = ResourceIDGen::GetNewUniqueID();
+  ResourceId c = ResourceIDGen::GetNewUniqueID();
+
+  bytebuf a1, b1, c2, b3;
+  fill(a1, size_t(PageSize * 16 + 123));
+  fill(b1, size_t(PageSize * 4));
+  fill(c2, size_t(PageSize * 2));
+  fill(b3, size_t(PageSize * 5));
+
+  bytebuf a2 = a1;
+  a2[size_t(PageSize * 3 + 10)]++;
+  a2[size_t(PageSize * 9)]++;
+  a2[size_t(PageSize * 16 + 100)]++;
+
+  bytebuf a3 = a2;
+  a3[0]++;
+
+  auto writeCapture = [](RDCIncrementalContents &contents, const rdcstr &path) {
+    RDCFile rdc;
+    rdc.SetData(RDCDriver::Vulkan, "Vulkan", 0, NULL, 0, 1.0);
+    rdc.Create(path);
+
+    // the frame capture must be the first section
+    SectionProperties props;
+    props.type = SectionType::FrameCapture;
+    StreamWriter *writer = rdc.WriteSection(props);
+    writer->Write<uint32_t>(0);
+    writer->Finish();
+    delete writer;
+
+    return contents.EndCapture(rdc, path);
+  };
+
+  auto check = [](const rdcstr &path, ResourceId id, const bytebuf &expected) {
+    RDCFile rdc;
+    rdc.Open(path);
+
+    RDCIncrementalContents contents;
+    if(!contents.Read(rdc, path))
+      return false;
+
+    bytebuf data;
+    data.resize(expected.size());
+    return contents.Resolve(id, data.data(), data.size()) && data == expected;
+  };
+
+  {
+    RDCIncrementalContents contents;
+
+    // the first capture has nothing to refer to so stores everything
+    contents.Add(a, a1.data(), a1.size());
+    contents.Add(b, b1.data(), b1.size());
+    CHECK(contents.GetDataSize() == a1.size() + b1.size());
+    REQUIRE(writeCapture(contents, paths[0]));
+
+    // the second only stores the changed pages
+    contents.Add(a, a2.data(), a2.size());
+    contents.Add(b, b1.data(), b1.size());
+    contents.Add(c, c2.data(), c2.size());
+    CHECK(contents.GetDataSize() == PageSize * 2 + 123 + c2.size());
+    REQUIRE(writeCapture(contents, paths[1]));
+
+    // a discarded capture isn't used as a base
+    contents.Add(a, a1.data(), a1.size());
+    contents.DiscardCapture();
+    CHECK(contents.GetDataSize() == 0);
+
+    // b changes size so has to be stored in full
+    contents.Add(a, a3.data(), a3.size());
+    contents.Add(b, b3.data(), b3.size());
+    CHECK(contents.GetDataSize() == PageSize + b3.size());
+    REQUIRE(writeCapture(contents, paths[2]));
+  }
+
+  SECTION("Contents are resolved through base captures")
+  {
+    CHECK(check(paths[0], a, a1));
+    CHECK(check(paths[1], a, a2));
+    CHECK(check(paths[1], b, b1));
+    CHECK(check(paths[1], c, c2));
+    CHECK(check(paths[2], a, a3));
+    CHECK(check(paths[2], b, b3));
+
+    // the third capture doesn't store c, and contents must be the size that was stored
+    bytebuf wrongSize = a3;
+    wrongSize.push_back(0);
+
+    CHECK_FALSE(check(paths[2], c, c2));
+    CHECK_FALSE(check(paths[2], a, wrongSize));
+  }
+
+  SECTION("Base captures are found when moved together")
+  {
+    rdcstr moved[3];
+    for(int i = 0; i < 3; i++)
+    {
+      moved[i] = dir + "/moved/" + get_basename(paths[i]);
+      FileIO::CreateParentDirectory(moved[i]);
+      REQUIRE(FileIO::Move(paths[i], moved[i], true));
+    }
+
+    CHECK(check(moved[2], a, a3));
+    CHECK(check(moved[1], c, c2));
+
+    for(int i = 0; i < 3; i++)
+      FileIO::Move(moved[i], paths[i], true);
+  }
+
+  SECTION("Missing base captures fail to resolve")
+  {
+    {
+      RDCFile rdc;
+      rdc.Open(paths[2]);
+
+      RDCIncrementalContents contents;
+      REQUIRE(contents.Read(rdc, paths[2]));
+
+      rdcstr missing;
+      CHECK(contents.FindBases(missing));
+    }
+
+    FileIO::Delete(paths[0]);
+
+    CHECK_FALSE(check(paths[2], a, a3));
+    // b was stored in full, so doesn't need the first capture
+    CHECK(check(paths[2], b, b3));
+
+    // the missing capture is found through the second capture
+    RDCFile rdc;
+    rdc.Open(paths[2]);
+
+    RDCIncrementalContents contents;
+    REQUIRE(contents.Read(rdc, paths[2]));
+
+    rdcstr missing;
+    CHECK_FALSE(contents.FindBases(missing));
+    CHECK(missing == paths[0]);
+  }
+
+  SECTION("A different capture under a base's name isn't used as the base")
+  {
+    // a new capture with identical contents, as if the first were overwritten by another session
+    {
+      RDCIncrementalContents contents;
+      contents.Add(a, a1.data(), a1.size());
+      contents.Add(b, b1.data(), b1.size());
+      REQUIRE(writeCapture(contents, paths[0]));
+    }
+
+    CHECK(check(paths[0], a, a1));
+    CHECK_FALSE(check(paths[1], a, a2));
+    CHECK_FALSE(check(paths[2], a, a3));
+    // c was stored in full in the second capture
+    CHECK(check(paths[1], c, c2));
+
+    RDCFile rdc;
+    rdc.Open(paths[1]);
+
+    RDCIncrementalContents contents;
+    REQUIRE(contents.Read(rdc, paths[1]));
+
+    rdcstr missing;
+    CHECK_FALSE(contents.FindBases(missing));
+    CHECK(missing == paths[0]);
+  }
+
+  for(int i = 0; i < 3; i++)
+    FileIO::Delete(paths[i]);
+};
+
+TEST_CASE("Chunks can be allocated from pages", "[serialiser][chunks]")
+{
+  WriteSerialiser ser(new StreamWriter(StreamWriter::DefaultScratchSize), Ownership::Stream);
+
+  ChunkPagePool pool(4 * 1024);
+  ChunkAllocator alloc(pool);
+
+  auto makeChunk = [&ser](uint32_t value, uint32_t bufSize, ChunkAllocator *allocator) {
+    SCOPED_SERIALISE_CHUNK(1);
+
+    bytebuf buf;
+    buf.resize(bufSize);
+    memset(buf.data(), (int)value, bufSize);
+
+    SERIALISE_ELEMENT(value);
+    SERIALISE_ELEMENT(buf);
+
+    return scope.Get(allocator);
+  };
+
+  auto checkChunk = [](Chunk *chunk, uint32_t value, uint32_t bufSize) {
+    StreamWriter *buf = new StreamWriter(StreamWriter::DefaultScratchSize);
+
+    {
+      WriteSerialiser ser(buf, Ownership::Nothing);
+      chunk->Write(ser);
+    }
+
+    ReadSerialiser ser(new StreamReader(buf->GetData(), buf->GetOffset()), Ownership::Stream);
+
+    CHECK(ser.ReadChunk<uint32_t>() == 1);
+
+    uint32_t readValue = 0;
+    bytebuf readBuf;
+
+    SERIALISE_ELEMENT(readValue);
+    SERIALISE_ELEMENT(readBuf);
+
+    ser.EndChunk();
+
+    CHECK(readValue == value);
+    REQUIRE(readBuf.size() == bufSize);
+    for(byte b : readBuf)
+      REQUIRE(b == byte(value));
+
+    delete buf;
+  };
+
+  SECTION("Small chunks come from the allocator's pages")
+  {
+    rdcarray<Chunk *> chunks;
+    for(uint32_t i = 0; i < 100; i++)
+      chunks.push_back(makeChunk(i, 100, &alloc));
+
+    for(uint32_t i = 0; i < 100; i++)
+    {
+      CHECK(chunks[i]->IsFromAllocator());
+      checkChunk(chunks[i], i, 100);
+    }
+
+    // deleting is a no-op, the memory goes back with the pages
+    for(Chunk *c : chunks)
+      c->Delete();
+
+    alloc.Reset();
+  };
+
+  SECTION("Chunks bigger than a page are allocated separately")
+  {
+    Chunk *small = makeChunk(1, 16, &alloc);
+    Chunk *big = makeChunk(2, 8 * 1024, &alloc);
+
+    CHECK(small->IsFromAllocator());
+    CHECK_FALSE(big->IsFromAllocator());
+
+    checkChunk(small, 1, 16);
+    checkChunk(big, 2, 8 * 1024);
+
+    small->Delete();
+    big->Delete();
+
+    alloc.Reset();
+  };
+
+  SECTION("Pages are reused once reset")
+  {
+    Chunk *first = makeChunk(1, 16, &alloc);
+    byte *firstData = first->GetData();
+    first->Delete();
+
+    alloc.Reset();
+
+    Chunk *second = makeChunk(2, 16, &alloc);
+    CHECK(second->GetData() == firstData);
+    checkChunk(second, 2, 16);
+    second->Delete();
+
+    // resetting the whole pool reclaims pages held by allocators, and once the allocator is reset
+    // it doesn't hand them back a second time
+    pool.Reset();
+    alloc.Reset();
+
+    Chunk *third = makeChunk(3, 16, &alloc);
+    CHECK(third->GetData() == firstData);
+    checkChunk(third, 3, 16);
+    third->Delete();
+
+    alloc.Reset();
+  };
+}
+
+TEST_CASE("Benchmark recording chunks on multiple threads", "[.][benchmark][serialiser][chunks]")
+{
+  // each thread stands in for an application thread recording into its own command buffer or
+  // context, which is reset at the end of every frame
+  const uint32_t callsPerFrame = 2000;
+  const uint32_t frames = 100;
+
+  enum class Mode
+  {
+    Idle,
+    Heap,
+    Paged,
+  };
+
+  auto recordFrames = [](Mode mode) -> uint64_t {
+    WriteSerialiser ser(new StreamWriter(StreamWriter::DefaultScratchSize), Ownership::Stream);
+
+    ChunkPagePool pool(32 * 1024);
+    ChunkAllocator alloc(pool);
+
+    rdcarray<Chunk *> chunks;
+    chunks.reserve(callsPerFrame);
+
+    uint64_t checksum = 0;
+
+    for(uint32_t f = 0; f < frames; f++)
+    {
+      for(uint32_t c = 0; c < callsPerFrame; c++)
+      {
+        uint64_t object = f * callsPerFrame + c;
+        uint32_t first = c, count = 3;
+        float params[4] = {1.0f, 2.0f, 3.0f, float(c)};
+
+        // when not capturing, a call only does its state tracking
+        if(mode == Mode::Idle)
+        {
+          checksum += object + first + count + uint64_t(params[3]);
+          continue;
+        }
+
+        SCOPED_SERIALISE_CHUNK(1);
+        SERIALISE_ELEMENT(object);
+        SERIALISE_ELEMENT(first);
+        SERIALISE_ELEMENT(count);
+        SERIALISE_ELEMENT(params);
+
+        chunks.push_back(scope.Get(mode == Mode::Paged ? &alloc : NULL));
+        checksum += chunks.back()->GetChunkType<uint32_t>();
+      }
+
+      for(Chunk *c : chunks)
+        c->Delete();
+      chunks.clear();
+
+      alloc.Reset();
+    }
+
+    return checksum;
+  };
+
+  rdcstr results;
+
+  for(uint32_t threads = 1; threads <= Threading::NumberOfCores(); threads *= 2)
+  {
+    results += StringFormat::Fmt("\n%u threads:", threads);
+
+    for(Mode mode : {Mode::Idle, Mode::Heap, Mode::Paged})
+    {
+      rdcarray<Threading::ThreadHandle> handles;
+      rdcarray<uint64_t> checksums;
+      checksums.resize(threads);
+
+      PerformanceTimer timer;
+
+      for(uint32_t t = 0; t < threads; t++)
+        handles.push_back(Threading::CreateThread(
+            [&recordFrames, &checksums, mode, t]() { checksums[t] = recordFrames(mode); }));
+
+      for(Threading::ThreadHandle h : handles)
+      {
+        Threading::JoinThread(h);
+        Threading::CloseThread(h);
+      }
+
+      double seconds = timer.GetMilliseconds() / 1000.0;
+      double calls = double(threads) * callsPerFrame * frames;
+
+      const char *name = mode == Mode::Idle ? "not capturing"
+                                            : (mode == Mode::Heap ? "heap chunks" : "paged chunks");
+
+      results += StringFormat::Fmt(" %s %.1fM calls/sec,", name, calls / seconds / 1000000.0);
+    }
+
+    results.pop_back();
+  }
+
+  WARN("Recording throughput:" << results.c_str());
+}
+
+// stands in for a driver's resource handle, which decodes to the live resource for an ID
+struct CacheTestHandle
+{
+  uint64_t live;
+};
+
+DECLARE_REFLECTION_STRUCT(CacheTestHandle);
+DECLARE_DECODE_CACHEABLE(CacheTestHandle);
+
+typedef std::unordered_map<uint64_t, uint64_t> CacheTestLiveIDs;
+
+template <class SerialiserType>
+void DoSerialise(SerialiserType &ser, CacheTestHandle &el)
+{
+  uint64_t id = el.live;
+  ser.Serialise("id"_lit, id);
+
+  if(ser.IsReading())
+  {
+    CacheTestLiveIDs &liveIDs = *(CacheTestLiveIDs *)ser.GetUserData();
+    el.live = liveIDs[id];
+  }
+}
+
+// serialises one chunk of a frame, returning a checksum of everything in it
+template <class SerialiserType>
+uint64_t SerialiseCacheTestChunk(SerialiserType &ser, uint32_t c)
+{
+  CacheTestHandle handle = {c % 64};
+  uint32_t first = c;
+  bool hasName = (c % 3) == 0;
+  rdcstr name = StringFormat::Fmt("chunk %u", c);
+  uint32_t numHandles = c % 5;
+  CacheTestHandle handleData[4] = {{c % 7}, {c % 11}, {c % 13}, {c % 17}};
+  CacheTestHandle *pHandles = handleData;
+  float params[4] = {1.0f, 2.0f, 3.0f, float(c)};
+
+  SERIALISE_ELEMENT(handle);
+  SERIALISE_ELEMENT(first);
+  SERIALISE_ELEMENT(hasName);
+  if(hasName)
+  {
+    SERIALISE_ELEMENT(name);
+  }
+  SERIALISE_ELEMENT(numHandles);
+  SERIALISE_ELEMENT_ARRAY(pHandles, numHandles);
+  SERIALISE_ELEMENT(params);
+
+  uint64_t checksum = handle.live * 31 + first + (hasName ? name.size() : 0) + uint64_t(params[3]);
+  for(uint32_t i = 0; i < numHandles; i++)
+    checksum = checksum * 31 + pHandles[i].live;
+
+  return checksum;
+}
+
+static StreamWriter *WriteCacheTestFrame(uint32_t numChunks)
+{
+  StreamWriter *buf = new StreamWriter(StreamWriter::DefaultScratchSize);
+
+  WriteSerialiser ser(buf, Ownership::Nothing);
+
+  for(uint32_t c = 0; c < numChunks; c++)
+  {
+    SCOPED_SERIALISE_CHUNK(1);
+    SerialiseCacheTestChunk(ser, c);
+  }
+
+  return buf;
+}
+
+static rdcarray<uint64_t> ReplayCacheTestFrame(StreamReader &reader, CacheTestLiveIDs &liveIDs,
+                                               DecodedChunkCache *cache)
+{
+  rdcarray<uint64_t> ret;
+
+  reader.SetOffset(0);
+
+  ReadSerialiser ser(&reader, Ownership::Nothing);
+  ser.SetUserData(&liveIDs);
+  ser.SetDecodedChunkCache(cache);
+
+  while(!reader.AtEnd() && !reader.IsErrored())
+  {
+    ser.ReadChunk<uint32_t>();
+    ret.push_back(SerialiseCacheTestChunk(ser, 0));
+    ser.EndChunk();
+  }
+
+  return ret;
+}
+
+TEST_CASE("Decoded chunks can be cached between reads", "[serialiser][chunks]")
+{
+  const uint32_t numChunks = 200;
+
+  StreamWriter *buf = WriteCacheTestFrame(numChunks);
+  StreamReader reader(buf->GetData(), buf->GetOffset());
+
+  CacheTestLiveIDs liveIDs;
+  for(uint64_t id = 0; id < 64; id++)
+    liveIDs[id] = id * 1000 + 1;
+
+  rdcarray<uint64_t> reference = ReplayCacheTestFrame(reader, liveIDs, NULL);
+  REQUIRE(reference.size() == numChunks);
+
+  DecodedChunkCache cache;
+  cache.SetBudget(16 * 1024 * 1024);
+
+  SECTION("Reading from the cache gives the same values")
+  {
+    CHECK(ReplayCacheTestFrame(reader, liveIDs, &cache) == reference);
+    CHECK(cache.GetNumChunks() == numChunks);
+    CHECK(cache.GetMemoryUsage() > 0);
+
+    CHECK(ReplayCacheTestFrame(reader, liveIDs, &cache) == reference);
+    CHECK(cache.GetNumChunks() == numChunks);
+  };
+
+  SECTION("Cached values are used until the cache is cleared")
+  {
+    ReplayCacheTestFrame(reader, liveIDs, &cache);
+
+    // change what the IDs decode to. The cached handles still have the previous values
+    for(uint64_t id = 0; id < 64; id++)
+      liveIDs[id] = id * 1000 + 2;
+
+    CHECK(ReplayCacheTestFrame(reader, liveIDs, &cache) == reference);
+
+    cache.Clear();
+    CHECK(cache.GetNumChunks() == 0);
+    CHECK(cache.GetMemoryUsage() == 0);
+
+    rdcarray<uint64_t> changed = ReplayCacheTestFrame(reader, liveIDs, NULL);
+    CHECK(changed != reference);
+    CHECK(ReplayCacheTestFrame(reader, liveIDs, &cache) == changed);
+    CHECK(ReplayCacheTestFrame(reader, liveIDs, &cache) == changed);
+  };
+
+  SECTION("Chunks stop being cached at the budget")
+  {
+    cache.SetBudget(0);
+
+    CHECK(ReplayCacheTestFrame(reader, liveIDs, &cache) == reference);
+    CHECK(cache.GetNumChunks() == 0);
+
+    cache.SetBudget(1024);
+
+    CHECK(ReplayCacheTestFrame(reader, liveIDs, &cache) == reference);
+    CHECK(cache.GetNumChunks() > 0);
+    CHECK(cache.GetNumChunks() < numChunks);
+    CHECK(ReplayCacheTestFrame(reader, liveIDs, &cache) == reference);
+  };
+
+  SECTION("The cache is unused while exporting structured data")
+  {
+    reader.SetOffset(0);
+
+    ReadSerialiser ser(&reader, Ownership::Nothing);
+    ser.SetUserData(&liveIDs);
+    ser.SetDecodedChunkCache(&cache);
+    ChunkLookup testChunkLoop = [](uint32_t) -> rdcstr { return "TestChunk"; };
+
+    ser.ConfigureStructuredExport(testChunkLoop, false, 0, 1.0);
+
+    ser.ReadChunk<uint32_t>();
+    CHECK(SerialiseCacheTestChunk(ser, 0) == reference[0]);
+    ser.EndChunk();
+
+    CHECK(cache.GetNumChunks() == 0);
+    CHECK(ser.GetStructuredFile().chunks[0]->NumChildren() == 7);
+  };
+
+  delete buf;
+}
+
+TEST_CASE("Benchmark replaying with decoded chunks cached", "[.][benchmark][serialiser][chunks]")
+{
+  const uint32_t numChunks = 50000;
+  const uint32_t replays = 20;
+
+  StreamWriter *buf = WriteCacheTestFrame(numChunks);
+  StreamReader reader(buf->GetData(), buf->GetOffset());
+
+  // a capture typically has thousands of resources to look up handles in
+  CacheTestLiveIDs liveIDs;
+  for(uint64_t id = 0; id < 4096; id++)
+    liveIDs[id] = id * 1000 + 1;
+
+  DecodedChunkCache cache;
+  cache.SetBudget(256 * 1024 * 1024);
+
+  rdcarray<uint64_t> reference = ReplayCacheTestFrame(reader, liveIDs, NULL);
+
+  rdcstr results;
+
+  for(bool cached : {false, true})
+  {
+    // the first replay fills the cache and isn't timed
+    if(cached)
+      ReplayCacheTestFrame(reader, liveIDs, &cache);
+
+    PerformanceTimer timer;
+
+    for(uint32_t r = 0; r < replays; r++)
+      CHECK(ReplayCacheTestFrame(reader, liveIDs, cached ? &cache : NULL) == reference);
+
+    double seconds = timer.GetMilliseconds() / 1000.0;
+
+    results += StringFormat::Fmt("\n%s: %.1f replays/sec", cached ? "cached" : "uncached",
+                                 replays / seconds);
+  }
+
+  results += StringFormat::Fmt("\n%llu bytes cached", cache.GetMemoryUsage());
+
+  WARN("Replaying " << numChunks << " chunks:" << results.c_str());
+
+  delete buf;
+}
+
 TEST_CASE("Read/write container types", "[serialiser][structured]")
 {
   StreamWriter *buf = new StreamWriter(StreamWriter::DefaultScratchSize);
@@ -1437,6 +2281,185 @@ TEST_CASE("Read/write complex types", "[serialiser][structured]")
   delete buf;
 };
 
+static StreamWriter *WriteArenaTestChunks(uint32_t numChunks)
+{
+  StreamWriter *buf = new StreamWriter(StreamWriter::DefaultScratchSize);
+
+  WriteSerialiser ser(buf, Ownership::Nothing);
+
+  for(uint32_t i = 0; i < numChunks; i++)
+  {
+    SCOPED_SERIALISE_CHUNK(1 + (i % 3));
+
+    MySpecialEnum enumVal = (i % 2) ? AnotherEnumValue : TheLastEnumValue;
+    float f = float(i);
+    rdcarray<uint32_t> v = {i, i + 1, i + 2, i + 3};
+
+    SERIALISE_ELEMENT(i);
+    SERIALISE_ELEMENT(enumVal);
+    SERIALISE_ELEMENT(f);
+    SERIALISE_ELEMENT(v);
+  }
+
+  return buf;
+}
+
+static void ReadArenaTestChunks(StreamWriter *buf, uint32_t numChunks, SDFile &file)
+{
+  ReadSerialiser ser(new StreamReader(buf->GetData(), buf->GetOffset()), Ownership::Stream);
+
+  ser.ConfigureStructuredExport(
+      [](uint32_t id) -> rdcstr { return StringFormat::Fmt("TestChunk%u", id); }, true, 0, 1.0);
+
+  for(uint32_t c = 0; c < numChunks; c++)
+  {
+    ser.ReadChunk<uint32_t>();
+    {
+      uint32_t i;
+      MySpecialEnum enumVal;
+      float f;
+      rdcarray<uint32_t> v;
+
+      SERIALISE_ELEMENT(i);
+      SERIALISE_ELEMENT(enumVal);
+      SERIALISE_ELEMENT(f);
+      SERIALISE_ELEMENT(v);
+    }
+    ser.EndChunk();
+  }
+
+  ser.GetStructuredFile().Swap(file);
+}
+
+TEST_CASE("Structured data is allocated from the file's arena", "[serialiser][structured]")
+{
+  StreamWriter *buf = WriteArenaTestChunks(6);
+
+  SDFile *file = new SDFile;
+  ReadArenaTestChunks(buf, 6, *file);
+
+  REQUIRE(file->chunks.size() == 6);
+
+  // chunk names and enum strings are interned, so repeated values share storage
+  CHECK(file->chunks[0]->name == "TestChunk1");
+  CHECK(file->chunks[0]->name.c_str() == file->chunks[3]->name.c_str());
+  CHECK(file->chunks[1]->name.c_str() == file->chunks[4]->name.c_str());
+  CHECK(file->chunks[0]->name.c_str() != file->chunks[1]->name.c_str());
+
+  CHECK(file->chunks[1]->GetChild(1)->data.str == "AnotherEnumValue");
+  CHECK(file->chunks[1]->GetChild(1)->data.str.c_str() ==
+        file->chunks[3]->GetChild(1)->data.str.c_str());
+
+  // arena objects can be mixed freely with individually allocated ones
+  SDChunk *chunk = file->chunks[2];
+  chunk->RemoveChild(2);
+  chunk->AddAndOwnChild(makeSDString("extra"_lit, "value"));
+  chunk->GetChild(2)->DuplicateAndAddChild(chunk->GetChild(0));
+
+  REQUIRE(chunk->NumChildren() == 4);
+  CHECK(chunk->GetChild(2)->NumChildren() == 5);
+  CHECK(chunk->GetChild(3)->AsString() == "value");
+
+  SDChunk *dup = chunk->Duplicate();
+  delete file->chunks.takeAt(5);
+
+  // swapping files takes the arena along with the chunks
+  SDFile other;
+  other.Swap(*file);
+  delete file;
+
+  REQUIRE(other.chunks.size() == 5);
+  CHECK(other.chunks[4]->GetChild(0)->AsUInt32() == 4);
+  CHECK(other.chunks[4]->GetChild(3)->GetChild(3)->AsUInt32() == 7);
+  CHECK(other.chunks[2]->HasEqualValue(dup));
+
+  delete dup;
+  delete buf;
+};
+
+TEST_CASE("Duplicated structured data doesn't use the file's arena", "[serialiser][structured]")
+{
+  StreamWriter *buf = WriteArenaTestChunks(2);
+
+  SDFile *file = new SDFile;
+  ReadArenaTestChunks(buf, 2, *file);
+
+  REQUIRE(file->chunks.size() == 2);
+
+  SDChunk *dup = file->chunks[1]->Duplicate();
+  SDObject *enumDup = file->chunks[1]->GetChild(1)->Duplicate();
+
+  CHECK(dup->name.c_str() != file->chunks[1]->name.c_str());
+  CHECK(dup->GetChild(1)->data.str.c_str() != file->chunks[1]->GetChild(1)->data.str.c_str());
+
+  // copying into another file, as the capture file does when structured data is set
+  SDFile copy;
+  for(SDChunk *chunk : file->chunks)
+    copy.chunks.push_back(chunk->Duplicate());
+
+  delete file;
+
+  CHECK(dup->name == "TestChunk2");
+  CHECK(dup->GetChild(1)->data.str == "AnotherEnumValue");
+  CHECK(enumDup->data.str == "AnotherEnumValue");
+  CHECK(copy.chunks[0]->name == "TestChunk1");
+  CHECK(copy.chunks[0]->GetChild(1)->data.str == "TheLastEnumValue");
+  CHECK(copy.chunks[1]->name == "TestChunk2");
+
+  // objects that aren't from an arena, including ones on the stack, keep their strings as-is
+  SDObject local("local"_lit, "Local"_lit);
+  local.AddAndOwnChild(makeSDString("str"_lit, "value"));
+  SDObject *localDup = local.Duplicate();
+
+  CHECK(localDup->name.c_str() == local.name.c_str());
+  CHECK(localDup->GetChild(0)->AsString() == "value");
+
+  delete localDup;
+  delete enumDup;
+  delete dup;
+  delete buf;
+};
+
+TEST_CASE("Benchmark building and destroying structured data", "[.][benchmark][serialiser]")
+{
+  const uint32_t numChunks = 1000000;
+
+  StreamWriter *buf = WriteArenaTestChunks(numChunks);
+
+  SDFile *file = new SDFile;
+
+  PerformanceTimer timer;
+
+  ReadArenaTestChunks(buf, numChunks, *file);
+
+  double buildTime = timer.GetMilliseconds();
+
+  REQUIRE(file->chunks.size() == numChunks);
+
+  // for comparison, a copy where every object is individually allocated
+  SDFile *heapFile = new SDFile;
+  for(SDChunk *chunk : file->chunks)
+    heapFile->chunks.push_back(chunk->Duplicate());
+
+  timer.Restart();
+
+  delete file;
+
+  double destroyTime = timer.GetMilliseconds();
+
+  timer.Restart();
+
+  delete heapFile;
+
+  double heapDestroyTime = timer.GetMilliseconds();
+
+  WARN(StringFormat::Fmt("Structured data for %u chunks: built in %.2f ms, destroyed in %.2f ms "
+                         "(%.2f ms when individually allocated)",
+                         numChunks, buildTime, destroyTime, heapDestroyTime));
+
+  delete buf;
+};
+
 enum class TestEnumClass
 {
   A = 1,
@@ -25,6 +25,7 @@
 #include "streamio.h"
 #include <errno.h>
 #include "api/replay/stringise.h"
+#include "common/threading.h"
 #include "common/timing.h"
 
 Compressor::~Compressor()
@@ -39,6 +40,302 @@ Decompressor::~Decompressor()
     delete m_Read;
 }
 
+bool Decompressor::SetOffset(uint64_t offs)
+{
+  RDCERR("Decompressor is not reading a seekable stream, can't seek");
+  return false;
+}
+
+bool SeekableBlockIndex::Write(StreamWriter *writer) const
+{
+  bool success = true;
+
+  success &= writer->Write(offsets.data(), offsets.byteSize());
+
+  const uint64_t numBlocks = NumBlocks();
+  const uint32_t magic = Magic;
+
+  success &= writer->Write(uncompressedSize);
+  success &= writer->Write(numBlocks);
+  success &= writer->Write(blockSize);
+  success &= writer->Write(magic);
+
+  return success;
+}
+
+bool SeekableBlockIndex::Read(StreamReader *reader)
+{
+  const uint64_t footerSize = sizeof(uint64_t) * 2 + sizeof(uint32_t) * 2;
+  const uint64_t streamSize = reader->GetSize();
+
+  if(streamSize < footerSize)
+  {
+    RDCERR("Seekable stream is too small (%llu bytes) to contain a block index", streamSize);
+    return false;
+  }
+
+  reader->SetOffset(streamSize - footerSize);
+
+  uint64_t numBlocks = 0;
+  uint32_t magic = 0;
+
+  reader->Read(uncompressedSize);
+  reader->Read(numBlocks);
+  reader->Read(blockSize);
+  reader->Read(magic);
+
+  if(reader->IsErrored() || magic != Magic)
+  {
+    RDCERR("Couldn't read seekable block index footer, got magic %08x", magic);
+    return false;
+  }
+
+  if(blockSize == 0 || numBlocks >= (streamSize - footerSize) / sizeof(uint64_t) ||
+     uncompressedSize > numBlocks * blockSize)
+  {
+    RDCERR("Invalid seekable block index: %llu blocks of %u bytes for %llu bytes", numBlocks,
+           blockSize, uncompressedSize);
+    return false;
+  }
+
+  const uint64_t tableSize = (numBlocks + 1) * sizeof(uint64_t);
+
+  reader->SetOffset(streamSize - footerSize - tableSize);
+
+  offsets.resize((size_t)numBlocks + 1);
+  reader->Read(offsets.data(), tableSize);
+
+  if(reader->IsErrored())
+  {
+    RDCERR("Couldn't read seekable block index table");
+    return false;
+  }
+
+  for(size_t i = 0; i + 1 < offsets.size(); i++)
+  {
+    if(offsets[i] > offsets[i + 1])
+    {
+      RDCERR("Corrupt seekable block index, block %zu offset %llu is after %llu", i, offsets[i],
+             offsets[i + 1]);
+      return false;
+    }
+  }
+
+  if(offsets.back() > streamSize - footerSize - tableSize)
+  {
+    RDCERR("Corrupt seekable block index, block data ends past the index table");
+    return false;
+  }
+
+  reader->SetOffset(0);
+
+  return !reader->IsErrored();
+}
+
+bool ParallelProcessBlocks(uint32_t count, std::function<bool(uint32_t)> process)
+{
+  int32_t failed = 0;
+
+  auto processItem = [&](uint32_t item) {
+    if(!process(item))
+      Atomic::Inc32(&failed);
+  };
+
+  // blocks are large, so hand them out one at a time to balance uneven compression ratios
+  Threading::Jobs::ParallelFor(0, count, processItem, 1);
+
+  return failed == 0;
+}
+
+// each page handed to a worker is around this size, rounded to a whole number of blocks
+static const uint64_t parallelPageSize = 1024 * 1024;
+
+ParallelCompressor::ParallelCompressor(StreamWriter *write, Ownership own, uint32_t blockSize,
+                                       uint32_t numThreads,
+                                       std::function<BlockCodec *()> createCodec)
+    : Compressor(write, own)
+{
+  m_BlockSize = blockSize;
+  m_PageSize = RDCMAX((uint64_t)1, parallelPageSize / blockSize) * blockSize;
+  m_CreateCodec = createCodec;
+
+  m_Index.blockSize = blockSize;
+
+  numThreads = RDCMAX(1U, numThreads);
+
+  // two pages per thread so that the jobs can keep the threads busy while the writing thread fills
+  // the next pages and writes out finished ones
+  m_Pages.resize(numThreads * 2);
+  for(Page &page : m_Pages)
+    page.data = AllocAlignedBuffer(m_PageSize);
+}
+
+ParallelCompressor::~ParallelCompressor()
+{
+  WaitForPages();
+
+  for(Page &page : m_Pages)
+    FreeAlignedBuffer(page.data);
+
+  for(BlockCodec *codec : m_Codecs)
+    delete codec;
+}
+
+bool ParallelCompressor::Write(const void *data, uint64_t numBytes)
+{
+  if(m_Error)
+    return false;
+
+  const byte *src = (const byte *)data;
+
+  while(numBytes > 0)
+  {
+    Page &page = m_Pages[m_FillPage];
+
+    uint64_t chunkSize = RDCMIN(numBytes, m_PageSize - page.size);
+    memcpy(page.data + page.size, src, (size_t)chunkSize);
+
+    page.size += chunkSize;
+    src += chunkSize;
+    numBytes -= chunkSize;
+
+    if(page.size == m_PageSize && !SubmitPage())
+      return false;
+  }
+
+  return true;
+}
+
+bool ParallelCompressor::Finish()
+{
+  if(m_Error)
+    return false;
+
+  bool success = true;
+
+  if(m_Pages[m_FillPage].size > 0)
+    success = SubmitPage();
+
+  while(success && m_PagesInFlight > 0)
+    success = WriteOldestPage();
+
+  if(!success)
+    return false;
+
+  m_Index.offsets.push_back(m_CompressedOffset);
+
+  return m_Index.Write(m_Write);
+}
+
+bool ParallelCompressor::SubmitPage()
+{
+  Page *page = &m_Pages[m_FillPage];
+  page->state = PageQueued;
+  page->job = Threading::Jobs::Add([this, page]() { CompressPage(*page); });
+
+  m_PagesInFlight++;
+  m_FillPage = (m_FillPage + 1) % m_Pages.size();
+
+  // if every page is in flight we have to wait for the oldest so we can fill it next
+  if(m_PagesInFlight == m_Pages.size() && !WriteOldestPage())
+    return false;
+
+  // write out any other pages that are already done, without waiting
+  while(m_PagesInFlight > 0 &&
+        Atomic::CmpExch32(&m_Pages[m_OldestPage].state, PageQueued, PageQueued) != PageQueued)
+  {
+    if(!WriteOldestPage())
+      return false;
+  }
+
+  return true;
+}
+
+bool ParallelCompressor::WriteOldestPage()
+{
+  Page &page = m_Pages[m_OldestPage];
+
+  // this runs other jobs while the page's job is still going
+  Threading::Jobs::Wait(page.job);
+  page.job = NULL;
+
+  bool success = (page.state == PageCompressed);
+
+  if(success)
+  {
+    for(uint64_t blockSize : page.blockSizes)
+    {
+      m_Index.offsets.push_back(m_CompressedOffset);
+      m_CompressedOffset += blockSize;
+    }
+    m_Index.uncompressedSize += page.size;
+
+    success = m_Write->Write(page.compressed.data(), page.compressed.size());
+  }
+  else
+  {
+    RDCERR("Failed to compress block");
+  }
+
+  page.size = 0;
+  page.state = PageFree;
+
+  m_PagesInFlight--;
+  m_OldestPage = (m_OldestPage + 1) % m_Pages.size();
+
+  if(!success)
+    m_Error = true;
+
+  return success;
+}
+
+void ParallelCompressor::CompressPage(Page &page)
+{
+  BlockCodec *codec = NULL;
+  {
+    SCOPED_LOCK(m_CodecLock);
+    if(!m_Codecs.empty())
+    {
+      codec = m_Codecs.back();
+      m_Codecs.pop_back();
+    }
+  }
+
+  if(codec == NULL)
+    codec = m_CreateCodec();
+
+  bool success = (codec != NULL);
+
+  page.compressed.clear();
+  page.blockSizes.clear();
+
+  for(uint64_t offs = 0; success && offs < page.size; offs += m_BlockSize)
+  {
+    uint64_t blockSize = RDCMIN((uint64_t)m_BlockSize, page.size - offs);
+    size_t prevSize = page.compressed.size();
+    success = codec->CompressBlock(page.data + offs, blockSize, page.compressed);
+    page.blockSizes.push_back(page.compressed.size() - prevSize);
+  }
+
+  if(codec)
+  {
+    SCOPED_LOCK(m_CodecLock);
+    m_Codecs.push_back(codec);
+  }
+
+  Atomic::CmpExch32(&page.state, PageQueued, success ? PageCompressed : PageFailed);
+}
+
+void ParallelCompressor::WaitForPages()
+{
+  // pages are only left in flight on error, but their jobs still reference the pages
+  for(Page &page : m_Pages)
+  {
+    Threading::Jobs::Wait(page.job);
+    page.job = NULL;
+  }
+}
+
 static const uint64_t initialBufferSize = 64 * 1024;
 const byte StreamWriter::empty[128] = {};
 
@@ -114,6 +411,7 @@ StreamReader::StreamReader(FILE *file, uint64_t fileSize, Ownership own)
   }
 
   m_File = file;
+  m_FileBase = FileIO::ftell64(file);
   m_InputSize = fileSize;
 
   m_BufferSize = initialBufferSize;
@@ -151,8 +449,49 @@ StreamReader::StreamReader(FILE *file)
   m_Ownership = Ownership::Stream;
 }
 
+StreamReader::StreamReader(StreamMemory *memory, uint64_t offset, uint64_t size)
+{
+  if(offset + size > memory->GetSize())
+  {
+    RDCERR("Invalid range %llu bytes at %llu for %llu bytes of memory", size, offset,
+           memory->GetSize());
+
+    m_InputSize = 0;
+
+    m_BufferSize = 0;
+    m_BufferHead = m_BufferBase = NULL;
+
+    m_HasError = true;
+    m_Ownership = Ownership::Nothing;
+    return;
+  }
+
+  m_Memory = memory;
+  m_Memory->AddRef();
+
+  m_InputSize = m_BufferSize = size;
+  m_BufferHead = m_BufferBase = (byte *)memory->GetData() + offset;
+
+  m_Ownership = Ownership::Nothing;
+}
+
 StreamReader::StreamReader(StreamReader *reader, uint64_t bufferSize)
 {
+  // if the source is reading memory in place then share it rather than copying
+  if(reader->m_Memory && !reader->m_HasError && bufferSize <= reader->Available())
+  {
+    m_Memory = reader->m_Memory;
+    m_Memory->AddRef();
+
+    m_InputSize = m_BufferSize = bufferSize;
+    m_BufferHead = m_BufferBase = reader->m_BufferHead;
+
+    reader->m_BufferHead += bufferSize;
+
+    m_Ownership = Ownership::Nothing;
+    return;
+  }
+
   m_InputSize = m_BufferSize = bufferSize;
   m_BufferHead = m_BufferBase = AllocAlignedBuffer(m_BufferSize);
 
@@ -179,7 +518,10 @@ StreamReader::~StreamReader()
   for(StreamCloseCallback cb : m_Callbacks)
     cb();
 
-  FreeAlignedBuffer(m_BufferBase);
+  if(m_Memory)
+    m_Memory->Release();
+  else
+    FreeAlignedBuffer(m_BufferBase);
 
   if(m_Ownership == Ownership::Stream)
   {
@@ -193,9 +535,37 @@ StreamReader::~StreamReader()
 
 void StreamReader::SetOffset(uint64_t offs)
 {
+  if(m_Sock)
+  {
+    RDCERR("Socket stream readers do not support seeking");
+    return;
+  }
+
   if(m_File || m_Decompressor)
   {
-    RDCERR("File and decompress stream readers do not support seeking");
+    if(m_HasError)
+      return;
+
+    if(offs > m_InputSize)
+    {
+      RDCERR("Seeking to %llu past the end of the stream (%llu bytes)", offs, m_InputSize);
+      return;
+    }
+
+    if(m_File)
+    {
+      FileIO::fseek64(m_File, m_FileBase + offs, SEEK_SET);
+    }
+    else if(!m_Decompressor->SetOffset(offs))
+    {
+      return;
+    }
+
+    // discard the current window entirely and refill it from the new position
+    m_ReadOffset = offs;
+    m_BufferHead = m_BufferBase;
+
+    ReadFromExternal(m_BufferBase, RDCMIN(m_BufferSize, m_InputSize - offs));
     return;
   }
 
@@ -638,3 +1008,75 @@ void StreamTransfer(StreamWriter *writer, StreamReader *reader, RENDERDOC_Progre
 
   delete[] buf;
 }
+
+bool StreamWriteOrdered(StreamWriter *writer, size_t count, size_t batchSize,
+                        std::function<void(size_t, size_t, rdcstr &)> format,
+                        RENDERDOC_ProgressCallback progress)
+{
+  batchSize = RDCMAX(batchSize, (size_t)1);
+
+  const size_t numBatches = (count + batchSize - 1) / batchSize;
+
+  uint32_t numThreads =
+      (uint32_t)RDCMIN((size_t)Threading::Jobs::NumWorkers() + 1, numBatches);
+
+  // with nothing to overlap, format each batch and write it straight away
+  if(numThreads <= 1)
+  {
+    rdcstr out;
+    for(size_t b = 0; b < numBatches; b++)
+    {
+      out.clear();
+      format(b * batchSize, RDCMIN(count, (b + 1) * batchSize), out);
+      writer->Write(out.data(), out.size());
+
+      if(progress)
+        progress(float(b + 1) / float(numBatches));
+    }
+
+    return !writer->IsErrored();
+  }
+
+  struct Batch
+  {
+    rdcstr text;
+    Threading::Jobs::Job job = NULL;
+  };
+
+  // batches are formatted by jobs into a ring of slots and written out from the oldest. Two slots
+  // per thread keeps the threads busy while the oldest batch is written, and a slot is only reused
+  // once its batch has been written
+  rdcarray<Batch> slots;
+  slots.resize(numThreads * 2);
+
+  auto formatBatch = [&](size_t b) {
+    Batch *batch = &slots[b % slots.size()];
+    batch->job = Threading::Jobs::Add([&format, count, batchSize, batch, b]() {
+      format(b * batchSize, RDCMIN(count, (b + 1) * batchSize), batch->text);
+    });
+  };
+
+  for(size_t b = 0; b < RDCMIN(slots.size(), numBatches); b++)
+    formatBatch(b);
+
+  for(size_t b = 0; b < numBatches; b++)
+  {
+    Batch &batch = slots[b % slots.size()];
+
+    // this runs other batches' jobs while the oldest batch is still being formatted
+    Threading::Jobs::Wait(batch.job);
+    batch.job = NULL;
+
+    writer->Write(batch.text.data(), batch.text.size());
+
+    batch.text.clear();
+
+    if(b + slots.size() < numBatches)
+      formatBatch(b + slots.size());
+
+    if(progress)
+      progress(float(b + 1) / float(numBatches));
+  }
+
+  return !writer->IsErrored();
+}
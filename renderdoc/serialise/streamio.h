@@ -27,6 +27,7 @@
 #include <stdio.h>
 #include <functional>
 #include "common/common.h"
+#include "common/threading.h"
 #include "os/os_specific.h"
 
 enum class Ownership
@@ -40,6 +41,40 @@ class StreamReader;
 
 typedef std::function<void()> StreamCloseCallback;
 
+// A block of memory that StreamReaders can read from in place without copying, such as a
+// memory-mapped file. It's reference counted so that readers keep it alive after its creator is
+// done with it.
+class StreamMemory
+{
+public:
+  // the creator holds the first reference. release is called once the last reference is gone
+  StreamMemory(const byte *data, uint64_t size, std::function<void()> release)
+      : m_Data(data), m_Size(size), m_ReleaseCallback(release)
+  {
+  }
+
+  const byte *GetData() const { return m_Data; }
+  uint64_t GetSize() const { return m_Size; }
+  void AddRef() { Atomic::Inc32(&m_RefCount); }
+  void Release()
+  {
+    if(Atomic::Dec32(&m_RefCount) == 0)
+      delete this;
+  }
+
+private:
+  ~StreamMemory()
+  {
+    if(m_ReleaseCallback)
+      m_ReleaseCallback();
+  }
+
+  const byte *m_Data;
+  uint64_t m_Size;
+  std::function<void()> m_ReleaseCallback;
+  int32_t m_RefCount = 1;
+};
+
 class Compressor
 {
 public:
@@ -61,11 +96,106 @@ public:
   virtual bool Recompress(Compressor *comp) = 0;
   virtual bool Read(void *data, uint64_t numBytes) = 0;
 
+  // seek to an offset in the uncompressed data. Only supported when reading a seekable stream
+  virtual bool SetOffset(uint64_t offs);
+
 protected:
   StreamReader *m_Read;
   Ownership m_Ownership;
 };
 
+// Seekable compressed streams are made up of independently compressed blocks, each stored exactly
+// as it would be in the normal streaming format so that a sequential reader can consume them as-is.
+// After the last block comes a table of the compressed offset of each block, then a small footer.
+struct SeekableBlockIndex
+{
+  static const uint32_t Magic = MAKE_FOURCC('R', 'D', 'B', 'I');
+
+  // the compressed offset of each block relative to the start of the stream, with one extra entry
+  // at the end pointing to the end of the block data
+  rdcarray<uint64_t> offsets;
+  // the total size of the stream once decompressed
+  uint64_t uncompressedSize = 0;
+  // the uncompressed size of every block, except possibly the last
+  uint32_t blockSize = 0;
+
+  uint64_t NumBlocks() const { return offsets.empty() ? 0 : offsets.size() - 1; }
+  // appends the table and footer to the compressed stream
+  bool Write(StreamWriter *writer) const;
+  // reads the table and footer from the end of the compressed stream, then seeks back to the start
+  bool Read(StreamReader *reader);
+};
+
+// runs process(i) for i in [0, count) spread across the job workers, and returns once all items
+// have completed. Returns false if any item returned false.
+bool ParallelProcessBlocks(uint32_t count, std::function<bool(uint32_t)> process);
+
+// Writes a seekable compressed stream, compressing blocks on the shared job workers. Incoming data
+// is gathered into pages of several blocks which are each compressed by a job, and finished pages
+// are written out in order so the output is identical to a serial seekable compressor.
+class ParallelCompressor : public Compressor
+{
+public:
+  // compresses one block at a time. Codecs are reused between pages, but each is only used by one
+  // job at a time
+  class BlockCodec
+  {
+  public:
+    virtual ~BlockCodec() = default;
+    // appends the compressed block to out, framed exactly as the serial compressor would write it
+    virtual bool CompressBlock(const byte *src, uint64_t srcSize, bytebuf &out) = 0;
+  };
+
+  ParallelCompressor(StreamWriter *write, Ownership own, uint32_t blockSize, uint32_t numThreads,
+                     std::function<BlockCodec *()> createCodec);
+  ~ParallelCompressor();
+
+  bool Write(const void *data, uint64_t numBytes);
+  bool Finish();
+
+private:
+  enum PageState : int32_t
+  {
+    PageFree,
+    PageQueued,
+    PageCompressed,
+    PageFailed,
+  };
+
+  struct Page
+  {
+    byte *data = NULL;
+    uint64_t size = 0;
+    int32_t state = PageFree;
+    Threading::Jobs::Job job = NULL;
+    bytebuf compressed;
+    rdcarray<uint64_t> blockSizes;
+  };
+
+  bool SubmitPage();
+  bool WriteOldestPage();
+  void CompressPage(Page &page);
+  void WaitForPages();
+
+  uint32_t m_BlockSize;
+  uint64_t m_PageSize;
+  std::function<BlockCodec *()> m_CreateCodec;
+
+  // pages are used as a ring - filled on the writing thread, compressed by workers, then written
+  rdcarray<Page> m_Pages;
+  size_t m_FillPage = 0;
+  size_t m_OldestPage = 0;
+  size_t m_PagesInFlight = 0;
+
+  // codecs not in use by any job
+  Threading::CriticalSection m_CodecLock;
+  rdcarray<BlockCodec *> m_Codecs;
+
+  SeekableBlockIndex m_Index;
+  uint64_t m_CompressedOffset = 0;
+  bool m_Error = false;
+};
+
 class StreamReader
 {
 public:
@@ -82,6 +212,8 @@ public:
   StreamReader(StreamDummyType);
   StreamReader(const byte *buffer, uint64_t bufferSize);
   StreamReader(const bytebuf &buffer);
+  // reads size bytes at offset within memory, in place. The reader holds a reference on memory
+  StreamReader(StreamMemory *memory, uint64_t offset, uint64_t size);
 
   StreamReader(Network::Socket *sock, Ownership own);
   StreamReader(FILE *file, uint64_t fileSize, Ownership own);
@@ -229,6 +361,30 @@ public:
     return Read(&data, sizeof(T));
   }
 
+  // if the stream is held entirely in memory, returns a pointer to the next numBytes in place and
+  // skips over them. Returns NULL without reading anything if the data would have to be copied or
+  // isn't aligned to the given alignment. The pointer remains valid as long as the reader.
+  const byte *ReadInPlace(uint64_t numBytes, uint64_t alignment = 1)
+  {
+    if(numBytes == 0 || m_Dummy || m_HasError || !m_BufferBase || m_File || m_Sock ||
+       m_Decompressor || numBytes > Available() || (uintptr_t(m_BufferHead) % alignment) != 0)
+      return NULL;
+
+    const byte *ret = m_BufferHead;
+    m_BufferHead += numBytes;
+    return ret;
+  }
+
+  // returns true if ptr points into data that this reader holds in memory, as returned from
+  // ReadInPlace.
+  bool IsInPlace(const void *ptr) const
+  {
+    if(m_File || m_Sock || m_Decompressor || !m_BufferBase)
+      return false;
+
+    return ptr >= m_BufferBase && ptr < m_BufferBase + m_BufferSize;
+  }
+
   void AddCloseCallback(StreamCloseCallback callback) { m_Callbacks.push_back(callback); }
 private:
   inline uint64_t Available()
@@ -258,12 +414,18 @@ private:
   // file pointer, if we're reading from a file
   FILE *m_File = NULL;
 
+  // the offset in the file where our stream begins, for seeking
+  uint64_t m_FileBase = 0;
+
   // socket, if we're reading from a socket
   Network::Socket *m_Sock = NULL;
 
   // the decompressor, if reading from it
   Decompressor *m_Decompressor = NULL;
 
+  // external memory we're reading in place, if any. In that case we don't own m_BufferBase
+  StreamMemory *m_Memory = NULL;
+
   // the offset in the file/decompressor that corresponds to the start of m_BufferBase
   uint64_t m_ReadOffset = 0;
 
@@ -535,3 +697,11 @@ private:
 };
 
 void StreamTransfer(StreamWriter *writer, StreamReader *reader, RENDERDOC_ProgressCallback progress);
+
+// Writes count items to writer in order, formatting them on the job workers. Items are formatted
+// in batches by calling format(begin, end, out) to append items [begin, end) to out, and only a
+// few batches per thread are held at once so memory use doesn't grow with the amount of output.
+// Returns false if writing failed.
+bool StreamWriteOrdered(StreamWriter *writer, size_t count, size_t batchSize,
+                        std::function<void(size_t, size_t, rdcstr &)> format,
+                        RENDERDOC_ProgressCallback progress);
@@ -0,0 +1,170 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#pragma once
+
+#include "api/replay/structured_data.h"
+
+// A bump allocator for structured objects, owned by the SDFile they belong to. It also interns
+// strings so that names repeated across many objects share storage.
+//
+// Objects allocated from it are still destructed individually when the file is destroyed, since
+// their children lists and any non-interned strings own heap storage. Only the objects' own storage
+// is freed with the arena, a page at a time, which saves one allocation and free per object.
+struct SDObjectArena
+{
+  // returns the arena for a file, creating it on first use.
+  static SDObjectArena &Get(SDFile &file)
+  {
+    if(file.arena == NULL)
+    {
+      file.arena = new SDObjectArena;
+      file.freeArena = [](SDObjectArena *arena) { delete arena; };
+    }
+    return *file.arena;
+  }
+
+  // constructs an SDObject or SDChunk in the arena. The object is marked as owned by the arena so
+  // that deleting it only runs the destructor.
+  template <typename T, typename... ArgTypes>
+  T *New(ArgTypes &&... args)
+  {
+    byte *mem = (byte *)Allocate(sizeof(T) + SDObject::AllocHeaderSize);
+    *(uint64_t *)mem = 1;
+    T *ret = ::new(mem + SDObject::AllocHeaderSize) T(std::forward<ArgTypes>(args)...);
+    ret->m_Arena = this;
+    return ret;
+  }
+
+  SDObjectArena() = default;
+  ~SDObjectArena()
+  {
+    for(byte *page : m_Pages)
+      dealloc(page);
+  }
+  SDObjectArena(const SDObjectArena &) = delete;
+  SDObjectArena &operator=(const SDObjectArena &) = delete;
+
+  void *Allocate(size_t size)
+  {
+    // keep everything pointer aligned
+    size = (size + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+
+    if(size > size_t(m_End - m_Head))
+    {
+      // oversized allocations get a page to themselves so we don't waste the current page
+      if(size > PageSize / 4)
+      {
+        byte *page = (byte *)alloc(size);
+        m_Pages.push_back(page);
+        return page;
+      }
+
+      m_Head = (byte *)alloc(PageSize);
+      m_End = m_Head + PageSize;
+      m_Pages.push_back(m_Head);
+    }
+
+    void *ret = m_Head;
+    m_Head += size;
+    return ret;
+  }
+
+  // returns a string with the same contents whose storage is owned by the arena, so that it can be
+  // copied around without allocating.
+  rdcinflexiblestr Intern(const rdcstr &str)
+  {
+    // keep the table at most half full
+    if(m_NumStrings * 2 >= m_Strings.size())
+      Rehash(m_Strings.empty() ? 256 : m_Strings.size() * 2);
+
+    const size_t mask = m_Strings.size() - 1;
+
+    for(size_t i = Hash(str.c_str()) & mask;; i = (i + 1) & mask)
+    {
+      const char *s = m_Strings[i];
+
+      if(s == NULL)
+      {
+        char *copy = (char *)Allocate(str.size() + 1);
+        memcpy(copy, str.c_str(), str.size() + 1);
+        m_Strings[i] = copy;
+        m_NumStrings++;
+        return rdcliteral(copy, str.size());
+      }
+
+      if(!strcmp(s, str.c_str()))
+        return rdcliteral(s, str.size());
+    }
+  }
+
+private:
+  static const size_t PageSize = 256 * 1024;
+
+  static size_t Hash(const char *str)
+  {
+    // FNV-1a
+    uint64_t hash = 14695981039346656037ULL;
+    for(; *str; str++)
+      hash = (hash ^ (byte)*str) * 1099511628211ULL;
+    return (size_t)hash;
+  }
+
+  void Rehash(size_t size)
+  {
+    rdcarray<const char *> old;
+    old.swap(m_Strings);
+    m_Strings.resize(size);
+    for(const char *&s : m_Strings)
+      s = NULL;
+
+    for(const char *s : old)
+    {
+      if(s == NULL)
+        continue;
+
+      size_t i = Hash(s) & (size - 1);
+      while(m_Strings[i])
+        i = (i + 1) & (size - 1);
+      m_Strings[i] = s;
+    }
+  }
+
+  static void *alloc(size_t sz)
+  {
+    void *ret = malloc(sz);
+    if(ret == NULL)
+      RENDERDOC_OutOfMemory(sz);
+    return ret;
+  }
+  static void dealloc(void *p) { free(p); }
+
+  rdcarray<byte *> m_Pages;
+  byte *m_Head = NULL;
+  byte *m_End = NULL;
+
+  // open-addressed hash table of interned strings, always a power of two in size
+  rdcarray<const char *> m_Strings;
+  size_t m_NumStrings = 0;
+};
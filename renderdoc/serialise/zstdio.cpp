@@ -24,17 +24,21 @@
 
 #define ZSTD_STATIC_LINKING_ONLY
 #include "zstdio.h"
+#include "api/replay/stringise.h"
 
 static const uint64_t zstdBlockSize = 128 * 1024;
 static const uint64_t compressBlockSize = ZSTD_compressBound(zstdBlockSize);
 
-ZSTDCompressor::ZSTDCompressor(StreamWriter *write, Ownership own) : Compressor(write, own)
+ZSTDCompressor::ZSTDCompressor(StreamWriter *write, Ownership own, bool seekable)
+    : Compressor(write, own), m_Seekable(seekable)
 {
   m_Page = AllocAlignedBuffer(zstdBlockSize);
   m_CompressBuffer = AllocAlignedBuffer(compressBlockSize);
 
   m_PageOffset = 0;
 
+  m_Index.blockSize = (uint32_t)zstdBlockSize;
+
   m_Stream = ZSTD_createCStream();
 }
 
@@ -112,7 +116,24 @@ bool ZSTDCompressor::Finish()
   // only the last one can be smaller, so we only write a partial page when finishing.
   // Calling Write() after Finish() is illegal
 
-  return FlushPage();
+  if(!m_Seekable)
+    return FlushPage();
+
+  // seekable streams don't need a trailing empty block, and instead end with the block index
+  bool success = true;
+
+  if(m_PageOffset > 0)
+    success &= FlushPage();
+
+  // if we encountered a stream error this will be NULL
+  if(!m_CompressBuffer)
+    return false;
+
+  m_Index.offsets.push_back(m_CompressedOffset);
+
+  success &= m_Index.Write(m_Write);
+
+  return success;
 }
 
 bool ZSTDCompressor::FlushPage()
@@ -137,22 +158,32 @@ bool ZSTDCompressor::FlushPage()
   success &= m_Write->Write((uint32_t)out.pos);
   success &= m_Write->Write(m_CompressBuffer, out.pos);
 
+  // every frame is compressed independently, so all we need to do to be seekable is note where the
+  // block starts
+  if(m_Seekable)
+  {
+    m_Index.offsets.push_back(m_CompressedOffset);
+    m_Index.uncompressedSize += m_PageOffset;
+  }
+
+  m_CompressedOffset += sizeof(uint32_t) + out.pos;
+
   // start writing to the start of the page again
   m_PageOffset = 0;
 
   return success;
 }
 
-bool ZSTDCompressor::CompressZSTDFrame(ZSTD_inBuffer &in, ZSTD_outBuffer &out)
+static const int zstdCompressionLevel = 7;
+
+// compresses the whole input as a single independent frame
+static bool CompressFrame(ZSTD_CStream *stream, ZSTD_inBuffer &in, ZSTD_outBuffer &out)
 {
-  size_t err = ZSTD_initCStream(m_Stream, 7);
+  size_t err = ZSTD_initCStream(stream, zstdCompressionLevel);
 
   if(ZSTD_isError(err))
   {
     RDCERR("Error compressing: %s", ZSTD_getErrorName(err));
-    FreeAlignedBuffer(m_Page);
-    FreeAlignedBuffer(m_CompressBuffer);
-    m_Page = m_CompressBuffer = NULL;
     return false;
   }
 
@@ -162,7 +193,7 @@ bool ZSTDCompressor::CompressZSTDFrame(ZSTD_inBuffer &in, ZSTD_outBuffer &out)
     size_t inpos = in.pos;
     size_t outpos = out.pos;
 
-    err = ZSTD_compressStream(m_Stream, &out, &in);
+    err = ZSTD_compressStream(stream, &out, &in);
 
     if(ZSTD_isError(err) || (inpos == in.pos && outpos == out.pos))
     {
@@ -170,14 +201,11 @@ bool ZSTDCompressor::CompressZSTDFrame(ZSTD_inBuffer &in, ZSTD_outBuffer &out)
         RDCERR("Error compressing: %s", ZSTD_getErrorName(err));
       else
         RDCERR("Error compressing, no progress made");
-      FreeAlignedBuffer(m_Page);
-      FreeAlignedBuffer(m_CompressBuffer);
-      m_Page = m_CompressBuffer = NULL;
       return false;
     }
   }
 
-  err = ZSTD_endStream(m_Stream, &out);
+  err = ZSTD_endStream(stream, &out);
 
   if(ZSTD_isError(err) || err != 0)
   {
@@ -185,6 +213,16 @@ bool ZSTDCompressor::CompressZSTDFrame(ZSTD_inBuffer &in, ZSTD_outBuffer &out)
       RDCERR("Error compressing: %s", ZSTD_getErrorName(err));
     else
       RDCERR("Error compressing, couldn't end stream");
+    return false;
+  }
+
+  return true;
+}
+
+bool ZSTDCompressor::CompressZSTDFrame(ZSTD_inBuffer &in, ZSTD_outBuffer &out)
+{
+  if(!CompressFrame(m_Stream, in, out))
+  {
     FreeAlignedBuffer(m_Page);
     FreeAlignedBuffer(m_CompressBuffer);
     m_Page = m_CompressBuffer = NULL;
@@ -194,7 +232,47 @@ bool ZSTDCompressor::CompressZSTDFrame(ZSTD_inBuffer &in, ZSTD_outBuffer &out)
   return true;
 }
 
-ZSTDDecompressor::ZSTDDecompressor(StreamReader *read, Ownership own) : Decompressor(read, own)
+class ZSTDBlockCodec : public ParallelCompressor::BlockCodec
+{
+public:
+  ZSTDBlockCodec() { m_Stream = ZSTD_createCStream(); }
+  ~ZSTDBlockCodec() { ZSTD_freeCStream(m_Stream); }
+  bool CompressBlock(const byte *src, uint64_t srcSize, bytebuf &out)
+  {
+    const size_t offs = out.size();
+    const size_t outSize = RDCMAX((size_t)compressBlockSize, ZSTD_CStreamOutSize());
+    out.resize(offs + sizeof(uint32_t) + outSize);
+
+    // same as ZSTDCompressor - one frame per block prefixed with its compressed size
+    ZSTD_inBuffer in = {src, (size_t)srcSize, 0};
+    ZSTD_outBuffer outBuf = {out.data() + offs + sizeof(uint32_t), outSize, 0};
+
+    if(!CompressFrame(m_Stream, in, outBuf))
+    {
+      out.resize(offs);
+      return false;
+    }
+
+    uint32_t compSize = (uint32_t)outBuf.pos;
+    memcpy(out.data() + offs, &compSize, sizeof(compSize));
+    out.resize(offs + sizeof(compSize) + compSize);
+
+    return true;
+  }
+
+private:
+  ZSTD_CStream *m_Stream;
+};
+
+ZSTDParallelCompressor::ZSTDParallelCompressor(StreamWriter *write, Ownership own,
+                                               uint32_t numThreads)
+    : ParallelCompressor(write, own, (uint32_t)zstdBlockSize, numThreads,
+                         []() { return new ZSTDBlockCodec(); })
+{
+}
+
+ZSTDDecompressor::ZSTDDecompressor(StreamReader *read, Ownership own, bool seekable)
+    : Decompressor(read, own), m_Seekable(seekable)
 {
   m_Page = AllocAlignedBuffer(zstdBlockSize);
   m_CompressBuffer = AllocAlignedBuffer(compressBlockSize);
@@ -203,6 +281,20 @@ ZSTDDecompressor::ZSTDDecompressor(StreamReader *read, Ownership own) : Decompre
   m_PageLength = 0;
 
   m_Stream = ZSTD_createDStream();
+
+  if(m_Seekable)
+  {
+    if(!m_Index.Read(m_Read))
+    {
+      RDCERR("Couldn't read block index for seekable Zstd stream");
+      FreeBuffers();
+    }
+    else if(m_Index.blockSize != zstdBlockSize)
+    {
+      RDCERR("Unexpected block size %u in seekable Zstd stream", m_Index.blockSize);
+      FreeBuffers();
+    }
+  }
 }
 
 ZSTDDecompressor::~ZSTDDecompressor()
@@ -216,7 +308,8 @@ bool ZSTDDecompressor::Recompress(Compressor *comp)
 {
   bool success = true;
 
-  while(success && !m_Read->AtEnd())
+  // seekable streams have the block index after the last block, so we can't just read to the end
+  while(success && (m_Seekable ? m_Block < m_Index.NumBlocks() : !m_Read->AtEnd()))
   {
     success &= FillPage();
     if(success)
@@ -264,6 +357,25 @@ bool ZSTDDecompressor::Read(void *data, uint64_t numBytes)
 
   while(success && numBytes > 0)
   {
+    // see LZ4Decompressor::Read - runs of whole blocks are decompressed directly in parallel
+    if(m_Seekable && numBytes >= 2 * zstdBlockSize && m_Block + 1 < m_Index.NumBlocks())
+    {
+      uint64_t numBlocks = RDCMIN(numBytes / zstdBlockSize, m_Index.NumBlocks() - 1 - m_Block);
+
+      success &= ReadBlocksParallel(dst, numBlocks);
+
+      if(!success)
+        return success;
+
+      dst += numBlocks * zstdBlockSize;
+      numBytes -= numBlocks * zstdBlockSize;
+
+      // the page no longer holds the block before m_Block, so it can't be used
+      m_PageOffset = m_PageLength = 0;
+
+      continue;
+    }
+
     success &= FillPage();
 
     if(!success)
@@ -286,14 +398,165 @@ bool ZSTDDecompressor::Read(void *data, uint64_t numBytes)
   return success;
 }
 
+bool ZSTDDecompressor::SetOffset(uint64_t offs)
+{
+  if(!m_Seekable)
+    return Decompressor::SetOffset(offs);
+
+  // if we encountered a stream error this will be NULL
+  if(!m_CompressBuffer)
+    return false;
+
+  if(offs > m_Index.uncompressedSize)
+  {
+    RDCERR("Seeking to %llu past the end of the stream (%llu bytes)", offs,
+           m_Index.uncompressedSize);
+    return false;
+  }
+
+  const uint64_t block = offs / zstdBlockSize;
+
+  // if we already have this block decompressed we can just move within it
+  if(m_PageLength > 0 && block + 1 == m_Block)
+  {
+    m_PageOffset = offs - block * zstdBlockSize;
+    return true;
+  }
+
+  m_Block = block;
+  m_PageOffset = m_PageLength = 0;
+
+  // nothing to decompress if we're seeking to the end of a stream that finishes on a block boundary
+  if(block == m_Index.NumBlocks())
+    return true;
+
+  m_Read->SetOffset(m_Index.offsets[block]);
+
+  if(m_Read->IsErrored())
+  {
+    RDCERR("Error seeking to block %llu", block);
+    FreeBuffers();
+    return false;
+  }
+
+  if(!FillPage())
+    return false;
+
+  m_PageOffset = offs - block * zstdBlockSize;
+
+  return true;
+}
+
+bool ZSTDDecompressor::ReadBlocksParallel(byte *dst, uint64_t numBlocks)
+{
+  // bound how much compressed data we read in at once
+  const uint64_t maxBatchBlocks = 128;
+
+  while(numBlocks > 0)
+  {
+    const uint64_t batchBlocks = RDCMIN(numBlocks, maxBatchBlocks);
+    const uint64_t firstBlock = m_Block;
+    const uint64_t compStart = m_Index.offsets[firstBlock];
+    const uint64_t compLength = m_Index.offsets[firstBlock + batchBlocks] - compStart;
+
+    // blocks are read in order, so the underlying stream is already at the first one
+    RDCASSERTEQUAL(m_Read->GetOffset(), compStart);
+
+    // if the compressed data is already in memory, e.g. in a mapped file, decompress it in place
+    const byte *compData = m_Read->ReadInPlace(compLength);
+
+    if(!compData)
+    {
+      m_Staging.resize((size_t)compLength);
+
+      if(!m_Read->Read(m_Staging.data(), compLength))
+      {
+        RDCERR("Error reading %llu compressed blocks", batchBlocks);
+        FreeBuffers();
+        return false;
+      }
+
+      compData = m_Staging.data();
+    }
+
+    bool success = ParallelProcessBlocks(
+        (uint32_t)batchBlocks, [this, dst, compData, firstBlock, compStart](uint32_t i) {
+          const uint64_t blockStart = m_Index.offsets[firstBlock + i] - compStart;
+          const uint64_t blockLength = m_Index.offsets[firstBlock + i + 1] - compStart - blockStart;
+
+          uint32_t compSize = 0;
+
+          if(blockLength < sizeof(compSize))
+            return false;
+
+          memcpy(&compSize, compData + blockStart, sizeof(compSize));
+
+          if(uint64_t(compSize) + sizeof(compSize) != blockLength)
+            return false;
+
+          // each thread needs its own context, so use the simple one-shot API
+          size_t decompSize =
+              ZSTD_decompress(dst + i * zstdBlockSize, zstdBlockSize,
+                              compData + blockStart + sizeof(compSize), compSize);
+
+          return !ZSTD_isError(decompSize) && decompSize == zstdBlockSize;
+        });
+
+    if(!success)
+    {
+      RDCERR("Error decompressing blocks %llu to %llu", firstBlock, firstBlock + batchBlocks - 1);
+      FreeBuffers();
+      return false;
+    }
+
+    m_Block += batchBlocks;
+    dst += batchBlocks * zstdBlockSize;
+    numBlocks -= batchBlocks;
+  }
+
+  return true;
+}
+
+void ZSTDDecompressor::FreeBuffers()
+{
+  FreeAlignedBuffer(m_Page);
+  FreeAlignedBuffer(m_CompressBuffer);
+  m_Page = m_CompressBuffer = NULL;
+}
+
 bool ZSTDDecompressor::FillPage()
 {
   uint32_t compSize = 0;
 
   bool success = true;
 
+  if(m_Seekable && m_Block >= m_Index.NumBlocks())
+  {
+    RDCERR("Reading past the last block in seekable stream");
+    FreeBuffers();
+    return false;
+  }
+
   success &= m_Read->Read(compSize);
-  success &= m_Read->Read(m_CompressBuffer, compSize);
+
+  if(compSize > compressBlockSize)
+  {
+    RDCERR("Error reading size: %u", compSize);
+    success = false;
+  }
+
+  const byte *compData = NULL;
+
+  if(success)
+  {
+    compData = m_Read->ReadInPlace(compSize);
+
+    if(!compData)
+    {
+      success &= m_Read->Read(m_CompressBuffer, compSize);
+      compData = m_CompressBuffer;
+    }
+  }
 
   if(!success)
   {
@@ -314,7 +577,7 @@ bool ZSTDDecompressor::FillPage()
     return false;
   }
 
-  ZSTD_inBuffer in = {m_CompressBuffer, compSize, 0};
+  ZSTD_inBuffer in = {compData, compSize, 0};
   ZSTD_outBuffer out = {m_Page, zstdBlockSize, 0};
 
   // keep calling compressStream until everything is consumed
@@ -341,5 +604,8 @@ bool ZSTDDecompressor::FillPage()
   m_PageOffset = 0;
   m_PageLength = out.pos;
 
+  if(m_Seekable)
+    m_Block++;
+
   return success;
 }
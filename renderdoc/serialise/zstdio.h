@@ -30,7 +30,8 @@
 class ZSTDCompressor : public Compressor
 {
 public:
-  ZSTDCompressor(StreamWriter *write, Ownership own);
+  // if seekable is true, a block index is written on Finish() - see SeekableBlockIndex
+  ZSTDCompressor(StreamWriter *write, Ownership own, bool seekable = false);
   ~ZSTDCompressor();
 
   bool Write(const void *data, uint64_t numBytes);
@@ -45,25 +46,46 @@ private:
   byte *m_CompressBuffer;
   uint64_t m_PageOffset;
 
+  bool m_Seekable;
+  uint64_t m_CompressedOffset = 0;
+  SeekableBlockIndex m_Index;
+
   ZSTD_CStream *m_Stream;
 };
 
+// writes the same seekable stream as ZSTDCompressor, with blocks compressed on worker threads
+class ZSTDParallelCompressor : public ParallelCompressor
+{
+public:
+  ZSTDParallelCompressor(StreamWriter *write, Ownership own, uint32_t numThreads);
+};
+
 class ZSTDDecompressor : public Decompressor
 {
 public:
-  ZSTDDecompressor(StreamReader *read, Ownership own);
+  // seekable must match how the stream was compressed
+  ZSTDDecompressor(StreamReader *read, Ownership own, bool seekable = false);
   ~ZSTDDecompressor();
 
   bool Recompress(Compressor *comp);
   bool Read(void *data, uint64_t numBytes);
+  bool SetOffset(uint64_t offs);
 
 private:
   bool FillPage();
+  bool ReadBlocksParallel(byte *dst, uint64_t numBlocks);
+  void FreeBuffers();
 
   byte *m_Page;
   byte *m_CompressBuffer;
   uint64_t m_PageOffset;
   uint64_t m_PageLength;
 
+  bool m_Seekable;
+  // the next block that FillPage will decompress, when seekable
+  uint64_t m_Block = 0;
+  SeekableBlockIndex m_Index;
+  bytebuf m_Staging;
+
   ZSTD_DStream *m_Stream;
 };
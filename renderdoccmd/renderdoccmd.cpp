@@ -26,7 +26,9 @@
 #include "renderdoccmd.h"
 #include <app/renderdoc_app.h>
 #include <replay/version.h>
+#include <chrono>
 #include <string>
+#include <thread>
 
 rdcstr conv(const std::string &s)
 {
@@ -450,6 +452,161 @@ public:
   }
 };
 
+struct CallStatsCommand : public Command
+{
+private:
+  std::string host;
+  uint32_t ident = 0;
+  uint32_t interval = 1000;
+  uint32_t count = 0;
+  uint32_t top = 20;
+
+  struct Totals
+  {
+    uint64_t calls = 0;
+    double totalMicroseconds = 0.0;
+    double driverMicroseconds = 0.0;
+    uint64_t serialisedBytes = 0;
+  };
+
+  // entry point name and whether the calls were made while capturing
+  typedef std::pair<std::string, bool> EntryKey;
+  typedef std::pair<EntryKey, Totals> EntryDelta;
+
+public:
+  CallStatsCommand() : Command() {}
+  virtual void AddOptions(cmdline::parser &parser)
+  {
+    parser.add<std::string>("host", 'h',
+                            "The host the target is running on. By default the local machine.",
+                            false, "");
+    parser.add<uint32_t>(
+        "ident", 'i', "The target control ident to connect to. By default the first one found.",
+        false, 0);
+    parser.add<uint32_t>("interval", 0, "The time in milliseconds between polls.", false, 1000);
+    parser.add<uint32_t>(
+        "count", 'n', "The number of polls to make. Default is 0, which polls until disconnected.",
+        false, 0);
+    parser.add<uint32_t>("top", 't', "The number of entry points listed for each poll.", false, 20);
+  }
+  virtual const char *Description()
+  {
+    return "Polls a running application for the overhead added to each intercepted API call.";
+  }
+  virtual bool IsInternalOnly() { return false; }
+  virtual bool IsCaptureCommand() { return false; }
+  virtual bool Parse(cmdline::parser &parser, GlobalEnvironment &)
+  {
+    host = parser.get<std::string>("host");
+    ident = parser.get<uint32_t>("ident");
+    interval = parser.get<uint32_t>("interval");
+    count = parser.get<uint32_t>("count");
+    top = parser.get<uint32_t>("top");
+    return true;
+  }
+  virtual int Execute(const CaptureOptions &)
+  {
+    if(ident == 0)
+      ident = RENDERDOC_EnumerateRemoteTargets(conv(host), 0);
+
+    if(ident == 0)
+    {
+      std::cerr << "Couldn't find a running target to connect to." << std::endl;
+      return 1;
+    }
+
+    ITargetControl *control =
+        RENDERDOC_CreateTargetControl(conv(host), ident, "renderdoccmd", true);
+
+    if(!control)
+    {
+      std::cerr << "Couldn't connect to target control ident " << ident << "." << std::endl;
+      return 1;
+    }
+
+    std::cout << "Connected to " << control->GetTarget() << " (PID " << control->GetPID() << ")"
+              << std::endl;
+
+    control->SetCallStatisticsEnabled(true);
+
+    // the target reports totals since counting was first enabled, so keep the previous totals to
+    // print what changed in each interval
+    std::map<EntryKey, Totals> previous;
+
+    for(uint32_t poll = 0; count == 0 || poll < count; poll++)
+    {
+      std::this_thread::sleep_for(std::chrono::milliseconds(interval));
+
+      control->RequestCallStatistics();
+
+      TargetControlMessage msg;
+      do
+      {
+        msg = control->ReceiveMessage(NULL);
+      } while(msg.type != TargetControlMessageType::CallStatistics &&
+              msg.type != TargetControlMessageType::Disconnected);
+
+      if(msg.type == TargetControlMessageType::Disconnected)
+      {
+        std::cerr << "Target disconnected." << std::endl;
+        break;
+      }
+
+      std::vector<EntryDelta> deltas;
+
+      for(const APICallStatistics &stats : msg.callStatistics)
+      {
+        EntryKey key = {conv(stats.name), stats.capturing};
+
+        Totals &prev = previous[key];
+
+        Totals delta;
+        delta.calls = stats.callCount - prev.calls;
+        delta.totalMicroseconds = stats.totalMicroseconds - prev.totalMicroseconds;
+        delta.driverMicroseconds = stats.driverMicroseconds - prev.driverMicroseconds;
+        delta.serialisedBytes = stats.serialisedBytes - prev.serialisedBytes;
+
+        prev.calls = stats.callCount;
+        prev.totalMicroseconds = stats.totalMicroseconds;
+        prev.driverMicroseconds = stats.driverMicroseconds;
+        prev.serialisedBytes = stats.serialisedBytes;
+
+        if(delta.calls > 0)
+          deltas.push_back({key, delta});
+      }
+
+      std::sort(deltas.begin(), deltas.end(), [](const EntryDelta &a, const EntryDelta &b) {
+        return a.second.totalMicroseconds > b.second.totalMicroseconds;
+      });
+
+      if(deltas.size() > top)
+        deltas.resize(top);
+
+      char line[256];
+
+      std::cout << std::endl << "Most expensive entry points over the last " << interval
+                << "ms (* while capturing):" << std::endl;
+      snprintf(line, sizeof(line), "  %-48s %10s %12s %12s %12s", "Entry point", "Calls",
+               "Total ms", "Driver ms", "Serialised KB");
+      std::cout << line << std::endl;
+
+      for(const EntryDelta &d : deltas)
+      {
+        std::string name = d.first.first + (d.first.second ? " *" : "");
+        snprintf(line, sizeof(line), "  %-48s %10llu %12.3f %12.3f %12.1f", name.c_str(),
+                 (unsigned long long)d.second.calls, d.second.totalMicroseconds / 1000.0,
+                 d.second.driverMicroseconds / 1000.0, double(d.second.serialisedBytes) / 1024.0);
+        std::cout << line << std::endl;
+      }
+    }
+
+    control->SetCallStatisticsEnabled(false);
+    control->Shutdown();
+
+    return 0;
+  }
+};
+
 struct RemoteServerCommand : public Command
 {
 private:
@@ -1547,6 +1704,7 @@ int renderdoccmd(GlobalEnvironment &env, std::vector<std::string> &argv)
     add_command("thumb", new ThumbCommand());
     add_command("capture", new CaptureCommand());
     add_command("inject", new InjectCommand());
+    add_command("callstats", new CallStatsCommand());
     add_command("remoteserver", new RemoteServerCommand());
     add_command("replay", new ReplayCommand());
     add_command("capaltbit", new CapAltBitCommand());
@@ -1630,6 +1788,11 @@ int renderdoccmd(GlobalEnvironment &env, std::vector<std::string> &argv)
               "Capturing Option: In D3D11, record all command lists from application start.");
     }
 
+    cmd.add<std::string>("profile-trace", 0,
+                         "Record internal profile regions while the command runs, and write them "
+                         "to the given file as Chrome trace JSON when it finishes.",
+                         false);
+
     cmd.parse_check(argv, true);
 
     CaptureOptions opts;
@@ -1674,10 +1837,18 @@ int renderdoccmd(GlobalEnvironment &env, std::vector<std::string> &argv)
       return 1;
     }
 
+    std::string profileTrace = cmd.get<std::string>("profile-trace");
+
+    if(!profileTrace.empty())
+      RENDERDOC_SetProfileRecording(true);
+
     RENDERDOC_InitialiseReplay(env, convertArgs(cmd.rest()));
 
     int ret = it->second->Execute(opts);
 
+    if(!profileTrace.empty())
+      RENDERDOC_WriteProfileTrace(conv(profileTrace));
+
     RENDERDOC_ShutdownReplay();
 
     clean_up();
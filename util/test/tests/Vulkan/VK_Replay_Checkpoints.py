@@ -0,0 +1,72 @@
+import renderdoc as rd
+import rdtest
+
+
+class VK_Replay_Checkpoints(rdtest.TestCase):
+    demos_test_name = 'VK_Draw_Zoo'
+
+    def get_leaf_actions(self, actions, ret):
+        for action in actions:
+            if len(action.children) > 0:
+                self.get_leaf_actions(action.children, ret)
+            else:
+                ret.append(action)
+
+    def get_contents(self, action: rd.ActionDescription):
+        self.controller.SetFrameEvent(action.eventId, False)
+
+        ret = {}
+
+        resources = list(action.outputs) + [action.depthOut, action.copyDestination]
+
+        for res in resources:
+            if res == rd.ResourceId.Null() or res in ret:
+                continue
+
+            tex = self.get_texture(res)
+
+            if tex is not None:
+                data = b''
+                for mip in range(tex.mips):
+                    data += self.controller.GetTextureData(res, rd.Subresource(mip, 0, 0))
+                ret[res] = data
+            else:
+                ret[res] = self.controller.GetBufferData(res, 0, 0)
+
+        return ret
+
+    def check_capture(self):
+        actions = []
+        self.get_leaf_actions(self.controller.GetRootActions(), actions)
+
+        interval = rd.SetConfigSetting('Vulkan_ReplayCheckpointInterval')
+        prev_interval = interval.data.basic.u
+
+        try:
+            # reference contents, every event replays from the start of the frame
+            interval.data.basic.u = 0
+
+            reference = {}
+            for action in actions:
+                reference[action.eventId] = self.get_contents(action)
+
+            # replay again with a checkpoint every few events. Going backwards first means the
+            # checkpoints are created on the way and then restored, and the interleaved order after
+            # that jumps in both directions between them
+            interval.data.basic.u = 4
+
+            interleaved = actions[0::2] + list(reversed(actions[1::2]))
+
+            for order in [list(reversed(actions)), actions, interleaved]:
+                for action in order:
+                    contents = self.get_contents(action)
+
+                    for res, data in reference[action.eventId].items():
+                        if contents.get(res) != data:
+                            raise rdtest.TestFailureException(
+                                "Contents of {} at event {} differ with replay checkpoints".format(
+                                    res, action.eventId))
+        finally:
+            interval.data.basic.u = prev_interval
+
+        rdtest.log.success("Resource contents match with and without replay checkpoints")